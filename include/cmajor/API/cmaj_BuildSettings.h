@@ -44,6 +44,15 @@ struct BuildSettings
     bool         shouldUseFastMaths() const                { return getOptimisationLevel() >= 4; }
     std::string  getMainProcessor() const                  { return getWithDefault (mainProcessorMember, ""); }
     double       getTransformTimeout() const               { return getWithDefault (transformTimeoutMember, defaultTransformTimeout); }
+    bool         shouldCacheObjectCode() const             { return getWithDefault (cacheObjectCodeMember, false); }
+    uint32_t     getSparseStreamSettleFrames() const       { return getWithRangeCheck (sparseStreamSettleFramesMember, 0u, 1u << 24, 0u); }
+    std::string  getTargetCPU() const                      { return getWithDefault (targetCPUMember, ""); }
+    std::string  getTargetFeatures() const                 { return getWithDefault (targetFeaturesMember, ""); }
+    bool         shouldProfileNodes() const                { return getWithDefault (profileNodesMember, false); }
+    bool         shouldUseDynamicFrequency() const         { return getWithDefault (dynamicFrequencyMember, false); }
+    bool         shouldUseTieredCompilation() const        { return getWithDefault (tieredCompilationMember, false); }
+    uint32_t     getNumCompileThreads() const              { return getWithRangeCheck (compileThreadsMember, 0u, 1024u, 0u); }
+    bool         shouldCompileHandlersLazily() const       { return getWithDefault (lazyHandlersMember, false); }
 
     BuildSettings& setMaxFrequency (double f)              { setProperty (maxFrequencyMember, f); return *this; }
     BuildSettings& setFrequency (double f)                 { setProperty (frequencyMember, f); return *this; }
@@ -57,6 +66,63 @@ struct BuildSettings
     BuildSettings& setDebugFlag (bool b)                   { setProperty (debugMember, b); return *this; }
     BuildSettings& setMainProcessor (std::string_view s)   { setProperty (mainProcessorMember, s); return *this; }
     BuildSettings& setTransformTimeout (double f)          { setProperty (transformTimeoutMember, f); return *this; }
+    BuildSettings& setCacheObjectCode (bool b)             { setProperty (cacheObjectCodeMember, b); return *this; }
+
+    /// If this is non-zero, graph nodes whose input and output streams have all been silent
+    /// (i.e. every element within +/-1.0e-6) for this many frames stop being run until an input
+    /// stream becomes non-silent or one of their input event handlers is called. While a node
+    /// sleeps its outputs are zero and its state is frozen, so a node with a long inaudible tail
+    /// will be cut short, which is why this is off (zero) by default. Only nodes that have both
+    /// input and output streams, no output events, and whose streams are all scalars or vectors/
+    /// arrays of up to 16 elements can sleep - any other node is always run.
+    /// The command-line tool sets this with --sparseStreamSettleFrames.
+    BuildSettings& setSparseStreamSettleFrames (uint32_t numFrames) { setProperty (sparseStreamSettleFramesMember, static_cast<int32_t> (numFrames)); return *this; }
+
+    /// Selects the CPU that native code is built for. This can be "host" (the default) to
+    /// use the CPU and features of the machine doing the build, "baseline" for the most
+    /// generic CPU of the target's architecture, or the name of a specific CPU (e.g.
+    /// "haswell", "znver3", "apple-m1", "x86-64-v3").
+    BuildSettings& setTargetCPU (std::string_view cpu)     { setProperty (targetCPUMember, cpu); return *this; }
+
+    /// A comma-separated list of extra CPU features to enable or disable on top of
+    /// those of the target CPU, e.g. "+avx2,+fma,-avx512f"
+    BuildSettings& setTargetFeatures (std::string_view f)  { setProperty (targetFeaturesMember, f); return *this; }
+
+    /// If enabled, the main graph counts the CPU cycles and number of calls for each of
+    /// its nodes, which can be read with Performer::getNodeProfile(). This is only supported
+    /// by the LLVM JIT engine, and adds a small overhead to each node.
+    BuildSettings& setNodeProfiling (bool b)               { setProperty (profileNodesMember, b); return *this; }
+
+    /// If enabled, the processor frequency and period are not compiled into the code as
+    /// constants, but are held as state which is set from the frequency when each performer
+    /// is created. This means that one linked program can be used to create performers at
+    /// any sample rate (by changing the frequency with Engine::setBuildSettings() before
+    /// calling Engine::createPerformer()), at the cost of some constant-folding.
+    BuildSettings& setDynamicFrequency (bool b)            { setProperty (dynamicFrequencyMember, b); return *this; }
+
+    /// If enabled, the LLVM JIT first links a quickly-compiled, unoptimised version of the
+    /// program so that performers can start running straight away, and then builds the
+    /// code at the requested optimisation level on a background thread. Running performers
+    /// switch over to the optimised code at the start of a block once it's ready.
+    BuildSettings& setTieredCompilation (bool b)           { setProperty (tieredCompilationMember, b); return *this; }
+
+    /// Sets how many threads the LLVM JIT can use to generate machine code. If this is more
+    /// than 1, large programs are split into several modules which are compiled concurrently.
+    /// Zero (the default) or 1 compiles everything as a single module on the calling thread.
+    BuildSettings& setNumCompileThreads (uint32_t n)       { setProperty (compileThreadsMember, static_cast<int32_t> (n)); return *this; }
+
+    /// If enabled, the LLVM JIT only compiles the code for rendering and initialisation
+    /// while linking. The functions that handle input events and values are compiled
+    /// afterwards on a background thread, and Performer::prefetchEndpoint() can be used to
+    /// move particular endpoints to the front of the queue. The rendering thread never waits
+    /// for them, so any value or event sent to an endpoint before its handler is ready is
+    /// held back and delivered once it has been compiled. Each handler can hold as many
+    /// calls as the event buffer size, and any more than that are dropped and counted as
+    /// xruns.
+    BuildSettings& setLazyHandlerCompilation (bool b)      { setProperty (lazyHandlersMember, b); return *this; }
+
+    static constexpr auto hostTargetCPU     = "host";
+    static constexpr auto baselineTargetCPU = "baseline";
 
     void reset()                                           { settings = choc::value::Value(); }
 
@@ -131,6 +197,15 @@ private:
     static constexpr auto debugMember              = "debug";
     static constexpr auto mainProcessorMember      = "mainProcessor";
     static constexpr auto transformTimeoutMember   = "transformTimeout";
+    static constexpr auto cacheObjectCodeMember    = "cacheObjectCode";
+    static constexpr auto sparseStreamSettleFramesMember = "sparseStreamSettleFrames";
+    static constexpr auto targetCPUMember          = "targetCPU";
+    static constexpr auto targetFeaturesMember     = "targetFeatures";
+    static constexpr auto profileNodesMember       = "profileNodes";
+    static constexpr auto dynamicFrequencyMember   = "dynamicFrequency";
+    static constexpr auto tieredCompilationMember  = "tieredCompilation";
+    static constexpr auto compileThreadsMember     = "compileThreads";
+    static constexpr auto lazyHandlersMember       = "lazyHandlers";
 
     template <typename Type>
     Type getWithDefault (std::string_view name, Type defaultValue) const
@@ -108,15 +108,15 @@ inline choc::value::Value convertAudioDataToObject (choc::buffer::ChannelArrayVi
     return createAudioFileObject (choc::buffer::createValueViewFromBuffer (scratchBuffer.interleave (source)), sampleRate);
 }
 
-/// Attempts to load the contents of an audio file into a choc::value::Value,
-/// so that it can be passed into an engine as an external variable.
+/// Decodes an audio file, applying any "resample" and "sourceChannel" properties
+/// that the annotation contains.
 /// On success, returns an empty string, or an error message on failure.
-inline std::string readAudioFileAsValue (choc::value::Value& result,
-                                         const choc::audio::AudioFileFormatList& fileFormatList,
-                                         std::shared_ptr<std::istream> fileReader,
-                                         const choc::value::ValueView& annotation,
-                                         uint32_t maxNumChannels = 16,
-                                         uint64_t maxNumFrames = 48000 * 100)
+inline std::string readAudioFileData (choc::audio::AudioFileData& result,
+                                      const choc::audio::AudioFileFormatList& fileFormatList,
+                                      std::shared_ptr<std::istream> fileReader,
+                                      const choc::value::ValueView& annotation,
+                                      uint32_t maxNumChannels = 16,
+                                      uint64_t maxNumFrames = 48000 * 100)
 {
     try
     {
@@ -149,6 +149,34 @@ inline std::string readAudioFileAsValue (choc::value::Value& result,
             data.frames = std::move (extractedChannel);
         }
 
+        result = std::move (data);
+    }
+    catch (const std::exception& e)
+    {
+        return e.what();
+    }
+
+    return {};
+}
+
+/// Attempts to load the contents of an audio file into a choc::value::Value,
+/// so that it can be passed into an engine as an external variable.
+/// On success, returns an empty string, or an error message on failure.
+inline std::string readAudioFileAsValue (choc::value::Value& result,
+                                         const choc::audio::AudioFileFormatList& fileFormatList,
+                                         std::shared_ptr<std::istream> fileReader,
+                                         const choc::value::ValueView& annotation,
+                                         uint32_t maxNumChannels = 16,
+                                         uint64_t maxNumFrames = 48000 * 100)
+{
+    choc::audio::AudioFileData data;
+    auto error = readAudioFileData (data, fileFormatList, std::move (fileReader), annotation, maxNumChannels, maxNumFrames);
+
+    if (! error.empty())
+        return error;
+
+    try
+    {
         result = convertAudioDataToObject (data.frames, data.sampleRate);
 
         if (result.isVoid())
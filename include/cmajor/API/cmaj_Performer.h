@@ -115,6 +115,13 @@ struct Performer
     template <typename ValueType>
     Result addInputEvent (EndpointHandle, uint32_t typeIndex, const ValueType& eventValue);
 
+    /// Adds a list of timestamped events to the queue for an input event endpoint.
+    /// This function must only be called on the rendering thread, after setBlockSize() and
+    /// before advance(). The events must be in ascending order of frame offset, and each one
+    /// will be delivered at that frame within the next block, without the caller needing to
+    /// split the block. See PerformerInterface::addInputEvents() for more details.
+    Result addInputEvents (EndpointHandle, const TimestampedEvent* events, uint32_t numEvents);
+
     /// Copies-out the frame data from an output stream endpoint.
     /// This function must only be called on the rendering thread, after a call to advance().
     /// The handle must have been obtained by calling getEndpointHandle() before the program is linked.
@@ -183,6 +190,19 @@ struct Performer
     /// If there has been a runtime error, this returns the message, or nullptr if there isn't one.
     const char* getRuntimeError() const;
 
+    /// If the program was built with node profiling enabled, this returns an array of objects with
+    /// the properties "node", "cycles" and "calls". Otherwise it returns a void value.
+    /// See PerformerInterface::getNodeProfile() for more details.
+    choc::value::Value getNodeProfile() const;
+
+    /// Asks for the code that handles an input endpoint to be compiled soon, if it's being
+    /// compiled lazily. See PerformerInterface::prefetchEndpoint() for more details.
+    void prefetchEndpoint (EndpointHandle) const;
+
+    /// Returns true if this is a tiered build which hasn't yet switched over to its optimised
+    /// code. See PerformerInterface::isRunningQuickTier() for more details.
+    bool isRunningQuickTier() const;
+
     //==============================================================================
     /// The underlying performer that this helper object is wrapping.
     PerformerPtr performer;
@@ -307,6 +327,12 @@ Result Performer::addInputEvent (EndpointHandle e, uint32_t type, const ValueTyp
     }
 }
 
+inline Result Performer::addInputEvents (EndpointHandle endpoint, const TimestampedEvent* events, uint32_t numEvents)
+{
+    EventBatch batch { events, numEvents };
+    return performer->addInputEvents (endpoint, std::addressof (batch));
+}
+
 inline Result Performer::copyOutputValue (EndpointHandle endpoint, void* dest) const
 {
     return performer->copyOutputValue (endpoint, dest);
@@ -371,5 +397,30 @@ inline double Performer::getLatency() const             { return performer->getL
 inline uint32_t Performer::getEventBufferSize() const   { return performer->getEventBufferSize(); }
 inline const char* Performer::getRuntimeError() const   { return performer != nullptr ? performer->getRuntimeError() : nullptr; }
 
+inline void Performer::prefetchEndpoint (EndpointHandle h) const
+{
+    if (performer != nullptr)
+        performer->prefetchEndpoint (h);
+}
+
+inline bool Performer::isRunningQuickTier() const       { return performer != nullptr && performer->isRunningQuickTier(); }
+
+inline choc::value::Value Performer::getNodeProfile() const
+{
+    if (performer != nullptr)
+    {
+        if (auto profile = performer->getNodeProfile())
+        {
+            try
+            {
+                return choc::json::parse (choc::com::StringPtr (profile));
+            }
+            catch (...) {}
+        }
+    }
+
+    return {};
+}
+
 
 } // namespace cmaj
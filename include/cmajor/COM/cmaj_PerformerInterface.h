@@ -37,6 +37,26 @@ namespace cmaj
 /// its endpoints - see PerformerInterface::getEndpointHandle()
 using EndpointHandle = uint32_t;
 
+//==============================================================================
+/// A single entry in an EventBatch - see PerformerInterface::addInputEvents()
+struct TimestampedEvent
+{
+    /// The frame within the next block at which the event should be delivered.
+    uint32_t frameOffset;
+    /// If the endpoint supports multiple types, this selects the one to use (or 0 if it has only one).
+    uint32_t typeIndex;
+    /// The event's data, in choc::value::ValueView format.
+    const void* eventData;
+};
+
+/// A list of events for an input event endpoint, in ascending order of frameOffset.
+/// See PerformerInterface::addInputEvents()
+struct EventBatch
+{
+    const TimestampedEvent* events;
+    uint32_t numEvents;
+};
+
 
 //==============================================================================
 /** This is the basic COM API class for a performer.
@@ -148,6 +168,45 @@ struct PerformerInterface   : public choc::com::Object
 
     /// If there has been a runtime error, this returns the message, or nullptr if there isn't one.
     virtual const char* getRuntimeError() = 0;
+
+    /// Adds a batch of timestamped events to the queue for an input event endpoint.
+    /// This function must only be called on the rendering thread, as part of the preparations for
+    /// a call to advance(), and after the block size has been set with setBlockSize().
+    /// Each event's frameOffset is relative to the start of the next block. Events with an offset of 0
+    /// are delivered exactly as if they'd been passed to addInputEvent(), and later ones are delivered
+    /// at their given frame during the next advance() call, so a caller doesn't need to chop its block
+    /// into smaller pieces to get sample-accurate events. Offsets beyond the end of the block are
+    /// delivered on its last frame.
+    /// The event data is copied, so it doesn't need to outlive this call, but while there are events
+    /// pending with a non-zero offset, the data passed to setInputFrames() must stay valid until advance()
+    /// has returned.
+    /// The performer has room for getEventBufferSize() pending events per input event endpoint. Any that
+    /// are added when it's full are delivered at the start of the block instead, and an xrun is registered.
+    /// Back-ends which can't deliver events part-way through a block will deliver them all at its start.
+    virtual Result addInputEvents (EndpointHandle, const EventBatch*) = 0;
+
+    /// If the program was built with BuildSettings::setNodeProfiling() enabled, this returns a JSON
+    /// array with an object for each node of the main graph, containing its name and the total number
+    /// of CPU cycles and calls that have been counted since the performer was last reset. If profiling
+    /// isn't enabled or isn't supported by the back-end, this returns nullptr.
+    /// This may be called on any thread, but the counts may lag slightly behind the rendering thread.
+    virtual choc::com::String* getNodeProfile() = 0;
+
+    /// If the program was built with BuildSettings::setLazyHandlerCompilation() enabled, the code
+    /// for input value and event endpoints is compiled on a background thread after linking. This
+    /// asks for the given endpoint's code to be compiled next, so that it's ready before it's first
+    /// used - if a value or event is sent to it before it has been compiled, it's held back and
+    /// delivered when the code is ready, so it takes effect later than it should have done.
+    /// This never blocks, so it can be called from any thread, including the rendering thread.
+    /// For back-ends which compile everything up-front, it does nothing.
+    virtual void prefetchEndpoint (EndpointHandle) = 0;
+
+    /// If the program was built with BuildSettings::setTieredCompilation() enabled, this returns true
+    /// while the performer is still running the quickly-compiled code, and false once the optimised
+    /// code has been built and switched in, after which the next call to advance() will use it.
+    /// For builds which aren't tiered, and back-ends which don't support it, this always returns false.
+    /// This never blocks, so it can be called from any thread.
+    virtual bool isRunningQuickTier() = 0;
 };
 
 using PerformerPtr = choc::com::Ptr<PerformerInterface>;
@@ -19,7 +19,6 @@
 #pragma once
 
 #include <iostream>
-#include <thread>
 
 #include "../../choc/memory/choc_Endianness.h"
 #include "../../choc/containers/choc_VariableSizeFIFO.h"
@@ -30,6 +29,7 @@
 #include "../../choc/audio/choc_AudioMIDIBlockDispatcher.h"
 
 #include "cmaj_EndpointTypeCoercion.h"
+#include "cmaj_TimestampedEventQueue.h"
 
 
 namespace cmaj
@@ -100,13 +100,37 @@ struct AudioMIDIPerformer
     };
 
     //==============================================================================
-    // These can be called from any thread - it adds these incoming events and value changes
-    // to a FIFO that will be read during the next call to process()
-    bool postEvent (const cmaj::EndpointID&, const choc::value::ValueView& value, uint32_t timeoutMilliseconds);
-    bool postEvent (cmaj::EndpointHandle,    const choc::value::ValueView& value, uint32_t timeoutMilliseconds);
-    bool postValue (const cmaj::EndpointID&, const choc::value::ValueView& value, uint32_t framesToReachValue, uint32_t timeoutMilliseconds);
-    bool postValue (cmaj::EndpointHandle,    const choc::value::ValueView& value, uint32_t framesToReachValue, uint32_t timeoutMilliseconds);
-    bool postEventOrValue (const cmaj::EndpointID&, const choc::value::ValueView& value, uint32_t framesToReachValue, uint32_t timeoutMilliseconds);
+    // These can be called from any thread - they add incoming events and value changes to a
+    // lock-free queue which process() reads as it renders. The frame argument is a position on
+    // the performer's timeline (see getCurrentFramePosition()), and process() will split its
+    // block so that the item is applied on exactly that frame. Items with a frame of 0, or
+    // whose frame has already passed, are applied at the start of the next block.
+    // Items are applied in the order they were posted, so one with a future timestamp will
+    // also hold back any items that are posted after it.
+    // If the queue is full, these return false, after retrying for up to timeoutMilliseconds.
+    bool postEvent (const cmaj::EndpointID&, const choc::value::ValueView& value, uint32_t timeoutMilliseconds, uint64_t frame = 0);
+    bool postEvent (cmaj::EndpointHandle,    const choc::value::ValueView& value, uint32_t timeoutMilliseconds, uint64_t frame = 0);
+    bool postValue (const cmaj::EndpointID&, const choc::value::ValueView& value, uint32_t framesToReachValue, uint32_t timeoutMilliseconds, uint64_t frame = 0);
+    bool postValue (cmaj::EndpointHandle,    const choc::value::ValueView& value, uint32_t framesToReachValue, uint32_t timeoutMilliseconds, uint64_t frame = 0);
+    bool postEventOrValue (const cmaj::EndpointID&, const choc::value::ValueView& value, uint32_t framesToReachValue, uint32_t timeoutMilliseconds, uint64_t frame = 0);
+
+    /// Adds a short MIDI message for a MIDI input endpoint, to be delivered at the given frame
+    /// within the block that the next call to process() renders. Unlike postEvent(), this doesn't
+    /// make process() split its block, because the performer delivers the message at that frame
+    /// itself (see Performer::addInputEvents()).
+    /// This must only be called on the audio thread, just before process(), and the messages for
+    /// each block must be added in order of frame. It returns false if there's no more room for
+    /// messages in the current block.
+    bool addMIDIInputEvent (cmaj::EndpointHandle,    uint32_t frame, choc::midi::ShortMessage);
+    bool addMIDIInputEvent (const cmaj::EndpointID&, uint32_t frame, choc::midi::ShortMessage);
+
+    /// Returns the timeline position of the next frame that process() will render.
+    /// This can be called from any thread.
+    uint64_t getCurrentFramePosition() const;
+
+    /// Returns the counters for the queue of incoming events and values, including the
+    /// number that were dropped because it was full, and the most it has held at once.
+    TimestampedEventQueue::Statistics getInputQueueStatistics() const;
 
     //==============================================================================
     /// This should be called after calling the connect functions to set up the routing,
@@ -117,8 +141,11 @@ struct AudioMIDIPerformer
     /// aren't in use. If false, it will add the output to whatever is already in the buffer.
     bool process (const choc::audio::AudioMIDIBlockDispatcher::Block&, bool replaceOutput);
 
-    /// This version of process will automatically chop up a set of MIDI events with frame
-    /// times into sub-blocks, and process each chunk separately
+    /// This version of process takes a set of MIDI events with frame times, and uses
+    /// addMIDIInputEvent() to deliver each one at its frame within the block. The messages
+    /// must be sorted by time. If there are more than the performer's event buffer can
+    /// hold, the block is split at the frame of the first one that doesn't fit, so that
+    /// none of them are lost.
     bool processWithTimeStampedMIDI (const choc::buffer::ChannelArrayView<const float> audioInput,
                                      const choc::buffer::ChannelArrayView<float> audioOutput,
                                      const choc::audio::AudioMIDIBlockDispatcher::MIDIMessage* midiInMessages,
@@ -152,14 +179,29 @@ private:
     std::vector<cmaj::EndpointHandle> midiInputEndpoints, midiOutputEndpoints;
     std::vector<std::pair<cmaj::EndpointHandle, std::string>> eventOutputHandles;
     std::unordered_map<std::string, EndpointHandle> inputEndpointHandles;
-    choc::fifo::VariableSizeFIFO inputQueue, outputQueue;
+    TimestampedEventQueue inputQueue;
+    choc::fifo::VariableSizeFIFO outputQueue;
     OutputEventsReadyFn outputEventsReadyHandler;
     std::vector<std::pair<choc::midi::ShortMessage, uint32_t>> midiOutputMessages;
+
+    struct TimedMIDIEvent
+    {
+        uint32_t frame;
+        cmaj::EndpointHandle endpoint;
+        int32_t packedMIDI;
+    };
+
+    std::vector<TimedMIDIEvent> timedMIDIEvents;
+    std::vector<TimestampedEvent> timedEventScratch;
+    size_t nextTimedMIDIEvent = 0;
+
     choc::buffer::InterleavingScratchBuffer<float> audioInputScratchBuffer;
     std::vector<uint8_t> audioOutputScratchSpace;
 
-    uint64_t numFramesProcessed = 0;
-    static constexpr uint32_t maxFramesPerBlock = 512;
+    std::atomic<uint64_t> numFramesProcessed { 0 };
+    /// The largest chunk that process() will render in one go, which is taken from the
+    /// engine's BuildSettings::getMaxBlockSize(). The scratch buffers are sized to hold this.
+    const uint32_t maxFramesPerBlock;
     uint32_t currentMaxBlockSize = 0;
 
     std::atomic<uint32_t> processCallCount { 0 };
@@ -171,6 +213,13 @@ private:
     AudioMIDIPerformer (cmaj::Engine, uint32_t eventFIFOSize);
 
     void allocateScratch();
+    void renderChunk (const choc::audio::AudioMIDIBlockDispatcher::Block&, bool replaceOutput, uint32_t startFrame, bool isLastChunk);
+    bool addTimedMIDIEvent (cmaj::EndpointHandle, uint32_t frame, int32_t packedMIDI);
+    void addTimedMIDIEventsForChunk (uint32_t startFrame, uint32_t endFrame, bool isLastChunk);
+    void deliverTimedMIDIEventsNow();
+    void clearTimedMIDIEvents();
+    void dispatchPendingInputEvents();
+    uint32_t getFramesUntilNextInputEvent (uint32_t maxFrames) const;
     void dispatchMIDIOutputEvents (const choc::audio::AudioMIDIBlockDispatcher::Block&);
     void moveOutputEventsToQueue();
 };
@@ -543,13 +592,16 @@ inline std::unique_ptr<AudioMIDIPerformer> AudioMIDIPerformer::Builder::createPe
 
 //==============================================================================
 inline AudioMIDIPerformer::AudioMIDIPerformer (cmaj::Engine e, uint32_t eventFIFOSize)
-    : engine (std::move (e))
+    : engine (std::move (e)),
+      maxFramesPerBlock (engine.getBuildSettings().getMaxBlockSize())
 {
-    inputQueue.reset (eventFIFOSize);
-    outputQueue.reset (eventFIFOSize);
-
     endpointTypeCoercionHelpers.initialise (engine, maxFramesPerBlock, true, true);
 
+    auto maxInputDataSize = endpointTypeCoercionHelpers.getMaxInputValueDataSize();
+    inputQueue.reset (eventFIFOSize / static_cast<uint32_t> (sizeof (TimestampedEventQueue::Item) + maxInputDataSize),
+                      maxInputDataSize);
+    outputQueue.reset (eventFIFOSize);
+
     for (auto& endpoint : engine.getInputEndpoints())
         inputEndpointHandles[endpoint.endpointID.toString()] = engine.getEndpointHandle (endpoint.endpointID);
 
@@ -577,105 +629,106 @@ inline void AudioMIDIPerformer::allocateScratch()
         audioOutputScratchSpace.resize (scratchNeeded);
 }
 
-template <typename Fifo, typename Fn>
-static bool pushWithTimeout (Fifo& fifo, uint32_t totalSize, uint32_t timeoutMilliseconds, Fn&& f)
+inline bool AudioMIDIPerformer::postEvent (cmaj::EndpointHandle handle, const choc::value::ValueView& value,
+                                           uint32_t timeoutMilliseconds, uint64_t frame)
 {
-    if (fifo.push (totalSize, f))
-        return true;
-
-    if (timeoutMilliseconds == 0)
+    if (endpointTypeCoercionHelpers.getInputEndpointType (handle) != EndpointType::event)
         return false;
 
-    for (auto startTime = std::chrono::steady_clock::now();;)
-    {
-        std::this_thread::sleep_for (std::chrono::milliseconds (1));
-
-        if (fifo.push (totalSize, f))
-            return true;
-
-        auto elapsed = std::chrono::steady_clock::now() - startTime;
-
-        if (elapsed > std::chrono::milliseconds (timeoutMilliseconds))
-            return false;
-    }
-}
-
-inline bool AudioMIDIPerformer::postEvent (cmaj::EndpointHandle handle, const choc::value::ValueView& value,
-                                           uint32_t timeoutMilliseconds)
-{
-    if (auto coercedData = endpointTypeCoercionHelpers.coerceValueToMatchingType (handle, value, EndpointType::event))
+    // The value is coerced straight into the queue slot, because the coercion helper's
+    // shared scratch space can't be used by multiple producer threads
+    return inputQueue.push (timeoutMilliseconds, [&] (TimestampedEventQueue::Item& item, void* dest)
     {
-        auto typeIndex = static_cast<uint32_t> (coercedData.typeIndex);
-        auto totalSize = static_cast<uint32_t> (sizeof (handle) + sizeof (typeIndex) + coercedData.data.size);
-
-        return pushWithTimeout (inputQueue, totalSize, timeoutMilliseconds, [&] (void* dest)
+        if (auto coercedData = endpointTypeCoercionHelpers.coerceValueToMatchingType (handle, value, EndpointType::event, dest))
         {
-            auto d = static_cast<uint8_t*> (dest);
-            choc::memory::writeNativeEndian (d, handle);
-            d += sizeof (handle);
-            choc::memory::writeNativeEndian (d, typeIndex);
-            d += sizeof (typeIndex);
-            std::memcpy (d, coercedData.data.data, coercedData.data.size);
-        });
-    }
+            item.frame = frame;
+            item.endpoint = handle;
+            item.typeIndexOrFrameCount = coercedData.typeIndex;
+            item.dataSize = coercedData.data.size;
+            return true;
+        }
 
-    return false;
+        return false;
+    });
 }
 
 inline bool AudioMIDIPerformer::postEvent (const cmaj::EndpointID& endpointID, const choc::value::ValueView& value,
-                                           uint32_t timeoutMilliseconds)
+                                           uint32_t timeoutMilliseconds, uint64_t frame)
 {
     if (auto h = inputEndpointHandles.find (endpointID.toString()); h != inputEndpointHandles.end())
-        return postEvent (h->second, value, timeoutMilliseconds);
+        return postEvent (h->second, value, timeoutMilliseconds, frame);
 
     return false;
 }
 
 inline bool AudioMIDIPerformer::postValue (const EndpointHandle handle, const choc::value::ValueView& value,
-                                           uint32_t framesToReachValue, uint32_t timeoutMilliseconds)
+                                           uint32_t framesToReachValue, uint32_t timeoutMilliseconds, uint64_t frame)
 {
-    if (auto coercedData = endpointTypeCoercionHelpers.coerceValue (handle, value))
-    {
-        auto totalSize = static_cast<uint32_t> (sizeof (handle) + sizeof (framesToReachValue) + coercedData.size);
+    if (endpointTypeCoercionHelpers.getInputEndpointType (handle) != EndpointType::value)
+        return false;
 
-        return pushWithTimeout (inputQueue, totalSize, timeoutMilliseconds, [&] (void* dest)
+    return inputQueue.push (timeoutMilliseconds, [&] (TimestampedEventQueue::Item& item, void* dest)
+    {
+        if (auto coercedData = endpointTypeCoercionHelpers.coerceValue (handle, value, dest))
         {
-            auto d = static_cast<uint8_t*> (dest);
-            choc::memory::writeNativeEndian (d, handle);
-            d += sizeof (handle);
-            // upper bit is used to indicate this is a value rather than event
-            choc::memory::writeNativeEndian (d, framesToReachValue | 0x80000000u);
-            d += sizeof (framesToReachValue);
-            std::memcpy (d, coercedData.data, coercedData.size);
-        });
-    }
+            item.frame = frame;
+            item.endpoint = handle;
+            item.typeIndexOrFrameCount = framesToReachValue;
+            item.dataSize = coercedData.size;
+            item.isValue = true;
+            return true;
+        }
 
-    return false;
+        return false;
+    });
 }
 
 inline bool AudioMIDIPerformer::postValue (const cmaj::EndpointID& endpointID, const choc::value::ValueView& value,
-                                           uint32_t framesToReachValue, uint32_t timeoutMilliseconds)
+                                           uint32_t framesToReachValue, uint32_t timeoutMilliseconds, uint64_t frame)
 {
     if (auto h = inputEndpointHandles.find (endpointID.toString()); h != inputEndpointHandles.end())
-        return postValue (h->second, value, framesToReachValue, timeoutMilliseconds);
+        return postValue (h->second, value, framesToReachValue, timeoutMilliseconds, frame);
 
     return false;
 }
 
 inline bool AudioMIDIPerformer::postEventOrValue (const cmaj::EndpointID& endpointID, const choc::value::ValueView& value,
-                                                  uint32_t framesToReachValue, uint32_t timeoutMilliseconds)
+                                                  uint32_t framesToReachValue, uint32_t timeoutMilliseconds, uint64_t frame)
 {
     if (auto h = inputEndpointHandles.find (endpointID.toString()); h != inputEndpointHandles.end())
     {
         if (endpointTypeCoercionHelpers.getInputEndpointType (h->second) == EndpointType::event)
-            return postEvent (h->second, value, timeoutMilliseconds);
+            return postEvent (h->second, value, timeoutMilliseconds, frame);
 
-        return postValue (h->second, value, framesToReachValue, timeoutMilliseconds);
+        return postValue (h->second, value, framesToReachValue, timeoutMilliseconds, frame);
     }
 
     return false;
 }
 
+inline bool AudioMIDIPerformer::addMIDIInputEvent (cmaj::EndpointHandle handle, uint32_t frame, choc::midi::ShortMessage message)
+{
+    return addTimedMIDIEvent (handle, frame, cmaj::MIDIEvents::midiMessageToPackedInt (message));
+}
+
+inline bool AudioMIDIPerformer::addMIDIInputEvent (const cmaj::EndpointID& endpointID, uint32_t frame, choc::midi::ShortMessage message)
+{
+    if (auto h = inputEndpointHandles.find (endpointID.toString()); h != inputEndpointHandles.end())
+        return addMIDIInputEvent (h->second, frame, message);
+
+    return false;
+}
+
+inline uint64_t AudioMIDIPerformer::getCurrentFramePosition() const
+{
+    return numFramesProcessed.load (std::memory_order_relaxed);
+}
+
+inline TimestampedEventQueue::Statistics AudioMIDIPerformer::getInputQueueStatistics() const
+{
+    return inputQueue.getStatistics();
+}
+
 //==============================================================================
 inline bool AudioMIDIPerformer::prepareToStart()
 {
@@ -686,6 +739,8 @@ inline bool AudioMIDIPerformer::prepareToStart()
 
     currentMaxBlockSize = std::min (maxFramesPerBlock, performer.getMaximumBlockSize());
     midiOutputMessages.reserve (midiOutputEndpoints.size() * performer.getEventBufferSize());
+    timedMIDIEvents.reserve (std::max (midiInputEndpoints.size(), size_t (1)) * performer.getEventBufferSize());
+    timedEventScratch.reserve (timedMIDIEvents.capacity());
     endpointTypeCoercionHelpers.initialiseDictionary (performer);
     return true;
 }
@@ -701,102 +756,192 @@ inline bool AudioMIDIPerformer::process (const choc::audio::AudioMIDIBlockDispat
     try
     {
         if (performer == nullptr)
+        {
+            clearTimedMIDIEvents();
             return false;
+        }
 
+        ++processCallCount;
         auto numFrames = block.audioOutput.getNumFrames();
 
-        if (numFrames > currentMaxBlockSize)
+        for (uint32_t start = 0; start < numFrames;)
         {
-            for (uint32_t start = 0; start < numFrames;)
+            // Queued events are applied at the start of a chunk, so if the next one is due
+            // part-way through the block, the chunk is cut short to land it on the right frame
+            dispatchPendingInputEvents();
+            auto numToDo = getFramesUntilNextInputEvent (std::min (currentMaxBlockSize, numFrames - start));
+            auto isLastChunk = start + numToDo >= numFrames;
+
+            if (start == 0 && numToDo == numFrames)
             {
-                auto numToDo = std::min (currentMaxBlockSize, numFrames - start);
-
-                if (! process ({ block.audioInput.getFrameRange ({ start, start + numToDo }),
-                                 block.audioOutput.getFrameRange ({ start, start + numToDo }),
-                                 start == 0 ? block.midiMessages : choc::span<choc::audio::AudioMIDIBlockDispatcher::MIDIMessage>(),
-                                 [&] (uint32_t frame, choc::midi::ShortMessage m)
-                                 {
-                                     block.onMidiOutputMessage (start + frame, m);
-                                 }}, replaceOutput))
-                    return false;
-
-                start += numToDo;
+                renderChunk (block, replaceOutput, 0, true);
+            }
+            else
+            {
+                renderChunk ({ block.audioInput.getFrameRange ({ start, start + numToDo }),
+                               block.audioOutput.getFrameRange ({ start, start + numToDo }),
+                               start == 0 ? block.midiMessages : choc::span<choc::audio::AudioMIDIBlockDispatcher::MIDIMessage>(),
+                               block.onMidiOutputMessage == nullptr
+                                 ? choc::audio::AudioMIDIBlockDispatcher::HandleMIDIMessageFn()
+                                 : [&] (uint32_t frame, choc::midi::ShortMessage m)
+                                   {
+                                       block.onMidiOutputMessage (start + frame, m);
+                                   }}, replaceOutput, start, isLastChunk);
             }
 
-            return true;
+            start += numToDo;
         }
 
+        clearTimedMIDIEvents();
         ++processCallCount;
-        performer.setBlockSize (numFrames);
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Exception thrown in audio process callback: " << e.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cerr << "Unknown exception thrown in audio process callback" << std::endl;
+    }
 
-        for (auto& f : preRenderFunctions)
-            f (block);
+    clearTimedMIDIEvents();
+    return false;
+}
 
-        inputQueue.popAllAvailable ([&] (const void* data, [[maybe_unused]] uint32_t size)
-        {
-            CMAJ_ASSERT (size > 4);
-            auto d = static_cast<const char*> (data);
-            auto handle = choc::memory::readNativeEndian<cmaj::EndpointHandle> (d);
-            d += sizeof (handle);
-            // upper bit is used to indicate this is a value rather than event
-            auto typeIndexOrFrameCount = choc::memory::readNativeEndian<uint32_t> (d);
-            d += sizeof (typeIndexOrFrameCount);
-
-            if (typeIndexOrFrameCount >> 31)
-                performer.setInputValue (handle, d, typeIndexOrFrameCount & 0x7fffffffu);
-            else
-                performer.addInputEvent (handle, typeIndexOrFrameCount, d);
-        });
+inline void AudioMIDIPerformer::renderChunk (const choc::audio::AudioMIDIBlockDispatcher::Block& block, bool replaceOutput,
+                                             uint32_t startFrame, bool isLastChunk)
+{
+    auto numFrames = block.audioOutput.getNumFrames();
+    performer.setBlockSize (numFrames);
+    addTimedMIDIEventsForChunk (startFrame, startFrame + numFrames, isLastChunk);
+
+    for (auto& f : preRenderFunctions)
+        f (block);
 
-        if (! midiInputEndpoints.empty())
+    if (! midiInputEndpoints.empty())
+    {
+        for (auto midiEvent : block.midiMessages)
         {
-            for (auto midiEvent : block.midiMessages)
-            {
-                auto length = midiEvent.message.length();
+            auto length = midiEvent.message.length();
 
-                if (length < 4 && length != 0)
-                {
-                    auto bytes = midiEvent.message.data();
-                    int32_t packedMIDI = 0;
+            if (length < 4 && length != 0)
+            {
+                auto bytes = midiEvent.message.data();
+                int32_t packedMIDI = 0;
 
-                    for (uint32_t i = 0; i < length; ++i)
-                        packedMIDI = (packedMIDI << 8) | static_cast<int32_t> (bytes[i]);
+                for (uint32_t i = 0; i < length; ++i)
+                    packedMIDI = (packedMIDI << 8) | static_cast<int32_t> (bytes[i]);
 
-                    for (auto& midiEndpoint : midiInputEndpoints)
-                        performer.addInputEvent (midiEndpoint, 0, packedMIDI);
-                }
+                for (auto& midiEndpoint : midiInputEndpoints)
+                    performer.addInputEvent (midiEndpoint, 0, packedMIDI);
             }
         }
+    }
 
-        performer.advance();
-        dispatchMIDIOutputEvents (block);
+    performer.advance();
+    dispatchMIDIOutputEvents (block);
 
-        if (replaceOutput)
-        {
-            for (auto& f : postRenderReplaceFunctions)
-                f (block);
-        }
-        else
+    if (replaceOutput)
+    {
+        for (auto& f : postRenderReplaceFunctions)
+            f (block);
+    }
+    else
+    {
+        for (auto& f : postRenderAddFunctions)
+            f (block);
+    }
+
+    moveOutputEventsToQueue();
+    numFramesProcessed.store (numFramesProcessed.load (std::memory_order_relaxed) + numFrames, std::memory_order_relaxed);
+}
+
+inline void AudioMIDIPerformer::addTimedMIDIEventsForChunk (uint32_t startFrame, uint32_t endFrame, bool isLastChunk)
+{
+    // Each run of messages for the same endpoint goes to the performer as one batch, with
+    // frames relative to the start of this chunk. Anything left over for the last chunk
+    // gets delivered on its final frame.
+    while (nextTimedMIDIEvent < timedMIDIEvents.size())
+    {
+        auto endpoint = timedMIDIEvents[nextTimedMIDIEvent].endpoint;
+        timedEventScratch.clear();
+
+        while (nextTimedMIDIEvent < timedMIDIEvents.size())
         {
-            for (auto& f : postRenderAddFunctions)
-                f (block);
+            auto& e = timedMIDIEvents[nextTimedMIDIEvent];
+
+            if (e.endpoint != endpoint || (e.frame >= endFrame && ! isLastChunk))
+                break;
+
+            timedEventScratch.push_back ({ e.frame > startFrame ? e.frame - startFrame : 0u, 0u, std::addressof (e.packedMIDI) });
+            ++nextTimedMIDIEvent;
         }
 
-        moveOutputEventsToQueue();
-        numFramesProcessed += numFrames;
-        ++processCallCount;
-        return true;
+        if (timedEventScratch.empty())
+            return;
+
+        performer.addInputEvents (endpoint, timedEventScratch.data(), static_cast<uint32_t> (timedEventScratch.size()));
     }
-    catch (const std::exception& e)
+}
+
+inline bool AudioMIDIPerformer::addTimedMIDIEvent (cmaj::EndpointHandle handle, uint32_t frame, int32_t packedMIDI)
+{
+    if (timedMIDIEvents.size() >= timedMIDIEvents.capacity())
+        return false;
+
+    timedMIDIEvents.push_back ({ frame, handle, packedMIDI });
+    return true;
+}
+
+inline void AudioMIDIPerformer::deliverTimedMIDIEventsNow()
+{
+    for (auto& e : timedMIDIEvents)
+        performer.addInputEvent (e.endpoint, 0, std::addressof (e.packedMIDI));
+
+    clearTimedMIDIEvents();
+}
+
+inline void AudioMIDIPerformer::clearTimedMIDIEvents()
+{
+    timedMIDIEvents.clear();
+    nextTimedMIDIEvent = 0;
+}
+
+inline void AudioMIDIPerformer::dispatchPendingInputEvents()
+{
+    auto currentFrame = numFramesProcessed.load (std::memory_order_relaxed);
+
+    while (auto item = inputQueue.peek())
     {
-        std::cerr << "Exception thrown in audio process callback: " << e.what() << std::endl;
+        if (item->frame > currentFrame)
+            break;
+
+        if (item->isValid)
+        {
+            auto data = inputQueue.getPeekedPayload();
+
+            if (item->isValue)
+                performer.setInputValue (item->endpoint, data, item->typeIndexOrFrameCount);
+            else
+                performer.addInputEvent (item->endpoint, item->typeIndexOrFrameCount, data);
+        }
+
+        inputQueue.pop();
     }
-    catch (...)
+}
+
+inline uint32_t AudioMIDIPerformer::getFramesUntilNextInputEvent (uint32_t maxFrames) const
+{
+    if (auto item = inputQueue.peek())
     {
-        std::cerr << "Unknown exception thrown in audio process callback" << std::endl;
+        auto currentFrame = numFramesProcessed.load (std::memory_order_relaxed);
+
+        if (item->frame > currentFrame && item->frame - currentFrame < maxFrames)
+            return static_cast<uint32_t> (item->frame - currentFrame);
     }
 
-    return false;
+    return maxFrames;
 }
 
 inline bool AudioMIDIPerformer::processWithTimeStampedMIDI (const choc::buffer::ChannelArrayView<const float> audioInput,
@@ -807,48 +952,68 @@ inline bool AudioMIDIPerformer::processWithTimeStampedMIDI (const choc::buffer::
                                                             const choc::audio::AudioMIDIBlockDispatcher::HandleMIDIMessageFn& sendMidiOut,
                                                             bool replaceOutput)
 {
-    if (totalNumMIDIMessages == 0)
-        return process (choc::audio::AudioMIDIBlockDispatcher::Block { audioInput, audioOutput, {}, sendMidiOut }, replaceOutput);
-
-    auto remainingChunk = audioOutput.getFrameRange();
-    uint32_t midiStartIndex = 0;
+    auto numFrames = audioOutput.getNumFrames();
+    auto lastFrame = numFrames > 0 ? numFrames - 1 : 0u;
+    uint32_t chunkStart = 0;
+    bool ok = true;
+
+    // Renders the frames from chunkStart up to the given frame, with the MIDI that has been
+    // collected for them, which also leaves the timed event list empty again
+    auto renderChunkUpTo = [&] (uint32_t endFrame)
+    {
+        auto start = chunkStart;
+
+        ok = process ({ audioInput.getFrameRange ({ start, endFrame }),
+                        audioOutput.getFrameRange ({ start, endFrame }),
+                        {},
+                        sendMidiOut == nullptr
+                          ? choc::audio::AudioMIDIBlockDispatcher::HandleMIDIMessageFn()
+                          : [&sendMidiOut, start] (uint32_t frame, choc::midi::ShortMessage m)
+                            {
+                                sendMidiOut (start + frame, m);
+                            } }, replaceOutput) && ok;
+
+        chunkStart = endFrame;
+    };
 
-    while (remainingChunk.start < remainingChunk.end)
+    for (uint32_t i = 0; i < totalNumMIDIMessages; ++i)
     {
-        auto chunkToDo = remainingChunk;
-        auto endOfMIDI = midiStartIndex;
+        auto& message = midiInMessages[i].message;
+        auto length = message.length();
 
-        while (endOfMIDI < totalNumMIDIMessages)
+        if (length < 4 && length != 0)
         {
-            auto eventTime = midiInMessageTimes[endOfMIDI];
+            auto bytes = message.data();
+            int32_t packedMIDI = 0;
+
+            for (uint32_t j = 0; j < length; ++j)
+                packedMIDI = (packedMIDI << 8) | static_cast<int32_t> (bytes[j]);
 
-            if (eventTime > (int) chunkToDo.start)
+            auto frame = std::clamp (static_cast<uint32_t> (std::max (0, midiInMessageTimes[i])), chunkStart, lastFrame);
+
+            for (auto& midiEndpoint : midiInputEndpoints)
             {
-                chunkToDo.end = static_cast<choc::buffer::FrameCount> (eventTime);
-                break;
+                if (! addTimedMIDIEvent (midiEndpoint, frame - chunkStart, packedMIDI))
+                {
+                    // When the list is full, everything in it is due before this message, so the
+                    // block is split here. If they're all due on this same frame, they can just
+                    // be delivered straight away instead.
+                    if (frame > chunkStart)
+                        renderChunkUpTo (frame);
+                    else
+                        deliverTimedMIDIEventsNow();
+
+                    addTimedMIDIEvent (midiEndpoint, frame - chunkStart, packedMIDI);
+                }
             }
-
-            ++endOfMIDI;
         }
-
-        if (! process (choc::audio::AudioMIDIBlockDispatcher::Block
-                       {
-                           audioInput.getFrameRange (chunkToDo),
-                           audioOutput.getFrameRange (chunkToDo),
-                           choc::span<const choc::audio::AudioMIDIBlockDispatcher::MIDIMessage> (midiInMessages + midiStartIndex,
-                                                                                                 midiInMessages + endOfMIDI),
-                           [&] (uint32_t frame, choc::midi::ShortMessage m)
-                           {
-                               sendMidiOut (chunkToDo.start + frame, m);
-                           }
-                       }, replaceOutput))
-            return false;
-
-        remainingChunk.start = chunkToDo.end;
-        midiStartIndex = endOfMIDI;
     }
 
-    return false;
+    if (chunkStart == 0)
+        return process (choc::audio::AudioMIDIBlockDispatcher::Block { audioInput, audioOutput, {}, sendMidiOut }, replaceOutput);
+
+    renderChunkUpTo (numFrames);
+    return ok;
 }
 
 inline void AudioMIDIPerformer::dispatchMIDIOutputEvents (const choc::audio::AudioMIDIBlockDispatcher::Block& block)
@@ -917,7 +1082,7 @@ inline void AudioMIDIPerformer::moveOutputEventsToQueue()
                                            [this, &anyEvents] (EndpointHandle h, uint32_t dataTypeIndex, uint32_t frameOffset,
                                                                const void* valueData, uint32_t valueDataSize) -> bool
             {
-                auto frame = numFramesProcessed + frameOffset;
+                auto frame = getCurrentFramePosition() + frameOffset;
                 auto totalSize = static_cast<uint32_t> (sizeof (h) + sizeof (dataTypeIndex) + sizeof (frame) + valueDataSize);
 
                 bool ok = outputQueue.push (totalSize, [=] (void* dest)
@@ -196,8 +196,9 @@ struct EmbeddedWebAssets
         "     *  @param {string} endpointID\n"
         "     *  @param {number} granularity - if defined, this specifies the number of frames per callback\n"
         "     *  @param {boolean} sendFullAudioData - if false, the listener will receive an argument object containing\n"
-        "     *     two properties 'min' and 'max', which are each an array of values, one element per audio\n"
-        "     *     channel. This allows you to find the highest and lowest samples in that chunk for each channel.\n"
+        "     *     three properties 'min', 'max' and 'rms', which are each an array of values, one element per audio\n"
+        "     *     channel. This allows you to find the highest and lowest samples and the RMS level in that chunk\n"
+        "     *     for each channel.\n"
         "     *     If sendFullAudioData is true, the listener's argument will have a property 'data' which is an\n"
         "     *     array containing one array per channel of raw audio samples data.\n"
         "     */\n"
@@ -3533,7 +3534,7 @@ struct EmbeddedWebAssets
 
     static constexpr std::array files =
     {
-        File { "cmaj-patch-connection.js", std::string_view (cmajpatchconnection_js, 12712) },
+        File { "cmaj-patch-connection.js", std::string_view (cmajpatchconnection_js, 12750) },
         File { "cmaj-parameter-controls.js", std::string_view (cmajparametercontrols_js, 30757) },
         File { "cmaj-midi-helpers.js", std::string_view (cmajmidihelpers_js, 13253) },
         File { "cmaj-event-listener-list.js", std::string_view (cmajeventlistenerlist_js, 3474) },
@@ -149,31 +149,49 @@ struct EndpointTypeCoercionHelperList
         operator bool() const       { return data; }
     };
 
-    CoercedData coerceValue (EndpointHandle handle, const choc::value::ValueView& source)
+    /// If a destination is provided, the coerced data is always written there rather than
+    /// into the shared scratch space, which makes it safe to call from multiple threads. The
+    /// destination must have space for getMaxInputValueDataSize() bytes.
+    CoercedData coerceValue (EndpointHandle handle, const choc::value::ValueView& source, void* destination = nullptr)
     {
         if (auto e = getInput (handle))
             if (e->endpointType == EndpointType::value)
-                return e->scratchSpaces.front().getCoercedValue (source);
+                return e->scratchSpaces.front().getCoercedValue (source, destination);
 
         return {};
     }
 
-    CoercedDataWithIndex coerceValueToMatchingType (EndpointHandle handle, const choc::value::ValueView& source, EndpointType requiredType)
+    CoercedDataWithIndex coerceValueToMatchingType (EndpointHandle handle, const choc::value::ValueView& source, EndpointType requiredType,
+                                                    void* destination = nullptr)
     {
         if (auto e = getInput (handle))
         {
             if (e->endpointType == requiredType)
             {
                 if (doesObjectHaveTypeAsProperty (source))
-                    return e->coerceValueToMatchingType (convertTypePropertyToObjectType (source));
+                    return e->coerceValueToMatchingType (convertTypePropertyToObjectType (source), destination);
 
-                return e->coerceValueToMatchingType (source);
+                return e->coerceValueToMatchingType (source, destination);
             }
         }
 
         return {};
     }
 
+    /// Returns the size of the largest single event or value that can be sent to any of
+    /// the non-stream input endpoints.
+    uint32_t getMaxInputValueDataSize() const
+    {
+        uint32_t maxSize = 0;
+
+        for (auto& input : inputs)
+            if (input.endpointType != EndpointType::stream)
+                for (auto& s : input.scratchSpaces)
+                    maxSize = std::max (maxSize, s.typeSize);
+
+        return maxSize;
+    }
+
     CoercedData coerceArray (EndpointHandle handle, const choc::value::ValueView& source, EndpointType requiredType)
     {
         if (auto e = getInput (handle))
@@ -251,10 +269,19 @@ private:
 
             scratchView = choc::value::ValueView (viewType, nullptr,
                                                   type.usesStrings() ? std::addressof (d) : nullptr);
+            dictionary = type.usesStrings() ? std::addressof (d) : nullptr;
         }
 
-        CoercedData getCoercedValue (const choc::value::ValueView& source)
+        CoercedData getCoercedValue (const choc::value::ValueView& source, void* destination)
         {
+            if (destination != nullptr)
+            {
+                if (coerceChocValue (choc::value::ValueView (type, destination, dictionary), source))
+                    return { destination, typeSize };
+
+                return {};
+            }
+
             if (source.getType() == type)
                 return { source.getRawData(), typeSize };
 
@@ -282,6 +309,7 @@ private:
 
         choc::value::Type type;
         choc::value::ValueView scratchView;
+        choc::value::StringDictionary* dictionary = nullptr;
         uint32_t typeSize = 0;
         uint32_t maxArraySize = 0;
 
@@ -427,19 +455,19 @@ private:
                 s.scratchView.setRawData (data);
         }
 
-        CoercedDataWithIndex coerceValueToMatchingType (const choc::value::ValueView& source)
+        CoercedDataWithIndex coerceValueToMatchingType (const choc::value::ValueView& source, void* destination)
         {
             auto numTypes = static_cast<uint32_t> (scratchSpaces.size());
 
             if (numTypes == 1)
-                return { scratchSpaces.front().getCoercedValue (source), 0 };
+                return { scratchSpaces.front().getCoercedValue (source, destination), 0 };
 
             for (uint32_t i = 0; i < numTypes; ++i)
                 if (scratchSpaces[i].type == source.getType())
-                    return { scratchSpaces[i].getCoercedValue (source), i };
+                    return { scratchSpaces[i].getCoercedValue (source, destination), i };
 
             for (uint32_t i = 0; i < numTypes; ++i)
-                if (auto coerced = scratchSpaces[i].getCoercedValue (source))
+                if (auto coerced = scratchSpaces[i].getCoercedValue (source, destination))
                     return { coerced, i };
 
             return {};
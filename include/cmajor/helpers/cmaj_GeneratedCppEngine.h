@@ -175,6 +175,19 @@ private:
             return Result::Ok;
         }
 
+        Result addInputEvents (EndpointHandle endpoint, const EventBatch* batch) override
+        {
+            // The generated class can't deliver events part-way through a block, so
+            // these all get delivered at the start of it
+            for (uint32_t i = 0; i < batch->numEvents; ++i)
+            {
+                auto& e = batch->events[i];
+                generatedObject.addEvent (endpoint, e.typeIndex, (const unsigned char*) e.eventData);
+            }
+
+            return Result::Ok;
+        }
+
         Result copyOutputValue (EndpointHandle endpoint, void* dest) override
         {
             generatedObject.copyOutputValue (endpoint, dest);
@@ -220,6 +233,9 @@ private:
 
         uint32_t getXRuns() override            { return xruns; }
         const char* getRuntimeError() override  { return {}; }
+        choc::com::String* getNodeProfile() override  { return {}; }
+        void prefetchEndpoint (EndpointHandle) override {}
+        bool isRunningQuickTier() override      { return false; }
 
         uint32_t getMaximumBlockSize() override { return GeneratedCppClass::maxFramesPerBlock; }
         double getLatency() override            { return GeneratedCppClass::latency; }
@@ -0,0 +1,127 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../COM/cmaj_CacheDatabaseInterface.h"
+
+namespace cmaj
+{
+
+//==============================================================================
+/// A simple implementation of CacheDatabaseInterface that keeps everything in memory,
+/// which is handy for sharing compiled code between engines in the same process.
+/// When the total size of the data goes over the given limit, the entries that were
+/// least recently stored or reloaded are removed until it fits again.
+/// It can be used from multiple threads at once.
+struct InMemoryCacheDatabase   : public choc::com::ObjectWithAtomicRefCount<CacheDatabaseInterface, InMemoryCacheDatabase>
+{
+    InMemoryCacheDatabase (uint64_t maxTotalSizeInBytes = defaultMaxTotalSize)  : maxTotalSize (maxTotalSizeInBytes) {}
+    virtual ~InMemoryCacheDatabase() = default;
+
+    static constexpr uint64_t defaultMaxTotalSize = 256 * 1024 * 1024;
+
+    void store (const char* key, const void* dataToSave, uint64_t dataSize) override
+    {
+        auto data = static_cast<const uint8_t*> (dataToSave);
+
+        std::scoped_lock l (lock);
+        removeEntry (key);
+
+        if (dataSize > maxTotalSize)
+            return;
+
+        while (totalSize + dataSize > maxTotalSize)
+            removeEntry (leastRecentlyUsed.back());
+
+        leastRecentlyUsed.push_front (key);
+        entries[key] = { std::vector<uint8_t> (data, data + dataSize), leastRecentlyUsed.begin() };
+        totalSize += dataSize;
+    }
+
+    uint64_t reload (const char* key, void* destAddress, uint64_t destSize) override
+    {
+        std::scoped_lock l (lock);
+
+        auto found = entries.find (key);
+
+        if (found == entries.end())
+            return 0;
+
+        auto& entry = found->second;
+        leastRecentlyUsed.splice (leastRecentlyUsed.begin(), leastRecentlyUsed, entry.positionInList);
+
+        if (destAddress != nullptr && destSize >= entry.data.size())
+            std::memcpy (destAddress, entry.data.data(), entry.data.size());
+
+        return entry.data.size();
+    }
+
+    size_t getNumEntries() const
+    {
+        std::scoped_lock l (lock);
+        return entries.size();
+    }
+
+    uint64_t getTotalSize() const
+    {
+        std::scoped_lock l (lock);
+        return totalSize;
+    }
+
+    void clear()
+    {
+        std::scoped_lock l (lock);
+        entries.clear();
+        leastRecentlyUsed.clear();
+        totalSize = 0;
+    }
+
+private:
+    struct Entry
+    {
+        std::vector<uint8_t> data;
+        std::list<std::string>::iterator positionInList;
+    };
+
+    mutable std::mutex lock;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> leastRecentlyUsed;
+    const uint64_t maxTotalSize;
+    uint64_t totalSize = 0;
+
+    void removeEntry (const std::string& key)
+    {
+        auto found = entries.find (key);
+
+        if (found != entries.end())
+        {
+            totalSize -= found->second.data.size();
+            leastRecentlyUsed.erase (found->second.positionInList);
+            entries.erase (found);
+        }
+    }
+};
+
+} // namespace cmaj
@@ -185,7 +185,14 @@ public:
 
             patch->setHostDescription (hostDescription);
             patch->setAutoRebuildOnFileChange (true);
-            patch->createEngine = +[] { return cmaj::Engine::create(); };
+            patch->createEngine = +[]
+            {
+                // The host's cache is shared by every patch it loads, so storing their machine code
+                // there means that reopening a patch doesn't have to generate it again
+                auto engine = cmaj::Engine::create();
+                engine.setBuildSettings (engine.getBuildSettings().setCacheObjectCode (true));
+                return engine;
+            };
 
            #if CMAJ_USE_QUICKJS_WORKER
             enableQuickJSPatchWorker (*patch);
@@ -20,11 +20,14 @@
 
 #include "cmaj_PatchHelpers.h"
 #include "cmaj_AudioMIDIPerformer.h"
+#include "../../choc/memory/choc_Base64.h"
 
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <chrono>
+#include <cmath>
+#include <limits>
 #include <condition_variable>
 
 namespace cmaj
@@ -89,6 +92,10 @@ struct Patch
     /// Returns the log from the last build that was performed, if there was one.
     std::string getLastBuildLog() const;
 
+    /// If the patch was built with node profiling enabled, this returns the per-node
+    /// cycle and call counts - see cmaj::Performer::getNodeProfile().
+    choc::value::Value getNodeProfile() const;
+
     /// When the patch is loaded and playing, this resets it to the
     /// state is has when initially loaded.
     void resetToInitialState();
@@ -113,9 +120,15 @@ struct Patch
     };
 
     /// Updates the playback parameters, which may trigger a rebuild if
-    /// they have changed.
+    /// they have changed. If only the sample rate has changed and the patch was
+    /// built with BuildSettings::setDynamicFrequency(), it switches to the new rate
+    /// without rebuilding.
     void setPlaybackParams (PlaybackParams, bool synchronousRebuild = true);
 
+    /// Returns true if the loaded patch was built with BuildSettings::setDynamicFrequency(),
+    /// so that it can change sample rate without being rebuilt.
+    bool canChangeSampleRateWithoutRebuilding() const;
+
     /// Returns the current playback parameters.
     PlaybackParams getPlaybackParams() const        { return currentPlaybackParams; }
 
@@ -240,8 +253,14 @@ struct Patch
     /// the engine to use when compiling code.
     cmaj::CacheDatabaseInterface::Ptr cache;
 
+    /// This optional cache is used to store the decoded contents of audio files that
+    /// the patch's externals refer to, so that rebuilding the patch doesn't need to
+    /// decode them again. See readManifestResourceAsAudioData().
+    cmaj::CacheDatabaseInterface::Ptr audioDataCache;
+
     // These dispatch various types of event to any active views that the patch has open.
     void sendMessageToView (PatchView&, std::string_view type, const choc::value::ValueView&) const;
+    void sendBinaryMessageToView (PatchView&, const void* frameData, size_t frameSize) const;
     void broadcastMessageToViews (std::string_view type, const choc::value::ValueView&) const;
     void sendPatchStatusChangeToViews() const;
     void sendParameterChangeToViews (const EndpointID&, float value) const;
@@ -256,6 +275,12 @@ struct Patch
     bool sendMIDIInputEvent (const EndpointID&, choc::midi::ShortMessage,
                              uint32_t timeoutMilliseconds);
 
+    /// Adds a MIDI message for an input endpoint, to be delivered at the given frame within the
+    /// block that the next call to process() or processChunk() renders, without that block having
+    /// to be split up. This must be called on the audio thread, just before rendering, and the
+    /// messages for a block must be added in order of frame.
+    bool addTimedMIDIInputEvent (const EndpointID&, uint32_t frame, choc::midi::ShortMessage);
+
     void sendGestureStart (const EndpointID&);
     void sendGestureEnd (const EndpointID&);
 
@@ -413,6 +438,13 @@ struct PatchView
     bool isViewOf (Patch&) const;
     virtual void sendMessage (const choc::value::ValueView&) = 0;
 
+    /// A view can override this to say that it would like to receive high-rate messages
+    /// (audio levels, CPU level and float event data) as BinaryViewMessage frames via
+    /// sendBinaryMessage(), rather than as JSON objects via sendMessage().
+    virtual bool canReceiveBinaryMessages() const                   { return false; }
+    /// Receives a frame created by BinaryViewMessage, if canReceiveBinaryMessages() is true.
+    virtual void sendBinaryMessage (const void* /*frameData*/, size_t /*frameSize*/) {}
+
     uint32_t width = 0, height = 0;
     bool resizable = true;
 
@@ -420,6 +452,76 @@ struct PatchView
     const uint16_t viewID;
 };
 
+//==============================================================================
+/// Builds the compact frames that a Patch uses to send high-rate messages to views
+/// which can receive binary data (see PatchView::canReceiveBinaryMessages()).
+///
+/// A frame is an 8-byte header, followed by the message type string, followed by a
+/// block of float32 values. All fields use native byte order, which is little-endian
+/// on all the supported platforms:
+///
+///   uint8     content type (a ContentType value)
+///   uint8     length of the message type string
+///   uint16    number of rows
+///   uint32    number of values in each row
+///   char[]    the message type, padded with zeros to a multiple of 4 bytes
+///   float32   the values, one row after another
+///
+/// The javascript decoder for these frames is in panel_api/helpers/cmaj-binary-messages.js
+///
+/// Note that choc's websocket server can only send text frames, so the patch server doesn't
+/// send these as binary websocket frames, but as text created by toText(): a '#' followed by
+/// the frame in base64. That makes them a third bigger than the raw frame (but still much
+/// smaller than the JSON they replace), and the client has to decode the base64. The
+/// javascript decoder also accepts real binary frames, so a server that can send them
+/// only needs to change its side.
+struct BinaryViewMessage
+{
+    enum class ContentType  : uint8_t
+    {
+        audioMinMax     = 1,    ///< Rows of minimum, maximum and RMS levels, with a value per channel
+        audioFullData   = 2,    ///< A row of frames for each channel
+        cpuLevel        = 3,    ///< A single value
+        eventFloat      = 4,    ///< A single value which is an event's float32 payload
+        eventFloatArray = 5     ///< A single row holding an event's float32 array or vector payload
+    };
+
+    static constexpr size_t headerSize = 8;
+
+    /// Returns false if the message type string is too long to fit in a frame.
+    static bool canEncodeType (std::string_view type)       { return type.length() < 256; }
+
+    /// Resizes the frame and fills in its header, and returns the address at which the
+    /// caller must write the numRows * rowLength float values.
+    static char* create (std::vector<char>& frame, ContentType contentType, std::string_view type,
+                         uint32_t numRows, uint32_t rowLength)
+    {
+        CMAJ_ASSERT (canEncodeType (type) && numRows < 65536);
+        auto paddedTypeLength = (type.length() + 3u) & ~static_cast<size_t> (3);
+
+        frame.resize (headerSize + paddedTypeLength + sizeof (float) * numRows * rowLength);
+        auto d = frame.data();
+        d[0] = static_cast<char> (contentType);
+        d[1] = static_cast<char> (type.length());
+        choc::memory::writeNativeEndian<uint16_t> (d + 2, static_cast<uint16_t> (numRows));
+        choc::memory::writeNativeEndian<uint32_t> (d + 4, rowLength);
+        std::fill (d + headerSize, d + headerSize + paddedTypeLength, 0);
+        memcpy (d + headerSize, type.data(), type.length());
+        return d + headerSize + paddedTypeLength;
+    }
+
+    /// The character that starts a frame which was sent as text. It can't be the first
+    /// character of a JSON message, so clients can tell the two kinds of message apart.
+    static constexpr char textPrefix = '#';
+
+    /// Returns the text form of a frame, for sending over a connection that can only
+    /// carry text, i.e. the prefix character followed by the frame in base64.
+    static std::string toText (const void* frameData, size_t frameSize)
+    {
+        return textPrefix + choc::base64::encodeToString (frameData, frameSize);
+    }
+};
+
 
 
 //==============================================================================
@@ -433,7 +535,141 @@ struct PatchView
 //
 //==============================================================================
 
+//==============================================================================
+/// Accumulates the minimum, maximum and sum-of-squares of each channel of a stream
+/// of audio. All its storage is allocated by the constructor, so it can be used on
+/// the audio thread.
+struct AudioLevelStatistics
+{
+    AudioLevelStatistics (uint32_t numChannelsToUse)
+        : numChannels (numChannelsToUse), mins (numChannels), maxs (numChannels), sumSquares (numChannels)
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        numFrames = 0;
+        std::fill (mins.begin(), mins.end(), std::numeric_limits<float>::max());
+        std::fill (maxs.begin(), maxs.end(), std::numeric_limits<float>::lowest());
+        std::fill (sumSquares.begin(), sumSquares.end(), 0.0f);
+    }
+
+    /// Adds the levels of a block of interleaved frames.
+    template <typename SampleType>
+    void add (const choc::buffer::InterleavedView<SampleType>& block)
+    {
+        CMAJ_ASSERT (block.getNumChannels() == numChannels);
+        auto blockFrames = block.getNumFrames();
+
+        if (blockFrames == 0)
+            return;
+
+        if (block.data.stride == numChannels && numChannels <= maxLanes / 2)
+            addPackedSamples (block.data.data, blockFrames);
+        else
+            addFrames (block, blockFrames);
+
+        numFrames += blockFrames;
+    }
+
+    /// Merges in the levels from another set of statistics.
+    void add (const AudioLevelStatistics& other)
+    {
+        CMAJ_ASSERT (other.numChannels == numChannels);
+
+        for (uint32_t chan = 0; chan < numChannels; ++chan)
+            addToChannel (chan, other.mins[chan], other.maxs[chan], other.sumSquares[chan]);
+
+        numFrames += other.numFrames;
+    }
+
+    float getRMS (uint32_t channel) const
+    {
+        return numFrames == 0 ? 0.0f : std::sqrt (sumSquares[channel] / static_cast<float> (numFrames));
+    }
+
+    const uint32_t numChannels;
+    uint32_t numFrames = 0;
+    std::vector<float> mins, maxs, sumSquares;
+
+private:
+    static constexpr uint32_t maxLanes = 16;
+    float laneMins[maxLanes], laneMaxs[maxLanes], laneSquares[maxLanes];
+
+    void addToChannel (uint32_t chan, float minLevel, float maxLevel, float squares)
+    {
+        mins[chan] = std::min (mins[chan], minLevel);
+        maxs[chan] = std::max (maxs[chan], maxLevel);
+        sumSquares[chan] += squares;
+    }
+
+    // Treats the frames as one flat run of samples, accumulating them into a set of lanes
+    // whose count is a multiple of the number of channels, so that each lane only ever sees
+    // one channel. The inner loop has no dependencies between lanes, which lets the compiler
+    // turn it into SIMD min/max/multiply-add operations.
+    template <typename SampleType>
+    void addPackedSamples (const SampleType* samples, uint32_t blockFrames)
+    {
+        auto numLanes = (maxLanes / numChannels) * numChannels;
+        auto numSamples = blockFrames * numChannels;
+
+        for (uint32_t lane = 0; lane < numLanes; ++lane)
+        {
+            laneMins[lane] = std::numeric_limits<float>::max();
+            laneMaxs[lane] = std::numeric_limits<float>::lowest();
+            laneSquares[lane] = 0;
+        }
+
+        uint32_t i = 0;
+
+        for (; i + numLanes <= numSamples; i += numLanes)
+        {
+            for (uint32_t lane = 0; lane < numLanes; ++lane)
+            {
+                auto level = static_cast<float> (samples[i + lane]);
+                laneMins[lane] = level < laneMins[lane] ? level : laneMins[lane];
+                laneMaxs[lane] = level > laneMaxs[lane] ? level : laneMaxs[lane];
+                laneSquares[lane] += level * level;
+            }
+        }
+
+        // The remaining samples are whole frames, so they start at lane 0 for channel 0
+        for (uint32_t lane = 0; i < numSamples; ++i, ++lane)
+        {
+            auto level = static_cast<float> (samples[i]);
+            laneMins[lane] = std::min (level, laneMins[lane]);
+            laneMaxs[lane] = std::max (level, laneMaxs[lane]);
+            laneSquares[lane] += level * level;
+        }
+
+        for (uint32_t lane = 0; lane < numLanes; ++lane)
+            addToChannel (lane % numChannels, laneMins[lane], laneMaxs[lane], laneSquares[lane]);
+    }
 
+    template <typename SampleType>
+    void addFrames (const choc::buffer::InterleavedView<SampleType>& block, uint32_t blockFrames)
+    {
+        for (uint32_t chan = 0; chan < numChannels; ++chan)
+        {
+            auto minLevel = std::numeric_limits<float>::max();
+            auto maxLevel = std::numeric_limits<float>::lowest();
+            float squares = 0;
+
+            for (uint32_t frame = 0; frame < blockFrames; ++frame)
+            {
+                auto level = static_cast<float> (block.getSample (chan, frame));
+                minLevel = std::min (level, minLevel);
+                maxLevel = std::max (level, maxLevel);
+                squares += level * level;
+            }
+
+            addToChannel (chan, minLevel, maxLevel, squares);
+        }
+    }
+};
+
+//==============================================================================
 struct Patch::ClientEventQueue
 {
     ClientEventQueue (Patch& p) : patch (p)
@@ -501,15 +737,15 @@ struct Patch::ClientEventQueue
         patch.sendCPUInfoToViews (value);
     }
 
-    void postAudioMinMax (const PatchView& view, const std::string& eventName, const choc::buffer::ChannelArrayBuffer<float>& levels)
+    void postAudioMinMax (const PatchView& view, const std::string& eventName, const AudioLevelStatistics& levels)
     {
         triggerDispatchOnEndOfBlock = true;
-        auto numChannels = levels.getNumChannels();
+        auto numChannels = levels.numChannels;
 
         auto eventNameChars = eventName.data();
         auto eventNameLen = static_cast<uint32_t> (eventName.length());
 
-        fifo.push (5 + numChannels * sizeof (float) * 2 + eventNameLen, [&] (void* dest)
+        fifo.push (5 + numChannels * sizeof (float) * 3 + eventNameLen, [&] (void* dest)
         {
             auto d = static_cast<char*> (dest);
             *d++ = static_cast<char> (EventType::audioMinMaxLevels);
@@ -520,11 +756,11 @@ struct Patch::ClientEventQueue
 
             for (uint32_t chan = 0; chan < numChannels; ++chan)
             {
-                auto i = levels.getIterator (chan);
-                choc::memory::writeNativeEndian (d, *i);
+                choc::memory::writeNativeEndian (d, levels.mins[chan]);
+                d += sizeof (float);
+                choc::memory::writeNativeEndian (d, levels.maxs[chan]);
                 d += sizeof (float);
-                ++i;
-                choc::memory::writeNativeEndian (d, *i);
+                choc::memory::writeNativeEndian (d, levels.getRMS (chan));
                 d += sizeof (float);
             }
 
@@ -542,7 +778,29 @@ struct Patch::ClientEventQueue
             auto numChannels = choc::memory::readNativeEndian<uint16_t> (d);
             d += sizeof (uint16_t);
 
-            choc::SmallVector<float, 8> mins, maxs;
+            auto levelsSize = numChannels * sizeof (float) * 3;
+            CMAJ_ASSERT (end > d + levelsSize);
+            auto type = std::string_view (d + levelsSize, static_cast<std::string_view::size_type> (end - d) - levelsSize);
+
+            if (view->canReceiveBinaryMessages() && BinaryViewMessage::canEncodeType (type))
+            {
+                auto dest = BinaryViewMessage::create (binaryFrame, BinaryViewMessage::ContentType::audioMinMax,
+                                                       type, 3, numChannels);
+
+                for (uint32_t chan = 0; chan < numChannels; ++chan)
+                {
+                    for (uint32_t row = 0; row < 3; ++row)
+                    {
+                        memcpy (dest + (row * numChannels + chan) * sizeof (float), d, sizeof (float));
+                        d += sizeof (float);
+                    }
+                }
+
+                patch.sendBinaryMessageToView (*view, binaryFrame.data(), binaryFrame.size());
+                return;
+            }
+
+            choc::SmallVector<float, 8> mins, maxs, rms;
 
             for (uint32_t chan = 0; chan < numChannels; ++chan)
             {
@@ -550,14 +808,15 @@ struct Patch::ClientEventQueue
                 d += sizeof (float);
                 maxs.push_back (choc::memory::readNativeEndian<float> (d));
                 d += sizeof (float);
+                rms.push_back (choc::memory::readNativeEndian<float> (d));
+                d += sizeof (float);
             }
 
-            CMAJ_ASSERT (end > d);
-
-            patch.sendMessageToView (*view, std::string_view (d, static_cast<std::string_view::size_type> (end - d)),
+            patch.sendMessageToView (*view, type,
                                      choc::json::create (
                                         "min", choc::value::createArrayView (mins.data(), static_cast<uint32_t> (mins.size())),
-                                        "max", choc::value::createArrayView (maxs.data(), static_cast<uint32_t> (maxs.size()))));
+                                        "max", choc::value::createArrayView (maxs.data(), static_cast<uint32_t> (maxs.size())),
+                                        "rms", choc::value::createArrayView (rms.data(), static_cast<uint32_t> (rms.size()))));
         }
     }
 
@@ -610,6 +869,18 @@ struct Patch::ClientEventQueue
             auto audioData = d;
             d += numFrames * numChannels * sizeof (float);
             CMAJ_ASSERT (end > d);
+            auto type = std::string_view (d, static_cast<std::string_view::size_type> (end - d));
+
+            if (view->canReceiveBinaryMessages() && BinaryViewMessage::canEncodeType (type))
+            {
+                // the queued data is already laid out as one row of frames per channel
+                memcpy (BinaryViewMessage::create (binaryFrame, BinaryViewMessage::ContentType::audioFullData,
+                                                   type, numChannels, numFrames),
+                        audioData, numFrames * numChannels * sizeof (float));
+
+                patch.sendBinaryMessageToView (*view, binaryFrame.data(), binaryFrame.size());
+                return;
+            }
 
             auto levels = choc::value::createArray (numChannels, [=] (uint32_t channel)
             {
@@ -621,8 +892,7 @@ struct Patch::ClientEventQueue
                 });
             });
 
-            patch.sendMessageToView (*view, std::string_view (d, static_cast<std::string_view::size_type> (end - d)),
-                                     choc::json::create ("data", std::move (levels)));
+            patch.sendMessageToView (*view, type, choc::json::create ("data", std::move (levels)));
         }
     }
 
@@ -668,9 +938,40 @@ struct Patch::ClientEventQueue
             auto valueData = choc::value::InputData { reinterpret_cast<const uint8_t*> (d + 4 + eventNameLen),
                                                       reinterpret_cast<const uint8_t*> (d + size) };
 
-            patch.sendMessageToView (*view, std::string_view (d + 4, eventNameLen),
-                                     choc::value::Value::deserialise (valueData));
+            auto type = std::string_view (d + 4, eventNameLen);
+            auto value = choc::value::Value::deserialise (valueData);
+
+            if (! (view->canReceiveBinaryMessages() && sendFloatEventAsBinary (*view, type, value)))
+                patch.sendMessageToView (*view, type, value);
+        }
+    }
+
+    bool sendFloatEventAsBinary (PatchView& view, std::string_view type, const choc::value::ValueView& value)
+    {
+        if (! BinaryViewMessage::canEncodeType (type))
+            return false;
+
+        auto& valueType = value.getType();
+
+        if (valueType.isFloat32())
+        {
+            auto v = value.getFloat32();
+            memcpy (BinaryViewMessage::create (binaryFrame, BinaryViewMessage::ContentType::eventFloat, type, 1, 1),
+                    std::addressof (v), sizeof (float));
         }
+        else if ((valueType.isVector() || valueType.isUniformArray()) && valueType.getElementType().isFloat32())
+        {
+            auto numElements = value.size();
+            memcpy (BinaryViewMessage::create (binaryFrame, BinaryViewMessage::ContentType::eventFloatArray, type, 1, numElements),
+                    value.getRawData(), numElements * sizeof (float));
+        }
+        else
+        {
+            return false;
+        }
+
+        patch.sendBinaryMessageToView (view, binaryFrame.data(), binaryFrame.size());
+        return true;
     }
 
     void startOfProcessCallback()
@@ -727,6 +1028,7 @@ struct Patch::ClientEventQueue
     choc::threading::TaskThread clientEventHandlerThread;
     choc::threading::ThreadSafeFunctor<std::function<void()>> dispatchClientEventsCallback;
     MIDIEvents::SerialisedShortMIDIMessage serialisedMIDIMessage;
+    std::vector<char> binaryFrame;
     bool triggerDispatchOnEndOfBlock = false;
     uint32_t framesProcessedInBlock = 0;
 
@@ -1008,58 +1310,32 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
               endpointID (endpoint.endpointID.toString()),
               replyType (std::move (type)),
               sendFullData (fullData),
-              granularity (gran >= minGranularity && gran <= maxGranularity ? gran : defaultGranularity)
+              granularity (gran >= minGranularity && gran <= maxGranularity ? gran : defaultGranularity),
+              numChannels (endpoint.getNumAudioChannels()),
+              levels (numChannels)
         {
-            auto numChannels = endpoint.getNumAudioChannels();
             CMAJ_ASSERT (numChannels > 0);
 
             if (sendFullData)
-                levels.resize ({ numChannels, granularity });
-            else
-                levels.resize ({ numChannels, 2 });
+                fullData.resize ({ numChannels, granularity });
         }
 
-        template <typename SampleType>
-        void process (ClientEventQueue& queue, const choc::buffer::InterleavedView<SampleType>& data)
-        {
-            if (sendFullData)
-                processFullData (queue, data);
-            else
-                processMinMax (queue, data);
-        }
+        /// Returns the number of frames that can be added before the next message is due
+        uint32_t getNumFramesUntilNextMessage() const     { return granularity - frameCount; }
 
-        template <typename SampleType>
-        void processMinMax (ClientEventQueue& queue, const choc::buffer::InterleavedView<SampleType>& data)
+        /// Adds the statistics for a block of frames, which must not be longer than
+        /// getNumFramesUntilNextMessage().
+        void addLevels (ClientEventQueue& queue, const AudioLevelStatistics& blockLevels)
         {
-            auto numFrames = data.getNumFrames();
-            auto numChannels = data.getNumChannels();
+            CMAJ_ASSERT (! sendFullData && blockLevels.numFrames <= getNumFramesUntilNextMessage());
+            levels.add (blockLevels);
+            frameCount += blockLevels.numFrames;
 
-            for (uint32_t i = 0; i < numFrames; ++i)
+            if (frameCount == granularity)
             {
-                for (uint32_t chan = 0; chan < numChannels; ++chan)
-                {
-                    auto level = static_cast<float> (data.getSample (chan, i));
-                    auto minMax = levels.getIterator (chan);
-
-                    if (frameCount == 0)
-                    {
-                        *minMax = level;
-                        ++minMax;
-                        *minMax = level;
-                    }
-                    else
-                    {
-                        *minMax = std::min (level, *minMax);
-                        ++minMax;
-                        *minMax = std::max (level, *minMax);
-                    }
-                }
-
-                if (++frameCount == granularity)
-                {
-                    frameCount = 0;
-                    queue.postAudioMinMax (view, replyType, levels);
-                }
+                frameCount = 0;
+                queue.postAudioMinMax (view, replyType, levels);
+                levels.clear();
             }
         }
 
@@ -1073,7 +1349,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
             {
                 auto numToAdd = std::min (numFrames, granularity - frameCount);
 
-                copy (levels.getFrameRange ({ frameCount, frameCount + numToAdd }),
+                copy (fullData.getFrameRange ({ frameCount, frameCount + numToAdd }),
                       data.getFrameRange ({ sourceStart, sourceStart + numToAdd }));
 
                 frameCount += numToAdd;
@@ -1081,8 +1357,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
                 if (frameCount == granularity)
                 {
                     frameCount = 0;
-                    queue.postAudioFullData (view, replyType, levels);
-                    break;
+                    queue.postAudioFullData (view, replyType, fullData);
                 }
 
                 sourceStart += numToAdd;
@@ -1098,14 +1373,15 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
         PatchView& view;
         const std::string endpointID, replyType;
         const bool sendFullData;
-        const uint32_t granularity;
+        const uint32_t granularity, numChannels;
 
         static constexpr uint32_t minGranularity = 64;
         static constexpr uint32_t maxGranularity = 8192;
         static constexpr uint32_t defaultGranularity = 500;
 
     private:
-        choc::buffer::ChannelArrayBuffer<float> levels;
+        AudioLevelStatistics levels;
+        choc::buffer::ChannelArrayBuffer<float> fullData;
         uint32_t frameCount = 0;
     };
 
@@ -1132,8 +1408,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
             if (customSource != nullptr)
                 customSource->read (block);
 
-            for (auto& m : audioMonitors)
-                m->process (queue, block);
+            processMonitors (block);
         }
 
         void process (const choc::buffer::InterleavedView<double>& block) override
@@ -1141,8 +1416,16 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
             if (customSource != nullptr)
                 customSource->read (block);
 
-            for (auto& m : audioMonitors)
-                m->process (queue, block);
+            processMonitors (block);
+        }
+
+        /// This must be called with the renderer's processLock held
+        void addMonitor (std::unique_ptr<AudioLevelMonitor> monitor)
+        {
+            if (! monitor->sendFullData && (blockLevels == nullptr || blockLevels->numChannels != monitor->numChannels))
+                blockLevels = std::make_unique<AudioLevelStatistics> (monitor->numChannels);
+
+            audioMonitors.push_back (std::move (monitor));
         }
 
         bool removeMonitor (PatchView& view, const EndpointID& e, const std::string& type)
@@ -1173,6 +1456,50 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
         ClientEventQueue& queue;
         CustomAudioSourcePtr customSource;
         std::vector<std::unique_ptr<AudioLevelMonitor>> audioMonitors;
+
+    private:
+        std::unique_ptr<AudioLevelStatistics> blockLevels;
+
+        // All the min/max monitors share a single pass over the data: the block is split
+        // at each point where any of them is due to send a message, and the statistics for
+        // each of these sections are merged into every monitor.
+        template <typename SampleType>
+        void processMonitors (const choc::buffer::InterleavedView<SampleType>& block)
+        {
+            bool anyLevelMonitors = false;
+
+            for (auto& m : audioMonitors)
+            {
+                if (m->sendFullData)
+                    m->processFullData (queue, block);
+                else
+                    anyLevelMonitors = true;
+            }
+
+            if (! anyLevelMonitors)
+                return;
+
+            auto numFrames = block.getNumFrames();
+            choc::buffer::FrameCount start = 0;
+
+            while (start < numFrames)
+            {
+                auto sectionLength = numFrames - start;
+
+                for (auto& m : audioMonitors)
+                    if (! m->sendFullData)
+                        sectionLength = std::min (sectionLength, m->getNumFramesUntilNextMessage());
+
+                blockLevels->clear();
+                blockLevels->add (block.getFrameRange ({ start, start + sectionLength }));
+
+                for (auto& m : audioMonitors)
+                    if (! m->sendFullData)
+                        m->addLevels (queue, *blockLevels);
+
+                start += sectionLength;
+            }
+        }
     };
 
     //==============================================================================
@@ -1182,6 +1509,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
                 bool shouldResolveExternals,
                 bool shouldLink,
                 const cmaj::CacheDatabaseInterface::Ptr& c,
+                const cmaj::CacheDatabaseInterface::Ptr& audioDataCache,
                 const std::function<std::string(DiagnosticMessageList&, const std::string&, const std::string&)>& transformSource,
                 const std::function<void()>& checkForStopSignal,
                 uint32_t eventFIFOSize)
@@ -1191,7 +1519,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
             configuredPlaybackParams = playbackParams;
             manifest = std::move (loadParams.manifest);
 
-            if (! loadProgram (engine, playbackParams, shouldResolveExternals, transformSource, checkForStopSignal))
+            if (! loadProgram (engine, playbackParams, shouldResolveExternals, audioDataCache.get(), transformSource, checkForStopSignal))
                 return;
 
             if (! shouldResolveExternals)
@@ -1232,6 +1560,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
     bool loadProgram (cmaj::Engine& engine,
                       const PlaybackParams& playbackParams,
                       bool shouldResolveExternals,
+                      cmaj::CacheDatabaseInterface* audioDataCache,
                       const std::function<std::string(DiagnosticMessageList&, const std::string&, const std::string&)>& transformSource,
                       const std::function<void()>& checkForStopSignal)
     {
@@ -1251,7 +1580,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
         checkForStopSignal();
 
         if (engine.load (errors, program,
-                         shouldResolveExternals ? manifest.createExternalResolverFunction()
+                         shouldResolveExternals ? manifest.createExternalResolverFunction (audioDataCache)
                                                 : [] (const cmaj::ExternalVariable&) -> choc::value::Value { return {}; },
                          {}))
         {
@@ -1433,7 +1762,7 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
                 auto monitor = std::make_unique<AudioLevelMonitor> (view, *details, std::move (replyType), granularity, fullData);
 
                 std::scoped_lock lock (processLock);
-                l->audioMonitors.push_back (std::move (monitor));
+                l->addMonitor (std::move (monitor));
                 return true;
             }
 
@@ -1545,6 +1874,23 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
         return true;
     }
 
+    bool addTimedMIDIInputEvent (ClientEventQueue& queue, const EndpointID& endpointID,
+                                 uint32_t frame, choc::midi::ShortMessage message)
+    {
+        if (! performer->addMIDIInputEvent (endpointID, frame, message))
+            return false;
+
+        if (! endpointListeners.eventMonitors.empty())
+        {
+            auto value = cmaj::MIDIEvents::createMIDIMessageObject (message);
+
+            for (auto& m : endpointListeners.eventMonitors)
+                m->process (queue, endpointID.toString(), value);
+        }
+
+        return true;
+    }
+
     void sendGestureStart (const EndpointID& endpointID)
     {
         if (auto param = findParameter (endpointID))
@@ -1576,6 +1922,49 @@ struct Patch::PatchRenderer  : public std::enable_shared_from_this<PatchRenderer
             param->resetToDefaultValue (true, -1, 0);
     }
 
+    bool usesDynamicFrequency() const
+    {
+        return performer != nullptr && performer->engine.getBuildSettings().shouldUseDynamicFrequency();
+    }
+
+    /// If the program was linked with a dynamic frequency, this switches it to a new rate
+    /// by creating a fresh performer from the existing engine, keeping the current
+    /// parameter values. Returns false if a full rebuild is needed instead.
+    bool changeSampleRate (double newRate)
+    {
+        if (! usesDynamicFrequency())
+            return false;
+
+        auto& engine = performer->engine;
+        engine.setBuildSettings (engine.getBuildSettings().setFrequency (newRate));
+
+        auto newPerformer = engine.createPerformer();
+
+        if (! newPerformer)
+            return false;
+
+        std::unordered_map<std::string, float> currentValues;
+
+        for (auto& param : parameterList)
+            currentValues[param->properties.endpointID] = param->currentValue;
+
+        // Everything is done before the lock is released, so that no block can be rendered
+        // by the new performer until its sources are prepared and the parameter values are
+        // queued for it to pick up before its first frame
+        std::scoped_lock lock (processLock);
+
+        sampleRate = newRate;
+        configuredPlaybackParams.sampleRate = newRate;
+
+        for (auto& l : endpointListeners.dataListeners)
+            if (l.second->customSource != nullptr)
+                l.second->customSource->prepare (newRate);
+
+        applyParameterValues (currentValues, 0, 0);
+        std::swap (performer->performer, newPerformer);
+        return true;
+    }
+
     void beginProcessBlock()    { processLock.lock(); }
     void endProcessBlock()      { processLock.unlock(); }
 
@@ -1838,7 +2227,7 @@ struct Patch::Build
 
         renderer = std::make_shared<PatchRenderer> (patch);
         renderer->build (engine, loadParams, patch.currentPlaybackParams,
-                         resolveExternals, performLink, patch.cache,
+                         resolveExternals, performLink, patch.cache, patch.audioDataCache,
                          [&] (DiagnosticMessageList& errors, const std::string& filename, const std::string& content) -> std::string { return transformSource (errors, filename, content); },
                          checkForStopSignal, patch.performerEventQueueSize);
         return engine;
@@ -2124,6 +2513,15 @@ inline std::string Patch::getLastBuildLog() const
     return renderer != nullptr ? renderer->lastBuildLog : std::string();
 }
 
+inline choc::value::Value Patch::getNodeProfile() const
+{
+    if (renderer != nullptr)
+        if (auto performer = renderer->getPerformerPointer())
+            return performer->performer.getNodeProfile();
+
+    return {};
+}
+
 inline void Patch::setAutoRebuildOnFileChange (bool shouldMonitorFilesForChanges)
 {
     scanFilesForChanges = shouldMonitorFilesForChanges;
@@ -2233,11 +2631,30 @@ inline void Patch::setPlaybackParams (PlaybackParams newParams, bool synchronous
 {
     if (currentPlaybackParams != newParams)
     {
+        auto oldParams = currentPlaybackParams;
         currentPlaybackParams = newParams;
+
+        auto sameExceptRate = newParams;
+        sameExceptRate.sampleRate = oldParams.sampleRate;
+
+        if (sameExceptRate == oldParams
+             && renderer != nullptr
+             && renderer->configuredPlaybackParams == oldParams
+             && renderer->changeSampleRate (newParams.sampleRate))
+        {
+            clientEventQueue->cpu.reset (newParams.sampleRate);
+            return;
+        }
+
         rebuild (synchronousRebuild);
     }
 }
 
+inline bool Patch::canChangeSampleRateWithoutRebuilding() const
+{
+    return renderer != nullptr && renderer->usesDynamicFrequency();
+}
+
 inline void Patch::setHostDescription (const std::string& h)
 {
     hostDescription = h;
@@ -2427,6 +2844,12 @@ inline void Patch::sendMessageToView (PatchView& view, std::string_view type, co
                                               "message", message));
 }
 
+inline void Patch::sendBinaryMessageToView (PatchView& view, const void* frameData, size_t frameSize) const
+{
+    if (std::find (activeViews.begin(), activeViews.end(), std::addressof (view)) != activeViews.end())
+        view.sendBinaryMessage (frameData, frameSize);
+}
+
 inline void Patch::broadcastMessageToViews (std::string_view type, const choc::value::ValueView& message) const
 {
     auto msg = choc::json::create ("type", type,
@@ -2559,8 +2982,28 @@ inline void Patch::sendParameterChangeToViews (const EndpointID& endpointID, flo
 
 inline void Patch::sendCPUInfoToViews (float level) const
 {
-    broadcastMessageToViews ("cpu_info",
-                             choc::json::create ("level", level));
+    choc::value::Value message;
+    std::vector<char> binaryFrame;
+
+    for (auto pv : activeViews)
+    {
+        if (pv->canReceiveBinaryMessages())
+        {
+            if (binaryFrame.empty())
+                memcpy (BinaryViewMessage::create (binaryFrame, BinaryViewMessage::ContentType::cpuLevel, "cpu_info", 1, 1),
+                        std::addressof (level), sizeof (float));
+
+            pv->sendBinaryMessage (binaryFrame.data(), binaryFrame.size());
+        }
+        else
+        {
+            if (message.isVoid())
+                message = choc::json::create ("type", "cpu_info",
+                                              "message", choc::json::create ("level", level));
+
+            pv->sendMessage (message);
+        }
+    }
 }
 
 inline void Patch::sendStoredStateValueToViews (const std::string& key) const
@@ -2694,6 +3137,14 @@ inline bool Patch::sendMIDIInputEvent (const EndpointID& endpointID, choc::midi:
     return false;
 }
 
+inline bool Patch::addTimedMIDIInputEvent (const EndpointID& endpointID, uint32_t frame, choc::midi::ShortMessage message)
+{
+    if (renderer == nullptr)
+        return false;
+
+    return renderer->addTimedMIDIInputEvent (*clientEventQueue, endpointID, frame, message);
+}
+
 inline void Patch::sendGestureStart (const EndpointID& endpointID)
 {
     if (renderer != nullptr)
@@ -27,8 +27,10 @@
 #include "../../choc/audio/choc_AudioFileFormat_Ogg.h"
 #include "../../choc/audio/choc_AudioFileFormat_FLAC.h"
 #include "../../choc/audio/choc_AudioFileFormat_MP3.h"
+#include "../../choc/memory/choc_xxHash.h"
 #include "../API/cmaj_Program.h"
 #include "../API/cmaj_ExternalVariables.h"
+#include "../COM/cmaj_CacheDatabaseInterface.h"
 
 namespace cmaj
 {
@@ -163,7 +165,9 @@ struct PatchManifest
     /// Returns a function that can auto-resolve externals for this manifest, using
     /// the replaceFilenameStringsWithAudioData() helper function. This function
     /// can be passed straight into the Engine::load() method.
-    std::function<choc::value::Value(const cmaj::ExternalVariable&)> createExternalResolverFunction() const;
+    /// If a cache is provided, it's used to store and reload decoded audio files, and
+    /// it must outlive the function that is returned.
+    std::function<choc::value::Value(const cmaj::ExternalVariable&)> createExternalResolverFunction (CacheDatabaseInterface* audioDataCache = nullptr) const;
 
     /// Parses and adds all the source files from this patch to the given Program,
     /// returning true if no errors were encountered.
@@ -181,13 +185,19 @@ private:
 
 
 //==============================================================================
+/// Decodes an audio file from the patch into an object that can be used as a Cmajor
+/// std::audio_data value. If a cache is provided, the decoded data is stored in it,
+/// keyed by the content of the file and the annotation's "resample" and "sourceChannel"
+/// properties, so that later loads of the same file don't need to decode it again.
 choc::value::Value readManifestResourceAsAudioData (const PatchManifest& manifest,
                                                     const std::string& path,
-                                                    const choc::value::ValueView& annotation);
+                                                    const choc::value::ValueView& annotation,
+                                                    CacheDatabaseInterface* audioDataCache = nullptr);
 
 choc::value::Value replaceFilenameStringsWithAudioData (const PatchManifest& manifest,
                                                         const choc::value::ValueView& sourceObject,
-                                                        const choc::value::ValueView& annotation);
+                                                        const choc::value::ValueView& annotation,
+                                                        CacheDatabaseInterface* audioDataCache = nullptr);
 
 std::optional<std::string> readJavascriptResource (std::string_view resourcePath, const PatchManifest*);
 
@@ -454,14 +464,14 @@ inline std::unordered_map<std::string, choc::value::ValueView> PatchManifest::ge
     return result;
 }
 
-inline std::function<choc::value::Value(const cmaj::ExternalVariable&)> PatchManifest::createExternalResolverFunction() const
+inline std::function<choc::value::Value(const cmaj::ExternalVariable&)> PatchManifest::createExternalResolverFunction (CacheDatabaseInterface* audioDataCache) const
 {
-    return [this, list = getExternalsList()] (const cmaj::ExternalVariable& v) -> choc::value::Value
+    return [this, list = getExternalsList(), audioDataCache] (const cmaj::ExternalVariable& v) -> choc::value::Value
     {
         auto external = list.find (v.name);
 
         if (external != list.end())
-            return replaceFilenameStringsWithAudioData (*this, external->second, v.annotation);
+            return replaceFilenameStringsWithAudioData (*this, external->second, v.annotation, audioDataCache);
 
         return {};
     };
@@ -495,11 +505,102 @@ inline bool PatchManifest::addSourceFilesToProgram (Program& program,
 }
 
 //==============================================================================
+namespace decoded_audio_cache
+{
+    // The cached data is this header, followed by the interleaved float32 frames
+    struct Header
+    {
+        uint32_t magic, numChannels, numFrames, reserved;
+        double sampleRate;
+    };
+
+    static constexpr uint32_t magicNumber = 0x75614d43; // "CMau" - change this if the format changes
+
+    inline std::string createKey (std::istream& file, const choc::value::ValueView& annotation)
+    {
+        choc::hash::xxHash64 hash (magicNumber);
+        char buffer[16384];
+
+        for (;;)
+        {
+            file.read (buffer, sizeof (buffer));
+            auto numRead = file.gcount();
+
+            if (numRead <= 0)
+                break;
+
+            hash.addInput (buffer, static_cast<size_t> (numRead));
+        }
+
+        if (annotation.isObject())
+        {
+            auto settings = std::to_string (annotation["resample"].getWithDefault<double> (0))
+                              + " " + std::to_string (annotation["sourceChannel"].getWithDefault<int64_t> (-1));
+            hash.addInput (settings.data(), settings.length());
+        }
+
+        return "audio_" + choc::text::createHexString (hash.getHash());
+    }
+
+    inline choc::value::Value reload (CacheDatabaseInterface& cache, const std::string& key)
+    {
+        auto size = cache.reload (key.c_str(), nullptr, 0);
+
+        if (size <= sizeof (Header))
+            return {};
+
+        std::vector<float> data ((static_cast<size_t> (size) + sizeof (float) - 1) / sizeof (float));
+
+        if (cache.reload (key.c_str(), data.data(), size) != size)
+            return {};
+
+        Header header;
+        memcpy (std::addressof (header), data.data(), sizeof (header));
+        static_assert (sizeof (Header) % sizeof (float) == 0);
+
+        if (header.magic != magicNumber || header.numChannels == 0
+             || size != sizeof (Header) + sizeof (float) * static_cast<uint64_t> (header.numChannels) * header.numFrames)
+            return {};
+
+        auto frames = choc::buffer::createInterleavedView (data.data() + sizeof (Header) / sizeof (float),
+                                                           header.numChannels, header.numFrames);
+
+        return createAudioFileObject (choc::buffer::createValueViewFromBuffer (frames), header.sampleRate);
+    }
+
+    inline void store (CacheDatabaseInterface& cache, const std::string& key, const choc::audio::AudioFileData& audio)
+    {
+        auto numChannels = audio.frames.getNumChannels();
+        auto numFrames = audio.frames.getNumFrames();
+
+        std::vector<float> data (sizeof (Header) / sizeof (float) + static_cast<size_t> (numChannels) * numFrames);
+        Header header { magicNumber, numChannels, numFrames, 0, audio.sampleRate };
+        memcpy (data.data(), std::addressof (header), sizeof (header));
+
+        copy (choc::buffer::createInterleavedView (data.data() + sizeof (Header) / sizeof (float), numChannels, numFrames),
+              audio.frames);
+
+        cache.store (key.c_str(), data.data(), data.size() * sizeof (float));
+    }
+}
+
 inline choc::value::Value readManifestResourceAsAudioData (const PatchManifest& manifest,
                                                            const std::string& path,
-                                                           const choc::value::ValueView& annotation)
+                                                           const choc::value::ValueView& annotation,
+                                                           CacheDatabaseInterface* audioDataCache)
 {
-    choc::value::Value audioFileContent;
+    std::string cacheKey;
+
+    if (audioDataCache != nullptr)
+    {
+        if (auto reader = manifest.createFileReader (path))
+        {
+            cacheKey = decoded_audio_cache::createKey (*reader, annotation);
+
+            if (auto cached = decoded_audio_cache::reload (*audioDataCache, cacheKey); ! cached.isVoid())
+                return cached;
+        }
+    }
 
     if (auto reader = manifest.createFileReader (path))
     {
@@ -509,18 +610,24 @@ inline choc::value::Value readManifestResourceAsAudioData (const PatchManifest&
         formats.addFormat<choc::audio::FLACAudioFileFormat<false>>();
         formats.addFormat<choc::audio::WAVAudioFileFormat<true>>();
 
-        auto error = cmaj::readAudioFileAsValue (audioFileContent, formats, reader, annotation);
+        choc::audio::AudioFileData audio;
 
-        if (! error.empty())
+        if (! cmaj::readAudioFileData (audio, formats, reader, annotation).empty())
             return {};
+
+        if (! cacheKey.empty())
+            decoded_audio_cache::store (*audioDataCache, cacheKey, audio);
+
+        return convertAudioDataToObject (audio.frames, audio.sampleRate);
     }
 
-    return audioFileContent;
+    return {};
 }
 
 inline choc::value::Value replaceFilenameStringsWithAudioData (const PatchManifest& manifest,
                                                                const choc::value::ValueView& v,
-                                                               const choc::value::ValueView& annotation)
+                                                               const choc::value::ValueView& annotation,
+                                                               CacheDatabaseInterface* audioDataCache)
 {
     if (v.isVoid())
         return {};
@@ -529,7 +636,7 @@ inline choc::value::Value replaceFilenameStringsWithAudioData (const PatchManife
     {
         try
         {
-            auto audio = readManifestResourceAsAudioData (manifest, v.get<std::string>(), annotation);
+            auto audio = readManifestResourceAsAudioData (manifest, v.get<std::string>(), annotation, audioDataCache);
 
             if (! audio.isVoid())
                 return audio;
@@ -543,7 +650,7 @@ inline choc::value::Value replaceFilenameStringsWithAudioData (const PatchManife
         auto copy = choc::value::createEmptyArray();
 
         for (auto element : v)
-            copy.addArrayElement (replaceFilenameStringsWithAudioData (manifest, element, annotation));
+            copy.addArrayElement (replaceFilenameStringsWithAudioData (manifest, element, annotation, audioDataCache));
 
         return copy;
     }
@@ -555,7 +662,7 @@ inline choc::value::Value replaceFilenameStringsWithAudioData (const PatchManife
         for (uint32_t i = 0; i < v.size(); ++i)
         {
             auto m = v.getObjectMemberAt (i);
-            copy.setMember (m.name, replaceFilenameStringsWithAudioData (manifest, m.value, annotation));
+            copy.setMember (m.name, replaceFilenameStringsWithAudioData (manifest, m.value, annotation, audioDataCache));
         }
 
         return copy;
@@ -79,7 +79,8 @@ inline void enableQuickJSPatchWorker (Patch& p)
                 {
                     if (auto path = args.get<std::string>(0); ! path.empty())
                         if (auto manifest = p.getManifest())
-                            return readManifestResourceAsAudioData (*manifest, path, args[1] != nullptr ? *args[1] : choc::value::Value());
+                            return readManifestResourceAsAudioData (*manifest, path, args[1] != nullptr ? *args[1] : choc::value::Value(),
+                                                                   p.audioDataCache.get());
                 }
                 catch (...)
                 {}
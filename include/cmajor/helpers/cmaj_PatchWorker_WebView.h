@@ -101,7 +101,7 @@ inline void enableWebViewPatchWorker (Patch& p)
                                 annotation = args[1];
 
                             if (auto manifest = p.getManifest())
-                                return readManifestResourceAsAudioData (*manifest, path, annotation);
+                                return readManifestResourceAsAudioData (*manifest, path, annotation, p.audioDataCache.get());
                         }
                     }
                 }
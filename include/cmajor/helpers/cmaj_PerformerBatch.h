@@ -0,0 +1,383 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../API/cmaj_Engine.h"
+
+
+namespace cmaj
+{
+
+//==============================================================================
+/// Runs a set of identical performers in lock-step.
+///
+/// All the instances are created from the same linked Engine, so they share one copy
+/// of the compiled code, and each block is rendered by running every instance
+/// back-to-back over it. Each instance keeps its own state and can still be addressed
+/// individually with operator[], but the stream helpers here also let you pass a single
+/// multi-channel buffer for the whole batch, in which each instance gets its own group
+/// of adjacent channels.
+///
+/// The results are identical to running the same number of separate performers.
+/// Once create() has been called, none of the methods used to render a block allocate.
+///
+/// By default advance() runs the instances one after another on the calling thread,
+/// but setNumThreads() can be used to spread them across a pool of worker threads.
+///
+struct PerformerBatch
+{
+    PerformerBatch() = default;
+    PerformerBatch (const PerformerBatch&) = delete;
+    ~PerformerBatch();
+
+    /// Creates the given number of instances from an engine which must already have
+    /// been linked. Returns false if the performers couldn't be created.
+    bool create (Engine&, uint32_t numInstances);
+
+    /// Releases all the instances
+    void clear();
+
+    /// Sets the number of threads that advance() uses, including the caller's thread.
+    /// When this is more than 1, a pool of worker threads is started. They sleep between
+    /// blocks, and advance() wakes them to share out the instances, with the calling
+    /// thread rendering its share too. Each instance is always rendered by a single
+    /// thread, so the results are identical to a single-threaded run.
+    /// This must not be called while advance() is running.
+    void setNumThreads (uint32_t numThreads);
+
+    uint32_t size() const                                   { return static_cast<uint32_t> (instances.size()); }
+    bool empty() const                                      { return instances.empty(); }
+
+    /// Returns one of the instances, e.g. to send it events or values of its own.
+    Performer& operator[] (uint32_t index)                  { return instances[index]; }
+    const Performer& operator[] (uint32_t index) const      { return instances[index]; }
+
+    /// Calls reset() on all instances
+    Result reset();
+
+    /// Sets the block size for the next call to advance() on all instances
+    Result setBlockSize (uint32_t numFramesForNextBlock);
+
+    /// Sends the same value to all instances
+    template <typename ValueType>
+    Result setInputValue (EndpointHandle, const ValueType& newValue, uint32_t numFramesToReachValue);
+
+    /// Takes a buffer which contains a group of channels for each instance, and sends each
+    /// group to the stream endpoint of the corresponding instance. The buffer must have a
+    /// multiple of size() channels, and no more frames than the maximum block size.
+    template <typename SampleType>
+    Result setInputFrames (EndpointHandle, const choc::buffer::InterleavedView<SampleType>& allInstances);
+
+    /// Copies the output stream of each instance into its own group of channels in the
+    /// destination buffer, which must have a multiple of size() channels, and no more
+    /// frames than the maximum block size.
+    template <typename SampleType>
+    Result copyOutputFrames (EndpointHandle, const choc::buffer::InterleavedView<SampleType>& allInstances);
+
+    /// Renders the next block on all instances
+    Result advance();
+
+private:
+    //==============================================================================
+    struct WorkerPool;
+
+    std::vector<Performer> instances;
+    std::vector<uint64_t> scratchSpace;
+    std::unique_ptr<WorkerPool> workerPool;
+
+    template <typename SampleType>
+    choc::buffer::InterleavedView<SampleType> getScratchBuffer (uint32_t numChannels, uint32_t numFrames);
+};
+
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+struct PerformerBatch::WorkerPool
+{
+    WorkerPool (PerformerBatch& b, uint32_t numThreads) : batch (b)
+    {
+        for (uint32_t i = 1; i < numThreads; ++i)
+            threads.emplace_back ([this] { runWorker(); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::scoped_lock l (lock);
+            shouldStop = true;
+        }
+
+        workAvailable.notify_all();
+
+        for (auto& t : threads)
+            t.join();
+    }
+
+    Result advanceAll()
+    {
+        numFinished.store (0, std::memory_order_relaxed);
+        firstError.store (static_cast<int32_t> (Result::Ok), std::memory_order_relaxed);
+        nextInstance.store (0, std::memory_order_release);
+
+        {
+            std::scoped_lock l (lock);
+            ++generation;
+        }
+
+        workAvailable.notify_all();
+        processInstances();
+
+        // By the time the caller has run out of instances to claim, the only ones left are
+        // those that workers are already in the middle of rendering, so this wait is short
+        auto numInstances = batch.size();
+
+        while (numFinished.load (std::memory_order_acquire) < numInstances)
+            std::this_thread::yield();
+
+        return static_cast<Result> (firstError.load (std::memory_order_relaxed));
+    }
+
+private:
+    PerformerBatch& batch;
+    std::vector<std::thread> threads;
+
+    std::mutex lock;
+    std::condition_variable workAvailable;
+    uint64_t generation = 0;
+    bool shouldStop = false;
+
+    alignas (64) std::atomic<uint32_t> nextInstance { 0 };
+    alignas (64) std::atomic<uint32_t> numFinished { 0 };
+    std::atomic<int32_t> firstError { 0 };
+
+    void processInstances()
+    {
+        auto numInstances = batch.size();
+
+        for (;;)
+        {
+            auto index = nextInstance.fetch_add (1, std::memory_order_acq_rel);
+
+            if (index >= numInstances)
+                return;
+
+            if (auto r = batch.instances[index].advance(); r != Result::Ok)
+            {
+                auto expected = static_cast<int32_t> (Result::Ok);
+                firstError.compare_exchange_strong (expected, static_cast<int32_t> (r), std::memory_order_relaxed);
+            }
+
+            numFinished.fetch_add (1, std::memory_order_acq_rel);
+        }
+    }
+
+    void runWorker()
+    {
+        uint64_t lastGeneration = 0;
+
+        for (;;)
+        {
+            {
+                std::unique_lock l (lock);
+                workAvailable.wait (l, [&] { return shouldStop || generation != lastGeneration; });
+
+                if (shouldStop)
+                    return;
+
+                lastGeneration = generation;
+            }
+
+            processInstances();
+        }
+    }
+};
+
+inline PerformerBatch::~PerformerBatch()
+{
+    workerPool.reset();
+}
+
+inline bool PerformerBatch::create (Engine& engine, uint32_t numInstances)
+{
+    clear();
+    instances.reserve (numInstances);
+
+    for (uint32_t i = 0; i < numInstances; ++i)
+    {
+        auto performer = engine.createPerformer();
+
+        if (! performer)
+        {
+            clear();
+            return false;
+        }
+
+        instances.push_back (std::move (performer));
+    }
+
+    if (instances.empty())
+        return true;
+
+    // The stream helpers pack one instance's frames at a time into this, so it's made big
+    // enough for a full block of the largest stream endpoint now, rather than on the
+    // rendering thread
+    size_t largestFrameSize = 0;
+
+    for (auto& endpoints : { engine.getInputEndpoints(), engine.getOutputEndpoints() })
+        for (auto& e : endpoints)
+            if (e.isStream())
+                largestFrameSize = std::max (largestFrameSize, static_cast<size_t> (e.dataTypes.front().getValueDataSize()));
+
+    auto maxBytes = largestFrameSize * instances.front().getMaximumBlockSize();
+    scratchSpace.resize ((maxBytes + sizeof (uint64_t) - 1) / sizeof (uint64_t));
+    return true;
+}
+
+inline void PerformerBatch::clear()
+{
+    instances.clear();
+    scratchSpace.clear();
+}
+
+inline void PerformerBatch::setNumThreads (uint32_t numThreads)
+{
+    workerPool.reset();
+
+    if (numThreads > 1)
+        workerPool = std::make_unique<WorkerPool> (*this, numThreads);
+}
+
+inline Result PerformerBatch::reset()
+{
+    for (auto& p : instances)
+        if (auto r = p.reset(); r != Result::Ok)
+            return r;
+
+    return Result::Ok;
+}
+
+inline Result PerformerBatch::setBlockSize (uint32_t numFramesForNextBlock)
+{
+    for (auto& p : instances)
+        if (auto r = p.setBlockSize (numFramesForNextBlock); r != Result::Ok)
+            return r;
+
+    return Result::Ok;
+}
+
+template <typename ValueType>
+Result PerformerBatch::setInputValue (EndpointHandle endpoint, const ValueType& newValue, uint32_t numFramesToReachValue)
+{
+    for (auto& p : instances)
+        if (auto r = p.setInputValue (endpoint, newValue, numFramesToReachValue); r != Result::Ok)
+            return r;
+
+    return Result::Ok;
+}
+
+template <typename SampleType>
+Result PerformerBatch::setInputFrames (EndpointHandle endpoint, const choc::buffer::InterleavedView<SampleType>& allInstances)
+{
+    auto numInstances = size();
+
+    if (numInstances == 0)
+        return Result::Ok;
+
+    auto numChannels = allInstances.getNumChannels() / numInstances;
+    CMAJ_ASSERT (numChannels * numInstances == allInstances.getNumChannels());
+    auto numFrames = allInstances.getNumFrames();
+    auto packed = getScratchBuffer<SampleType> (numChannels, numFrames);
+
+    for (uint32_t i = 0; i < numInstances; ++i)
+    {
+        copy (packed, allInstances.getChannelRange ({ i * numChannels, (i + 1) * numChannels }));
+
+        if (auto r = instances[i].setInputFrames (endpoint, packed.data.data, numFrames); r != Result::Ok)
+            return r;
+    }
+
+    return Result::Ok;
+}
+
+template <typename SampleType>
+Result PerformerBatch::copyOutputFrames (EndpointHandle endpoint, const choc::buffer::InterleavedView<SampleType>& allInstances)
+{
+    auto numInstances = size();
+
+    if (numInstances == 0)
+        return Result::Ok;
+
+    auto numChannels = allInstances.getNumChannels() / numInstances;
+    CMAJ_ASSERT (numChannels * numInstances == allInstances.getNumChannels());
+    auto numFrames = allInstances.getNumFrames();
+    auto packed = getScratchBuffer<SampleType> (numChannels, numFrames);
+
+    for (uint32_t i = 0; i < numInstances; ++i)
+    {
+        if (auto r = instances[i].copyOutputFrames (endpoint, packed.data.data, numFrames); r != Result::Ok)
+            return r;
+
+        copy (allInstances.getChannelRange ({ i * numChannels, (i + 1) * numChannels }), packed);
+    }
+
+    return Result::Ok;
+}
+
+inline Result PerformerBatch::advance()
+{
+    if (workerPool != nullptr && instances.size() > 1)
+        return workerPool->advanceAll();
+
+    for (auto& p : instances)
+        if (auto r = p.advance(); r != Result::Ok)
+            return r;
+
+    return Result::Ok;
+}
+
+template <typename SampleType>
+choc::buffer::InterleavedView<SampleType> PerformerBatch::getScratchBuffer (uint32_t numChannels, uint32_t numFrames)
+{
+    auto numWords = (static_cast<size_t> (numChannels) * numFrames * sizeof (SampleType) + sizeof (uint64_t) - 1) / sizeof (uint64_t);
+
+    // This is sized in create(), and must never grow here because it's used while rendering
+    CMAJ_ASSERT (numWords <= scratchSpace.size());
+
+    return choc::buffer::createInterleavedView (reinterpret_cast<SampleType*> (scratchSpace.data()), numChannels, numFrames);
+}
+
+} // namespace cmaj
@@ -0,0 +1,852 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "../../choc/platform/choc_DynamicLibrary.h"
+#include "../../choc/memory/choc_AlignedMemoryBlock.h"
+#include "../../choc/text/choc_Files.h"
+#include "../API/cmaj_Engine.h"
+
+#ifndef _WIN32
+ #include <cerrno>
+ #include <spawn.h>
+ #include <sys/wait.h>
+ #include <unistd.h>
+
+ extern char** environ;
+#endif
+
+namespace cmaj
+{
+
+//==============================================================================
+/// This function loads a shared library that was built from a Cmajor program with
+/// `cmaj generate --target=sharedlib`, and returns a cmaj::Engine that can create
+/// performers for it. If the library can't be loaded, it returns a null Engine.
+///
+/// The library contains native code that was compiled ahead-of-time, so this doesn't
+/// need the Cmajor compiler or LLVM to be present in the process. For more details,
+/// see the PerformerLibraryEngine class, which is used as the wrapper.
+Engine createEngineForPerformerLibrary (const std::string& pathToLibrary);
+
+/// Links some object code that was produced by the `sharedlib` code-gen target into a
+/// shared library that createEngineForPerformerLibrary() can load.
+///
+/// The linker is a compiler driver command such as "c++" or "clang -fuse-ld=lld". It's
+/// split into arguments at its spaces and run directly rather than via a shell, so the
+/// library path is never interpreted as part of a command line. This is only available
+/// on POSIX systems. It returns an error message, including anything that the linker
+/// printed, if it fails.
+std::string linkPerformerLibrary (const std::string& objectCode,
+                                  const std::string& pathToLibrary,
+                                  const std::string& linker = "c++");
+
+//==============================================================================
+/// The name of the C function that a performer library exports. It takes no
+/// arguments and returns a pointer to a PerformerLibraryInfo.
+static constexpr const char* performerLibraryEntryPoint = "cmajor_getPerformerLibrary";
+
+/// This is bumped whenever the format of a PerformerLibraryInfo or its JSON changes.
+static constexpr uint32_t performerLibraryVersion = 1;
+
+/// The structure that a performer library's entry point returns. The LLVM code generator
+/// emits this as a constant, so its layout mustn't change without bumping the version.
+///
+/// The details JSON contains the program details, the sizes of the state and IO memory
+/// that each instance needs, and for each endpoint, its handle, where its data lives,
+/// how to convert its native data layout to the packed one that the API uses, and the
+/// indexes in the function table of any functions that need to be called to use it.
+struct PerformerLibraryInfo
+{
+    uint32_t version;
+    uint32_t numFunctions;
+    const char* detailsJSON;
+    void* const* functions;
+    const char* stringDictionary;
+    uint64_t stringDictionarySize;
+};
+
+//==============================================================================
+///
+/// This helper class lets you create a cmaj::Engine object around a shared library
+/// that was built ahead-of-time with the command-line tool's `--target=sharedlib`
+/// option.
+///
+/// Like the GeneratedCppEngine, there's no point in calling load() or link() on
+/// this engine, and you can't set external variables, but you can query it for
+/// endpoints and set the frequency and session ID via the BuildSettings.
+///
+/// Note that rather than constructing this class directly, you can call the
+/// createEngineForPerformerLibrary() function which will return an instance
+/// that is nicely wrapped in a cmaj::Engine object.
+///
+struct PerformerLibraryEngine  : public choc::com::ObjectWithAtomicRefCount<EngineInterface, PerformerLibraryEngine>
+{
+    PerformerLibraryEngine() = default;
+    virtual ~PerformerLibraryEngine() = default;
+
+    /// Loads the library, returning an error message if it fails.
+    std::string loadLibrary (const std::string& pathToLibrary);
+
+    //==============================================================================
+    choc::com::String* getBuildSettings() override
+    {
+        return choc::com::createRawString (buildSettings.toJSON());
+    }
+
+    void setBuildSettings (const char* newSettings) override
+    {
+        buildSettings = BuildSettings::fromJSON (std::string_view (newSettings));
+
+        if (library != nullptr)
+            buildSettings.setMaxBlockSize (library->maxBlockSize);
+    }
+
+    //==============================================================================
+    void unload() override          { loaded = linked = false; }
+    bool isLoaded() override        { return loaded; }
+    bool isLinked() override        { return linked; }
+
+    choc::com::String* load (ProgramInterface*,
+                             void*, EngineInterface::RequestExternalVariableFn,
+                             void*, EngineInterface::RequestExternalFunctionFn) override   { loaded = true; linked = false; return {}; }
+    choc::com::String* link (CacheDatabaseInterface*) override                             { loaded = linked = true; return {}; }
+    choc::com::String* getLastBuildLog() override                                          { return {}; }
+
+    PerformerInterface* createPerformer() override
+    {
+        if (library == nullptr)
+            return {};
+
+        return choc::com::create<Performer> (library, getSessionID(), getFrequency()).getWithIncrementedRefCount();
+    }
+
+    //==============================================================================
+    choc::com::String* getProgramDetails() override
+    {
+        if (library == nullptr)
+            return {};
+
+        return choc::com::createRawString (library->programDetailsJSON);
+    }
+
+    EndpointHandle getEndpointHandle (const char* endpointName) override
+    {
+        if (library != nullptr && endpointName != nullptr)
+            for (auto& e : library->endpoints)
+                if (e.endpointID == endpointName)
+                    return e.handle;
+
+        return {};
+    }
+
+    bool setExternalVariable (const char*, const void*, size_t) override { return false; }
+
+    const char* getAvailableCodeGenTargetTypes() override   { return ""; }
+    void generateCode (const char*, const char*, void*, EngineInterface::HandleCodeGenOutput) override {}
+
+    BuildSettings buildSettings;
+
+    /// The alignment of the state and IO memory that each performer allocates
+    static constexpr size_t memoryAlignment = 128;
+
+private:
+    //==============================================================================
+    /// Converts between the packed data layout that the API uses and the native one
+    /// that the compiled code uses. It's a list of chunks which can be copied with a
+    /// memcpy, apart from bool vectors, which are stored natively as bits.
+    struct DataLayout
+    {
+        struct Chunk
+        {
+            uint32_t packedOffset, nativeOffset, numBytes, numBits;
+        };
+
+        std::vector<Chunk> chunks;
+        uint32_t nativeSize = 0, packedSize = 0;
+
+        bool requiresPacking() const    { return ! chunks.empty(); }
+
+        void copyNativeToPacked (void* packedDest, const void* nativeSource) const
+        {
+            if (! requiresPacking())
+            {
+                std::memcpy (packedDest, nativeSource, nativeSize);
+                return;
+            }
+
+            auto dest = static_cast<uint8_t*> (packedDest);
+            auto source = static_cast<const uint8_t*> (nativeSource);
+
+            for (auto& c : chunks)
+            {
+                if (c.numBits == 0)
+                {
+                    std::memcpy (dest + c.packedOffset, source + c.nativeOffset, c.numBytes);
+                }
+                else
+                {
+                    auto d = reinterpret_cast<uint32_t*> (dest + c.packedOffset);
+
+                    for (uint32_t i = 0; i < c.numBits; ++i)
+                        d[i] = (source[c.nativeOffset + i / 8] >> (i & 7u)) & 1u;
+                }
+            }
+        }
+
+        void copyPackedToNative (void* nativeDest, const void* packedSource) const
+        {
+            if (! requiresPacking())
+            {
+                std::memcpy (nativeDest, packedSource, nativeSize);
+                return;
+            }
+
+            auto dest = static_cast<uint8_t*> (nativeDest);
+            auto source = static_cast<const uint8_t*> (packedSource);
+
+            for (auto& c : chunks)
+            {
+                if (c.numBits == 0)
+                {
+                    std::memcpy (dest + c.nativeOffset, source + c.packedOffset, c.numBytes);
+                }
+                else
+                {
+                    auto s = reinterpret_cast<const uint32_t*> (source + c.packedOffset);
+                    std::memset (dest + c.nativeOffset, 0, (c.numBits + 7u) / 8u);
+
+                    for (uint32_t i = 0; i < c.numBits; ++i)
+                        if (s[i] != 0)
+                            dest[c.nativeOffset + i / 8] |= static_cast<uint8_t> (1u << (i & 7u));
+                }
+            }
+        }
+
+        static DataLayout fromJSON (const choc::value::ValueView& v)
+        {
+            DataLayout l;
+            l.nativeSize = v["nativeSize"].getWithDefault<uint32_t> (0);
+            l.packedSize = v["packedSize"].getWithDefault<uint32_t> (0);
+
+            if (v.hasObjectMember ("chunks"))
+                for (auto c : v["chunks"])
+                    l.chunks.push_back ({ c[0].get<uint32_t>(), c[1].get<uint32_t>(), c[2].get<uint32_t>(), c[3].get<uint32_t>() });
+
+            return l;
+        }
+    };
+
+    //==============================================================================
+    /// The ways in which an event handler function can take its argument
+    enum class EventArgument { none, int32, int64, float32, float64, pointer };
+
+    struct EventType
+    {
+        void* function = nullptr;
+        EventArgument argument = EventArgument::none;
+        uint32_t offset = 0;
+        DataLayout layout;
+    };
+
+    struct Endpoint
+    {
+        EndpointHandle handle = {};
+        std::string endpointID;
+        bool isInput = false;
+        EndpointType endpointType = EndpointType::unknown;
+
+        // For streams, these are the offset in the IO memory and the native frame stride.
+        // For output values, the offset is the value's position in the state, and for input
+        // values, the stride is the padded size that the setter function reads. For output
+        // events, they're the position and element size of the state's event list.
+        uint32_t offset = 0, stride = 0;
+        uint32_t eventCountOffset = 0, eventTypeFieldOffset = 0;
+        DataLayout layout;
+        void* setValueFunction = nullptr;
+        std::vector<EventType> eventTypes;
+    };
+
+    //==============================================================================
+    struct LoadedLibrary
+    {
+        using InitialiseFn       = void*(*)(void*, int32_t*, int32_t, double);
+        using AdvanceOneFrameFn  = void(*)(void*, void*);
+        using AdvanceBlockFn     = void(*)(void*, void*, uint32_t);
+
+        std::unique_ptr<choc::file::DynamicLibrary> dll;
+        std::string programDetailsJSON;
+        choc::value::SimpleStringDictionary stringDictionary;
+        std::vector<Endpoint> endpoints;
+
+        InitialiseFn initialiseFn = {};
+        AdvanceOneFrameFn advanceOneFrameFn = {};
+        AdvanceBlockFn advanceBlockFn = {};
+
+        uint32_t stateSize = 0, ioSize = 0, maxBlockSize = 0, eventBufferSize = 0;
+        double latency = 0;
+
+        std::string load (const std::string& path);
+        const Endpoint* findEndpoint (EndpointHandle) const;
+    };
+
+    std::shared_ptr<LoadedLibrary> library;
+    bool loaded = false, linked = false;
+
+    int32_t getSessionID() const
+    {
+        if (auto sessionID = buildSettings.getSessionID())
+            return sessionID;
+
+        return static_cast<int32_t> ((std::rand() & 0xfffff) + 1);
+    }
+
+    double getFrequency() const
+    {
+        auto f = buildSettings.getFrequency();
+        return f > 1.0 ? f : 44100.0;
+    }
+
+    //==============================================================================
+    struct Performer  : public choc::com::ObjectWithAtomicRefCount<PerformerInterface, Performer>
+    {
+        Performer (std::shared_ptr<LoadedLibrary>, int32_t sessionID, double frequency);
+        virtual ~Performer() = default;
+
+        Result setBlockSize (uint32_t numFramesForNextBlock) override;
+        Result reset() override;
+        Result advance() override;
+        Result setInputFrames (EndpointHandle, const void* frameData, uint32_t numFrames) override;
+        Result setInputValue (EndpointHandle, const void* valueData, uint32_t numFramesToReachValue) override;
+        Result addInputEvent (EndpointHandle, uint32_t typeIndex, const void* eventData) override;
+        Result addInputEvents (EndpointHandle, const EventBatch*) override;
+        Result copyOutputValue (EndpointHandle, void* dest) override;
+        Result copyOutputFrames (EndpointHandle, void* dest, uint32_t numFramesToCopy) override;
+        Result iterateOutputEvents (EndpointHandle, void* context, PerformerInterface::HandleOutputEventCallback) override;
+        const char* getStringForHandle (uint32_t handle, size_t& stringLength) override;
+
+        uint32_t getXRuns() override                    { return xruns; }
+        const char* getRuntimeError() override          { return {}; }
+        choc::com::String* getNodeProfile() override    { return {}; }
+        void prefetchEndpoint (EndpointHandle) override {}
+        bool isRunningQuickTier() override              { return false; }
+
+        uint32_t getMaximumBlockSize() override         { return library->maxBlockSize; }
+        double getLatency() override                    { return library->latency; }
+        uint32_t getEventBufferSize() override          { return library->eventBufferSize; }
+
+    private:
+        std::shared_ptr<LoadedLibrary> library;
+        choc::AlignedMemoryBlock<memoryAlignment> stateMemory, ioMemory;
+        choc::AlignedMemoryBlock<16> scratchMemory;
+        uint8_t* state = nullptr;
+        uint8_t* io = nullptr;
+        uint32_t currentBlockSize = 1, xruns = 0;
+        int32_t sessionID;
+        double frequency;
+
+        void sendEvent (const EventType&, const void* eventData);
+    };
+};
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+inline Engine createEngineForPerformerLibrary (const std::string& pathToLibrary)
+{
+    auto engine = choc::com::create<PerformerLibraryEngine>();
+
+    if (! engine->loadLibrary (pathToLibrary).empty())
+        return {};
+
+    return Engine (EnginePtr (engine.getWithIncrementedRefCount()));
+}
+
+inline std::string linkPerformerLibrary (const std::string& objectCode, const std::string& pathToLibrary, const std::string& linker)
+{
+   #ifdef _WIN32
+    (void) objectCode; (void) pathToLibrary; (void) linker;
+    return "Linking a performer library isn't supported on Windows";
+   #else
+    choc::file::TempFile objectFile (choc::file::TempFile::createRandomFilename ("cmaj_sharedlib", "o"));
+    choc::file::replaceFileWithContent (objectFile.file, objectCode);
+
+    std::vector<std::string> args;
+
+    for (auto& arg : choc::text::splitAtWhitespace (linker))
+        if (! arg.empty())
+            args.push_back (arg);
+
+    if (args.empty())
+        return "No linker was specified";
+
+    for (auto arg : { "-shared", "-o" })
+        args.push_back (arg);
+
+    args.push_back (pathToLibrary);
+    args.push_back (objectFile.file.string());
+    args.push_back ("-lm");
+
+    std::vector<char*> argv;
+
+    for (auto& arg : args)
+        argv.push_back (arg.data());
+
+    argv.push_back (nullptr);
+
+    // The linker's stdout and stderr both go to a pipe, so that its messages can be returned
+    int outputPipe[2];
+
+    if (::pipe (outputPipe) != 0)
+        return "Failed to create a pipe for the linker";
+
+    posix_spawn_file_actions_t actions;
+    ::posix_spawn_file_actions_init (std::addressof (actions));
+    ::posix_spawn_file_actions_addclose (std::addressof (actions), outputPipe[0]);
+    ::posix_spawn_file_actions_adddup2 (std::addressof (actions), outputPipe[1], STDOUT_FILENO);
+    ::posix_spawn_file_actions_adddup2 (std::addressof (actions), outputPipe[1], STDERR_FILENO);
+    ::posix_spawn_file_actions_addclose (std::addressof (actions), outputPipe[1]);
+
+    pid_t pid = 0;
+    auto spawnResult = ::posix_spawnp (std::addressof (pid), argv[0], std::addressof (actions), nullptr, argv.data(), environ);
+    ::posix_spawn_file_actions_destroy (std::addressof (actions));
+    ::close (outputPipe[1]);
+
+    if (spawnResult != 0)
+    {
+        ::close (outputPipe[0]);
+        return "Failed to run the linker " + args.front() + ": " + std::strerror (spawnResult);
+    }
+
+    std::string linkerOutput;
+    char buffer[1024];
+
+    for (;;)
+    {
+        auto bytesRead = ::read (outputPipe[0], buffer, sizeof (buffer));
+
+        if (bytesRead > 0)
+            linkerOutput.append (buffer, static_cast<size_t> (bytesRead));
+        else if (bytesRead == 0 || errno != EINTR)
+            break;
+    }
+
+    ::close (outputPipe[0]);
+
+    int status = 0;
+
+    while (::waitpid (pid, std::addressof (status), 0) < 0)
+        if (errno != EINTR)
+            return "Failed to wait for the linker";
+
+    if (! WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        return "The linker failed: " + choc::text::joinStrings (args, " ") + "\n" + linkerOutput;
+
+    return {};
+   #endif
+}
+
+inline std::string PerformerLibraryEngine::loadLibrary (const std::string& pathToLibrary)
+{
+    auto newLibrary = std::make_shared<LoadedLibrary>();
+
+    if (auto error = newLibrary->load (pathToLibrary); ! error.empty())
+        return error;
+
+    library = std::move (newLibrary);
+    buildSettings.setMaxBlockSize (library->maxBlockSize);
+    buildSettings.setEventBufferSize (library->eventBufferSize);
+    return {};
+}
+
+inline std::string PerformerLibraryEngine::LoadedLibrary::load (const std::string& path)
+{
+    dll = std::make_unique<choc::file::DynamicLibrary> (path);
+
+    if (dll->handle == nullptr)
+        return "Could not open " + path;
+
+    using GetInfoFn = const PerformerLibraryInfo*(*)();
+    auto getInfo = reinterpret_cast<GetInfoFn> (dll->findFunction (performerLibraryEntryPoint));
+
+    if (getInfo == nullptr)
+        return path + " is not a Cmajor performer library";
+
+    auto info = getInfo();
+
+    if (info == nullptr || info->version != performerLibraryVersion || info->detailsJSON == nullptr)
+        return path + " was built for a different version of Cmajor";
+
+    try
+    {
+        auto details = choc::json::parse (info->detailsJSON);
+
+        auto getFunction = [info] (const choc::value::ValueView& index) -> void*
+        {
+            auto i = index.getWithDefault<int32_t> (-1);
+
+            if (i < 0)
+                return nullptr;
+
+            if (static_cast<uint32_t> (i) >= info->numFunctions)
+                throw std::runtime_error ("Function index out of range");
+
+            return info->functions[i];
+        };
+
+        programDetailsJSON = choc::json::toString (details["programDetails"], true);
+        stateSize       = details["stateSize"].get<uint32_t>();
+        ioSize          = details["ioSize"].get<uint32_t>();
+        maxBlockSize    = details["maxBlockSize"].get<uint32_t>();
+        eventBufferSize = details["eventBufferSize"].get<uint32_t>();
+        latency         = details["latency"].getWithDefault<double> (0);
+
+        initialiseFn = reinterpret_cast<InitialiseFn> (getFunction (details["initialise"]));
+
+        if (details["singleFrameOnly"].getWithDefault<bool> (false))
+            advanceOneFrameFn = reinterpret_cast<AdvanceOneFrameFn> (getFunction (details["advance"]));
+        else
+            advanceBlockFn = reinterpret_cast<AdvanceBlockFn> (getFunction (details["advance"]));
+
+        if (initialiseFn == nullptr || (advanceOneFrameFn == nullptr && advanceBlockFn == nullptr))
+            return path + " is missing its initialise or advance functions";
+
+        for (auto e : details["endpoints"])
+        {
+            Endpoint endpoint;
+            endpoint.handle = e["handle"].get<EndpointHandle>();
+            endpoint.endpointID = e["endpointID"].toString();
+            endpoint.isInput = e["isInput"].getWithDefault<bool> (false);
+            auto type = e["endpointType"].toString();
+
+            if (type == "stream")       endpoint.endpointType = EndpointType::stream;
+            else if (type == "value")   endpoint.endpointType = EndpointType::value;
+            else if (type == "event")   endpoint.endpointType = EndpointType::event;
+
+            endpoint.offset = e["offset"].getWithDefault<uint32_t> (0);
+            endpoint.stride = e["stride"].getWithDefault<uint32_t> (0);
+            endpoint.eventCountOffset = e["eventCountOffset"].getWithDefault<uint32_t> (0);
+            endpoint.eventTypeFieldOffset = e["eventTypeFieldOffset"].getWithDefault<uint32_t> (0);
+            endpoint.setValueFunction = getFunction (e["setValue"]);
+
+            if (e.hasObjectMember ("layout"))
+                endpoint.layout = DataLayout::fromJSON (e["layout"]);
+
+            if (e.hasObjectMember ("eventTypes"))
+            {
+                for (auto t : e["eventTypes"])
+                {
+                    EventType type;
+                    type.function = getFunction (t["function"]);
+                    type.offset = t["offset"].getWithDefault<uint32_t> (0);
+                    type.layout = DataLayout::fromJSON (t["layout"]);
+
+                    auto argument = t["argument"].toString();
+
+                    if (argument == "int32")         type.argument = EventArgument::int32;
+                    else if (argument == "int64")    type.argument = EventArgument::int64;
+                    else if (argument == "float32")  type.argument = EventArgument::float32;
+                    else if (argument == "float64")  type.argument = EventArgument::float64;
+                    else if (argument == "pointer")  type.argument = EventArgument::pointer;
+
+                    endpoint.eventTypes.push_back (std::move (type));
+                }
+            }
+
+            endpoints.push_back (std::move (endpoint));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        return path + " has invalid details: " + e.what();
+    }
+
+    if (info->stringDictionarySize != 0)
+        stringDictionary.setRawData (info->stringDictionary, static_cast<size_t> (info->stringDictionarySize));
+
+    return {};
+}
+
+inline const PerformerLibraryEngine::Endpoint* PerformerLibraryEngine::LoadedLibrary::findEndpoint (EndpointHandle handle) const
+{
+    for (auto& e : endpoints)
+        if (e.handle == handle)
+            return std::addressof (e);
+
+    return nullptr;
+}
+
+//==============================================================================
+inline PerformerLibraryEngine::Performer::Performer (std::shared_ptr<LoadedLibrary> l, int32_t s, double f)
+    : library (std::move (l)), sessionID (s), frequency (f)
+{
+    stateMemory.resize (library->stateSize);
+    ioMemory.resize (library->ioSize);
+    state = static_cast<uint8_t*> (stateMemory.data());
+    io = static_cast<uint8_t*> (ioMemory.data());
+
+    size_t maxScratchSize = 16;
+
+    for (auto& e : library->endpoints)
+    {
+        maxScratchSize = std::max (maxScratchSize, static_cast<size_t> (std::max (e.layout.nativeSize, e.stride)));
+
+        for (auto& t : e.eventTypes)
+            maxScratchSize = std::max (maxScratchSize, static_cast<size_t> (std::max (t.layout.nativeSize, t.layout.packedSize)));
+    }
+
+    scratchMemory.resize (maxScratchSize);
+    reset();
+}
+
+inline Result PerformerLibraryEngine::Performer::setBlockSize (uint32_t numFramesForNextBlock)
+{
+    if (numFramesForNextBlock == 0 || numFramesForNextBlock > library->maxBlockSize)
+        return Result::InvalidBlockSize;
+
+    currentBlockSize = numFramesForNextBlock;
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::reset()
+{
+    stateMemory.clear();
+    ioMemory.clear();
+
+    int32_t processorID = 0;
+    library->initialiseFn (state, &processorID, sessionID, frequency);
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::advance()
+{
+    // Any events that weren't read after the last block are discarded
+    for (auto& e : library->endpoints)
+        if (! e.isInput && e.endpointType == EndpointType::event)
+            *reinterpret_cast<uint32_t*> (state + e.eventCountOffset) = 0;
+
+    if (library->advanceOneFrameFn != nullptr)
+        library->advanceOneFrameFn (state, io);
+    else
+        library->advanceBlockFn (state, io, currentBlockSize);
+
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::setInputFrames (EndpointHandle handle, const void* frameData, uint32_t numFrames)
+{
+    auto e = library->findEndpoint (handle);
+
+    if (e == nullptr || ! e->isInput || e->endpointType != EndpointType::stream)
+        return Result::InvalidEndpointHandle;
+
+    if (numFrames != currentBlockSize)
+    {
+        ++xruns;
+        numFrames = std::min (numFrames, currentBlockSize);
+    }
+
+    auto dest = io + e->offset;
+    auto source = static_cast<const uint8_t*> (frameData);
+
+    for (uint32_t i = 0; i < numFrames; ++i)
+    {
+        e->layout.copyPackedToNative (dest, source);
+        dest += e->stride;
+        source += e->layout.packedSize;
+    }
+
+    if (numFrames < currentBlockSize)
+        std::memset (dest, 0, static_cast<size_t> (currentBlockSize - numFrames) * e->stride);
+
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::setInputValue (EndpointHandle handle, const void* valueData, uint32_t numFramesToReachValue)
+{
+    auto e = library->findEndpoint (handle);
+
+    if (e == nullptr || ! e->isInput || e->setValueFunction == nullptr)
+        return Result::InvalidEndpointHandle;
+
+    e->layout.copyPackedToNative (scratchMemory.data(), valueData);
+
+    using SetValueFn = void(*)(void*, const void*, uint32_t);
+    reinterpret_cast<SetValueFn> (e->setValueFunction) (state, scratchMemory.data(), numFramesToReachValue);
+    return Result::Ok;
+}
+
+inline void PerformerLibraryEngine::Performer::sendEvent (const EventType& type, const void* data)
+{
+    if (type.function == nullptr)
+        return;
+
+    switch (type.argument)
+    {
+        case EventArgument::none:     return reinterpret_cast<void(*)(void*)> (type.function) (state);
+        case EventArgument::int32:    return reinterpret_cast<void(*)(void*, int32_t)> (type.function) (state, *static_cast<const int32_t*> (data));
+        case EventArgument::int64:    return reinterpret_cast<void(*)(void*, int64_t)> (type.function) (state, *static_cast<const int64_t*> (data));
+        case EventArgument::float32:  return reinterpret_cast<void(*)(void*, float)> (type.function) (state, *static_cast<const float*> (data));
+        case EventArgument::float64:  return reinterpret_cast<void(*)(void*, double)> (type.function) (state, *static_cast<const double*> (data));
+
+        case EventArgument::pointer:
+            type.layout.copyPackedToNative (scratchMemory.data(), data);
+            return reinterpret_cast<void(*)(void*, const void*)> (type.function) (state, scratchMemory.data());
+
+        default:
+            return;
+    }
+}
+
+inline Result PerformerLibraryEngine::Performer::addInputEvent (EndpointHandle handle, uint32_t typeIndex, const void* eventData)
+{
+    auto e = library->findEndpoint (handle);
+
+    if (e == nullptr || ! e->isInput || e->endpointType != EndpointType::event)
+        return Result::InvalidEndpointHandle;
+
+    if (typeIndex >= e->eventTypes.size())
+        return Result::TypeIndexOutOfRange;
+
+    sendEvent (e->eventTypes[typeIndex], eventData);
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::addInputEvents (EndpointHandle handle, const EventBatch* batch)
+{
+    // Like the GeneratedCppEngine, this can't deliver events part-way through a
+    // block, so these all get delivered at the start of it
+    for (uint32_t i = 0; i < batch->numEvents; ++i)
+    {
+        auto& event = batch->events[i];
+
+        if (auto r = addInputEvent (handle, event.typeIndex, event.eventData); r != Result::Ok)
+            return r;
+    }
+
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::copyOutputValue (EndpointHandle handle, void* dest)
+{
+    auto e = library->findEndpoint (handle);
+
+    if (e == nullptr || e->isInput)
+        return Result::InvalidEndpointHandle;
+
+    if (e->endpointType == EndpointType::stream)
+        return copyOutputFrames (handle, dest, 1);
+
+    if (e->endpointType != EndpointType::value)
+        return Result::InvalidEndpointHandle;
+
+    e->layout.copyNativeToPacked (dest, state + e->offset);
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::copyOutputFrames (EndpointHandle handle, void* destBuffer, uint32_t numFramesToCopy)
+{
+    auto e = library->findEndpoint (handle);
+
+    if (e == nullptr || e->isInput || e->endpointType != EndpointType::stream)
+        return Result::InvalidEndpointHandle;
+
+    auto source = io + e->offset;
+    auto dest = static_cast<uint8_t*> (destBuffer);
+
+    for (uint32_t i = 0; i < numFramesToCopy; ++i)
+    {
+        e->layout.copyNativeToPacked (dest, source);
+        dest += e->layout.packedSize;
+        source += e->stride;
+    }
+
+    std::memset (io + e->offset, 0, static_cast<size_t> (numFramesToCopy) * e->stride);
+    return Result::Ok;
+}
+
+inline Result PerformerLibraryEngine::Performer::iterateOutputEvents (EndpointHandle handle, void* context,
+                                                                      PerformerInterface::HandleOutputEventCallback callback)
+{
+    auto e = library->findEndpoint (handle);
+
+    if (e == nullptr || e->isInput || e->endpointType != EndpointType::event)
+        return Result::InvalidEndpointHandle;
+
+    auto& eventCount = *reinterpret_cast<uint32_t*> (state + e->eventCountOffset);
+    auto numEvents = eventCount;
+
+    if (numEvents > library->eventBufferSize)
+    {
+        numEvents = library->eventBufferSize;
+        ++xruns;
+    }
+
+    auto entry = state + e->offset;
+
+    for (uint32_t i = 0; i < numEvents; ++i)
+    {
+        auto frame = *reinterpret_cast<const uint32_t*> (entry);
+        auto typeIndex = *reinterpret_cast<const uint32_t*> (entry + e->eventTypeFieldOffset);
+
+        if (typeIndex < e->eventTypes.size())
+        {
+            auto& type = e->eventTypes[typeIndex];
+            type.layout.copyNativeToPacked (scratchMemory.data(), entry + type.offset);
+
+            if (! callback (context, handle, typeIndex, frame, scratchMemory.data(), type.layout.packedSize))
+                break;
+        }
+
+        entry += e->stride;
+    }
+
+    eventCount = 0;
+    return Result::Ok;
+}
+
+inline const char* PerformerLibraryEngine::Performer::getStringForHandle (uint32_t handle, size_t& stringLength)
+{
+    try
+    {
+        auto s = library->stringDictionary.getStringForHandle (choc::value::StringDictionary::Handle { handle });
+        stringLength = s.length();
+        return s.data();
+    }
+    catch (...) {}
+
+    stringLength = 0;
+    return nullptr;
+}
+
+} // namespace cmaj
@@ -35,6 +35,7 @@ struct PerformerProxy  : public PerformerInterface
     Result setInputFrames (EndpointHandle e, const void* data, uint32_t numFrames) override         { return target->setInputFrames (e, data, numFrames); }
     Result setInputValue (EndpointHandle e, const void* data, uint32_t n) override                  { return target->setInputValue (e, data, n); }
     Result addInputEvent (EndpointHandle e, uint32_t index, const void* data) override              { return target->addInputEvent (e, index, data); }
+    Result addInputEvents (EndpointHandle e, const EventBatch* batch) override                      { return target->addInputEvents (e, batch); }
     Result copyOutputValue (EndpointHandle e, void* dest) override                                  { return target->copyOutputValue (e, dest); }
     Result copyOutputFrames (EndpointHandle e, void* dest, uint32_t num) override                   { return target->copyOutputFrames (e, dest, num); }
     Result iterateOutputEvents (EndpointHandle e, void* c, HandleOutputEventCallback h) override    { return target->iterateOutputEvents (e, c, h); }
@@ -45,6 +46,9 @@ struct PerformerProxy  : public PerformerInterface
     double getLatency() override                                                                    { return target->getLatency(); }
     uint32_t getEventBufferSize() override                                                          { return target->getEventBufferSize(); }
     const char* getRuntimeError() override                                                          { return target->getRuntimeError(); }
+    choc::com::String* getNodeProfile() override                                                    { return target->getNodeProfile(); }
+    void prefetchEndpoint (EndpointHandle h) override                                               { target->prefetchEndpoint (h); }
+    bool isRunningQuickTier() override                                                              { return target->isRunningQuickTier(); }
 
     PerformerPtr target;
 };
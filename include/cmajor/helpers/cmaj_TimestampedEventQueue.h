@@ -0,0 +1,289 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../API/cmaj_Engine.h"
+
+
+namespace cmaj
+{
+
+//==============================================================================
+/// A bounded multiple-producer, single-consumer queue of timestamped events and
+/// value changes, which is used to pass them to a realtime thread.
+///
+/// All its storage is allocated by reset(), so pushing and popping never allocate
+/// or take a lock. A producer claims a slot with a compare-and-swap, fills it in,
+/// and then publishes it. The consumer can look at the item at the head of the
+/// queue before deciding whether to take it. Items come out in the order in which
+/// their slots were claimed.
+///
+struct TimestampedEventQueue
+{
+    TimestampedEventQueue() = default;
+    TimestampedEventQueue (const TimestampedEventQueue&) = delete;
+
+    /// Allocates space for at least the given number of items, each of which can hold
+    /// up to maxPayloadSize bytes of data. This must not be called while other threads
+    /// are using the queue.
+    void reset (uint32_t minNumItems, uint32_t maxPayloadSize);
+
+    /// The header of a queued item. The meaning of its fields is up to the caller.
+    struct Item
+    {
+        /// The frame position at which this item should be handled. Zero means
+        /// "as soon as possible".
+        uint64_t frame = 0;
+        EndpointHandle endpoint = {};
+        /// For events, this is the data type index. For values, it's the number of
+        /// frames over which to ramp.
+        uint32_t typeIndexOrFrameCount = 0;
+        uint32_t dataSize = 0;
+        bool isValue = false;
+        /// False if the producer failed to fill in this item, so it should be skipped
+        bool isValid = false;
+    };
+
+    /// Claims a slot and calls a function to fill it in. The function is given a
+    /// reference to the Item header and a pointer to the slot's payload space. It
+    /// must return false if it couldn't write the item.
+    /// When the queue is full, this returns false straight away if timeoutMilliseconds
+    /// is zero. Otherwise it keeps retrying, yielding between attempts, until the
+    /// timeout expires. It never sleeps or locks, and any item that can't be pushed
+    /// is counted as a drop.
+    template <typename WriteItemFn>
+    bool push (uint32_t timeoutMilliseconds, WriteItemFn&& writeItem);
+
+    /// Returns the item at the head of the queue, or nullptr if the queue is empty or
+    /// the next item hasn't been published yet. Only the consumer thread may call this.
+    const Item* peek() const;
+
+    /// Returns a pointer to the payload of the item that peek() returned
+    const void* getPeekedPayload() const;
+
+    /// Removes the item that peek() returned. Only the consumer thread may call this.
+    void pop();
+
+    uint32_t getCapacity() const            { return mask + 1; }
+    uint32_t getMaxPayloadSize() const      { return payloadStride; }
+
+    struct Statistics
+    {
+        uint64_t numItemsPushed = 0;
+        uint64_t numItemsDropped = 0;
+        /// The largest number of items that have been in the queue at the same time
+        uint32_t highWaterMark = 0;
+        uint32_t capacity = 0;
+    };
+
+    /// Returns the queue's counters. This can be called from any thread.
+    Statistics getStatistics() const;
+
+    /// Resets the high-water mark and the counters. This can be called from any thread.
+    void resetStatistics();
+
+private:
+    //==============================================================================
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence { 0 };
+        Item item;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::vector<uint64_t> payloads;
+    uint32_t mask = 0, payloadStride = 0;
+
+    alignas (64) std::atomic<uint64_t> writePosition { 0 };
+    alignas (64) std::atomic<uint64_t> readPosition { 0 };
+    alignas (64) std::atomic<uint64_t> numItemsPushed { 0 }, numItemsDropped { 0 };
+    std::atomic<uint32_t> highWaterMark { 0 };
+
+    uint8_t* getPayload (uint64_t position) const
+    {
+        return reinterpret_cast<uint8_t*> (const_cast<uint64_t*> (payloads.data()))
+                 + (position & mask) * payloadStride;
+    }
+
+    bool tryToClaimSlot (uint64_t& position);
+    void updateHighWaterMark (uint64_t position);
+};
+
+
+
+//==============================================================================
+//        _        _           _  _
+//     __| |  ___ | |_   __ _ (_)| | ___
+//    / _` | / _ \| __| / _` || || |/ __|
+//   | (_| ||  __/| |_ | (_| || || |\__ \ _  _  _
+//    \__,_| \___| \__| \__,_||_||_||___/(_)(_)(_)
+//
+//   Code beyond this point is implementation detail...
+//
+//==============================================================================
+
+inline void TimestampedEventQueue::reset (uint32_t minNumItems, uint32_t maxPayloadSize)
+{
+    uint32_t capacity = 2;
+
+    while (capacity < minNumItems)
+        capacity *= 2;
+
+    mask = capacity - 1;
+    payloadStride = (maxPayloadSize + 7u) & ~7u;
+    slots.reset (new Slot[capacity]);
+    payloads.assign ((static_cast<size_t> (capacity) * payloadStride) / sizeof (uint64_t), 0);
+
+    for (uint32_t i = 0; i < capacity; ++i)
+        slots[i].sequence.store (i, std::memory_order_relaxed);
+
+    writePosition.store (0, std::memory_order_relaxed);
+    readPosition.store (0, std::memory_order_relaxed);
+    resetStatistics();
+}
+
+inline bool TimestampedEventQueue::tryToClaimSlot (uint64_t& position)
+{
+    position = writePosition.load (std::memory_order_relaxed);
+
+    for (;;)
+    {
+        auto sequence = slots[position & mask].sequence.load (std::memory_order_acquire);
+        auto difference = static_cast<int64_t> (sequence - position);
+
+        if (difference == 0)
+        {
+            if (writePosition.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+                return true;
+        }
+        else if (difference < 0)
+        {
+            return false; // the consumer hasn't yet released this slot, so the queue is full
+        }
+        else
+        {
+            position = writePosition.load (std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename WriteItemFn>
+bool TimestampedEventQueue::push (uint32_t timeoutMilliseconds, WriteItemFn&& writeItem)
+{
+    if (slots == nullptr)
+        return false;
+
+    uint64_t position = 0;
+
+    if (! tryToClaimSlot (position))
+    {
+        bool claimed = false;
+
+        if (timeoutMilliseconds != 0)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds (timeoutMilliseconds);
+
+            while (! claimed && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+                claimed = tryToClaimSlot (position);
+            }
+        }
+
+        if (! claimed)
+        {
+            numItemsDropped.fetch_add (1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    updateHighWaterMark (position);
+
+    auto& slot = slots[position & mask];
+    slot.item = {};
+    slot.item.isValid = writeItem (slot.item, getPayload (position));
+    CMAJ_ASSERT (slot.item.dataSize <= payloadStride);
+    slot.sequence.store (position + 1, std::memory_order_release);
+
+    if (! slot.item.isValid)
+        return false;
+
+    numItemsPushed.fetch_add (1, std::memory_order_relaxed);
+    return true;
+}
+
+inline void TimestampedEventQueue::updateHighWaterMark (uint64_t position)
+{
+    auto numInUse = static_cast<uint32_t> (position + 1 - readPosition.load (std::memory_order_relaxed));
+    auto current = highWaterMark.load (std::memory_order_relaxed);
+
+    while (numInUse > current && ! highWaterMark.compare_exchange_weak (current, numInUse, std::memory_order_relaxed))
+    {}
+}
+
+inline const TimestampedEventQueue::Item* TimestampedEventQueue::peek() const
+{
+    if (slots == nullptr)
+        return nullptr;
+
+    auto position = readPosition.load (std::memory_order_relaxed);
+    auto& slot = slots[position & mask];
+
+    if (slot.sequence.load (std::memory_order_acquire) != position + 1)
+        return nullptr;
+
+    return std::addressof (slot.item);
+}
+
+inline const void* TimestampedEventQueue::getPeekedPayload() const
+{
+    return getPayload (readPosition.load (std::memory_order_relaxed));
+}
+
+inline void TimestampedEventQueue::pop()
+{
+    auto position = readPosition.load (std::memory_order_relaxed);
+    slots[position & mask].sequence.store (position + mask + 1, std::memory_order_release);
+    readPosition.store (position + 1, std::memory_order_relaxed);
+}
+
+inline TimestampedEventQueue::Statistics TimestampedEventQueue::getStatistics() const
+{
+    Statistics s;
+    s.numItemsPushed  = numItemsPushed.load (std::memory_order_relaxed);
+    s.numItemsDropped = numItemsDropped.load (std::memory_order_relaxed);
+    s.highWaterMark   = highWaterMark.load (std::memory_order_relaxed);
+    s.capacity        = slots != nullptr ? getCapacity() : 0;
+    return s;
+}
+
+inline void TimestampedEventQueue::resetStatistics()
+{
+    numItemsPushed.store (0, std::memory_order_relaxed);
+    numItemsDropped.store (0, std::memory_order_relaxed);
+    highWaterMark.store (0, std::memory_order_relaxed);
+}
+
+} // namespace cmaj
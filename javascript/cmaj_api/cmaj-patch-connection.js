@@ -148,8 +148,9 @@ export class PatchConnection  extends EventListenerList
      *  @param {string} endpointID
      *  @param {number} granularity - if defined, this specifies the number of frames per callback
      *  @param {boolean} sendFullAudioData - if false, the listener will receive an argument object containing
-     *     two properties 'min' and 'max', which are each an array of values, one element per audio
-     *     channel. This allows you to find the highest and lowest samples in that chunk for each channel.
+     *     three properties 'min', 'max' and 'rms', which are each an array of values, one element per audio
+     *     channel. This allows you to find the highest and lowest samples and the RMS level in that chunk
+     *     for each channel.
      *     If sendFullAudioData is true, the listener's argument will have a property 'data' which is an
      *     array containing one array per channel of raw audio samples data.
      */
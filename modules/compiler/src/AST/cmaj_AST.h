@@ -25,6 +25,8 @@
 #include <random>
 #include <optional>
 #include <functional>
+#include <memory>
+#include <cstring>
 
 #include "../../include/cmaj_ErrorHandling.h"
 
@@ -90,6 +92,7 @@ using ref = choc::ObjectReference<Type>;
   X(ConstantFloat64) \
   X(ConstantInt32) \
   X(ConstantInt64) \
+  X(ConstantPackedArray) \
   X(ConstantString) \
   X(ContinueStatement) \
   X(DotOperator) \
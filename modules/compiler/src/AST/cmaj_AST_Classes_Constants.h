@@ -904,6 +904,13 @@ struct ConstantAggregate  : public ConstantValueBase
             for (size_t i = 0; i < values.size(); ++i)
                 setElementValue (i, agg->getElement (i));
         }
+        else if (auto packed = v.getAsConstantPackedArray())
+        {
+            setNumberOfAllocatedElements (packed->getNumElements());
+
+            for (size_t i = 0; i < values.size(); ++i)
+                setElementValue (i, *packed->getAggregateElementValue (static_cast<int64_t> (i)));
+        }
         else
         {
             setToSingleValue (v);
@@ -947,3 +954,203 @@ struct ConstantAggregate  : public ConstantValueBase
     CMAJ_DECLARE_PROPERTIES(CMAJ_PROPERTIES)
     #undef CMAJ_PROPERTIES
 };
+
+//==============================================================================
+/// A constant array whose elements are held as one contiguous block of raw bytes,
+/// rather than as a list of child objects.
+///
+/// This is used for big blocks of data such as audio samples, where creating an
+/// object for every element would be far too slow. It can only hold one-dimensional
+/// arrays of int32, int64, float32 or float64, or of vectors of those types, and the
+/// data uses the same packed layout as a choc::value array of the same type.
+struct ConstantPackedArray  : public ConstantValueBase
+{
+    ConstantPackedArray (const ObjectContext& c)   : ConstantValueBase (c) {}
+
+    CMAJ_AST_DECLARE_STANDARD_METHODS(ConstantPackedArray, 76)
+
+    ptr<const TypeBase> getResultType() const override          { return castToTypeBase (type); }
+    TypeBase& getType() const                                   { return castToTypeBaseRef (type); }
+    const TypeBase& getElementType() const                      { return *getType().skipConstAndRefModifiers().getArrayOrVectorElementType(); }
+    size_t getElementSize() const                               { return getElementType().getPackedStorageSize(); }
+    void writeSignature (SignatureBuilder& sig) const override  { sig << type << data; }
+
+    static bool canHoldType (const TypeBase& t)
+    {
+        auto& arrayType = t.skipConstAndRefModifiers();
+
+        if (! (arrayType.isArray() && arrayType.getNumDimensions() == 1))
+            return false;
+
+        auto& elementType = arrayType.getArrayOrVectorElementType()->skipConstAndRefModifiers();
+
+        if (auto vec = elementType.getAsVectorType())
+            return ! vec->isSize1() && isPackablePrimitive (vec->getElementType());
+
+        return isPackablePrimitive (elementType);
+    }
+
+    static bool isPackablePrimitive (const TypeBase& t)
+    {
+        return t.isPrimitiveInt32() || t.isPrimitiveInt64() || t.isPrimitiveFloat32() || t.isPrimitiveFloat64();
+    }
+
+    ArraySize getNumElements() const
+    {
+        auto elementSize = getElementSize();
+        return elementSize == 0 ? 0 : static_cast<ArraySize> (data.size() / elementSize);
+    }
+
+    /// Returns a view of one of the elements, without allocating an object for it
+    choc::value::ValueView getElementView (size_t index) const
+    {
+        CMAJ_ASSERT (index < getNumElements());
+        return choc::value::ValueView (getElementType().toChocType(),
+                                       const_cast<uint8_t*> (data.getData() + index * getElementSize()), nullptr);
+    }
+
+    ptr<const ConstantValueBase> getAggregateElementValue (int64_t index) const override
+    {
+        auto numElements = getNumElements();
+
+        if (numElements == 0)
+            return {};
+
+        auto& element = getElementType().allocateConstantValue (context);
+        element.setFromValue (getElementView (TypeRules::convertArrayOrVectorIndexToWrappedIndex (numElements, index)));
+        return element;
+    }
+
+    choc::value::Value toValue (SliceToValueFn* sliceToValue) const override
+    {
+        auto result = getNumElements() == 0 ? choc::value::createEmptyArray()
+                                             : choc::value::Value (choc::value::Type::createArray (getElementType().toChocType(), getNumElements()),
+                                                                   data.getData(), data.size());
+
+        if (getType().skipConstAndRefModifiers().isSlice())
+        {
+            CMAJ_ASSERT (sliceToValue != nullptr);
+            return (*sliceToValue) (result);
+        }
+
+        return result;
+    }
+
+    bool setFromValue (const choc::value::ValueView& v) override
+    {
+        auto& arrayType = getType().skipConstAndRefModifiers();
+        auto numElements = arrayType.isSlice() ? v.size() : arrayType.getFixedSizeAggregateNumElements();
+
+        if (! (v.isArray() && v.size() == numElements))
+            return false;
+
+        auto elementType = getElementType().toChocType();
+        auto elementSize = getElementSize();
+        std::vector<uint8_t> newData (numElements * elementSize);
+
+        if (v.getType().isUniformArray() && v.getType().getElementType() == elementType)
+        {
+            if (! newData.empty())
+                std::memcpy (newData.data(), v.getRawData(), newData.size());
+        }
+        else
+        {
+            for (uint32_t i = 0; i < numElements; ++i)
+                if (! convertElement (newData.data() + i * elementSize, elementType, v[i]))
+                    return false;
+        }
+
+        data.set (std::move (newData));
+        return true;
+    }
+
+    void setFromConstant (const ConstantValueBase& v) override
+    {
+        if (auto packed = v.getAsConstantPackedArray())
+            return data.setShared (packed->data);
+
+        auto& arrayType = getType().skipConstAndRefModifiers();
+        auto numElements = arrayType.isSlice() ? getNumElements() : arrayType.getFixedSizeAggregateNumElements();
+
+        if (arrayType.isSlice())
+            if (auto agg = v.getAsConstantAggregate())
+                numElements = agg->getNumElements();
+
+        auto elementType = getElementType().toChocType();
+        auto elementSize = getElementSize();
+        std::vector<uint8_t> newData (numElements * elementSize);
+
+        for (uint32_t i = 0; i < numElements; ++i)
+        {
+            auto element = v.getAggregateElementValue (i);
+            auto value = (element != nullptr ? *element : v).toValue (nullptr);
+            convertElement (newData.data() + i * elementSize, elementType, value);
+        }
+
+        data.set (std::move (newData));
+    }
+
+    void setToZero() override
+    {
+        if (! isZero())
+            data.set (std::vector<uint8_t> (data.size()));
+    }
+
+    bool isZero() const override
+    {
+        auto d = data.getData();
+
+        for (size_t i = 0; i < data.size(); ++i)
+            if (d[i] != 0)
+                return false;
+
+        return true;
+    }
+
+    static bool convertElement (uint8_t* dest, const choc::value::Type& destType, const choc::value::ValueView& source)
+    {
+        if (destType.isVector())
+        {
+            auto numComponents = destType.getNumElements();
+
+            if (! ((source.isVector() || source.isArray()) && source.size() == numComponents))
+                return false;
+
+            auto componentType = destType.getElementType();
+            auto componentSize = componentType.getValueDataSize();
+
+            for (uint32_t i = 0; i < numComponents; ++i)
+                if (! convertElement (dest + i * componentSize, componentType, source[i]))
+                    return false;
+
+            return true;
+        }
+
+        if (source.getType().isVectorSize1())
+            return convertElement (dest, destType, source[0]);
+
+        if (! (source.isInt() || source.isFloat()))
+            return false;
+
+        if (destType.isInt32())     return writeElement (dest, source.get<int32_t>());
+        if (destType.isInt64())     return writeElement (dest, source.get<int64_t>());
+        if (destType.isFloat32())   return writeElement (dest, source.get<float>());
+        if (destType.isFloat64())   return writeElement (dest, source.get<double>());
+
+        return false;
+    }
+
+    template <typename PrimitiveType>
+    static bool writeElement (uint8_t* dest, PrimitiveType value)
+    {
+        std::memcpy (dest, std::addressof (value), sizeof (PrimitiveType));
+        return true;
+    }
+
+    #define CMAJ_PROPERTIES(X) \
+        X (1, ChildObject, type) \
+        X (2, DataProperty, data)
+
+    CMAJ_DECLARE_PROPERTIES(CMAJ_PROPERTIES)
+    #undef CMAJ_PROPERTIES
+};
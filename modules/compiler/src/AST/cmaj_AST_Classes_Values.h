@@ -234,6 +234,10 @@ struct Cast  : public ValueBase
 
             if (destType.isFixedSizeAggregate())
             {
+                if (auto sourcePacked = constSource->getAsConstantPackedArray())
+                    if (sourcePacked->getType().isSameType (destType, TypeBase::ComparisonFlags::ignoreConst))
+                        return *sourcePacked;
+
                 if (auto sourceAgg = constSource->getAsConstantAggregate())
                 {
                     auto& sourceType = sourceAgg->getType();
@@ -280,6 +284,10 @@ struct Cast  : public ValueBase
                 if (isSourceSliceable())
                     return *sourceAgg;
 
+                if (auto sourcePacked = constSource->getAsConstantPackedArray())
+                    if (sourcePacked->getElementType().isSameType (destElementType, TypeBase::ComparisonFlags::failOnAllDifferences))
+                        return *sourcePacked;
+
                 if (constSource->getResultType()
                       ->isSameType (destElementType, TypeBase::ComparisonFlags::ignoreConst))
                 {
@@ -1336,6 +1344,21 @@ struct GetElement  : public ValueBase
                 if (constantIndexes.size() == 1)
                     return getAsFoldedConstant (agg->getOrCreateAggregateElementValue (constantIndexes[0]));
             }
+
+            if (auto packed = constParent->getAsConstantPackedArray())
+            {
+                if (indexes.size() == 1)
+                {
+                    if (auto indexValue = getAsFoldedConstant (indexes[0]))
+                    {
+                        auto safeIndex = TypeRules::checkAndGetArrayIndex (getContext (indexes[0]), *indexValue, packed->getType(), 0, false);
+
+                        if (safeIndex < packed->getNumElements())
+                            if (auto element = packed->getAggregateElementValue (safeIndex))
+                                return element->constantFold();
+                    }
+                }
+            }
         }
 
         return {};
@@ -107,18 +107,68 @@ private:
         auto& variableType = castToTypeBaseRef (variable.declaredType);
         auto coerced = coerceAudioDataToType (variableType.toChocType(), value);
 
-        auto& constValue = variableType.allocateConstantValue (variable.context);
+        auto constValue = createConstantFromValue (variableType, variable.context, coerced);
 
-        if (! constValue.setFromValue (coerced))
+        if (constValue == nullptr)
             throwError (variable, Errors::cannotApplyExternalVariableValue (value.getType().getDescription(), variable.getName()));
 
-        variable.initialValue.referTo (constValue);
+        variable.initialValue.referTo (*constValue);
         variable.isExternal = false;
         variable.isConstant = true;
 
         return true;
     }
 
+    /// External data is often big, so any arrays that can be packed are stored as a
+    /// ConstantPackedArray rather than having an object allocated for each element.
+    static ptr<ConstantValueBase> createConstantFromValue (const TypeBase& type, const ObjectContext& context,
+                                                           const choc::value::ValueView& value)
+    {
+        auto& targetType = type.skipConstAndRefModifiers();
+
+        if (ConstantPackedArray::canHoldType (targetType))
+        {
+            auto& packed = context.allocate<ConstantPackedArray>();
+            packed.type.createReferenceTo (targetType);
+
+            if (packed.setFromValue (value))
+                return packed;
+
+            return {};
+        }
+
+        if (auto structType = targetType.getAsStructType())
+        {
+            auto numMembers = structType->memberNames.size();
+
+            if (! (value.isObject() && value.size() == numMembers))
+                return {};
+
+            auto& agg = castToRef<ConstantAggregate> (targetType.allocateConstantValue (context));
+            agg.values.reserve (numMembers);
+
+            for (size_t i = 0; i < numMembers; ++i)
+            {
+                auto member = createConstantFromValue (structType->getMemberType (i), context,
+                                                       value[structType->getMemberName (i)]);
+
+                if (member == nullptr)
+                    return {};
+
+                agg.values.addReference (*member);
+            }
+
+            return agg;
+        }
+
+        auto& constValue = targetType.allocateConstantValue (context);
+
+        if (constValue.setFromValue (value))
+            return constValue;
+
+        return {};
+    }
+
     static constexpr int64_t maxNumFrames = 100000000;
     static constexpr double maxFrequency = 10000000.0;
     static constexpr double maxRate = 10000000.0;
@@ -381,6 +431,14 @@ struct ExternalFunctionManager
         return {};
     }
 
+    template <typename Visitor>
+    void visitResolvedFunctions (Visitor&& visit) const
+    {
+        for (auto& f : functionPointers)
+            if (f.second != nullptr)
+                visit (*f.first, f.second);
+    }
+
 private:
     std::unordered_map<const Function*, void*> functionPointers;
     EngineInterface::RequestExternalFunctionFn requestExternalFunction = nullptr;
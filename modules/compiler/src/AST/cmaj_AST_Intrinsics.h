@@ -55,6 +55,7 @@ struct Intrinsic
         X(isinf,                   1,   false,  true  ) \
         X(reinterpretFloatToInt,   1,   false,  true  ) \
         X(reinterpretIntToFloat,   1,   true,   false ) \
+        X(readCycleCounter,        0,   false,  false ) \
 
     enum class Type
     {
@@ -89,6 +90,9 @@ struct Intrinsic
     {
         CMAJ_ASSERT (intrinsic != Type::unknown);
 
+        if (args.empty())
+            return {};
+
         if (auto argType = getArgType (args))
         {
             if (argType->isPrimitiveFloat64())   return perform<double, true> (intrinsic, args);
@@ -226,4 +230,6 @@ private:
     static int64_t perform_reinterpretFloatToInt (const double* args)     { return choc::memory::bit_cast<int64_t> (args[0]); }
     static float   perform_reinterpretIntToFloat (const int32_t* args)    { return choc::memory::bit_cast<float>   (args[0]); }
     static double  perform_reinterpretIntToFloat (const int64_t* args)    { return choc::memory::bit_cast<double>  (args[0]); }
+
+    template <typename T> static int64_t perform_readCycleCounter (const T*) { return 0; } // never folded
 };
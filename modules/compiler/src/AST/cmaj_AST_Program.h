@@ -44,7 +44,9 @@ struct Program  : public choc::com::ObjectWithAtomicRefCount<cmaj::ProgramInterf
     }
 
     /// Adds the standard library, and if the program has already been loaded and is
-    /// mashed-up, reparses it from the original source files
+    /// mashed-up, reparses it from the original source files.
+    /// The library is copied from a process-wide snapshot that has already been through
+    /// the resolution passes, so loading only has to resolve the user's code.
     bool prepareForLoading()
     {
         if (needsReparsing)
@@ -237,6 +239,31 @@ struct Program  : public choc::com::ObjectWithAtomicRefCount<cmaj::ProgramInterf
     AST::ExternalVariableManager externalVariableManager;
     AST::ExternalFunctionManager externalFunctionManager;
 
+    /// Running totals for each of the resolution passes, which are added to the build log
+    struct ResolutionPassStats
+    {
+        std::string_view passName;
+        double seconds = 0;
+        uint32_t numRuns = 0, numSkipped = 0;
+        size_t numChanges = 0;
+    };
+
+    std::vector<ResolutionPassStats> resolutionPassStats;
+
+    ResolutionPassStats& getResolutionPassStats (std::string_view passName)
+    {
+        for (auto& s : resolutionPassStats)
+            if (s.passName == passName)
+                return s;
+
+        resolutionPassStats.push_back ({ passName });
+        return resolutionPassStats.back();
+    }
+
+    /// If node profiling is enabled, this lists the main graph nodes whose counters are
+    /// held in the graph's profile counter array, in the order of their counters
+    std::vector<std::string> profiledNodeNames;
+
 
 private:
     mutable ptr<AST::ProcessorBase> mainProcessor;
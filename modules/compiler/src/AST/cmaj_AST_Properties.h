@@ -26,6 +26,7 @@ struct ObjectProperty;
 struct ChildObject;
 struct ObjectReference;
 struct ListProperty;
+struct DataProperty;
 
 //==============================================================================
 struct Property
@@ -56,6 +57,7 @@ struct Property
     virtual ptr<ChildObject>          getAsChildObject()           { return {}; }
     virtual ptr<ObjectReference>      getAsObjectReference()       { return {}; }
     virtual ptr<ListProperty>         getAsListProperty()          { return {}; }
+    virtual ptr<DataProperty>         getAsDataProperty()          { return {}; }
 
     virtual ptr<const IntegerProperty>      getAsIntegerProperty() const   { return {}; }
     virtual ptr<const FloatProperty>        getAsFloatProperty() const     { return {}; }
@@ -66,6 +68,7 @@ struct Property
     virtual ptr<const ChildObject>          getAsChildObject() const       { return {}; }
     virtual ptr<const ObjectReference>      getAsObjectReference() const   { return {}; }
     virtual ptr<const ListProperty>         getAsListProperty() const      { return {}; }
+    virtual ptr<const DataProperty>         getAsDataProperty() const      { return {}; }
 
     virtual PooledString toString() const                       { CMAJ_ASSERT_FALSE; }
     std::string_view toStdString() const                        { return toString().get(); }
@@ -951,3 +954,68 @@ struct ListProperty   : public Property
 private:
     std::vector<ref<Property>> list;
 };
+
+//==============================================================================
+/// Holds an immutable block of raw bytes, which is shared between any clones of
+/// the property, so copying one is cheap however big the data is.
+struct DataProperty   : public Property
+{
+    explicit DataProperty (Object& o) : Property (o) {}
+    explicit DataProperty (Object& o, std::shared_ptr<const std::vector<uint8_t>> d, uint64_t h) : Property (o), data (std::move (d)), hash (h) {}
+
+    static constexpr uint8_t typeID = 9;
+    static constexpr bool isObjectProperty = false;
+
+    void reset() override                                               { data.reset(); hash = 0; }
+    bool hasDefaultValue() const override                               { return size() == 0; }
+    bool isPrimitive() const override                                   { return true; }
+    std::string_view getPropertyType() const override                   { return "data"; }
+    uint8_t getPropertyTypeID() const override                          { return typeID; }
+    void writeSignature (SignatureBuilder& sig) const override          { sig << size(); sig << choc::text::createHexString (hash); }
+    ptr<DataProperty> getAsDataProperty() override                      { return *this; }
+    ptr<const DataProperty> getAsDataProperty() const override          { return *this; }
+    void visitObjects (Visitor&) override                               {}
+
+    const uint8_t* getData() const                                      { return data != nullptr ? data->data() : nullptr; }
+    size_t size() const                                                 { return data != nullptr ? data->size() : 0; }
+    uint64_t getHash() const                                            { return hash; }
+
+    std::string getDescription() const
+    {
+        return std::to_string (size()) + " bytes, hash " + choc::text::createHexString (hash);
+    }
+
+    void set (std::vector<uint8_t>&& newData)
+    {
+        choc::hash::xxHash64 h;
+        h.addInput (newData.data(), newData.size());
+        hash = h.getHash();
+        data = std::make_shared<const std::vector<uint8_t>> (std::move (newData));
+    }
+
+    void set (const void* sourceData, size_t numBytes)
+    {
+        auto start = static_cast<const uint8_t*> (sourceData);
+        set (std::vector<uint8_t> (start, start + numBytes));
+    }
+
+    void setShared (const DataProperty& source)                         { data = source.data; hash = source.hash; }
+
+    Property& allocateEmptyCopy (Object& o) const override              { return AST::getAllocator (o).allocate<DataProperty> (o); }
+    Property& createClone (Object& o) const override                    { return AST::getAllocator (o).allocate<DataProperty> (o, data, hash); }
+    void deepCopy (const Property& source, RemappedObjects&) override   { auto s = source.getAsDataProperty(); CMAJ_ASSERT (s != nullptr); setShared (*s); }
+    choc::value::Value toSyntaxTree (const SyntaxTreeOptions&) override { return choc::value::createString (getDescription()); }
+
+    bool isIdentical (const Property& other) const override
+    {
+        if (auto o = other.getAsDataProperty())
+            return o->data == data
+                    || (o->hash == hash && o->size() == size() && std::memcmp (o->getData(), getData(), size()) == 0);
+
+        return false;
+    }
+
+private:
+    std::shared_ptr<const std::vector<uint8_t>> data;
+    uint64_t hash = 0;
+};
@@ -45,10 +45,62 @@ namespace cmaj
         resetMainProcessor();
     }
 
+    static bool addModulesFromBinaryData (AST::Program& program, const void* data, size_t size)
+    {
+        auto modules = transformations::parseBinaryModule (program.allocator, data, size, false);
+
+        for (auto& m : modules)
+            program.rootNamespace.subModules.addChildObject (m);
+
+        return ! modules.empty();
+    }
+
+    /// The standard library only needs to be resolved once per process, so this creates
+    /// an immutable snapshot of it after running the resolution passes on it alone. Each
+    /// program then decodes a copy of this into its own allocator, and the passes that
+    /// run when it's loaded have nothing left to do in the library code.
+    static const std::vector<uint8_t>& getResolvedStandardLibraryData()
+    {
+        static const auto data = []
+        {
+            std::vector<uint8_t> result;
+
+            try
+            {
+                AST::Program program;
+
+                if (addModulesFromBinaryData (program, standardLibraryData, sizeof (standardLibraryData)))
+                {
+                    transformations::mergeDuplicateNamespaces (program.rootNamespace);
+                    transformations::runBasicResolutionPasses (program);
+
+                    auto modules = program.getTopLevelModules();
+                    result = transformations::createBinaryModule (modules);
+
+                    // if the resolved version doesn't survive a round-trip, we'll fall back to the original
+                    AST::Allocator testAllocator;
+
+                    if (transformations::parseBinaryModule (testAllocator, result.data(), result.size(), false).size() != modules.size())
+                        result.clear();
+                }
+            }
+            catch (...)
+            {
+                result.clear();
+            }
+
+            return result;
+        }();
+
+        return data;
+    }
+
     void AST::Program::addStandardLibraryCode()
     {
-        for (auto& m : transformations::parseBinaryModule (allocator, standardLibraryData, sizeof (standardLibraryData), false))
-            rootNamespace.subModules.addChildObject (m);
+        auto& resolvedLibrary = getResolvedStandardLibraryData();
+
+        if (resolvedLibrary.empty() || ! addModulesFromBinaryData (*this, resolvedLibrary.data(), resolvedLibrary.size()))
+            addModulesFromBinaryData (*this, standardLibraryData, sizeof (standardLibraryData));
 
         transformations::mergeDuplicateNamespaces (rootNamespace);
     }
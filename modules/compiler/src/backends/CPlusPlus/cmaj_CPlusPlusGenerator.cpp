@@ -1582,6 +1582,84 @@ struct EndpointInfo
         return createReaderNoParensNeeded (typeName + " { " + elementDecl + " }", type);
     }
 
+    // The elements are written straight from the packed data, without creating a constant object per element
+    ValueReader createConstantPackedArray (const AST::ConstantPackedArray& packed)
+    {
+        auto& type = AST::castToTypeBaseRef (packed.type);
+        auto typeName = getTypeName (type, true);
+        auto numElements = packed.getNumElements();
+
+        if (numElements == 0)
+            return createReaderParensNeeded (typeName + " {}", type);
+
+        auto& elementType = packed.getElementType().skipConstAndRefModifiers();
+        auto elementSize = packed.getElementSize();
+        auto data = packed.data.getData();
+
+        std::string elementDecl;
+        elementDecl.reserve (numElements * 16);
+
+        for (size_t i = 0; i < numElements; ++i)
+        {
+            if (i != 0)
+                elementDecl += ", ";
+
+            elementDecl += formatPackedElement (elementType, data + i * elementSize);
+        }
+
+        auto rawArrayName = getNextConstantName();
+        globalConstants.push_back ("const " + getTypeName (elementType, true) + " " + rawArrayName
+                                     + "[" + std::to_string (numElements) + "] = { " + elementDecl + " };");
+
+        auto arrayArgs = rawArrayName + ", " + std::to_string (numElements) + "u";
+
+        if (type.isSlice())
+        {
+            auto& fixedSizeType = AST::createArrayOfType (packed.context, elementType, static_cast<int32_t> (numElements));
+            auto fixedSizeArrayName = getNextConstantName();
+            globalConstants.push_back ("const " + getTypeName (fixedSizeType, true) + " " + fixedSizeArrayName + " = { " + arrayArgs + " };");
+            return createReaderNoParensNeeded (typeName + " { " + fixedSizeArrayName + " }", type);
+        }
+
+        return createReaderNoParensNeeded (typeName + " { " + arrayArgs + " }", type);
+    }
+
+    std::string formatPackedElement (const AST::TypeBase& elementType, const uint8_t* data)
+    {
+        if (auto vec = elementType.getAsVectorType())
+        {
+            auto& componentType = vec->getElementType();
+            auto componentSize = componentType.getPackedStorageSize();
+            std::string components;
+
+            for (uint32_t i = 0; i < vec->resolveSize(); ++i)
+            {
+                if (i != 0)
+                    components += ", ";
+
+                components += formatPackedElement (componentType, data + i * componentSize);
+            }
+
+            return getTypeName (elementType, true) + " { " + components + " }";
+        }
+
+        if (elementType.isPrimitiveFloat32())  return createConstantFloat32 (readPackedElement<float>   (data)).getWithoutParens();
+        if (elementType.isPrimitiveFloat64())  return createConstantFloat64 (readPackedElement<double>  (data)).getWithoutParens();
+        if (elementType.isPrimitiveInt32())    return createConstantInt32   (readPackedElement<int32_t> (data)).getWithoutParens();
+        if (elementType.isPrimitiveInt64())    return createConstantInt64   (readPackedElement<int64_t> (data)).getWithoutParens();
+
+        CMAJ_ASSERT_FALSE;
+        return {};
+    }
+
+    template <typename PrimitiveType>
+    static PrimitiveType readPackedElement (const uint8_t* data)
+    {
+        PrimitiveType value;
+        std::memcpy (std::addressof (value), data, sizeof (PrimitiveType));
+        return value;
+    }
+
     void printGlobalConstants()
     {
         for (auto& decl : globalConstants)
@@ -1707,6 +1785,9 @@ struct EndpointInfo
         if (intrinsic == AST::Intrinsic::Type::exp && ! argValues.front().paramType.isPrimitiveFloat())
             return {};
 
+        if (intrinsic == AST::Intrinsic::Type::readCycleCounter)
+            return {};
+
         bool isVectorOp = ! argValues.empty() && argValues.front().paramType.isVector() && ! argValues.front().paramType.isVectorSize1();
 
         if (isVectorOp
@@ -148,6 +148,7 @@ struct CPlusPlusEngine
     EngineBase<CPlusPlusEngine>& engine;
 
     static std::string getEngineVersion()   { return "cpp1"; }
+    static std::string getTargetDescription()   { return {}; }
 
     static constexpr bool canUseForwardBranches = true;
     static constexpr bool usesDynamicRateAndSessionID = true;
@@ -27,6 +27,11 @@
 
 #if CMAJ_ENABLE_PERFORMER_LLVM || CMAJ_ENABLE_CODEGEN_LLVM_WASM
 
+namespace cmaj
+{
+    struct EndpointInfo;
+}
+
 namespace cmaj::llvm
 {
    #if CMAJ_ENABLE_PERFORMER_LLVM
@@ -38,6 +43,13 @@ namespace cmaj::llvm
                                    const choc::value::Value& options);
 
     std::vector<std::string> getAssemberTargets();
+
+    std::string generatePerformerLibrary (const cmaj::ProgramInterface& program,
+                                          const cmaj::BuildSettings& buildSettings,
+                                          const choc::value::Value& options,
+                                          const std::vector<EndpointInfo>& endpoints,
+                                          const choc::value::Value& programDetails,
+                                          double latency);
    #endif
 
    #if CMAJ_ENABLE_CODEGEN_LLVM_WASM
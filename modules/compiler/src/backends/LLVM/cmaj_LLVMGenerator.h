@@ -16,11 +16,14 @@
 //  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
 //  DISCLAIMED.
 
+#include <array>
+#include <atomic>
 #include <iostream>
 
 #include "choc/memory/choc_Endianness.h"
 #include "../../codegen/cmaj_CodeGenHelpers.h"
 #include "../../validation/cmaj_ValidationUtilities.h"
+#include "../cmaj_NativeFFT.h"
 
 namespace cmaj::llvm
 {
@@ -62,16 +65,10 @@ struct LLVMCodeGenerator
 
     void addNativeOverriddenFunctions (AST::ExternalFunctionManager& externalFunctionManager)
     {
-        // example of how to use this. Remove the commented-out stuff when there's something real in here..
-
-        (void) externalFunctionManager;
-        // if (auto f = program.rootNamespace.findQualifiedFunction (std::string_view ("std::intrinsics::wrap"),
-        //                                                           allocator.int32Type, allocator.int32Type))
-        //     externalFunctionManager.addFunctionWithImplementation (*f,
-        //         (void*) +[] (int32_t value, int32_t size)
-        //         {
-        //             if (size == 0) return 0; auto n = value % size; if (n < 0) return n + size; return n;
-        //         });
+        // The JIT can call straight into native code, so the std::frequency FFTs use
+        // the faster C++ implementations rather than being compiled from the library
+        if (! webAssemblyMode)
+            addNativeFFTFunctions (program, externalFunctionManager);
     }
 
     bool generate()
@@ -138,6 +135,12 @@ struct LLVMCodeGenerator
     }
 
     void saveBitcodeToCache (CacheDatabaseInterface& cache, const char* key)
+    {
+        saveBitcodeToCache (cache, key, *targetModule, stringDictionary);
+    }
+
+    static void saveBitcodeToCache (CacheDatabaseInterface& cache, const char* key, const ::llvm::Module& module,
+                                    const choc::value::SimpleStringDictionary& dictionary)
     {
         ::llvm::SmallVector<char, 64> bitcode;
 
@@ -145,16 +148,60 @@ struct LLVMCodeGenerator
             ::llvm::raw_svector_ostream s (bitcode);
 
             char dictionarySize[sizeof (uint32_t)];
-            choc::memory::writeLittleEndian (dictionarySize, static_cast<uint32_t> (stringDictionary.getRawDataSize()));
+            choc::memory::writeLittleEndian (dictionarySize, static_cast<uint32_t> (dictionary.getRawDataSize()));
             s.write (dictionarySize, sizeof (dictionarySize));
-            s.write (stringDictionary.getRawData(), stringDictionary.getRawDataSize());
+            s.write (dictionary.getRawData(), dictionary.getRawDataSize());
 
-            ::llvm::WriteBitcodeToFile (*targetModule, s);
+            ::llvm::WriteBitcodeToFile (module, s);
         }
 
         cache.store (key, bitcode.data(), bitcode.size());
     }
 
+    /// Returns the module as bitcode, so that it can be re-loaded into another context
+    std::vector<char> getModuleBitcode() const
+    {
+        ::llvm::SmallVector<char, 64> bitcode;
+
+        {
+            ::llvm::raw_svector_ostream s (bitcode);
+            ::llvm::WriteBitcodeToFile (*targetModule, s);
+        }
+
+        return std::vector<char> (bitcode.begin(), bitcode.end());
+    }
+
+    /// Returns a string that identifies an external function independently of the
+    /// symbol name it was given, so that pre-compiled code can be re-bound to it
+    static std::string getExternalFunctionID (const AST::Function& f)
+    {
+        auto id = f.getFullyQualifiedReadableName();
+
+        for (auto& p : f.getParameterTypes())
+            id += " " + p->toChocType().getSignature (false);
+
+        return id;
+    }
+
+    /// When code is reloaded without being regenerated, this re-creates the map of external
+    /// symbol names to the native functions that the program has currently resolved
+    void restoreExternalFunctionPointers (const std::unordered_map<std::string, std::string>& symbolIDs)
+    {
+        program.externalFunctionManager.visitResolvedFunctions ([&] (const AST::Function& f, void* fn)
+        {
+            auto id = getExternalFunctionID (f);
+
+            for (auto& s : symbolIDs)
+            {
+                if (s.second == id)
+                {
+                    externalFunctionPointers[s.first] = fn;
+                    externalFunctionIDs[s.first] = id;
+                }
+            }
+        });
+    }
+
     void dumpDebugPrintout (const char* description, bool includeAssembly = true)
     {
         if (buildSettings.shouldDumpDebugInfo())
@@ -182,6 +229,428 @@ struct LLVMCodeGenerator
     size_t getStateAlignment() { return (getTypeAlignment (*stateStruct)); }
     size_t getIOAlignment()    { return (getTypeAlignment (*ioStruct)); }
 
+    //==============================================================================
+    /// Creates a builder for a target machine for the host's architecture, using the CPU
+    /// and features that the BuildSettings ask for.
+    static std::optional<::llvm::orc::JITTargetMachineBuilder> createTargetMachineBuilder (const BuildSettings& settings)
+    {
+        auto machineBuilder = ::llvm::orc::JITTargetMachineBuilder::detectHost();
+
+        if (! machineBuilder)
+        {
+            ::llvm::consumeError (machineBuilder.takeError());
+            return {};
+        }
+
+        auto& opts = machineBuilder->getOptions();
+        opts.ExceptionModel = ::llvm::ExceptionHandling::None;
+        opts.setFPDenormalMode (::llvm::DenormalMode::getPositiveZero());
+        opts.setFP32DenormalMode (::llvm::DenormalMode::getPositiveZero());
+
+        machineBuilder->setCodeGenOptLevel (getCodeGenOptLevel (settings.getOptimisationLevel()));
+
+        auto cpu = settings.getTargetCPU();
+        auto triple = machineBuilder->getTargetTriple();
+
+        if (cpu == BuildSettings::baselineTargetCPU)
+        {
+            machineBuilder->setCPU (getBaselineCPU (triple));
+            machineBuilder->getFeatures() = {};
+        }
+        else if (! (cpu.empty() || cpu == BuildSettings::hostTargetCPU))
+        {
+            std::string error;
+
+            if (auto target = ::llvm::TargetRegistry::lookupTarget (triple.str(), error))
+            {
+                std::unique_ptr<::llvm::MCSubtargetInfo> info (target->createMCSubtargetInfo (triple.str(), cpu, ""));
+
+                if (info == nullptr || ! info->isCPUStringValid (cpu))
+                    throwError (Errors::unknownTargetCPU (cpu));
+            }
+
+            machineBuilder->setCPU (cpu);
+            machineBuilder->getFeatures() = {};
+        }
+
+        machineBuilder->addFeatures (getExtraTargetFeatures (settings));
+        return std::move (*machineBuilder);
+    }
+
+    /// Parses BuildSettings::getTargetFeatures() into a list of LLVM feature strings
+    static std::vector<std::string> getExtraTargetFeatures (const BuildSettings& settings)
+    {
+        std::vector<std::string> features;
+
+        for (auto& feature : choc::text::splitString (settings.getTargetFeatures(), ',', false))
+        {
+            auto name = choc::text::trim (feature);
+
+            if (! name.empty())
+                features.push_back (name[0] == '+' || name[0] == '-' ? name : "+" + name);
+        }
+
+        return features;
+    }
+
+    /// Describes the triple, CPU and feature set that the BuildSettings will make native
+    /// code target, so that code built for one machine is never reused on another.
+    static std::string getTargetDescription (const BuildSettings& settings)
+    {
+        if (auto machineBuilder = createTargetMachineBuilder (settings))
+            return getTargetDescription (*machineBuilder);
+
+        return {};
+    }
+
+    static std::string getTargetDescription (::llvm::orc::JITTargetMachineBuilder& machineBuilder)
+    {
+        return machineBuilder.getTargetTriple().normalize() + " " + machineBuilder.getCPU()
+                 + " " + machineBuilder.getFeatures().getString();
+    }
+
+    static std::string getBaselineCPU (const ::llvm::Triple& triple)
+    {
+        if (triple.isX86())
+            return triple.isArch64Bit() ? "x86-64" : "i686";
+
+        return "generic";
+    }
+
+    //==============================================================================
+    /// Copies another generator's advanceBlock function (and everything it calls) into
+    /// this module under a new name. The other generator must have been built from the
+    /// same program, for the same triple, but may target a different CPU.
+    bool importAdvanceBlockVariant (LLVMCodeGenerator& variant, const std::string& newName)
+    {
+        auto& variantModule = *variant.targetModule;
+        auto advanceBlock = variantModule.getFunction (getAdvanceBlockFunctionName());
+
+        if (advanceBlock == nullptr)
+            return false;
+
+        for (auto& g : variantModule.global_values())
+            if (! g.isDeclaration())
+                g.setLinkage (::llvm::GlobalValue::LinkageTypes::InternalLinkage);
+
+        advanceBlock->setName (newName);
+        advanceBlock->setLinkage (::llvm::GlobalValue::LinkageTypes::ExternalLinkage);
+
+        {
+            ::llvm::ModuleAnalysisManager moduleAnalysisManager;
+            ::llvm::PassBuilder passBuilder;
+            passBuilder.registerModuleAnalyses (moduleAnalysisManager);
+            ::llvm::GlobalDCEPass().run (variantModule, moduleAnalysisManager);
+        }
+
+        // The modules belong to different LLVMContexts, so the variant has to be moved across as bitcode
+        ::llvm::SmallVector<char, 65536> bitcode;
+
+        {
+            ::llvm::raw_svector_ostream s (bitcode);
+            ::llvm::WriteBitcodeToFile (variantModule, s);
+        }
+
+        auto buffer = ::llvm::MemoryBuffer::getMemBuffer (::llvm::StringRef (bitcode.data(), bitcode.size()), {}, false);
+        auto parsedModule = ::llvm::parseBitcodeFile (buffer->getMemBufferRef(), *context);
+
+        if (! parsedModule)
+        {
+            ::llvm::consumeError (parsedModule.takeError());
+            return false;
+        }
+
+        if (::llvm::Linker::linkModules (*targetModule, std::move (*parsedModule)))
+            return false;
+
+        targetModule->getFunction (newName)->setLinkage (::llvm::GlobalValue::LinkageTypes::InternalLinkage);
+        return true;
+    }
+
+    /// The x86 features that a CPU must have to run some code, as the bits that must be set
+    /// in each of the CPUID results (and the XCR0 register) that they're reported in.
+    struct X86CPUFeatures
+    {
+        enum Register { leaf1ECX, leaf1EDX, leaf7EBX, leaf7ECX, leaf7EDX, leaf7Sub1EAX,
+                        leafDSub1EAX, extendedLeaf1ECX, xcr0, numRegisters };
+
+        std::array<uint32_t, numRegisters> masks {};
+    };
+
+    struct AdvanceBlockVariant
+    {
+        std::string functionName;
+        X86CPUFeatures requiredCPUFeatures;
+    };
+
+    /// Renames this module's advanceBlock function, and replaces it with one that calls
+    /// whichever of the variants was chosen when the program was initialised, falling back
+    /// to the original if the CPU doesn't support any of them.
+    ///
+    /// The choice is made by the initialise function, which runs CPUID (and XGETBV, to check
+    /// that the OS saves the AVX registers) and stores a pointer to the first variant whose
+    /// features are all present, so advanceBlock itself only has an indirect call to make.
+    /// Because this reads the CPU directly, it doesn't need any runtime support library,
+    /// but it's only for x86 targets.
+    void addAdvanceBlockDispatcher (const std::vector<AdvanceBlockVariant>& variants)
+    {
+        auto original = targetModule->getFunction (getAdvanceBlockFunctionName());
+        auto initialise = targetModule->getFunction (getInitFunctionName());
+        CMAJ_ASSERT (original != nullptr && initialise != nullptr);
+
+        original->setName (getAdvanceBlockFunctionName() + "_default");
+        original->setLinkage (::llvm::GlobalValue::LinkageTypes::InternalLinkage);
+
+        auto int32Type = ::llvm::Type::getInt32Ty (*context);
+        auto pointerType = ::llvm::PointerType::getUnqual (*context);
+        auto pointerAlignment = targetModule->getDataLayout().getPointerABIAlignment (0);
+
+        auto selectedVariant = new ::llvm::GlobalVariable (*targetModule, pointerType, false,
+                                                           ::llvm::GlobalValue::LinkageTypes::InternalLinkage,
+                                                           original, getAdvanceBlockFunctionName() + "_selected");
+
+        // The resolver, which is called at the start of initialise()
+        {
+            auto resolver = ::llvm::Function::Create (::llvm::FunctionType::get (::llvm::Type::getVoidTy (*context), false),
+                                                      ::llvm::GlobalValue::LinkageTypes::InternalLinkage,
+                                                      getAdvanceBlockFunctionName() + "_selectVariant", *targetModule);
+
+            auto entryBlock = ::llvm::BasicBlock::Create (*context, "entry", resolver);
+            ::llvm::IRBuilder<> b (entryBlock);
+
+            // rbx may be reserved as a base or PIC register, so like the compilers' cpuid.h,
+            // this swaps it with another register around the cpuid
+            auto cpuidType = ::llvm::StructType::get (*context, { int32Type, int32Type, int32Type, int32Type });
+            bool is64Bit = ::llvm::Triple (targetModule->getTargetTriple()).isArch64Bit();
+
+            auto cpuid = ::llvm::InlineAsm::get (::llvm::FunctionType::get (cpuidType, { int32Type, int32Type }, false),
+                                                 is64Bit ? "xchgq %rbx, ${1:q}\n\tcpuid\n\txchgq %rbx, ${1:q}"
+                                                         : "xchgl %ebx, $1\n\tcpuid\n\txchgl %ebx, $1",
+                                                 "={ax},=r,={cx},={dx},0,2,~{dirflag},~{fpsr},~{flags}", false);
+
+            auto xgetbv = ::llvm::InlineAsm::get (::llvm::FunctionType::get (::llvm::StructType::get (*context, { int32Type, int32Type }), { int32Type }, false),
+                                                  "xgetbv", "={ax},={dx},{cx},~{dirflag},~{fpsr},~{flags}", true);
+
+            auto callCPUID = [&] (uint32_t leaf, uint32_t subleaf)
+            {
+                auto result = b.CreateCall (cpuid, { b.getInt32 (leaf), b.getInt32 (subleaf) });
+                return std::array<::llvm::Value*, 4> { b.CreateExtractValue (result, 0), b.CreateExtractValue (result, 1),
+                                                       b.CreateExtractValue (result, 2), b.CreateExtractValue (result, 3) };
+            };
+
+            auto maxLeaf = callCPUID (0, 0)[0];
+            auto maxExtendedLeaf = callCPUID (0x80000000u, 0)[0];
+
+            // A leaf above the maximum that the CPU supports returns junk rather than zeros
+            auto readLeaf = [&] (uint32_t leaf, uint32_t subleaf)
+            {
+                auto registers = callCPUID (leaf, subleaf);
+                auto isSupported = b.CreateICmpUGE (leaf >= 0x80000000u ? maxExtendedLeaf : maxLeaf, b.getInt32 (leaf));
+
+                for (auto& r : registers)
+                    r = b.CreateSelect (isSupported, r, b.getInt32 (0));
+
+                return registers;
+            };
+
+            auto leaf1            = readLeaf (1, 0);
+            auto leaf7            = readLeaf (7, 0);
+            auto leaf7Sub1        = readLeaf (7, 1);
+            auto leafDSub1        = readLeaf (0xd, 1);
+            auto extendedLeaf1    = readLeaf (0x80000001u, 0);
+
+            // XGETBV is only available if the OS has enabled it, which is reported by the OSXSAVE bit
+            auto readXCR0Block = ::llvm::BasicBlock::Create (*context, "readXCR0", resolver);
+            auto selectBlock = ::llvm::BasicBlock::Create (*context, "select", resolver);
+
+            auto hasOSXSAVE = b.CreateICmpNE (b.CreateAnd (leaf1[2], b.getInt32 (1u << 27)), b.getInt32 (0));
+            b.CreateCondBr (hasOSXSAVE, readXCR0Block, selectBlock);
+
+            b.SetInsertPoint (readXCR0Block);
+            auto xcr0Value = b.CreateExtractValue (b.CreateCall (xgetbv, { b.getInt32 (0) }), 0);
+            b.CreateBr (selectBlock);
+
+            b.SetInsertPoint (selectBlock);
+            auto xcr0 = b.CreatePHI (int32Type, 2);
+            xcr0->addIncoming (b.getInt32 (0), entryBlock);
+            xcr0->addIncoming (xcr0Value, readXCR0Block);
+
+            std::array<::llvm::Value*, X86CPUFeatures::numRegisters> registers
+            {
+                leaf1[2], leaf1[3], leaf7[1], leaf7[2], leaf7[3], leaf7Sub1[0], leafDSub1[0], extendedLeaf1[2], xcr0
+            };
+
+            // Working backwards, so that the first suitable variant in the list wins
+            ::llvm::Value* chosenFunction = original;
+
+            for (auto variant = variants.rbegin(); variant != variants.rend(); ++variant)
+            {
+                ::llvm::Value* isSupported = b.getTrue();
+
+                for (size_t i = 0; i < registers.size(); ++i)
+                {
+                    if (auto mask = variant->requiredCPUFeatures.masks[i]; mask != 0)
+                    {
+                        auto maskValue = b.getInt32 (mask);
+                        isSupported = b.CreateAnd (isSupported, b.CreateICmpEQ (b.CreateAnd (registers[i], maskValue), maskValue));
+                    }
+                }
+
+                chosenFunction = b.CreateSelect (isSupported, targetModule->getFunction (variant->functionName), chosenFunction);
+            }
+
+            // Every instance stores the same value, but as they may be initialised on different threads, it's atomic
+            auto store = b.CreateAlignedStore (chosenFunction, selectedVariant, pointerAlignment);
+            store->setAtomic (::llvm::AtomicOrdering::Monotonic);
+            b.CreateRetVoid();
+
+            ::llvm::IRBuilder<> initBuilder (std::addressof (*initialise->getEntryBlock().getFirstInsertionPt()));
+            initBuilder.CreateCall (resolver);
+        }
+
+        // The dispatcher, which replaces advanceBlock
+        {
+            auto fnType = original->getFunctionType();
+            auto dispatcher = ::llvm::Function::Create (fnType, ::llvm::GlobalValue::LinkageTypes::ExternalLinkage,
+                                                        getAdvanceBlockFunctionName(), *targetModule);
+
+            ::llvm::IRBuilder<> b (::llvm::BasicBlock::Create (*context, "entry", dispatcher));
+
+            auto target = b.CreateAlignedLoad (pointerType, selectedVariant, pointerAlignment);
+            target->setAtomic (::llvm::AtomicOrdering::Monotonic);
+
+            std::vector<::llvm::Value*> args;
+
+            for (auto& arg : dispatcher->args())
+                args.push_back (std::addressof (arg));
+
+            auto call = b.CreateCall (fnType, target, args);
+            call->setTailCall();
+
+            if (fnType->getReturnType()->isVoidTy())
+                b.CreateRetVoid();
+            else
+                b.CreateRet (call);
+        }
+    }
+
+    /// Adds the C function that a performer library exports to describe itself. It returns
+    /// a pointer to a constant PerformerLibraryInfo (see cmaj_PerformerLibrary.h) containing
+    /// the given JSON, a table of the named functions and the string dictionary.
+    ///
+    /// All the other functions are given hidden visibility, so that the loader can only
+    /// reach them through the table, and so that several libraries can be loaded into the
+    /// same process without their symbols clashing.
+    void addPerformerLibraryEntryPoint (const char* entryPointName, uint32_t version,
+                                        const std::string& detailsJSON,
+                                        const std::vector<std::string>& functionNames)
+    {
+        for (auto& f : *targetModule)
+            if (! (f.isDeclaration() || f.hasLocalLinkage()))
+                f.setVisibility (::llvm::GlobalValue::VisibilityTypes::HiddenVisibility);
+
+        auto int32Type = ::llvm::Type::getInt32Ty (*context);
+        auto int64Type = ::llvm::Type::getInt64Ty (*context);
+        auto pointerType = ::llvm::PointerType::getUnqual (*context);
+
+        auto addConstant = [this] (::llvm::Constant* value, const char* name)
+        {
+            return new ::llvm::GlobalVariable (*targetModule, value->getType(), true,
+                                               ::llvm::GlobalValue::LinkageTypes::PrivateLinkage, value, name);
+        };
+
+        std::vector<::llvm::Constant*> functionTable;
+
+        for (auto& name : functionNames)
+        {
+            auto f = targetModule->getFunction (name);
+            CMAJ_ASSERT (f != nullptr);
+            functionTable.push_back (f);
+        }
+
+        auto functions  = addConstant (::llvm::ConstantArray::get (::llvm::ArrayType::get (pointerType, functionTable.size()), functionTable), "cmajor_functions");
+        auto details    = addConstant (::llvm::ConstantDataArray::getString (*context, detailsJSON, true), "cmajor_details");
+        auto dictionary = addConstant (::llvm::ConstantDataArray::getString (*context, ::llvm::StringRef (stringDictionary.getRawData(),
+                                                                                                          stringDictionary.getRawDataSize()), false),
+                                       "cmajor_strings");
+
+        auto infoType = ::llvm::StructType::get (*context, { int32Type, int32Type, pointerType, pointerType, pointerType, int64Type });
+
+        auto info = addConstant (::llvm::ConstantStruct::get (infoType, { ::llvm::ConstantInt::get (int32Type, version),
+                                                                          ::llvm::ConstantInt::get (int32Type, functionTable.size()),
+                                                                          details, functions, dictionary,
+                                                                          ::llvm::ConstantInt::get (int64Type, stringDictionary.getRawDataSize()) }),
+                                 "cmajor_library");
+
+        auto entryPoint = ::llvm::Function::Create (::llvm::FunctionType::get (pointerType, false),
+                                                    ::llvm::GlobalValue::LinkageTypes::ExternalLinkage,
+                                                    entryPointName, *targetModule);
+
+        if (::llvm::Triple (targetModule->getTargetTriple()).isOSWindows())
+            entryPoint->setDLLStorageClass (::llvm::GlobalValue::DLLStorageClassTypes::DLLExportStorageClass);
+
+        ::llvm::IRBuilder<> b (::llvm::BasicBlock::Create (*context, "entry", entryPoint));
+        b.CreateRet (info);
+    }
+
+    /// Returns all the x86 features that a CPU must have to run the code that this target
+    /// machine generates, including the ones that its CPU name implies (e.g. x86-64-v3 needs
+    /// F16C, LZCNT and MOVBE as well as AVX2), and the OS support for the wider registers.
+    static X86CPUFeatures getRequiredX86CPUFeatures (const ::llvm::TargetMachine& tm)
+    {
+        struct FeatureBit { const char* name; X86CPUFeatures::Register reg; uint32_t bit; };
+
+        using R = X86CPUFeatures::Register;
+
+        // LLVM feature names, and where CPUID reports them, from the Intel and AMD manuals.
+        // The XCR0 entries check that the OS saves the AVX and AVX-512 register state.
+        static constexpr FeatureBit featureBits[] =
+        {
+            { "cx8", R::leaf1EDX, 8 },          { "cmov", R::leaf1EDX, 15 },        { "mmx", R::leaf1EDX, 23 },
+            { "fxsr", R::leaf1EDX, 24 },        { "sse", R::leaf1EDX, 25 },         { "sse2", R::leaf1EDX, 26 },
+            { "sse3", R::leaf1ECX, 0 },         { "pclmul", R::leaf1ECX, 1 },       { "ssse3", R::leaf1ECX, 9 },
+            { "fma", R::leaf1ECX, 12 },         { "cx16", R::leaf1ECX, 13 },        { "sse4.1", R::leaf1ECX, 19 },
+            { "sse4.2", R::leaf1ECX, 20 },      { "movbe", R::leaf1ECX, 22 },       { "popcnt", R::leaf1ECX, 23 },
+            { "aes", R::leaf1ECX, 25 },         { "xsave", R::leaf1ECX, 26 },       { "avx", R::leaf1ECX, 28 },
+            { "f16c", R::leaf1ECX, 29 },        { "rdrnd", R::leaf1ECX, 30 },
+            { "fsgsbase", R::leaf7EBX, 0 },     { "bmi", R::leaf7EBX, 3 },          { "avx2", R::leaf7EBX, 5 },
+            { "bmi2", R::leaf7EBX, 8 },         { "invpcid", R::leaf7EBX, 10 },     { "rtm", R::leaf7EBX, 11 },
+            { "avx512f", R::leaf7EBX, 16 },     { "avx512dq", R::leaf7EBX, 17 },    { "rdseed", R::leaf7EBX, 18 },
+            { "adx", R::leaf7EBX, 19 },         { "avx512ifma", R::leaf7EBX, 21 },  { "clflushopt", R::leaf7EBX, 23 },
+            { "clwb", R::leaf7EBX, 24 },        { "avx512cd", R::leaf7EBX, 28 },    { "sha", R::leaf7EBX, 29 },
+            { "avx512bw", R::leaf7EBX, 30 },    { "avx512vl", R::leaf7EBX, 31 },
+            { "avx512vbmi", R::leaf7ECX, 1 },   { "pku", R::leaf7ECX, 3 },          { "waitpkg", R::leaf7ECX, 5 },
+            { "avx512vbmi2", R::leaf7ECX, 6 },  { "shstk", R::leaf7ECX, 7 },        { "gfni", R::leaf7ECX, 8 },
+            { "vaes", R::leaf7ECX, 9 },         { "vpclmulqdq", R::leaf7ECX, 10 },  { "avx512vnni", R::leaf7ECX, 11 },
+            { "avx512bitalg", R::leaf7ECX, 12 },{ "avx512vpopcntdq", R::leaf7ECX, 14 }, { "rdpid", R::leaf7ECX, 22 },
+            { "cldemote", R::leaf7ECX, 25 },    { "movdiri", R::leaf7ECX, 27 },     { "movdir64b", R::leaf7ECX, 28 },
+            { "enqcmd", R::leaf7ECX, 29 },
+            { "avx512vp2intersect", R::leaf7EDX, 8 }, { "serialize", R::leaf7EDX, 14 }, { "tsxldtrk", R::leaf7EDX, 16 },
+            { "avx512fp16", R::leaf7EDX, 23 },
+            { "avxvnni", R::leaf7Sub1EAX, 4 },  { "avx512bf16", R::leaf7Sub1EAX, 5 },
+            { "xsaveopt", R::leafDSub1EAX, 0 }, { "xsavec", R::leafDSub1EAX, 1 },   { "xsaves", R::leafDSub1EAX, 3 },
+            { "sahf", R::extendedLeaf1ECX, 0 }, { "lzcnt", R::extendedLeaf1ECX, 5 },{ "sse4a", R::extendedLeaf1ECX, 6 },
+            { "prfchw", R::extendedLeaf1ECX, 8 },{ "xop", R::extendedLeaf1ECX, 11 },{ "lwp", R::extendedLeaf1ECX, 15 },
+            { "fma4", R::extendedLeaf1ECX, 16 },{ "tbm", R::extendedLeaf1ECX, 21 }, { "mwaitx", R::extendedLeaf1ECX, 29 },
+            { "avx", R::xcr0, 1 },              { "avx", R::xcr0, 2 },
+            { "avx512f", R::xcr0, 5 },          { "avx512f", R::xcr0, 6 },          { "avx512f", R::xcr0, 7 }
+        };
+
+        // Going through the subtarget's own feature table avoids warnings about names that
+        // this version of LLVM doesn't know, and its feature bits include implied features
+        auto& subtarget = *tm.getMCSubtargetInfo();
+        auto& enabledFeatures = subtarget.getFeatureBits();
+        X86CPUFeatures result;
+
+        for (auto& feature : subtarget.getAllProcessorFeatures())
+            if (enabledFeatures[feature.Value])
+                for (auto& f : featureBits)
+                    if (std::string_view (feature.Key) == f.name)
+                        result.masks[f.reg] |= (1u << f.bit);
+
+        return result;
+    }
+
     static std::string getInitFunctionName()              { return "initialise"; }
     static std::string getAdvanceOneFrameFunctionName()   { return "advanceOneFrame"; }
     static std::string getAdvanceBlockFunctionName()      { return "advanceBlock"; }
@@ -218,6 +687,15 @@ struct LLVMCodeGenerator
     ptr<CodeGenerator<LLVMCodeGenerator>> codeGenerator;
     bool useFastMaths = false;
 
+    /// If this is set, the optimiser tunes the code (e.g. its vector widths) for this
+    /// target machine's CPU, and each function is tagged with its CPU and features.
+    ::llvm::TargetMachine* tuningTargetMachine = nullptr;
+
+    /// If this is set, generate() only runs the minimal -O0 passes over the module, whatever
+    /// the optimisation level in the build settings. This is used for the first tier of a
+    /// tiered build, which is later re-optimised with applyOptimisationPasses().
+    bool useQuickOptimisation = false;
+
     ::llvm::DataLayout dataLayout;
     choc::value::SimpleStringDictionary& stringDictionary;
 
@@ -232,6 +710,7 @@ struct LLVMCodeGenerator
     std::unordered_map<const AST::VariableDeclaration*, ::llvm::Value*> localVariables;
     std::unordered_map<const AST::Function*, ::llvm::FunctionCallee> functions;
     std::unordered_map<std::string, void*> externalFunctionPointers;
+    std::unordered_map<std::string, std::string> externalFunctionIDs;
     std::unordered_map<const AST::VariableDeclaration*, ::llvm::GlobalVariable*> globalVariables;
     DuckTypedStructMappings<::llvm::StructType*, false> structTypes;
     std::vector<std::vector<uint8_t>> gloalVariableSpace;
@@ -356,17 +835,9 @@ struct LLVMCodeGenerator
         }
         else
         {
-            if (auto machineBuilder = ::llvm::orc::JITTargetMachineBuilder::detectHost())
-            {
-                auto& opts = machineBuilder->getOptions();
-                opts.ExceptionModel = ::llvm::ExceptionHandling::None;
-                opts.setFPDenormalMode (::llvm::DenormalMode::getPositiveZero());
-
-                machineBuilder->setCodeGenOptLevel (getCodeGenOptLevel (buildSettings.getOptimisationLevel()));
-
+            if (auto machineBuilder = createTargetMachineBuilder (buildSettings))
                 if (auto tm = machineBuilder->createTargetMachine())
                     targetMachine = std::move (tm.get());
-            }
         }
 
         ::llvm::legacy::PassManager passManager;
@@ -380,14 +851,29 @@ struct LLVMCodeGenerator
 
     void applyOptimisationPasses()
     {
-        auto optLevel = getOptimisationLevelWithDefault (buildSettings.getOptimisationLevel());
+        applyOptimisationPasses (*targetModule, useQuickOptimisation ? 0 : buildSettings.getOptimisationLevel(), tuningTargetMachine);
+    }
+
+    /// If a cancel flag is given, any optional passes that haven't run by the time it's set are
+    /// skipped, so the module is still valid, but won't be fully optimised.
+    static void applyOptimisationPasses (::llvm::Module& module, int level, ::llvm::TargetMachine* targetMachine,
+                                         const std::atomic<bool>* cancelFlag = nullptr)
+    {
+        auto optLevel = getOptimisationLevelWithDefault (level);
 
         ::llvm::LoopAnalysisManager             loopAnalysisManager;
         ::llvm::FunctionAnalysisManager         functionAnalysisManager;
         ::llvm::CGSCCAnalysisManager            cGSCCAnalysisManager;
         ::llvm::ModuleAnalysisManager           moduleAnalysisManager;
+        ::llvm::PassInstrumentationCallbacks    instrumentationCallbacks;
+
+        if (cancelFlag != nullptr)
+            instrumentationCallbacks.registerShouldRunOptionalPassCallback ([cancelFlag] (::llvm::StringRef, ::llvm::Any)
+                                                                            {
+                                                                                return ! cancelFlag->load (std::memory_order_relaxed);
+                                                                            });
 
-        ::llvm::PassBuilder passBuilder;
+        ::llvm::PassBuilder passBuilder (targetMachine, ::llvm::PipelineTuningOptions(), {}, std::addressof (instrumentationCallbacks));
 
         passBuilder.registerModuleAnalyses          (moduleAnalysisManager);
         passBuilder.registerCGSCCAnalyses           (cGSCCAnalysisManager);
@@ -410,12 +896,12 @@ struct LLVMCodeGenerator
             };
 
             passBuilder.buildPerModuleDefaultPipeline (getOptimisationLevel())
-                .run (*targetModule, moduleAnalysisManager);
+                .run (module, moduleAnalysisManager);
         }
         else
         {
             passBuilder.buildO0DefaultPipeline (::llvm::OptimizationLevel::O0)
-                .run (*targetModule, moduleAnalysisManager);
+                .run (module, moduleAnalysisManager);
         }
     }
 
@@ -850,7 +1336,10 @@ struct LLVMCodeGenerator
         functions[std::addressof (f)] = callee;
 
         if (auto customImplementation = program.externalFunctionManager.findResolvedFunction (f))
+        {
             externalFunctionPointers[name] = customImplementation;
+            externalFunctionIDs[name] = getExternalFunctionID (f);
+        }
 
         return callee;
     }
@@ -869,6 +1358,12 @@ struct LLVMCodeGenerator
         {
             currentFunction->addFnAttr ("wasm-export-name", currentFunction->getName());
         }
+
+        if (tuningTargetMachine != nullptr)
+        {
+            currentFunction->addFnAttr ("target-cpu", tuningTargetMachine->getTargetCPU());
+            currentFunction->addFnAttr ("target-features", tuningTargetMachine->getTargetFeatureString());
+        }
     }
 
     void beginFunction (const AST::Function& fn, std::string_view, const AST::TypeBase&)
@@ -1285,18 +1780,7 @@ struct LLVMCodeGenerator
                 arrayOrVectorData = ::llvm::ConstantArray::get (arrayType, createElementConstants());
             }
 
-            auto sourceDataConstant = new ::llvm::GlobalVariable (*targetModule, arrayOrVectorData->getType(), true,
-                                                                  ::llvm::GlobalValue::PrivateLinkage, arrayOrVectorData,
-                                                                  "_slice_const" + std::to_string (++sliceConstantIndex));
-
-            auto& elementType = *type.getArrayOrVectorElementType();
-            auto pointerType = getLLVMType (elementType)->getPointerTo();
-
-            ::llvm::SmallVector<::llvm::Constant*, 32> fatPointerMembers;
-            fatPointerMembers.push_back (::llvm::ConstantExpr::getPointerCast (sourceDataConstant, pointerType));
-            fatPointerMembers.push_back (::llvm::ConstantInt::getSigned (getInt32Type(), static_cast<int64_t> (numElements)));
-
-            return makeReader (::llvm::ConstantStruct::get (checked_cast<::llvm::StructType> (llvmType), fatPointerMembers), type);
+            return createConstantSlice (type, arrayOrVectorData, numElements);
         }
 
         if (isArray)
@@ -1313,6 +1797,75 @@ struct LLVMCodeGenerator
         return {};
     }
 
+    ValueReader createConstantSlice (const AST::TypeBase& sliceType, ::llvm::Constant* arrayData, uint32_t numElements)
+    {
+        auto sourceDataConstant = new ::llvm::GlobalVariable (*targetModule, arrayData->getType(), true,
+                                                              ::llvm::GlobalValue::PrivateLinkage, arrayData,
+                                                              "_slice_const" + std::to_string (++sliceConstantIndex));
+
+        auto& elementType = *sliceType.getArrayOrVectorElementType();
+        auto pointerType = getLLVMType (elementType)->getPointerTo();
+
+        ::llvm::SmallVector<::llvm::Constant*, 32> fatPointerMembers;
+        fatPointerMembers.push_back (::llvm::ConstantExpr::getPointerCast (sourceDataConstant, pointerType));
+        fatPointerMembers.push_back (::llvm::ConstantInt::getSigned (getInt32Type(), static_cast<int64_t> (numElements)));
+
+        return makeReader (::llvm::ConstantStruct::get (checked_cast<::llvm::StructType> (getLLVMType (sliceType)), fatPointerMembers), sliceType);
+    }
+
+    template <typename LLVMType>
+    ::llvm::Constant* createConstantDataArrayOrVector (const uint8_t* data, size_t numElements, bool isVector)
+    {
+        ::llvm::ArrayRef<LLVMType> elements (reinterpret_cast<const LLVMType*> (data), numElements);
+
+        if (isVector)
+            return ::llvm::ConstantDataVector::get (*context, elements);
+
+        return ::llvm::ConstantDataArray::get (*context, elements);
+    }
+
+    ::llvm::Constant* createConstantDataArrayOrVector (const AST::TypeBase& primitiveType, const uint8_t* data, size_t numElements, bool isVector)
+    {
+        if (primitiveType.isPrimitiveFloat32())  return createConstantDataArrayOrVector<float>    (data, numElements, isVector);
+        if (primitiveType.isPrimitiveFloat64())  return createConstantDataArrayOrVector<double>   (data, numElements, isVector);
+        if (primitiveType.isPrimitiveInt32())    return createConstantDataArrayOrVector<uint32_t> (data, numElements, isVector);
+        if (primitiveType.isPrimitiveInt64())    return createConstantDataArrayOrVector<uint64_t> (data, numElements, isVector);
+
+        CMAJ_ASSERT_FALSE;
+        return {};
+    }
+
+    // The packed data can be handed to LLVM directly, without creating a constant object per element
+    ValueReader createConstantPackedArray (const AST::ConstantPackedArray& packed)
+    {
+        auto& type = packed.getType().skipConstAndRefModifiers();
+        auto& elementType = packed.getElementType().skipConstAndRefModifiers();
+        auto numElements = packed.getNumElements();
+        auto data = packed.data.getData();
+        ::llvm::Constant* arrayData = nullptr;
+
+        if (auto vec = elementType.getAsVectorType())
+        {
+            auto elementSize = packed.getElementSize();
+            ::llvm::SmallVector<::llvm::Constant*, 32> elements;
+            elements.reserve (numElements);
+
+            for (size_t i = 0; i < numElements; ++i)
+                elements.push_back (createConstantDataArrayOrVector (vec->getElementType(), data + i * elementSize, vec->resolveSize(), true));
+
+            arrayData = ::llvm::ConstantArray::get (::llvm::ArrayType::get (getLLVMType (elementType), numElements), elements);
+        }
+        else
+        {
+            arrayData = createConstantDataArrayOrVector (elementType, data, numElements, false);
+        }
+
+        if (type.isSlice())
+            return createConstantSlice (type, arrayData, numElements);
+
+        return makeReader (arrayData, type);
+    }
+
     ValueReader createNullConstant (const AST::TypeBase& type)
     {
         return makeReader (createNullConstant (getLLVMType (type)), type);
@@ -1570,6 +2123,27 @@ struct LLVMCodeGenerator
         return makeReader (getBlockBuilder().CreateSelect (args[0], args[1], args[2]), returnType);
     }
 
+    ValueReader createIntrinsic_readCycleCounter (const AST::TypeBase& returnType)
+    {
+        auto triple = ::llvm::Triple (targetModule->getTargetTriple());
+        auto& b = getBlockBuilder();
+
+        if (triple.isX86())
+            return makeReader (b.CreateCall (::llvm::Intrinsic::getDeclaration (targetModule.get(), ::llvm::Intrinsic::readcyclecounter)), returnType);
+
+        // On arm64 the cycle counter register can't be read from user code, so use the virtual timer instead
+        if (triple.isAArch64())
+        {
+            auto int64Type = ::llvm::Type::getInt64Ty (*context);
+            auto registerName = ::llvm::MDNode::get (*context, ::llvm::MDString::get (*context, "cntvct_el0"));
+            auto readRegister = ::llvm::Intrinsic::getDeclaration (targetModule.get(), ::llvm::Intrinsic::read_volatile_register, { int64Type });
+
+            return makeReader (b.CreateCall (readRegister, { ::llvm::MetadataAsValue::get (*context, registerName) }), returnType);
+        }
+
+        return {};
+    }
+
     ValueReader createIntrinsicCall (::llvm::Intrinsic::ID intrinsicID, ::llvm::ArrayRef<::llvm::Value*> args, const AST::TypeBase& returnType)
     {
         if (! returnType.isFloatOrVectorOfFloat())
@@ -1619,6 +2193,7 @@ struct LLVMCodeGenerator
             case AST::Intrinsic::Type::reinterpretIntToFloat:  return createIntrinsic_reinterpretIntToFloat (args.front());
 
             case AST::Intrinsic::Type::select:        return createIntrinsic_select (args, returnType);
+            case AST::Intrinsic::Type::readCycleCounter:  return webAssemblyMode ? ValueReader() : createIntrinsic_readCycleCounter (returnType);
 
             case AST::Intrinsic::Type::fmod:
             case AST::Intrinsic::Type::tan:
@@ -20,8 +20,14 @@
 
 #if CMAJ_ENABLE_PERFORMER_LLVM || CMAJ_ENABLE_CODEGEN_LLVM_WASM
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include "../../../include/cmaj_ErrorHandling.h"
 #include "../../../../../include/cmajor/COM/cmaj_EngineFactoryInterface.h"
+#include "../../../../../include/cmajor/helpers/cmaj_PerformerLibrary.h"
 
 #include "cmaj_LLVM.h"
 
@@ -35,10 +41,13 @@
 #include "choc/platform/choc_DisableAllWarnings.h"
 
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/LLJIT.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
@@ -51,9 +60,15 @@
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/MC/TargetRegistry.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Transforms/IPO/GlobalDCE.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 
 #include "choc/platform/choc_ReenableAllWarnings.h"
 #include "choc/memory/choc_AlignedMemoryBlock.h"
+#include "choc/memory/choc_Endianness.h"
 #include "choc/text/choc_Files.h"
 #include "choc/text/choc_OpenSourceLicenseList.h"
 
@@ -85,22 +100,52 @@ static void initialiseLLVM()
 
 struct LLJITHolder
 {
-    LLJITHolder (int optimisationLevel)
+    LLJITHolder (const BuildSettings& buildSettings, bool captureObjectCode)
     {
         ::llvm::sys::DynamicLibrary::LoadLibraryPermanently (nullptr);
 
-        if (auto machineBuilder = ::llvm::orc::JITTargetMachineBuilder::detectHost())
+        // The object code capture only holds a single object, so the code can't be split up
+        numCompileThreads = captureObjectCode ? 1u : getNumCompileThreads (buildSettings);
+
+        if (auto machineBuilder = LLVMCodeGenerator::createTargetMachineBuilder (buildSettings))
         {
             auto targetTriple = machineBuilder->getTargetTriple();
-            auto& opts = machineBuilder->getOptions();
-            opts.ExceptionModel = ::llvm::ExceptionHandling::None;
-            opts.setFPDenormalMode (::llvm::DenormalMode::getPositiveZero());
-            opts.setFP32DenormalMode (::llvm::DenormalMode::getPositiveZero());
 
-            machineBuilder->setCodeGenOptLevel (getCodeGenOptLevel (optimisationLevel));
+            machineBuilder->setCodeGenOptLevel (getCodeGenOptLevel (buildSettings.getOptimisationLevel()));
+
+            hostDescription = LLVMCodeGenerator::getTargetDescription (*machineBuilder);
+
+            if (auto tm = machineBuilder->createTargetMachine())
+                targetMachine = std::move (*tm);
+            else
+                ::llvm::consumeError (tm.takeError());
 
             ::llvm::orc::LLJITBuilder builder;
-            builder.setJITTargetMachineBuilder (machineBuilder.get());
+            builder.setJITTargetMachineBuilder (std::move (*machineBuilder));
+
+            if (captureObjectCode)
+            {
+                builder.setCompileFunctionCreator ([this] (::llvm::orc::JITTargetMachineBuilder jtmb)
+                                                     -> ::llvm::Expected<std::unique_ptr<::llvm::orc::IRCompileLayer::IRCompiler>>
+                                                   {
+                                                       auto tm = jtmb.createTargetMachine();
+
+                                                       if (! tm)
+                                                           return tm.takeError();
+
+                                                       return std::make_unique<::llvm::orc::TMOwningSimpleCompiler> (std::move (*tm), std::addressof (objectCodeCapture));
+                                                   });
+            }
+            else if (numCompileThreads > 1)
+            {
+                builder.setNumCompileThreads (numCompileThreads);
+                builder.setCompileFunctionCreator ([this] (::llvm::orc::JITTargetMachineBuilder jtmb)
+                                                     -> ::llvm::Expected<std::unique_ptr<::llvm::orc::IRCompileLayer::IRCompiler>>
+                                                   {
+                                                       return std::make_unique<TimedCompiler> (std::make_unique<::llvm::orc::ConcurrentIRCompiler> (std::move (jtmb)),
+                                                                                               partitionTimes);
+                                                   });
+            }
 
             // Avoid the special case ObjectLinkingLayer created by lljit when it's the wrong thing to do
             if (targetTriple.isOSBinFormatMachO())
@@ -130,14 +175,69 @@ struct LLJITHolder
         CMAJ_ASSERT_FALSE;
     }
 
-    void load (::llvm::orc::ThreadSafeModule&& module)
+    /// Adds the module to the JIT. Any functions named in lazyFunctionNames are moved into
+    /// modules of their own, which are only compiled when their symbol is first looked up.
+    void load (::llvm::orc::ThreadSafeModule&& module, const std::vector<std::string>& lazyFunctionNames = {})
     {
-        auto err = lljit->addIRModule (std::move (module));
+        if (! lazyFunctionNames.empty())
+        {
+            for (auto& m : extractLazyFunctions (module, lazyFunctionNames))
+            {
+                auto err = lljit->addIRModule (std::move (m));
+                CMAJ_ASSERT (! err);
+            }
+        }
+
+        std::vector<std::string> partitionSymbols;
+        auto partitions = module.withModuleDo ([&] (::llvm::Module& m) { return splitIntoPartitions (m, partitionSymbols); });
+
+        if (partitions.empty())
+        {
+            auto err = lljit->addIRModule (std::move (module));
+            CMAJ_ASSERT (! err);
+        }
+        else
+        {
+            for (auto& p : partitions)
+            {
+                auto err = lljit->addIRModule (std::move (p));
+                CMAJ_ASSERT (! err);
+            }
+        }
+
+        auto err = lljit->initialize (lljit->getMainJITDylib());
         CMAJ_ASSERT (! err);
-        err = lljit->initialize (lljit->getMainJITDylib());
+
+        if (! partitionSymbols.empty())
+            compilePartitions (partitionSymbols);
+    }
+
+    /// After a partitioned build, this returns how long each partition took to compile
+    std::vector<std::pair<std::string, std::chrono::duration<double>>> getPartitionTimes() const
+    {
+        std::scoped_lock lock (partitionTimes.lock);
+        return partitionTimes.times;
+    }
+
+    bool loadObjectCode (choc::span<char> objectCode)
+    {
+        auto buffer = ::llvm::MemoryBuffer::getMemBufferCopy ({ objectCode.data(), objectCode.size() }, "cmajor");
+
+        if (auto err = lljit->addObjectFile (std::move (buffer)))
+        {
+            ::llvm::consumeError (std::move (err));
+            return false;
+        }
+
+        auto err = lljit->initialize (lljit->getMainJITDylib());
         CMAJ_ASSERT (! err);
+        return true;
     }
 
+    /// If the holder was created with captureObjectCode = true, this returns the
+    /// relocatable object that was produced when the module was compiled.
+    const std::vector<char>& getCompiledObjectCode() const      { return objectCodeCapture.objectCode; }
+
     void addExternalFunctionSymbols (const std::unordered_map<std::string, void*>& functionPointers)
     {
         auto& processSymbols = lljit->getMainJITDylib();
@@ -174,8 +274,184 @@ struct LLJITHolder
     std::string getTargetTriple() const         { return lljit->getTargetTriple().normalize(); }
     const ::llvm::DataLayout& getDataLayout()   { return lljit->getDataLayout(); }
 
+    /// A target machine with the same CPU and features as the JIT, for the optimiser to tune for
+    ::llvm::TargetMachine* getTargetMachine() const     { return targetMachine.get(); }
+
+    /// A description of the triple, CPU and feature set that code is being built for.
+    /// Cached object code is only valid on a machine with an identical description.
+    std::string hostDescription;
+
 private:
+    struct ObjectCodeCapture  : public ::llvm::ObjectCache
+    {
+        void notifyObjectCompiled (const ::llvm::Module*, ::llvm::MemoryBufferRef object) override
+        {
+            objectCode.assign (object.getBufferStart(), object.getBufferEnd());
+        }
+
+        std::unique_ptr<::llvm::MemoryBuffer> getObject (const ::llvm::Module*) override
+        {
+            return {};
+        }
+
+        std::vector<char> objectCode;
+    };
+
+    struct PartitionTimes
+    {
+        mutable std::mutex lock;
+        std::vector<std::pair<std::string, std::chrono::duration<double>>> times;
+    };
+
+    // Wraps the JIT's compiler to record how long each module takes to compile
+    struct TimedCompiler  : public ::llvm::orc::IRCompileLayer::IRCompiler
+    {
+        TimedCompiler (std::unique_ptr<::llvm::orc::IRCompileLayer::IRCompiler> c, PartitionTimes& t)
+            : IRCompiler (c->getManglingOptions()), compiler (std::move (c)), times (t)
+        {}
+
+        ::llvm::Expected<std::unique_ptr<::llvm::MemoryBuffer>> operator() (::llvm::Module& module) override
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto result = (*compiler) (module);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            std::scoped_lock lock (times.lock);
+            times.times.emplace_back (module.getModuleIdentifier(), elapsed);
+            return result;
+        }
+
+        std::unique_ptr<::llvm::orc::IRCompileLayer::IRCompiler> compiler;
+        PartitionTimes& times;
+    };
+
+    ObjectCodeCapture objectCodeCapture;
+    PartitionTimes partitionTimes;
+    uint32_t numCompileThreads = 1;
     std::unique_ptr<::llvm::orc::LLJIT> lljit;
+    std::unique_ptr<::llvm::TargetMachine> targetMachine;
+
+    // Splitting only pays off when each thread gets a reasonable amount of code to compile
+    static constexpr size_t minFunctionsPerPartition = 64;
+
+    // Partitioning is opt-in, so that by default, the code is compiled on the calling thread
+    // as one module, exactly as it would be without any threads
+    static uint32_t getNumCompileThreads (const BuildSettings& buildSettings)
+    {
+        return std::max (1u, buildSettings.getNumCompileThreads());
+    }
+
+    // Splits a large module into one partition per compile thread, balanced by size. Each
+    // partition is moved into an LLVM context of its own, because ORC can only compile one
+    // module at a time from any given context. For each partition, the name of one of its
+    // functions is added to partitionSymbols, so that they can all be looked up together.
+    std::vector<::llvm::orc::ThreadSafeModule> splitIntoPartitions (::llvm::Module& module, std::vector<std::string>& partitionSymbols)
+    {
+        std::vector<::llvm::orc::ThreadSafeModule> partitions;
+
+        size_t numFunctions = 0;
+
+        for (auto& f : module)
+            if (! f.isDeclaration())
+                ++numFunctions;
+
+        auto numPartitions = std::min (static_cast<size_t> (numCompileThreads), numFunctions / minFunctionsPerPartition);
+
+        if (numPartitions < 2)
+            return partitions;
+
+        ::llvm::SplitModule (module, static_cast<unsigned> (numPartitions), [&] (std::unique_ptr<::llvm::Module> part)
+        {
+            ::llvm::SmallVector<char, 0> bitcode;
+
+            {
+                ::llvm::raw_svector_ostream s (bitcode);
+                ::llvm::WriteBitcodeToFile (*part, s);
+            }
+
+            auto context = std::make_unique<::llvm::LLVMContext>();
+            auto buffer = ::llvm::MemoryBuffer::getMemBuffer ({ bitcode.data(), bitcode.size() }, {}, false);
+            auto parsed = ::llvm::parseBitcodeFile (buffer->getMemBufferRef(), *context);
+
+            if (! parsed)
+                throwError (Errors::failedToJit (toString (parsed.takeError())));
+
+            auto& partModule = **parsed;
+            partModule.setModuleIdentifier ("partition " + std::to_string (partitions.size() + 1));
+
+            for (auto& f : partModule)
+            {
+                if (! f.isDeclaration())
+                {
+                    partitionSymbols.push_back (f.getName().str());
+                    break;
+                }
+            }
+
+            partitions.emplace_back (std::move (*parsed), std::move (context));
+        });
+
+        return partitions;
+    }
+
+    // Each extracted function gets a module to itself, so that nothing else is compiled along
+    // with it. Internal symbols in the main module are made external (but hidden) so that
+    // the extracted functions can still refer to them.
+    static std::vector<::llvm::orc::ThreadSafeModule> extractLazyFunctions (::llvm::orc::ThreadSafeModule& module,
+                                                                           const std::vector<std::string>& functionNames)
+    {
+        std::vector<::llvm::orc::ThreadSafeModule> extracted;
+        auto context = module.getContext();
+
+        module.withModuleDo ([&] (::llvm::Module& m)
+        {
+            for (auto& gv : m.global_values())
+            {
+                if (gv.hasLocalLinkage())
+                {
+                    if (! gv.hasName())
+                        gv.setName ("_cmaj_unnamed");
+
+                    gv.setLinkage (::llvm::GlobalValue::ExternalLinkage);
+                    gv.setVisibility (::llvm::GlobalValue::HiddenVisibility);
+                }
+            }
+
+            for (auto& name : functionNames)
+            {
+                auto f = m.getFunction (name);
+
+                if (f == nullptr || f->isDeclaration())
+                    continue;
+
+                ::llvm::ValueToValueMapTy valueMap;
+                auto functionModule = ::llvm::CloneModule (m, valueMap, [f] (const ::llvm::GlobalValue* gv) { return gv == f; });
+                functionModule->setModuleIdentifier (name);
+                f->deleteBody();
+
+                extracted.emplace_back (std::move (functionModule), context);
+            }
+        });
+
+        return extracted;
+    }
+
+    // Looking up a symbol from every partition in a single request lets the JIT's
+    // thread pool compile all of them at the same time
+    void compilePartitions (const std::vector<std::string>& symbolNames)
+    {
+        ::llvm::orc::SymbolLookupSet symbols;
+
+        for (auto& name : symbolNames)
+            symbols.add (lljit->mangleAndIntern (name));
+
+        auto result = lljit->getExecutionSession().lookup (::llvm::orc::makeJITDylibSearchOrder (std::addressof (lljit->getMainJITDylib()),
+                                                                                                ::llvm::orc::JITDylibLookupFlags::MatchAllSymbols),
+                                                           std::move (symbols));
+
+        if (! result)
+            throwError (Errors::failedToJit (toString (result.takeError())));
+    }
 
     static ::llvm::CodeGenOptLevel getCodeGenOptLevel (int level)
     {
@@ -205,6 +481,7 @@ struct LLVMEngine
     EngineBase<LLVMEngine>& engine;
 
     static std::string getEngineVersion()   { return "llvm1"; }
+    std::string getTargetDescription()      { return LLVMCodeGenerator::getTargetDescription (engine.buildSettings); }
 
     static constexpr bool canUseForwardBranches = true;
     static constexpr bool usesDynamicRateAndSessionID = false;
@@ -222,7 +499,10 @@ struct LLVMEngine
     {
         LinkedCode (LLVMEngine& llvmEngine, bool isSingleFrameOnly, double latencyToUse,
                     CacheDatabaseInterface* cache, const char* cacheKey)
-           : lljit (llvmEngine.engine.buildSettings.getOptimisationLevel()),
+           : isTiered (shouldBuildInTiers (llvmEngine.engine.buildSettings, cache, cacheKey)),
+             lljit (isTiered ? BuildSettings (llvmEngine.engine.buildSettings).setOptimisationLevel (0)
+                             : llvmEngine.engine.buildSettings,
+                    ! isTiered && cache != nullptr && llvmEngine.engine.buildSettings.shouldCacheObjectCode()),
              latency (latencyToUse)
         {
             LLVMCodeGenerator codeGen (*llvmEngine.engine.program,
@@ -233,9 +513,19 @@ struct LLVMEngine
                                        stringDictionary,
                                        false);
 
+            codeGen.tuningTargetMachine = lljit.getTargetMachine();
+            codeGen.useQuickOptimisation = isTiered;
             codeGen.addNativeOverriddenFunctions (llvmEngine.engine.program->externalFunctionManager);
 
-            bool loadedFromCache = loadFromCache (codeGen, cache, cacheKey);
+            bool useObjectCache = ! isTiered && cache != nullptr && llvmEngine.engine.buildSettings.shouldCacheObjectCode();
+            auto objectCacheKey = useObjectCache ? getObjectCodeCacheKey (cacheKey) : std::string();
+            std::vector<char> cachedObjectCode;
+
+            compileHandlersLazily = llvmEngine.engine.buildSettings.shouldCompileHandlersLazily() && ! useObjectCache;
+            maxDeferredCallsPerHandler = llvmEngine.engine.buildSettings.getEventBufferSize();
+
+            bool loadedObjectCode = useObjectCache && loadObjectCodeFromCache (codeGen, *cache, objectCacheKey, cachedObjectCode);
+            bool loadedFromCache = loadedObjectCode || loadFromCache (codeGen, cache, cacheKey);
 
             if (! (loadedFromCache || codeGen.generate()))
             {
@@ -253,25 +543,84 @@ struct LLVMEngine
                 throwError (Errors::failedToLink ("Memory alignment requirements not met"));
 
             initialiseEndpointHandlers (codeGen, llvmEngine.engine.endpointHandles);
+            initialiseNodeProfile (codeGen, llvmEngine.engine.program->profiledNodeNames);
 
-            if (cache != nullptr && ! loadedFromCache)
+            if (cache != nullptr && ! (loadedFromCache || isTiered))
                 codeGen.saveBitcodeToCache (*cache, cacheKey);
 
+            // The quick tier's module is about to be handed to the JIT, so a copy of it
+            // is taken first for the background thread to optimise
+            std::vector<char> bitcodeToOptimise;
+
+            if (isTiered)
+                bitcodeToOptimise = codeGen.getModuleBitcode();
+
             lljit.addExternalFunctionSymbols (codeGen.externalFunctionPointers);
-            lljit.load (codeGen.takeCompiledModule());
+
+            if (loadedObjectCode)
+            {
+                if (! lljit.loadObjectCode (cachedObjectCode))
+                    throwError (Errors::failedToLink ("Cached object code could not be loaded"));
+            }
+            else if (compileHandlersLazily)
+            {
+                std::vector<std::string> lazyFunctionNames;
+
+                for (auto& lazy : lazyFunctions)
+                    lazyFunctionNames.push_back (lazy->name);
+
+                lljit.load (codeGen.takeCompiledModule(), lazyFunctionNames);
+            }
+            else
+            {
+                lljit.load (codeGen.takeCompiledModule());
+            }
 
             loadFunction (initialiseFn, LLVMCodeGenerator::getInitFunctionName());
+            loadAdvanceFunction (lljit, isSingleFrameOnly);
 
-            if (isSingleFrameOnly)
-                loadFunction (advanceOneFrameFn, LLVMCodeGenerator::getAdvanceOneFrameFunctionName());
+            if (compileHandlersLazily)
+                startLazyCompilation();
             else
-                loadFunction (advanceBlockFn, LLVMCodeGenerator::getAdvanceBlockFunctionName());
+                for (auto& lazy : lazyFunctions)
+                    getAddress (*lazy);
 
-            for (auto& e : inputValues)
-                loadFunction (e.setValue, e.setValueFnName);
+            // The lookups above will have forced the module to be compiled, so the
+            // object code is now available to store
+            if (useObjectCache && ! loadedObjectCode)
+                saveObjectCodeToCache (codeGen, *cache, objectCacheKey);
+
+            if (auto partitionTimes = lljit.getPartitionTimes(); partitionTimes.size() > 1)
+                for (auto& t : partitionTimes)
+                    llvmEngine.engine.compilePerformanceTimes.addParallelTask (t.first, t.second);
+
+            if (isTiered)
+            {
+                quickTierActive = true;
+                startOptimisedBuild (std::move (bitcodeToOptimise), llvmEngine.engine.buildSettings,
+                                     codeGen.externalFunctionPointers, isSingleFrameOnly, cache, cacheKey);
+            }
+        }
+
+        ~LinkedCode()
+        {
+            if (lazyCompileThread.joinable())
+            {
+                stopLazyCompilation = true;
+                lazyCompileThread.join();
+            }
+
+            // The optimiser checks this flag between passes, so it gives up soon after being
+            // asked, and the only wait is for whichever pass or code-gen step is in progress
+            if (optimiserThread.joinable())
+            {
+                cancelOptimisedBuild = true;
+                optimiserThread.join();
+            }
         }
 
         //==============================================================================
+        const bool isTiered;
         LLJITHolder lljit;
         choc::value::SimpleStringDictionary stringDictionary;
         NativeTypeLayoutCache nativeTypeLayouts;
@@ -280,9 +629,20 @@ struct LLVMEngine
 
         double latency;
 
+        std::vector<std::string> profiledNodeNames;
+        size_t profileCountersOffset = 0;
+
         InitialiseFn        initialiseFn = {};
-        AdvanceOneFrameFn   advanceOneFrameFn = {};
-        AdvanceBlockFn      advanceBlockFn = {};
+
+        // In a tiered build, these are replaced by the optimised versions when they're ready,
+        // so performers re-read them at the start of each block
+        std::atomic<AdvanceOneFrameFn>  advanceOneFrameFn { nullptr };
+        std::atomic<AdvanceBlockFn>     advanceBlockFn { nullptr };
+
+        // Holds the optimised code for a tiered build once it has been compiled
+        std::unique_ptr<LLJITHolder> optimisedJIT;
+        std::thread optimiserThread;
+        std::atomic<bool> cancelOptimisedBuild { false }, quickTierActive { false };
 
         //==============================================================================
         struct InputStreamEndpoint
@@ -292,13 +652,127 @@ struct LLVMEngine
             ptr<const NativeTypeLayout> frameLayout;
         };
 
+        //==============================================================================
+        // An event handler or value setter. If handlers are compiled lazily, each one is
+        // built by a background thread, in the order they're declared unless prefetch()
+        // has been used to ask for some sooner. If the rendering thread calls one before
+        // it's ready, the performer holds on to the call and replays it once the function
+        // has been compiled, because compiling it there would block.
+        struct LazyFunction
+        {
+            std::string name;
+            std::atomic<void*> address { nullptr };
+            std::atomic<bool> prefetchRequested { false };
+
+            // Never compiles anything, so this is the only way the rendering thread may get
+            // the address. If the function isn't ready, it's moved to the front of the queue
+            // and this returns nullptr.
+            void* getAddressIfCompiled()
+            {
+                if (auto a = address.load (std::memory_order_acquire))
+                    return a;
+
+                prefetchRequested.store (true, std::memory_order_relaxed);
+                return nullptr;
+            }
+        };
+
+        std::vector<std::unique_ptr<LazyFunction>> lazyFunctions;
+        bool compileHandlersLazily = false;
+        uint32_t maxDeferredCallsPerHandler = 0;
+        std::atomic<bool> stopLazyCompilation { false };
+        std::thread lazyCompileThread;
+
+        LazyFunction& addLazyFunction (const std::string& name)
+        {
+            for (auto& f : lazyFunctions)
+                if (f->name == name)
+                    return *f;
+
+            lazyFunctions.push_back (std::make_unique<LazyFunction>());
+            lazyFunctions.back()->name = name;
+            return *lazyFunctions.back();
+        }
+
+        LazyFunction& getLazyFunction (const std::string& name)
+        {
+            for (auto& f : lazyFunctions)
+                if (f->name == name)
+                    return *f;
+
+            CMAJ_ASSERT_FALSE;
+        }
+
+        // This compiles the function if it isn't ready, so must never be called while rendering
+        void* getAddress (LazyFunction& f)
+        {
+            if (auto address = f.address.load (std::memory_order_acquire))
+                return address;
+
+            auto address = lljit.findSymbol (f.name);
+            CMAJ_ASSERT (address != nullptr);
+            f.address.store (address, std::memory_order_release);
+            return address;
+        }
+
+        /// Moves the handlers for an input endpoint to the front of the background compile
+        /// thread's queue. This doesn't lock or allocate, so it's safe on the rendering thread.
+        void prefetch (EndpointHandle handle)
+        {
+            for (auto& e : inputValues)
+                if (e.handle == handle)
+                    e.setValue->prefetchRequested.store (true, std::memory_order_relaxed);
+
+            for (auto& e : inputEvents)
+                if (e.handle == handle)
+                    for (auto* h : e.handlers)
+                        h->prefetchRequested.store (true, std::memory_order_relaxed);
+        }
+
+        void startLazyCompilation()
+        {
+            lazyCompileThread = std::thread ([this]
+            {
+                while (! stopLazyCompilation)
+                {
+                    LazyFunction* next = nullptr;
+
+                    for (auto& f : lazyFunctions)
+                    {
+                        if (f->address.load (std::memory_order_acquire) == nullptr)
+                        {
+                            if (next == nullptr)
+                                next = f.get();
+
+                            if (f->prefetchRequested.load (std::memory_order_relaxed))
+                            {
+                                next = f.get();
+                                break;
+                            }
+                        }
+                    }
+
+                    if (next == nullptr)
+                        return;
+
+                    getAddress (*next);
+                }
+            });
+        }
+
+        //==============================================================================
         struct InputValueEndpoint
         {
             EndpointHandle handle;
             size_t dataSize = 0;
             ptr<const NativeTypeLayout> layout;
-            std::string setValueFnName;
-            SetValueRampFn setValue = {};
+            LazyFunction* setValue = nullptr;
+        };
+
+        struct InputEventEndpoint
+        {
+            EndpointHandle handle;
+            std::vector<LazyFunction*> handlers;
         };
 
         struct OutputStreamEndpoint
@@ -332,10 +806,43 @@ struct LLVMEngine
 
         std::vector<InputStreamEndpoint>  inputStreams;
         std::vector<InputValueEndpoint>   inputValues;
+        std::vector<InputEventEndpoint>   inputEvents;
         std::vector<OutputStreamEndpoint> outputStreams;
         std::vector<OutputValueEndpoint>  outputValues;
         std::vector<OutputEventEndpoint>  outputEvents;
 
+        //==============================================================================
+        void initialiseNodeProfile (LLVMCodeGenerator& codeGen, const std::vector<std::string>& nodeNames)
+        {
+            if (nodeNames.empty())
+                return;
+
+            // When the main graph is wrapped in a block processor, its state is nested
+            // inside the outer state struct, so this has to search for the counters
+            if (auto offset = findStateMemberOffset (codeGen, *codeGen.stateStruct, transformations::getNodeProfileCountersName()))
+            {
+                profiledNodeNames = nodeNames;
+                profileCountersOffset = *offset;
+            }
+        }
+
+        static std::optional<size_t> findStateMemberOffset (LLVMCodeGenerator& codeGen, const AST::StructType& s, std::string_view name)
+        {
+            for (uint32_t i = 0; i < s.memberNames.size(); ++i)
+            {
+                auto memberOffset = codeGen.getStructMemberOffset (s, i);
+
+                if (s.getMemberName (i) == name)
+                    return memberOffset;
+
+                if (auto nested = AST::castTo<AST::StructType> (s.getMemberType (i).skipConstAndRefModifiers()))
+                    if (auto offset = findStateMemberOffset (codeGen, *nested, name))
+                        return memberOffset + *offset;
+            }
+
+            return {};
+        }
+
         static bool loadFromCache (LLVMCodeGenerator& codeGen, CacheDatabaseInterface* cache, const char* key)
         {
             if (cache != nullptr)
@@ -353,6 +860,108 @@ struct LLVMEngine
             return false;
         }
 
+        //==============================================================================
+        // Object code cache entries contain the host description, the string dictionary,
+        // the list of external function symbols and then the relocatable object itself.
+        // Each section is prefixed by its little-endian 32-bit size.
+        std::string getObjectCodeCacheKey (const char* cacheKey) const
+        {
+            choc::hash::xxHash64 hash;
+            hash.addInput (lljit.hostDescription);
+            return std::string (cacheKey) + "_obj_" + choc::text::createHexString (hash.getHash());
+        }
+
+        void saveObjectCodeToCache (const LLVMCodeGenerator& codeGen, CacheDatabaseInterface& cache, const std::string& key)
+        {
+            auto& objectCode = lljit.getCompiledObjectCode();
+
+            if (objectCode.empty())
+                return;
+
+            std::vector<char> data;
+
+            auto writeChunk = [&] (const void* source, size_t size)
+            {
+                char sizeBytes[sizeof (uint32_t)];
+                choc::memory::writeLittleEndian (sizeBytes, static_cast<uint32_t> (size));
+                data.insert (data.end(), sizeBytes, sizeBytes + sizeof (sizeBytes));
+                data.insert (data.end(), static_cast<const char*> (source), static_cast<const char*> (source) + size);
+            };
+
+            auto writeString = [&] (const std::string& s) { writeChunk (s.data(), s.length()); };
+
+            writeString (lljit.hostDescription);
+            writeChunk (stringDictionary.getRawData(), stringDictionary.getRawDataSize());
+
+            std::string externals;
+
+            for (auto& f : codeGen.externalFunctionIDs)
+                externals += f.first + "\n" + f.second + "\n";
+
+            writeString (externals);
+            writeChunk (objectCode.data(), objectCode.size());
+
+            cache.store (key.c_str(), data.data(), data.size());
+        }
+
+        bool loadObjectCodeFromCache (LLVMCodeGenerator& codeGen, CacheDatabaseInterface& cache,
+                                      const std::string& key, std::vector<char>& objectCode)
+        {
+            auto cachedSize = cache.reload (key.c_str(), nullptr, 0);
+
+            if (cachedSize == 0)
+                return false;
+
+            std::vector<char> loaded;
+            loaded.resize (static_cast<size_t> (cachedSize));
+
+            if (cache.reload (key.c_str(), loaded.data(), cachedSize) != cachedSize)
+                return false;
+
+            choc::span<char> remaining (loaded);
+
+            auto readChunk = [&] (choc::span<char>& chunk) -> bool
+            {
+                if (remaining.size() < sizeof (uint32_t))
+                    return false;
+
+                auto size = choc::memory::readLittleEndian<uint32_t> (remaining.data());
+                remaining = { remaining.begin() + sizeof (uint32_t), remaining.end() };
+
+                if (remaining.size() < size)
+                    return false;
+
+                chunk = { remaining.begin(), remaining.begin() + size };
+                remaining = { remaining.begin() + size, remaining.end() };
+                return true;
+            };
+
+            choc::span<char> host, dictionary, externals, object;
+
+            if (! (readChunk (host) && readChunk (dictionary) && readChunk (externals) && readChunk (object)))
+                return false;
+
+            if (std::string_view (host.data(), host.size()) != lljit.hostDescription || object.empty())
+                return false;
+
+            std::unordered_map<std::string, std::string> externalSymbols;
+            auto externalLines = choc::text::splitIntoLines (std::string_view (externals.data(), externals.size()), false);
+
+            for (size_t i = 0; i + 1 < externalLines.size(); i += 2)
+                externalSymbols[externalLines[i]] = externalLines[i + 1];
+
+            codeGen.restoreExternalFunctionPointers (externalSymbols);
+
+            if (codeGen.externalFunctionPointers.size() != externalSymbols.size())
+                return false;
+
+            if (! dictionary.empty())
+                stringDictionary.setRawData (dictionary.data(), dictionary.size());
+
+            objectCode = object.createVector();
+            return true;
+        }
+
         //==============================================================================
         void initialiseEndpointHandlers (LLVMCodeGenerator& codeGen, const std::vector<EndpointInfo>& endpointArray)
         {
@@ -378,13 +987,19 @@ struct LLVMEngine
                         inputValues.push_back ({ handle,
                                                  codeGen.getPaddedTypeSize (endpoint.endpoint.getSingleDataType()),
                                                  nativeTypeLayouts.get (endpoint.endpoint.getSingleDataType()),
-                                                 AST::getSetValueFunctionName (endpoint.endpoint),
-                                                 nullptr });
+                                                 std::addressof (addLazyFunction (AST::getSetValueFunctionName (endpoint.endpoint))) });
                     }
                     else if (endpoint.details.isEvent())
                     {
+                        inputEvents.push_back ({ handle, {} });
+
                         for (auto& dataType : endpoint.endpoint.getDataTypes())
+                        {
                             nativeTypeLayouts.get (dataType);
+
+                            if (auto handlerFunction = AST::findEventHandlerFunction (endpoint.endpoint, dataType))
+                                inputEvents.back().handlers.push_back (std::addressof (addLazyFunction (AST::getEventHandlerFunctionName (*handlerFunction))));
+                        }
                     }
                 }
                 else
@@ -449,23 +1064,109 @@ struct LLVMEngine
             f = reinterpret_cast<Fn> (lljit.findSymbol (name));
             CMAJ_ASSERT (f != nullptr);
         }
-    };
-
 
-    //==============================================================================
-    struct JITInstance
-    {
-        JITInstance (std::shared_ptr<LinkedCode> cc, int32_t s, double f) : code (std::move (cc)), sessionID (s), frequency (f)
+        void loadAdvanceFunction (LLJITHolder& jit, bool isSingleFrameOnly)
         {
-            stateMemory.resize (code->stateSize);
-            statePointer = static_cast<uint8_t*> (stateMemory.data());
+            if (isSingleFrameOnly)
+            {
+                auto f = reinterpret_cast<AdvanceOneFrameFn> (jit.findSymbol (LLVMCodeGenerator::getAdvanceOneFrameFunctionName()));
+                CMAJ_ASSERT (f != nullptr);
+                advanceOneFrameFn.store (f, std::memory_order_release);
+            }
+            else
+            {
+                auto f = reinterpret_cast<AdvanceBlockFn> (jit.findSymbol (LLVMCodeGenerator::getAdvanceBlockFunctionName()));
+                CMAJ_ASSERT (f != nullptr);
+                advanceBlockFn.store (f, std::memory_order_release);
+            }
+        }
+
+        //==============================================================================
+        // A tiered build is only worthwhile when there's some optimisation to defer, and
+        // when the optimised code isn't already waiting in the cache
+        static bool shouldBuildInTiers (const BuildSettings& settings, CacheDatabaseInterface* cache, const char* cacheKey)
+        {
+            if (! settings.shouldUseTieredCompilation())
+                return false;
+
+            if (LLVMCodeGenerator::getOptimisationLevelWithDefault (settings.getOptimisationLevel()) < 2)
+                return false;
+
+            return cache == nullptr || cache->reload (cacheKey, nullptr, 0) == 0;
+        }
+
+        // Re-optimises the quick tier's module on a separate LLVM context and JIT, and then
+        // publishes its advance function. The IR is the same apart from the optimisation passes,
+        // so the state and IO layouts match, and performers can switch over between blocks.
+        // The optimised bitcode also goes into the cache, so that the next link can use it directly.
+        // Setting cancelOptimisedBuild makes it give up at the next pass or step, leaving the
+        // quick tier in use.
+        void startOptimisedBuild (std::vector<char> bitcode, BuildSettings settings,
+                                  std::unordered_map<std::string, void*> externalFunctionPointers,
+                                  bool isSingleFrameOnly, CacheDatabaseInterface* cache, const char* cacheKey)
+        {
+            optimiserThread = std::thread ([this, bitcode = std::move (bitcode), settings = std::move (settings),
+                                            externalFunctionPointers = std::move (externalFunctionPointers),
+                                            isSingleFrameOnly, cache = CacheDatabaseInterface::Ptr (cache),
+                                            cacheKey = std::string (cacheKey != nullptr ? cacheKey : ""),
+                                            dictionary = stringDictionary]
+            {
+                try
+                {
+                    if (cancelOptimisedBuild)
+                        return;
+
+                    auto jit = std::make_unique<LLJITHolder> (settings, false);
+                    auto context = std::make_unique<::llvm::LLVMContext>();
+                    auto buffer = ::llvm::MemoryBuffer::getMemBuffer ({ bitcode.data(), bitcode.size() }, {}, false);
+                    auto module = ::llvm::parseBitcodeFile (buffer->getMemBufferRef(), *context);
+
+                    if (! module)
+                    {
+                        ::llvm::consumeError (module.takeError());
+                        return;
+                    }
+
+                    LLVMCodeGenerator::applyOptimisationPasses (**module, settings.getOptimisationLevel(),
+                                                                jit->getTargetMachine(), std::addressof (cancelOptimisedBuild));
+
+                    // If cancelled, the passes will have stopped early, and the module mustn't be cached
+                    if (cancelOptimisedBuild)
+                        return;
+
+                    if (cache != nullptr && ! cacheKey.empty())
+                        LLVMCodeGenerator::saveBitcodeToCache (*cache, cacheKey.c_str(), **module, dictionary);
+
+                    jit->addExternalFunctionSymbols (externalFunctionPointers);
+                    jit->load ({ std::move (*module), std::move (context) });
+
+                    if (cancelOptimisedBuild)
+                        return;
+
+                    optimisedJIT = std::move (jit);
+                    loadAdvanceFunction (*optimisedJIT, isSingleFrameOnly);
+                    quickTierActive.store (false, std::memory_order_release);
+                }
+                catch (...)
+                {
+                    // If anything goes wrong, performers just carry on running the quick tier
+                }
+            });
+        }
+    };
+
+
+    //==============================================================================
+    struct JITInstance
+    {
+        JITInstance (std::shared_ptr<LinkedCode> cc, int32_t s, double f) : code (std::move (cc)), sessionID (s), frequency (f)
+        {
+            stateMemory.resize (code->stateSize);
+            statePointer = static_cast<uint8_t*> (stateMemory.data());
 
             ioMemory.resize (code->ioSize);
             ioPointer = static_cast<uint8_t*> (ioMemory.data());
 
-            advanceOneFrameFn = code->advanceOneFrameFn;
-            advanceBlockFn = code->advanceBlockFn;
-
             reset();
         }
 
@@ -473,20 +1174,125 @@ struct LLVMEngine
         std::shared_ptr<LinkedCode> code;
         choc::AlignedMemoryBlock<LinkedCode::alignmentBytes> stateMemory, ioMemory;
 
-        AdvanceOneFrameFn advanceOneFrameFn = {};
-        AdvanceBlockFn    advanceBlockFn = {};
-
         uint8_t* statePointer = nullptr;
         uint8_t* ioPointer = nullptr;
         const int sessionID;
         const double frequency;
 
+        PerformerThunkContexts thunkContexts;
+
+        //==============================================================================
+        /// Holds the calls that are made to a lazily-compiled handler before it's ready, so
+        /// that they can be replayed in order once it has been compiled. The space for them
+        /// is allocated when the handler is bound, so queueing a call never allocates. Only
+        /// calls which arrive when the queue is already full are lost, and those are counted
+        /// as xruns.
+        struct DeferredCalls
+        {
+            using InvokeFn = void(*)(void* function, void* state, const void* data, uint32_t numFrames);
+
+            DeferredCalls (LinkedCode::LazyFunction& f, void* s, InvokeFn i, size_t size, uint32_t maxCalls, JITInstance& o)
+                : function (f), state (s), invoke (i), dataSize (size),
+                  entrySize ((size + sizeof (uint32_t) + 15u) & ~size_t (15)),
+                  capacity (maxCalls), storage (entrySize * maxCalls), owner (o)
+            {}
+
+            void call (const void* data, uint32_t numFrames)
+            {
+                if (auto f = function.getAddressIfCompiled())
+                {
+                    if (numQueued != 0)
+                        replay (f);
+
+                    invoke (f, state, data, numFrames);
+                    return;
+                }
+
+                if (numQueued == capacity)
+                {
+                    ++owner.numDroppedCalls;
+                    return;
+                }
+
+                auto entry = static_cast<uint8_t*> (storage.data()) + entrySize * numQueued++;
+
+                if (dataSize != 0)
+                    memcpy (entry, data, dataSize);
+
+                memcpy (entry + entrySize - sizeof (uint32_t), std::addressof (numFrames), sizeof (uint32_t));
+                owner.hasDeferredCalls = true;
+            }
+
+            /// Returns true if there's nothing left in the queue
+            bool replayIfCompiled()
+            {
+                if (numQueued != 0)
+                    if (auto f = function.getAddressIfCompiled())
+                        replay (f);
+
+                return numQueued == 0;
+            }
+
+            void replay (void* f)
+            {
+                auto entry = static_cast<const uint8_t*> (storage.data());
+
+                for (uint32_t i = 0; i < numQueued; ++i)
+                {
+                    uint32_t numFrames;
+                    memcpy (std::addressof (numFrames), entry + entrySize - sizeof (uint32_t), sizeof (uint32_t));
+                    invoke (f, state, entry, numFrames);
+                    entry += entrySize;
+                }
+
+                numQueued = 0;
+            }
+
+            LinkedCode::LazyFunction& function;
+            void* state;
+            InvokeFn invoke;
+            size_t dataSize, entrySize;
+            uint32_t capacity, numQueued = 0;
+            choc::AlignedMemoryBlock<16> storage;
+            JITInstance& owner;
+        };
+
+        std::vector<std::unique_ptr<DeferredCalls>> deferredCalls;
+        bool hasDeferredCalls = false;
+
+        // Calls to lazily-compiled handlers which couldn't be held until they were ready
+        uint32_t numDroppedCalls = 0;
+
+        DeferredCalls& createDeferredCalls (LinkedCode::LazyFunction& f, void* state, DeferredCalls::InvokeFn invoke, size_t dataSize)
+        {
+            deferredCalls.push_back (std::make_unique<DeferredCalls> (f, state, invoke, dataSize, code->maxDeferredCallsPerHandler, *this));
+            return *deferredCalls.back();
+        }
+
+        // Calls that were held back are delivered before any more frames are rendered, as
+        // soon as their handlers have been compiled
+        void replayDeferredCalls() noexcept
+        {
+            bool anyRemaining = false;
+
+            for (auto& d : deferredCalls)
+                if (! d->replayIfCompiled())
+                    anyRemaining = true;
+
+            hasDeferredCalls = anyRemaining;
+        }
+
         //==============================================================================
         Result reset() noexcept
         {
             stateMemory.clear();
             ioMemory.clear();
 
+            for (auto& d : deferredCalls)
+                d->numQueued = 0;
+
+            hasDeferredCalls = false;
+
             int processorID = 0;
             code->initialiseFn (statePointer, &processorID, sessionID, frequency);
 
@@ -495,66 +1301,64 @@ struct LLVMEngine
 
         void advance (uint32_t framesToAdvance) noexcept
         {
-            if (advanceOneFrameFn)
+            if (hasDeferredCalls)
+                replayDeferredCalls();
+
+            if (auto advanceOneFrameFn = code->advanceOneFrameFn.load (std::memory_order_acquire))
                 advanceOneFrameFn (statePointer, ioPointer);
             else
-                advanceBlockFn (statePointer, ioPointer, framesToAdvance);
+                code->advanceBlockFn.load (std::memory_order_acquire) (statePointer, ioPointer, framesToAdvance);
         }
 
-        std::function<Result(void*, uint32_t)> createCopyOutputValueFunction (const EndpointInfo& e)
+        OutputStreamAccessor createOutputStreamAccessor (const EndpointInfo& e)
         {
-            if (e.details.isStream())
+            auto& info = code->getEndpointInfo (code->outputStreams, e.handle);
+            auto* source = ioPointer + info.addressOffset;
+            auto destStride = info.frameSize;
+            auto sourceStride = info.frameStride;
+
+            if (destStride == sourceStride)
+                return { source, static_cast<uint32_t> (destStride), {} };
+
+            auto* frameLayout = info.frameLayout.get();
+
+            return { nullptr, 0, thunkContexts.create<void(void*, uint32_t)> ([source, destStride, sourceStride, frameLayout] (void* destBuffer, uint32_t numFrames)
             {
-                auto& info = code->getEndpointInfo (code->outputStreams, e.handle);
-                auto* source = ioPointer + info.addressOffset;
-                auto destStride = info.frameSize;
-                auto sourceStride = info.frameStride;
+                auto dest = static_cast<uint8_t*> (destBuffer);
+                auto src = source;
 
-                if (destStride == sourceStride)
+                for (uint32_t i = 0; i < numFrames; ++i)
                 {
-                    return [source, destStride] (void* destBuffer, uint32_t numFrames) -> Result
-                    {
-                        memcpy (destBuffer, source, destStride * numFrames);
-                        memset (source, 0, destStride * numFrames);
-                        return Result::Ok;
-                    };
+                    frameLayout->copyNativeToPacked (dest, src);
+                    dest += destStride;
+                    src += sourceStride;
                 }
-                else
-                {
-                    auto* frameLayout = info.frameLayout.get();
 
-                    return [source, destStride, sourceStride, frameLayout] (void* destBuffer, uint32_t numFrames) -> Result
-                    {
-                        auto dest = static_cast<uint8_t*> (destBuffer);
-                        auto src = source;
+                memset (source, 0, sourceStride * numFrames);
+            }) };
+        }
 
-                        for (uint32_t i = 0; i < numFrames; ++i)
-                        {
-                            frameLayout->copyNativeToPacked (dest, src);
-                            dest += destStride;
-                            src += sourceStride;
-                        }
+        PerformerThunk<void(void*)> createCopyOutputValueFunction (const EndpointInfo& e)
+        {
+            auto& info = code->getEndpointInfo (code->outputValues, e.handle);
+            auto* source = statePointer + info.addressOffset;
+            auto layout = info.layout.get();
 
-                        memset (source, 0, sourceStride * numFrames);
-                        return Result::Ok;
-                    };
-                }
-            }
-            else
+            if (! layout->requiresPacking())
             {
-                auto& info = code->getEndpointInfo (code->outputValues, e.handle);
-                auto* source = statePointer + info.addressOffset;
-                auto layout = info.layout.get();
-
-                return [layout, source] (void* destBuffer, uint32_t) -> Result
+                return thunkContexts.create<void(void*)> ([source, size = layout->getNativeSize()] (void* destBuffer)
                 {
-                    layout->copyNativeToPacked (destBuffer, source);
-                    return Result::Ok;
-                };
+                    memcpy (destBuffer, source, size);
+                });
             }
+
+            return thunkContexts.create<void(void*)> ([layout, source] (void* destBuffer)
+            {
+                layout->copyNativeToPacked (destBuffer, source);
+            });
         }
 
-        std::function<void(const void*, uint32_t, uint32_t)> createSetInputStreamFramesFunction (const EndpointInfo& e)
+        InputStreamAccessor createInputStreamAccessor (const EndpointInfo& e)
         {
             auto& info = code->getEndpointInfo (code->inputStreams, e.handle);
             auto* dest = ioPointer + info.addressOffset;
@@ -562,143 +1366,285 @@ struct LLVMEngine
             auto sourceStride = info.frameSize;
 
             if (destStride == sourceStride)
-            {
-                return [dest, destStride] (const void* sourceData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
-                {
-                    auto source = static_cast<const uint8_t*> (sourceData);
-                    auto size = destStride * numFrames;
-                    memcpy (dest, source, size);
+                return { dest, static_cast<uint32_t> (destStride), {} };
 
-                    if (numTrailingFramesToClear != 0)
-                        memset (dest + size, 0, numTrailingFramesToClear * destStride);
-                };
-            }
-            else
+            auto* frameLayout = info.frameLayout.get();
+
+            return { nullptr, 0, thunkContexts.create<void(const void*, uint32_t, uint32_t)> ([dest, destStride, sourceStride, frameLayout]
+                                                                                              (const void* sourceData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
             {
-                auto* frameLayout = info.frameLayout.get();
+                auto source = static_cast<const uint8_t*> (sourceData);
+                auto d = dest;
 
-                return [dest, destStride, sourceStride, frameLayout] (const void* sourceData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
+                for (uint32_t i = 0; i < numFrames; ++i)
                 {
-                    auto source = static_cast<const uint8_t*> (sourceData);
-                    auto d = dest;
+                    frameLayout->copyPackedToNative (d, source);
+                    d += destStride;
+                    source += sourceStride;
+                }
 
-                    for (uint32_t i = 0; i < numFrames; ++i)
-                    {
-                        frameLayout->copyPackedToNative (d, source);
-                        d += destStride;
-                        source += sourceStride;
-                    }
+                if (numTrailingFramesToClear != 0)
+                    memset (d, 0, numTrailingFramesToClear * destStride);
+            }) };
+        }
+
+        PerformerThunk<void(const void*, uint32_t)> createSetInputValueFunction (const EndpointInfo& e)
+        {
+            auto& info = code->getEndpointInfo (code->inputValues, e.handle);
 
-                    if (numTrailingFramesToClear != 0)
-                        memset (d, 0, numTrailingFramesToClear * destStride);
-                };
+            if (code->compileHandlersLazily)
+            {
+                auto& deferred = createDeferredCalls (*info.setValue, statePointer,
+                                                      [] (void* f, void* state, const void* valueData, uint32_t numFramesToReachValue)
+                                                      {
+                                                          reinterpret_cast<SetValueRampFn> (f) (state, valueData, numFramesToReachValue);
+                                                      },
+                                                      info.layout->getNativeSize());
+
+                return createSetInputValueFunction (info, [deferred = std::addressof (deferred)]
+                                                          (void*, const void* valueData, uint32_t numFramesToReachValue)
+                {
+                    deferred->call (valueData, numFramesToReachValue);
+                });
             }
+
+            // Everything was compiled while linking, so the function can be called directly
+            return createSetInputValueFunction (info, reinterpret_cast<SetValueRampFn> (code->getAddress (*info.setValue)));
         }
 
-        auto createSetInputValueFunction (const EndpointInfo& e)
+        template <typename SetValueFn>
+        PerformerThunk<void(const void*, uint32_t)> createSetInputValueFunction (const LinkedCode::InputValueEndpoint& info, SetValueFn setValue)
         {
-            auto& info = code->getEndpointInfo (code->inputValues, e.handle);
             auto* layout = info.layout.get();
-            auto setValueFn = info.setValue;
             auto state = statePointer;
             choc::AlignedMemoryBlock<16> tempBuffer (info.dataSize);
 
-            return [setValueFn, state, layout, tempBuffer] (const void* valueData, uint32_t numFramesToReachValue) mutable
+            if (! layout->requiresPacking())
+            {
+                return thunkContexts.create<void(const void*, uint32_t)> ([setValue, state, tempBuffer, size = layout->getNativeSize()]
+                                                                          (const void* valueData, uint32_t numFramesToReachValue) mutable
+                {
+                    // the data can be passed straight through unless it's not suitably aligned
+                    if ((reinterpret_cast<uintptr_t> (valueData) & 15u) != 0)
+                        valueData = memcpy (tempBuffer.data(), valueData, size);
+
+                    setValue (state, valueData, numFramesToReachValue);
+                });
+            }
+
+            return thunkContexts.create<void(const void*, uint32_t)> ([setValue, state, layout, tempBuffer] (const void* valueData, uint32_t numFramesToReachValue) mutable
             {
                 auto* buffer = tempBuffer.data();
                 layout->copyPackedToNative (buffer, valueData);
-                setValueFn (state, buffer, numFramesToReachValue);
-            };
+                setValue (state, buffer, numFramesToReachValue);
+            });
         }
 
-        std::function<void(const void*)> createSendEventFunction (const EndpointInfo&, const AST::TypeBase& type, const AST::Function& f)
+        PerformerThunk<void(const void*)> createSendEventFunction (const EndpointInfo&, const AST::TypeBase& type, const AST::Function& f)
         {
-            auto eventType = type.toChocType();
-            auto name = AST::getEventHandlerFunctionName (f);
+            auto& call = code->getLazyFunction (AST::getEventHandlerFunctionName (f));
             auto state = statePointer;
 
-            void* call = code->lljit.findSymbol (name);
-            CMAJ_ASSERT (call != nullptr);
-
-            if (type.isVoid())              return [call, state] (const void*)      { using F = void(*)(void*);           reinterpret_cast<F> (call) (state); };
-            if (type.isPrimitiveInt32())    return [call, state] (const void* data) { using F = void(*)(void*, int32_t);  reinterpret_cast<F> (call) (state, *static_cast<const int32_t*>  (data)); };
-            if (type.isPrimitiveInt64())    return [call, state] (const void* data) { using F = void(*)(void*, int64_t);  reinterpret_cast<F> (call) (state, *static_cast<const int64_t*>  (data)); };
-            if (type.isPrimitiveFloat32())  return [call, state] (const void* data) { using F = void(*)(void*, float);    reinterpret_cast<F> (call) (state, *static_cast<const float*>    (data)); };
-            if (type.isPrimitiveFloat64())  return [call, state] (const void* data) { using F = void(*)(void*, double);   reinterpret_cast<F> (call) (state, *static_cast<const double*>   (data)); };
-            if (type.isPrimitiveBool())     return [call, state] (const void* data) { using F = void(*)(void*, int32_t);  reinterpret_cast<F> (call) (state, *static_cast<const int32_t*>  (data)); };
-            if (type.isPrimitiveString())   return [call, state] (const void* data) { using F = void(*)(void*, uint32_t); reinterpret_cast<F> (call) (state, *static_cast<const uint32_t*> (data)); };
+            if (type.isVoid())              return createSendPrimitiveEventFunction<void>     (call, state);
+            if (type.isPrimitiveInt32())    return createSendPrimitiveEventFunction<int32_t>  (call, state);
+            if (type.isPrimitiveInt64())    return createSendPrimitiveEventFunction<int64_t>  (call, state);
+            if (type.isPrimitiveFloat32())  return createSendPrimitiveEventFunction<float>    (call, state);
+            if (type.isPrimitiveFloat64())  return createSendPrimitiveEventFunction<double>   (call, state);
+            if (type.isPrimitiveBool())     return createSendPrimitiveEventFunction<int32_t>  (call, state);
+            if (type.isPrimitiveString())   return createSendPrimitiveEventFunction<uint32_t> (call, state);
 
             auto& layout = *code->nativeTypeLayouts.find (type);
 
             if (layout.requiresPacking())
             {
+                using F = void(*)(void*, const void*);
                 choc::AlignedMemoryBlock<16> scratch (layout.getNativeSize());
 
-                return [call, state, scratch, &layout] (const void* data) mutable
+                if (code->compileHandlersLazily)
+                {
+                    auto& deferred = createDeferredCalls (call, state,
+                                                          [] (void* function, void* s, const void* data, uint32_t)
+                                                          {
+                                                              reinterpret_cast<F> (function) (s, data);
+                                                          },
+                                                          layout.getNativeSize());
+
+                    return thunkContexts.create<void(const void*)> ([deferred = std::addressof (deferred), scratch, &layout] (const void* data) mutable
+                    {
+                        layout.copyPackedToNative (scratch.data(), data);
+                        deferred->call (scratch.data(), 0);
+                    });
+                }
+
+                return thunkContexts.create<void(const void*)> ([function = reinterpret_cast<F> (code->getAddress (call)), state, scratch, &layout] (const void* data) mutable
                 {
                     layout.copyPackedToNative (scratch.data(), data);
-                    using F = void(*)(void*, const void*);
-                    reinterpret_cast<F> (call) (state, scratch.data());
-                };
+                    function (state, scratch.data());
+                });
             }
 
-            return [call, state] (const void* data)
-            {
-                using F = void(*)(void*, const void*);
-                reinterpret_cast<F> (call) (state, data);
-            };
+            return createSendPrimitiveEventFunction<const void*> (call, state, layout.getNativeSize());
         }
 
-        auto createGetNumOutputEventsFunction (const EndpointInfo& e)
+        /// Primitive (and packing-free) event types are passed straight to the handler
+        /// function, so the context is just the function and state pointers.
+        struct SendEventContext
         {
-            auto& info = code->getEndpointInfo (code->outputEvents, e.handle);
-            auto* count = reinterpret_cast<uint32_t*> (statePointer + info.eventCountAddressOffset);
-            return [count] { return *count; };
+            void* function;
+            void* state;
+        };
+
+        /// When handlers are compiled lazily, calls go via a queue which holds them until
+        /// the function has been compiled.
+        struct SendEventLazilyContext
+        {
+            DeferredCalls* deferred;
+        };
+
+        template <typename ArgType>
+        PerformerThunk<void(const void*)> createSendPrimitiveEventFunction (LinkedCode::LazyFunction& function, void* state, size_t dataSize = getArgSize<ArgType>())
+        {
+            using Thunk = PerformerThunk<void(const void*)>;
+
+            if (code->compileHandlersLazily)
+                return Thunk::bind<sendPrimitiveEventIfCompiled> (thunkContexts.add (SendEventLazilyContext { std::addressof (createDeferredCalls (function, state,
+                                                                                                                                                   invokeEventHandler<ArgType>,
+                                                                                                                                                   dataSize)) }));
+
+            return Thunk::bind<sendPrimitiveEvent<ArgType>> (thunkContexts.add (SendEventContext { code->getAddress (function), state }));
         }
 
-        auto createResetEventCountFunction (const EndpointInfo& e)
+        template <typename ArgType>
+        static constexpr size_t getArgSize()
         {
-            auto& info = code->getEndpointInfo (code->outputEvents, e.handle);
-            auto* count = reinterpret_cast<uint32_t*> (statePointer + info.eventCountAddressOffset);
-            return [count] { *count = 0; };
+            if constexpr (std::is_void_v<ArgType> || std::is_pointer_v<ArgType>)
+                return 0;
+            else
+                return sizeof (ArgType);
         }
 
-        auto createGetEventTypeIndexFunction (const EndpointInfo& e)
+        template <typename ArgType>
+        static void sendPrimitiveEvent (SendEventContext& context, const void* data)
         {
-            auto& info = code->getEndpointInfo (code->outputEvents, e.handle);
-            auto* firstTypeEntry = statePointer + info.eventListStartAddressOffset + info.typeFieldOffset;
-            auto stride = info.eventListElementStride;
+            callEventHandler<ArgType> (context.function, context.state, data);
+        }
 
-            return [firstTypeEntry, stride] (uint32_t index)
+        static void sendPrimitiveEventIfCompiled (SendEventLazilyContext& context, const void* data)
+        {
+            context.deferred->call (data, 0);
+        }
+
+        template <typename ArgType>
+        static void invokeEventHandler (void* function, void* state, const void* data, uint32_t)
+        {
+            callEventHandler<ArgType> (function, state, data);
+        }
+
+        template <typename ArgType>
+        static void callEventHandler (void* function, void* state, const void* data)
+        {
+            if constexpr (std::is_void_v<ArgType>)
             {
-                return *reinterpret_cast<uint32_t*> (firstTypeEntry + (index * stride));
-            };
+                (void) data;
+                reinterpret_cast<void(*)(void*)> (function) (state);
+            }
+            else if constexpr (std::is_pointer_v<ArgType>)
+            {
+                reinterpret_cast<void(*)(void*, ArgType)> (function) (state, data);
+            }
+            else
+            {
+                reinterpret_cast<void(*)(void*, ArgType)> (function) (state, *static_cast<const ArgType*> (data));
+            }
         }
 
-        auto createReadOutputEventFunction (const EndpointInfo& e)
+        //==============================================================================
+        struct ReadOutputEventsContext
+        {
+            struct EventType
+            {
+                uint32_t offset, size;
+                const NativeTypeLayout* layoutIfPacked;
+            };
+
+            uint32_t* eventCount;
+            const uint8_t* firstListEntry;
+            size_t stride, typeFieldOffset;
+            std::vector<EventType> eventTypes;
+        };
+
+        ReadOutputEventsThunk createReadOutputEventsFunction (const EndpointInfo& e)
         {
             auto& info = code->getEndpointInfo (code->outputEvents, e.handle);
-            auto* firstListEntry = statePointer + info.eventListStartAddressOffset;
-            auto typeFieldOffset = info.typeFieldOffset;
-            auto stride = info.eventListElementStride;
-            choc::span<LinkedCode::OutputEventEndpoint::EventTypeHandler> eventTypeHandlers (info.eventTypeHandlers);
 
-            return [firstListEntry, stride, typeFieldOffset, eventTypeHandlers] (uint32_t index, void* dataBuffer)
+            ReadOutputEventsContext context { reinterpret_cast<uint32_t*> (statePointer + info.eventCountAddressOffset),
+                                              statePointer + info.eventListStartAddressOffset,
+                                              info.eventListElementStride,
+                                              info.typeFieldOffset,
+                                              {} };
+
+            for (auto& handler : info.eventTypeHandlers)
+                context.eventTypes.push_back ({ handler.offset,
+                                                handler.layout->getNativeSize(),
+                                                handler.layout->requiresPacking() ? handler.layout.get() : nullptr });
+
+            return ReadOutputEventsThunk::bind<readOutputEvents> (thunkContexts.add (std::move (context)));
+        }
+
+        static uint32_t readOutputEvents (ReadOutputEventsContext& context, OutputEventQueue& queue, uint32_t frameOffset)
+        {
+            auto numAvailable = *context.eventCount;
+
+            if (numAvailable == 0)
+                return 0;
+
+            auto numToRead = std::min (numAvailable, queue.getNumFreeSlots());
+            auto eventEntry = context.firstListEntry;
+
+            for (uint32_t i = 0; i < numToRead; ++i)
             {
-                auto eventEntry = firstListEntry + index * stride;
+                auto& event = queue.getEvent (queue.numEvents + i);
+                event.frame = *reinterpret_cast<const uint32_t*> (eventEntry) + frameOffset;
+                event.type  = *reinterpret_cast<const uint32_t*> (eventEntry + context.typeFieldOffset);
+
+                CMAJ_ASSERT (event.type < context.eventTypes.size());
+                auto& eventType = context.eventTypes[event.type];
 
-                auto frame = *reinterpret_cast<uint32_t*> (eventEntry);
-                auto type = *reinterpret_cast<uint32_t*> (eventEntry + typeFieldOffset);
+                if (eventType.layoutIfPacked != nullptr)
+                    eventType.layoutIfPacked->copyNativeToPacked (event.data, eventEntry + eventType.offset);
+                else
+                    memcpy (event.data, eventEntry + eventType.offset, eventType.size);
 
-                CMAJ_ASSERT (type < eventTypeHandlers.size());
-                auto& handler = eventTypeHandlers[type];
-                handler.layout->copyNativeToPacked (dataBuffer, eventEntry + handler.offset);
+                eventEntry += context.stride;
+            }
 
-                return frame;
-            };
+            queue.numEvents += numToRead;
+            *context.eventCount = 0;
+            return numAvailable - numToRead;
         }
 
         choc::value::StringDictionary& getDictionary()  { return code->stringDictionary; }
+
+        void prefetchEndpoint (EndpointHandle handle)   { code->prefetch (handle); }
+        bool isRunningQuickTier() const                 { return code->quickTierActive.load (std::memory_order_acquire); }
+        uint32_t getNumDroppedCalls() const             { return numDroppedCalls; }
+
+        choc::value::Value getNodeProfile()
+        {
+            if (code->profiledNodeNames.empty())
+                return {};
+
+            auto counters = reinterpret_cast<const int64_t*> (statePointer + code->profileCountersOffset);
+            auto result = choc::value::createEmptyArray();
+
+            for (size_t i = 0; i < code->profiledNodeNames.size(); ++i)
+                result.addArrayElement (choc::value::createObject ("NodeProfile",
+                                                                   "node",   code->profiledNodeNames[i],
+                                                                   "cycles", counters[i * 2],
+                                                                   "calls",  counters[i * 2 + 1]));
+
+            return result;
+        }
     };
 
     PerformerInterface* createPerformer (std::shared_ptr<LinkedCode> code)
@@ -728,40 +1674,172 @@ struct Factory : public choc::com::ObjectWithAtomicRefCount<EngineFactoryInterfa
 
 EngineFactoryPtr createEngineFactory()   { return choc::com::create<Factory>(); }
 
+//==============================================================================
+static std::unique_ptr<::llvm::TargetMachine> createTargetMachine (const BuildSettings& settings, bool isPositionIndependent)
+{
+    if (auto machineBuilder = LLVMCodeGenerator::createTargetMachineBuilder (settings))
+    {
+        if (isPositionIndependent)
+            machineBuilder->setRelocationModel (::llvm::Reloc::PIC_);
+
+        if (auto tm = machineBuilder->createTargetMachine())
+            return std::move (*tm);
+        else
+            ::llvm::consumeError (tm.takeError());
+    }
+
+    return {};
+}
+
+/// Returns the CPUs in the "multiversion" option, which is a comma-separated list.
+static std::vector<std::string> getMultiversionCPUs (const choc::value::Value& options)
+{
+    std::vector<std::string> cpus;
+
+    if (options.isObject() && options.hasObjectMember ("multiversion"))
+        for (auto& cpu : choc::text::splitString (options["multiversion"].toString(), ',', false))
+            if (auto name = choc::text::trim (cpu); ! name.empty())
+                cpus.push_back (name);
+
+    return cpus;
+}
+
+/// When advanceBlock is multiversioned, the rest of the code must be able to run on any
+/// CPU of the architecture, so the host CPU is replaced by the baseline one.
+static BuildSettings getMultiversionBaseSettings (const BuildSettings& buildSettings)
+{
+    auto baseSettings = BuildSettings (buildSettings);
+
+    if (auto cpu = baseSettings.getTargetCPU(); cpu.empty() || cpu == BuildSettings::hostTargetCPU)
+        baseSettings.setTargetCPU (BuildSettings::baselineTargetCPU);
+
+    return baseSettings;
+}
+
+/// Adds a version of advanceBlock for each of the given CPUs to a generator whose code has
+/// been built for the baseline CPU, plus the dispatcher that picks between them at runtime.
+/// Returns an error message if something fails.
+static std::string addAdvanceBlockVariants (LLVMCodeGenerator& generator,
+                                            const AST::Program& program,
+                                            const cmaj::BuildSettings& baseSettings,
+                                            const choc::value::Value& options,
+                                            const std::vector<std::string>& variantCPUs,
+                                            const ::llvm::TargetMachine& baseTargetMachine,
+                                            choc::value::SimpleStringDictionary& stringDictionary)
+{
+    auto targetTriple = baseTargetMachine.getTargetTriple();
+
+    if (! targetTriple.isX86())
+        return "Multiversioned code can only be generated for x86 targets";
+
+    auto dataLayout = baseTargetMachine.createDataLayout();
+    std::vector<LLVMCodeGenerator::AdvanceBlockVariant> variants;
+
+    for (auto& cpu : variantCPUs)
+    {
+        auto variantSettings = BuildSettings (baseSettings).setTargetCPU (cpu);
+        auto variantTargetMachine = createTargetMachine (variantSettings, false);
+
+        if (! variantTargetMachine)
+            return "Failed to create target machine for " + cpu;
+
+        LLVMCodeGenerator variantGenerator (program, options, variantSettings, targetTriple.str(), dataLayout, stringDictionary, false);
+        variantGenerator.tuningTargetMachine = variantTargetMachine.get();
+
+        if (! variantGenerator.generate())
+            return "Failed to generate the advanceBlock variant for " + cpu;
+
+        auto functionName = LLVMCodeGenerator::getAdvanceBlockFunctionName() + "_" + LLVMCodeGenerator::makeSafeIdentifier (cpu);
+
+        if (! generator.importAdvanceBlockVariant (variantGenerator, functionName))
+            return "Failed to add the advanceBlock variant for " + cpu;
+
+        variants.push_back ({ functionName, LLVMCodeGenerator::getRequiredX86CPUFeatures (*variantTargetMachine) });
+    }
+
+    generator.addAdvanceBlockDispatcher (variants);
+    return {};
+}
+
+/// Builds code for the host's architecture in which advanceBlock has a version for each
+/// of the given CPUs, plus a baseline version, and picks between them at runtime.
+static std::string generateMultiversionedAssembler (const AST::Program& program,
+                                                    const cmaj::BuildSettings& buildSettings,
+                                                    const choc::value::Value& options,
+                                                    const std::vector<std::string>& variantCPUs,
+                                                    bool generateObjectCode)
+{
+    auto baseSettings = getMultiversionBaseSettings (buildSettings);
+    auto baseTargetMachine = createTargetMachine (baseSettings, false);
+
+    if (! baseTargetMachine)
+        return "Failed to create target machine";
+
+    // All the variants are generated from the same program, so sharing a dictionary
+    // will give their strings the same handles
+    choc::value::SimpleStringDictionary stringDictionary;
+
+    LLVMCodeGenerator generator (program, options, baseSettings, baseTargetMachine->getTargetTriple().str(),
+                                 baseTargetMachine->createDataLayout(), stringDictionary, false);
+    generator.tuningTargetMachine = baseTargetMachine.get();
+
+    if (! generator.generate())
+        return {};
+
+    if (auto error = addAdvanceBlockVariants (generator, program, baseSettings, options, variantCPUs,
+                                              *baseTargetMachine, stringDictionary); ! error.empty())
+        return error;
+
+    return generator.printAssembly (*baseTargetMachine, generateObjectCode);
+}
+
 //==============================================================================
 std::string generateAssembler (const cmaj::ProgramInterface& p,
                                const cmaj::BuildSettings& buildSettings,
                                const choc::value::Value& options)
 {
-    std::unique_ptr<::llvm::TargetMachine> targetMachine;
+    std::string targetFormat;
 
-    if (! options.hasObjectMember ("targetTriple"))
+    if (options.hasObjectMember ("targetFormat"))
+        targetFormat = options["targetFormat"].toString();
+
+    if (options.hasObjectMember ("multiversion"))
     {
-        if (auto machineBuilder = ::llvm::orc::JITTargetMachineBuilder::detectHost())
-        {
-            auto& opts = machineBuilder->getOptions();
-            opts.ExceptionModel = ::llvm::ExceptionHandling::None;
-            opts.setFPDenormalMode (::llvm::DenormalMode::getPositiveZero());
+        if (options.hasObjectMember ("targetTriple"))
+            return "Multiversioned code can only be generated for the host's architecture";
+
+        return generateMultiversionedAssembler (AST::getProgram (p), buildSettings, options,
+                                                getMultiversionCPUs (options), targetFormat == "obj");
+    }
 
-            machineBuilder->setCodeGenOptLevel (LLVMCodeGenerator::getCodeGenOptLevel (buildSettings.getOptimisationLevel()));
+    std::unique_ptr<::llvm::TargetMachine> targetMachine;
 
+    if (! options.hasObjectMember ("targetTriple"))
+    {
+        if (auto machineBuilder = LLVMCodeGenerator::createTargetMachineBuilder (buildSettings))
             if (auto t = machineBuilder->createTargetMachine())
                 targetMachine = std::move (*t);
-        }
     }
     else
     {
+        // When cross-compiling, only a named CPU makes sense
+        auto cpu = buildSettings.getTargetCPU();
+
+        if (cpu == BuildSettings::hostTargetCPU || cpu == BuildSettings::baselineTargetCPU)
+            cpu = {};
+
         ::llvm::SmallVector<std::string, 16> attributes {};
-        targetMachine.reset (::llvm::EngineBuilder().selectTarget (::llvm::Triple (options["targetTriple"].toString()), {}, {}, attributes));
+        targetMachine.reset (::llvm::EngineBuilder().selectTarget (::llvm::Triple (options["targetTriple"].toString()), {}, cpu, attributes));
 
         if (! targetMachine)
             return "Failed to create target machine - is the target triple valid?";
-    }
 
-    std::string targetFormat;
+        if (auto features = LLVMCodeGenerator::getExtraTargetFeatures (buildSettings); ! features.empty())
+            targetMachine->setTargetFeatureString (choc::text::joinStrings (features, ","));
+    }
 
-    if (options.hasObjectMember ("targetFormat"))
-        targetFormat = options["targetFormat"].toString();
+    if (! targetMachine)
+        return "Failed to create target machine";
 
     auto targetTriple = targetMachine->getTargetTriple();
     auto dataLayout = targetMachine->createDataLayout();
@@ -776,12 +1854,193 @@ std::string generateAssembler (const cmaj::ProgramInterface& p,
                                  stringDictionary,
                                  false);
 
+    generator.tuningTargetMachine = targetMachine.get();
+
     if (generator.generate())
         return generator.printAssembly (*targetMachine, targetFormat == "obj");
 
     return {};
 }
 
+//==============================================================================
+/// Builds a position-independent object file for the host, containing the program and
+/// an entry point which describes it to the PerformerLibraryEngine. The details it
+/// contains are the same ones that a LinkedCode works out for the JIT, so that once
+/// this is linked into a shared library, it can be run without a compiler or LLVM.
+///
+/// Like the llvm target, the options can contain a "multiversion" list of CPUs, in which
+/// case advanceBlock gets a version for each of them, chosen when the program is initialised.
+std::string generatePerformerLibrary (const cmaj::ProgramInterface& p,
+                                      const cmaj::BuildSettings& originalBuildSettings,
+                                      const choc::value::Value& options,
+                                      const std::vector<EndpointInfo>& endpoints,
+                                      const choc::value::Value& programDetails,
+                                      double latency)
+{
+    auto variantCPUs = getMultiversionCPUs (options);
+    auto buildSettings = variantCPUs.empty() ? originalBuildSettings : getMultiversionBaseSettings (originalBuildSettings);
+    auto targetMachine = createTargetMachine (buildSettings, true);
+
+    if (! targetMachine)
+        throw std::runtime_error ("Failed to create target machine");
+
+    auto& tm = *targetMachine;
+    choc::value::SimpleStringDictionary stringDictionary;
+
+    LLVMCodeGenerator generator (AST::getProgram (p), options, buildSettings,
+                                 tm.getTargetTriple().str(), tm.createDataLayout(),
+                                 stringDictionary, false);
+
+    generator.tuningTargetMachine = std::addressof (tm);
+
+    if (! generator.generate())
+        throw std::runtime_error ("Failed to generate code");
+
+    if (! variantCPUs.empty())
+        if (auto error = addAdvanceBlockVariants (generator, AST::getProgram (p), buildSettings, options,
+                                                  variantCPUs, tm, stringDictionary); ! error.empty())
+            throw std::runtime_error (error);
+
+    if (! generator.externalFunctionPointers.empty())
+        throw std::runtime_error ("Programs that use native external functions can't be built as a shared library");
+
+    if (std::max (generator.getStateAlignment(), generator.getIOAlignment()) > PerformerLibraryEngine::memoryAlignment * 8)
+        throw std::runtime_error ("Memory alignment requirements not met");
+
+    NativeTypeLayoutCache layouts;
+    layouts.createLayout = [&generator] (const AST::TypeBase& t) { return generator.createNativeTypeLayout (t); };
+
+    bool isSingleFrameOnly = buildSettings.getMaxBlockSize() == 1;
+
+    std::vector<std::string> functionNames { LLVMCodeGenerator::getInitFunctionName(),
+                                             isSingleFrameOnly ? LLVMCodeGenerator::getAdvanceOneFrameFunctionName()
+                                                               : LLVMCodeGenerator::getAdvanceBlockFunctionName() };
+
+    auto addFunction = [&] (const std::string& name)
+    {
+        functionNames.push_back (name);
+        return static_cast<int32_t> (functionNames.size() - 1);
+    };
+
+    auto getStateOffset = [&] (const std::string& member)  { return static_cast<int32_t> (generator.getStructMemberOffset (*generator.stateStruct, member)); };
+    auto getIOOffset    = [&] (const std::string& member)  { return static_cast<int32_t> (generator.getStructMemberOffset (*generator.ioStruct, member)); };
+
+    // Primitive event types are passed to their handlers by value, and everything else by pointer
+    auto getEventArgumentType = [] (const AST::TypeBase& type) -> std::string
+    {
+        if (type.isVoid())                 return "none";
+        if (type.isPrimitiveInt32())       return "int32";
+        if (type.isPrimitiveBool())        return "int32";
+        if (type.isPrimitiveString())      return "int32";
+        if (type.isPrimitiveInt64())       return "int64";
+        if (type.isPrimitiveFloat32())     return "float32";
+        if (type.isPrimitiveFloat64())     return "float64";
+
+        return "pointer";
+    };
+
+    auto endpointList = choc::value::createEmptyArray();
+
+    for (auto& endpoint : endpoints)
+    {
+        auto endpointID = endpoint.details.endpointID.toString();
+
+        auto e = choc::value::createObject ({},
+                                            "handle", static_cast<int32_t> (endpoint.handle),
+                                            "endpointID", endpointID,
+                                            "isInput", endpoint.details.isInput,
+                                            "endpointType", std::string (getEndpointTypeName (endpoint.details.endpointType)));
+
+        if (endpoint.details.isStream())
+        {
+            auto& frameType = endpoint.endpoint.getSingleDataType();
+
+            e.setMember ("offset", getIOOffset (endpointID));
+            e.setMember ("stride", static_cast<int32_t> (generator.getPaddedTypeSize (frameType)));
+            e.setMember ("layout", layouts.get (frameType)->toJSON());
+        }
+        else if (endpoint.details.isValue())
+        {
+            auto& valueType = endpoint.endpoint.getSingleDataType();
+            e.setMember ("layout", layouts.get (valueType)->toJSON());
+
+            if (endpoint.details.isInput)
+            {
+                e.setMember ("stride", static_cast<int32_t> (generator.getPaddedTypeSize (valueType)));
+                e.setMember ("setValue", addFunction (AST::getSetValueFunctionName (endpoint.endpoint)));
+            }
+            else
+            {
+                e.setMember ("offset", getStateOffset (StreamUtilities::getValueEndpointStructMemberName (endpointID)));
+            }
+        }
+        else if (endpoint.details.isEvent())
+        {
+            auto eventTypes = choc::value::createEmptyArray();
+
+            if (endpoint.details.isInput)
+            {
+                for (auto& dataType : endpoint.endpoint.getDataTypes())
+                {
+                    auto& type = dataType->skipConstAndRefModifiers();
+                    auto handler = AST::findEventHandlerFunction (endpoint.endpoint, dataType);
+
+                    eventTypes.addArrayElement (choc::value::createObject ({},
+                                                                           "function", handler != nullptr ? addFunction (AST::getEventHandlerFunctionName (*handler)) : -1,
+                                                                           "argument", getEventArgumentType (type),
+                                                                           "layout", layouts.get (type)->toJSON()));
+                }
+            }
+            else
+            {
+                auto& eventListType = *generator.stateStruct->getTypeForMember (endpointID);
+                auto eventEntryType = AST::castTo<AST::StructType> (eventListType.getArrayOrVectorElementType());
+
+                e.setMember ("offset", getStateOffset (endpointID));
+                e.setMember ("stride", static_cast<int32_t> (generator.getStructPaddedSize (*eventEntryType)));
+                e.setMember ("eventCountOffset", getStateOffset (EventHandlerUtilities::getEventCountStateMemberName (endpointID)));
+                e.setMember ("eventTypeFieldOffset", static_cast<int32_t> (generator.getStructMemberOffset (*eventEntryType, 1)));
+
+                for (uint32_t i = 0; i < endpoint.details.dataTypes.size(); ++i)
+                {
+                    auto memberIndex = eventEntryType->indexOfMember ("value_" + std::to_string (i));
+
+                    auto& type = (memberIndex >= 0) ? eventEntryType->getMemberType (static_cast<size_t> (memberIndex))
+                                                    : eventEntryType->context.allocator.createVoidType();
+
+                    if (memberIndex < 0)
+                        memberIndex = 0;
+
+                    eventTypes.addArrayElement (choc::value::createObject ({},
+                                                                           "offset", static_cast<int32_t> (generator.getStructMemberOffset (*eventEntryType, static_cast<uint32_t> (memberIndex))),
+                                                                           "layout", layouts.get (type)->toJSON()));
+                }
+            }
+
+            e.setMember ("eventTypes", eventTypes);
+        }
+
+        endpointList.addArrayElement (e);
+    }
+
+    auto details = choc::value::createObject ({},
+                                              "programDetails", programDetails,
+                                              "stateSize", static_cast<int64_t> (generator.getStateSize()),
+                                              "ioSize", static_cast<int64_t> (generator.getIOSize()),
+                                              "maxBlockSize", static_cast<int32_t> (buildSettings.getMaxBlockSize()),
+                                              "eventBufferSize", static_cast<int32_t> (buildSettings.getEventBufferSize()),
+                                              "latency", latency,
+                                              "singleFrameOnly", isSingleFrameOnly,
+                                              "initialise", 0,
+                                              "advance", 1,
+                                              "endpoints", endpointList);
+
+    generator.addPerformerLibraryEntryPoint (performerLibraryEntryPoint, performerLibraryVersion,
+                                             choc::json::toString (details, false), functionNames);
+
+    return generator.printAssembly (tm, true);
+}
+
 #endif // CMAJ_ENABLE_PERFORMER_LLVM
 
 void addTargetIfAvailable (std::vector<std::string>& targets, std::string target)
@@ -44,6 +44,7 @@ struct WebAssemblyEngine
     EngineBase<WebAssemblyEngine>& engine;
 
     static std::string getEngineVersion()   { return std::string ("wasm1"); }
+    static std::string getTargetDescription()   { return {}; }
 
     struct ExtraEndpointInfo
     {
@@ -159,51 +160,49 @@ initialisePatch();
             context.evaluate (instanceName + ".advance (" + std::to_string (framesToAdvance) + ")");
         }
 
-        std::function<Result(void*, uint32_t)> createCopyOutputValueFunction (const EndpointInfo& e)
+        OutputStreamAccessor createOutputStreamAccessor (const EndpointInfo& e)
         {
             const auto& name = e.details.endpointID.toString();
             CMAJ_ASSERT (e.details.dataTypes.size() == 1);
 
-            if (e.details.isStream())
-            {
-                context.evaluate (choc::text::replace (R"(
-                        let tempOutputFrames_NAME = new Array (2048);
+            context.evaluate (choc::text::replace (R"(
+                    let tempOutputFrames_NAME = new Array (2048);
 
-                        function returnOutputFrames_NAME (numFrames)
-                        {
-                            for (let frame = 0; frame < numFrames; ++frame)
-                                tempOutputFrames_NAME[frame] = INSTANCE.getOutputFrame_NAME (frame);
+                    function returnOutputFrames_NAME (numFrames)
+                    {
+                        for (let frame = 0; frame < numFrames; ++frame)
+                            tempOutputFrames_NAME[frame] = INSTANCE.getOutputFrame_NAME (frame);
 
-                            return tempOutputFrames_NAME.slice (0, numFrames);
-                        })",
-                    "NAME", name,
-                    "INSTANCE", instanceName));
+                        return tempOutputFrames_NAME.slice (0, numFrames);
+                    })",
+                "NAME", name,
+                "INSTANCE", instanceName));
 
-                return [this,
-                        frameType = e.details.dataTypes.front(),
-                        functionName = "returnOutputFrames_" + name] (void* destBuffer, uint32_t numFrames) -> Result
-                {
-                    ScopedDisableAllocationTracking disableTracking;
-                    auto result = context.evaluateWithResult (functionName + "(" + std::to_string (numFrames) + ")");
-                    writeToValueWithType (destBuffer, choc::value::Type::createArray (frameType, numFrames), result);
-                    return Result::Ok;
-                };
-            }
-            else
+            return { nullptr, 0, thunkContexts.create<void(void*, uint32_t)> ([this,
+                                                                               frameType = e.details.dataTypes.front(),
+                                                                               functionName = "returnOutputFrames_" + name] (void* destBuffer, uint32_t numFrames)
             {
-                return [this,
-                        command = instanceName + ".getOutputValue_" + name + "()",
-                        endpointType = e.details.dataTypes.front()] (void* destBuffer, uint32_t) -> Result
-                {
-                    ScopedDisableAllocationTracking disableTracking;
-                    auto result = context.evaluateWithResult (command);
-                    writeToValueWithType (destBuffer, endpointType, result);
-                    return Result::Ok;
-                };
-            }
+                ScopedDisableAllocationTracking disableTracking;
+                auto result = context.evaluateWithResult (functionName + "(" + std::to_string (numFrames) + ")");
+                writeToValueWithType (destBuffer, choc::value::Type::createArray (frameType, numFrames), result);
+            }) };
+        }
+
+        PerformerThunk<void(void*)> createCopyOutputValueFunction (const EndpointInfo& e)
+        {
+            CMAJ_ASSERT (e.details.dataTypes.size() == 1);
+
+            return thunkContexts.create<void(void*)> ([this,
+                                                       command = instanceName + ".getOutputValue_" + e.details.endpointID.toString() + "()",
+                                                       endpointType = e.details.dataTypes.front()] (void* destBuffer)
+            {
+                ScopedDisableAllocationTracking disableTracking;
+                auto result = context.evaluateWithResult (command);
+                writeToValueWithType (destBuffer, endpointType, result);
+            });
         }
 
-        std::function<void(const void*, uint32_t, uint32_t)> createSetInputStreamFramesFunction (const EndpointInfo& e)
+        InputStreamAccessor createInputStreamAccessor (const EndpointInfo& e)
         {
             auto command = instanceName + ".setInputStreamFrames_" + e.details.endpointID.toString() + "([";
             CMAJ_ASSERT (e.details.dataTypes.size() == 1);
@@ -218,20 +217,22 @@ initialisePatch();
 
             if (elementType.isFloat32())
             {
-                return [this, command, numChannels] (const void* sourceData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
+                return { nullptr, 0, thunkContexts.create<void(const void*, uint32_t, uint32_t)> ([this, command, numChannels]
+                                                                                                  (const void* sourceData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
                 {
                     ScopedDisableAllocationTracking disableTracking;
                     this->setInputStreamFrames<float> (command, sourceData, numChannels, numFrames, numTrailingFramesToClear);
-                };
+                }) };
             }
 
             if (elementType.isFloat64())
             {
-                return [this, command, numChannels] (const void* sourceData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
+                return { nullptr, 0, thunkContexts.create<void(const void*, uint32_t, uint32_t)> ([this, command, numChannels]
+                                                                                                  (const void* sourceData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
                 {
                     ScopedDisableAllocationTracking disableTracking;
                     this->setInputStreamFrames<double> (command, sourceData, numChannels, numFrames, numTrailingFramesToClear);
-                };
+                }) };
             }
 
             CMAJ_ASSERT_FALSE;
@@ -292,78 +293,65 @@ initialisePatch();
             context.evaluate (s.str());
         }
 
-        auto createSetInputValueFunction (const EndpointInfo& e)
+        PerformerThunk<void(const void*, uint32_t)> createSetInputValueFunction (const EndpointInfo& e)
         {
             auto command = instanceName + ".setInputValue_" + e.details.endpointID.toString() + "(";
             CMAJ_ASSERT (e.details.dataTypes.size() == 1);
             auto temp = choc::value::Value (e.details.dataTypes.front());
 
-            return [this, command, t = std::move (temp)] (const void* valueData, uint32_t numFramesToReachValue) mutable
+            return thunkContexts.create<void(const void*, uint32_t)> ([this, command, t = std::move (temp)] (const void* valueData, uint32_t numFramesToReachValue) mutable
             {
                 ScopedDisableAllocationTracking disableTracking;
                 memcpy (t.getRawData(), valueData, t.getRawDataSize());
                 context.evaluate (command + choc::json::toString (t) + ", " + std::to_string (numFramesToReachValue) + ")");
-            };
+            });
         }
 
-        std::function<void(const void*)> createSendEventFunction (const EndpointInfo&, const AST::TypeBase& type, const AST::Function& f)
+        PerformerThunk<void(const void*)> createSendEventFunction (const EndpointInfo&, const AST::TypeBase& type, const AST::Function& f)
         {
             auto eventType = type.toChocType();
             auto command = instanceName + "." + AST::getEventHandlerFunctionName (f, "sendInputEvent_") + "(";
             auto temp = choc::value::Value (eventType);
 
-            return [this, command, t = std::move (temp)] (const void* eventData) mutable
+            return thunkContexts.create<void(const void*)> ([this, command, t = std::move (temp)] (const void* eventData) mutable
             {
                 ScopedDisableAllocationTracking disableTracking;
                 memcpy (t.getRawData(), eventData, t.getRawDataSize());
                 context.evaluate (command + choc::json::toString (t) + ")");
-            };
+            });
         }
 
-        auto createGetNumOutputEventsFunction (const EndpointInfo& e)
+        ReadOutputEventsThunk createReadOutputEventsFunction (const EndpointInfo& e)
         {
-            auto command = instanceName + ".getOutputEventCount_" + e.details.endpointID.toString() + "()";
-
-            return [this, command]
-            {
-                ScopedDisableAllocationTracking disableTracking;
-                return static_cast<uint32_t> (context.evaluateWithResult (command).template getWithDefault<int32_t> (0));
-            };
-        }
+            const auto& name = e.details.endpointID.toString();
 
-        auto createResetEventCountFunction (const EndpointInfo& e)
-        {
-            auto command = instanceName + ".resetOutputEventCount_" + e.details.endpointID.toString() + "()";
-            return [this, command]
+            return thunkContexts.create<uint32_t(OutputEventQueue&, uint32_t)> ([this,
+                                                                                 getCountCommand = instanceName + ".getOutputEventCount_" + name + "()",
+                                                                                 resetCountCommand = instanceName + ".resetOutputEventCount_" + name + "()",
+                                                                                 getEventCommand = instanceName + ".getOutputEvent_" + name + "(",
+                                                                                 dataTypes = e.details.dataTypes] (OutputEventQueue& queue, uint32_t frameOffset)
             {
                 ScopedDisableAllocationTracking disableTracking;
-                context.evaluate (command);
-            };
-        }
+                auto numAvailable = static_cast<uint32_t> (context.evaluateWithResult (getCountCommand).template getWithDefault<int32_t> (0));
 
-        auto createGetEventTypeIndexFunction (const EndpointInfo& e)
-        {
-            auto command = instanceName + ".getOutputEvent_" + e.details.endpointID.toString() + "(";
+                if (numAvailable == 0)
+                    return 0u;
 
-            return [this, command] (uint32_t index)
-            {
-                ScopedDisableAllocationTracking disableTracking;
-                return static_cast<uint32_t> (context.evaluateWithResult (command + std::to_string (index) + ").typeIndex").template getWithDefault<int32_t> (0));
-            };
-        }
+                auto numToRead = std::min (numAvailable, queue.getNumFreeSlots());
 
-        auto createReadOutputEventFunction (const EndpointInfo& e)
-        {
-            auto command = instanceName + ".getOutputEvent_" + e.details.endpointID.toString() + "(";
+                for (uint32_t i = 0; i < numToRead; ++i)
+                {
+                    auto result = context.evaluateWithResult (getEventCommand + std::to_string (i) + ")");
+                    auto& event = queue.getEvent (queue.numEvents + i);
+                    event.type = static_cast<uint32_t> (result["typeIndex"].template getWithDefault<int32_t> (0));
+                    event.frame = static_cast<uint32_t> (result["frame"].template get<int32_t>()) + frameOffset;
+                    writeToValueWithType (event.data, dataTypes[event.type], result["event"]);
+                }
 
-            return [this, command, dataTypes = e.details.dataTypes] (uint32_t index, void* dataBuffer)
-            {
-                ScopedDisableAllocationTracking disableTracking;
-                auto result = context.evaluateWithResult (command + std::to_string (index) + ")");
-                auto typeIndex = static_cast<uint32_t> (result["typeIndex"].template getWithDefault<int32_t> (0));
-                writeToValueWithType (dataBuffer, dataTypes[typeIndex], result["event"]);
-                return static_cast<uint32_t> (result["frame"].template get<int32_t>());
-            };
+                queue.numEvents += numToRead;
+                context.evaluate (resetCountCommand);
+                return numAvailable - numToRead;
+            });
         }
 
         struct Dictionary  : public choc::value::StringDictionary
@@ -520,9 +508,22 @@ initialisePatch();
         std::shared_ptr<LinkedCode> code;
         std::string instanceName, initError;
         typename WebViewInstance::Context context { WebViewInstance::get() };
+        PerformerThunkContexts thunkContexts;
 
         Dictionary dictionary { *this };
         choc::value::StringDictionary& getDictionary()  { return dictionary; }
+
+        // The javascript performer can't read a cycle counter, so node profiling isn't supported
+        choc::value::Value getNodeProfile()             { return {}; }
+
+        // All the code is compiled up-front, so there's nothing to prefetch
+        void prefetchEndpoint (EndpointHandle)          {}
+
+        // There's only a single tier of code
+        bool isRunningQuickTier() const                 { return false; }
+
+        // Handlers are never compiled lazily, so no calls are dropped
+        uint32_t getNumDroppedCalls() const             { return 0; }
     };
 
 
@@ -27,6 +27,7 @@
 #include "CPlusPlus/cmaj_CPlusPlus.h"
 #include "WebAssembly/cmaj_WebAssembly.h"
 #include "LLVM/cmaj_LLVM.h"
+#include "cmaj_PerformerThunk.h"
 
 namespace cmaj
 {
@@ -38,6 +39,59 @@ struct EndpointInfo
     EndpointDetails details;
 };
 
+//==============================================================================
+/// The queue into which a performer collects the events from an output endpoint.
+/// Each JIT instance provides a thunk which moves its pending events into one of these.
+struct OutputEventQueue
+{
+    struct Event
+    {
+        uint32_t frame = 0, type = 0;
+        uint64_t data[1];
+    };
+
+    void initialise (const EndpointDetails& details, uint32_t maxNumEventsToUse)
+    {
+        numEvents = 0;
+        maxNumEvents = maxNumEventsToUse;
+        size_t maxEventDataSize = 0;
+
+        for (auto& t : details.dataTypes)
+        {
+            auto size = t.getValueDataSize();
+            maxEventDataSize = std::max (maxEventDataSize, size);
+            eventSizes.push_back (static_cast<uint32_t> (size));
+        }
+
+        eventStride = ((sizeof (Event) + maxEventDataSize) + 7u) & ~7u;
+        eventSpace.resize (maxNumEvents * eventStride);
+    }
+
+    Event& getEvent (size_t index) noexcept
+    {
+        return *reinterpret_cast<Event*> (eventSpace.data() + eventStride * index);
+    }
+
+    uint32_t getNumFreeSlots() const noexcept   { return maxNumEvents - numEvents; }
+
+    uint32_t numEvents = 0;
+    uint32_t maxNumEvents = 0;
+
+    std::vector<uint32_t> eventSizes;
+
+private:
+    size_t eventStride = 0;
+    std::vector<uint8_t> eventSpace;
+};
+
+/// Appends any events that a JIT instance has emitted to a queue, adding the given
+/// frame offset to their times and resetting the JIT's event count. It returns the
+/// number of events that were dropped because the queue was full.
+using ReadOutputEventsThunk = PerformerThunk<uint32_t(OutputEventQueue&, uint32_t frameOffset)>;
+
+using InputStreamAccessor   = StreamFrameAccessor<void(const void* sourceFrames, uint32_t numFrames, uint32_t numTrailingFramesToClear)>;
+using OutputStreamAccessor  = StreamFrameAccessor<void(void* destFrames, uint32_t numFrames)>;
+
 
 //==============================================================================
 template <typename Implementation>
@@ -199,7 +253,8 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
                 transformations::prepareForCodeGen (*program,
                                                     buildSettings,
                                                     Implementation::canUseForwardBranches,
-                                                    Implementation::usesDynamicRateAndSessionID,
+                                                    Implementation::usesDynamicRateAndSessionID
+                                                      || buildSettings.shouldUseDynamicFrequency(),
                                                     Implementation::allowTopLevelSlices,
                                                     Implementation::supportsExternalFunctions,
                                                     Implementation::engineSupportsIntrinsic,
@@ -224,14 +279,39 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
 
     choc::com::String* getLastBuildLog() override
     {
-        return choc::com::createRawString (compilePerformanceTimes.getResults());
+        auto log = compilePerformanceTimes.getResults();
+
+        if (program != nullptr && ! program->resolutionPassStats.empty())
+        {
+            std::vector<std::string> passTimes;
+
+            for (auto& s : program->resolutionPassStats)
+                passTimes.push_back (std::string (s.passName) + ": " + choc::text::getDurationDescription (std::chrono::duration<double> (s.seconds))
+                                       + " (" + std::to_string (s.numRuns) + " runs, " + std::to_string (s.numSkipped) + " skipped, "
+                                       + std::to_string (s.numChanges) + " changes)");
+
+            if (! log.empty())
+                log += "\n";
+
+            log += "Resolution passes: " + choc::text::joinStrings (passTimes, ", ");
+        }
+
+        return choc::com::createRawString (log);
     }
 
     std::string getCacheKey()
     {
         auto hash = getProgram().codeHash;
         hash.addInput (implementation->getEngineVersion());
-        hash.addInput (BuildSettings (buildSettings).setSessionID (0).toJSON());
+        hash.addInput (implementation->getTargetDescription());
+
+        auto settingsForKey = BuildSettings (buildSettings).setSessionID (0);
+
+        // A program built with a dynamic frequency can be shared between all rates
+        if (buildSettings.shouldUseDynamicFrequency())
+            settingsForKey.setFrequency (0);
+
+        hash.addInput (settingsForKey.toJSON());
 
         return std::string (mainProcessor->getName()) + "_" + choc::text::createHexString (hash.getHash());
     }
@@ -307,6 +387,7 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
 
            #if CMAJ_ENABLE_PERFORMER_LLVM
             availableTargets.append (" " + choc::text::joinStrings(::cmaj::llvm::getAssemberTargets(), " "));
+            availableTargets.append (" sharedlib");
            #endif
         }
 
@@ -346,6 +427,12 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
                 return;
             }
 
+            // A shared library has to be usable from any of the main processor's endpoints,
+            // so they all need handles before any unused ones are stripped out
+            if (type == "sharedlib")
+                for (auto& e : getProgram().endpointList.endpoints)
+                    getEndpointHandle (e.details.endpointID.toString().c_str());
+
             double latency;
 
             std::function<bool(AST::Intrinsic::Type)> engineSupportsIntrinsic
@@ -411,6 +498,16 @@ struct EngineBase  : public choc::com::ObjectWithAtomicRefCount<EngineInterface,
                 output = cmaj::llvm::generateAssembler (*program, buildSettings, opt);
                 outputTypeKnown = true;
             }
+
+            if (type == "sharedlib")
+            {
+                output = cmaj::llvm::generatePerformerLibrary (*program, buildSettings,
+                                                               choc::json::parse (optionsString.empty() ? "{}" : optionsString),
+                                                               endpointHandles,
+                                                               choc::json::parse (loadedProgramDetailsJSON),
+                                                               latency);
+                outputTypeKnown = true;
+            }
            #endif
 
             if (! outputTypeKnown)
@@ -483,6 +580,26 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
         return Result::InvalidEndpointHandle;
     }
 
+    Result addInputEvents (EndpointHandle handle, const EventBatch* batch) override
+    {
+        if (auto* endpointHandler = getEndpointHandler (handle))
+        {
+            for (uint32_t i = 0; i < batch->numEvents; ++i)
+            {
+                auto& e = batch->events[i];
+                auto result = e.frameOffset == 0 ? endpointHandler->addInputEvent (e.typeIndex, e.eventData)
+                                                 : endpointHandler->addTimedInputEvent (e.frameOffset, e.typeIndex, e.eventData);
+
+                if (result != Result::Ok)
+                    return result;
+            }
+
+            return Result::Ok;
+        }
+
+        return Result::InvalidEndpointHandle;
+    }
+
     Result copyOutputValue (EndpointHandle handle, void* dest) override
     {
         if (auto* endpointHandler = getEndpointHandler (handle))
@@ -509,10 +626,19 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
 
     Result advance() override
     {
+        if (! pendingEvents.empty())
+            return advanceWithTimedEvents();
+
         jit.advance (numFramesToDo);
 
         for (auto& e : outputEventHandlers)
-            e->moveOutputEventsToQueue();
+            e->moveOutputEventsToQueue (0, false);
+
+        for (auto& s : inputStreamHandlers)
+            s->lastFrameData = nullptr;
+
+        for (auto& s : outputStreamHandlers)
+            s->hasStagedFrames = false;
 
         return Result::Ok;
     }
@@ -520,9 +646,29 @@ struct PerformerBase  : public choc::com::ObjectWithAtomicRefCount<cmaj::Perform
     uint32_t getMaximumBlockSize() override     { return maxBlockSize; }
     double getLatency() override                { return latency; }
     uint32_t getEventBufferSize() override      { return eventBufferSize; }
-    uint32_t getXRuns() override                { return xruns; }
+    uint32_t getXRuns() override                { return xruns + jit.getNumDroppedCalls(); }
     const char* getRuntimeError() override      { return {}; }
 
+    choc::com::String* getNodeProfile() override
+    {
+        auto profile = jit.getNodeProfile();
+
+        if (profile.isVoid())
+            return {};
+
+        return choc::com::createRawString (choc::json::toString (profile));
+    }
+
+    void prefetchEndpoint (EndpointHandle handle) override
+    {
+        jit.prefetchEndpoint (handle);
+    }
+
+    bool isRunningQuickTier() override
+    {
+        return jit.isRunningQuickTier();
+    }
+
     const char* getStringForHandle (uint32_t handle, size_t& stringLength) override
     {
         try
@@ -548,6 +694,100 @@ private:
     const uint32_t maxBlockSize, eventBufferSize;
     const double latency;
 
+    //==============================================================================
+    // Events that were added with a non-zero frame offset wait in this list (which is kept
+    // sorted by frame) until advance() splits the block up to deliver them at the right time.
+    // Their data is copied into a pre-allocated arena to avoid allocating on the audio thread.
+    struct EndpointHandler;
+
+    struct PendingEvent
+    {
+        uint32_t frame, typeIndex;
+        EndpointHandler* handler;
+        size_t dataOffset;
+    };
+
+    std::vector<PendingEvent> pendingEvents;
+    std::vector<uint8_t> pendingEventData;
+    size_t pendingEventDataUsed = 0, maxPendingEvents = 0;
+
+    Result queueTimedEvent (EndpointHandler& handler, uint32_t frame, uint32_t typeIndex, const void* data, uint32_t dataSize)
+    {
+        if (pendingEvents.size() >= maxPendingEvents || pendingEventDataUsed + dataSize > pendingEventData.size())
+        {
+            // no space left, so it has to be delivered immediately, and is counted as an xrun
+            registerXRun();
+            return handler.addInputEvent (typeIndex, data);
+        }
+
+        if (dataSize != 0)
+            std::memcpy (pendingEventData.data() + pendingEventDataUsed, data, dataSize);
+
+        auto insertPos = std::upper_bound (pendingEvents.begin(), pendingEvents.end(), frame,
+                                           [] (uint32_t f, const PendingEvent& e) { return f < e.frame; });
+
+        pendingEvents.insert (insertPos, { frame, typeIndex, std::addressof (handler), pendingEventDataUsed });
+        pendingEventDataUsed += (dataSize + 7u) & ~7u;
+        return Result::Ok;
+    }
+
+    Result advanceWithTimedEvents()
+    {
+        for (auto& e : outputEventHandlers)
+            e->queue.numEvents = 0;
+
+        // Without a block size, there are no frames to place the events on, so they're
+        // delivered straight away rather than being lost
+        if (numFramesToDo == 0)
+        {
+            for (auto& e : pendingEvents)
+                e.handler->addInputEvent (e.typeIndex, pendingEventData.data() + e.dataOffset);
+
+            pendingEvents.clear();
+            pendingEventDataUsed = 0;
+            return Result::InvalidBlockSize;
+        }
+
+        auto lastFrame = numFramesToDo - 1;
+        size_t nextEvent = 0;
+
+        for (uint32_t frame = 0; frame < numFramesToDo;)
+        {
+            while (nextEvent < pendingEvents.size() && std::min (pendingEvents[nextEvent].frame, lastFrame) <= frame)
+            {
+                auto& e = pendingEvents[nextEvent++];
+                e.handler->addInputEvent (e.typeIndex, pendingEventData.data() + e.dataOffset);
+            }
+
+            auto chunkEnd = nextEvent < pendingEvents.size() ? std::min (pendingEvents[nextEvent].frame, lastFrame)
+                                                             : numFramesToDo;
+            auto numFrames = chunkEnd - frame;
+
+            // the first chunk can use the frames that were already passed to the JIT by setInputFrames()
+            if (frame != 0)
+                for (auto& s : inputStreamHandlers)
+                    s->setInputFramesForChunk (frame, numFrames);
+
+            jit.advance (numFrames);
+
+            for (auto& s : outputStreamHandlers)
+                s->stageOutputFramesForChunk (frame, numFrames);
+
+            for (auto& e : outputEventHandlers)
+                e->moveOutputEventsToQueue (frame, true);
+
+            frame = chunkEnd;
+        }
+
+        pendingEvents.clear();
+        pendingEventDataUsed = 0;
+
+        for (auto& s : inputStreamHandlers)
+            s->lastFrameData = nullptr;
+
+        return Result::Ok;
+    }
+
     //==============================================================================
     void initialiseEndpointList (const std::vector<EndpointInfo>& endpoints)
     {
@@ -556,6 +796,7 @@ private:
 
         firstHandle = endpoints.front().handle;
         lastHandle = firstHandle;
+        size_t maxInputEventDataSize = 0;
 
         for (auto& endpoint : endpoints)
         {
@@ -565,11 +806,23 @@ private:
             if (endpoint.details.isInput)
             {
                 if (endpoint.details.isEvent())
+                {
                     endpointHandlers.push_back (std::make_unique<InputEventHandler> (*this, endpoint));
+                    maxPendingEvents += eventBufferSize;
+
+                    for (auto& t : endpoint.details.dataTypes)
+                        maxInputEventDataSize = std::max (maxInputEventDataSize, (t.getValueDataSize() + 7u) & ~static_cast<size_t> (7u));
+                }
                 else if (endpoint.details.isStream())
-                    endpointHandlers.push_back (std::make_unique<InputStreamHandler> (*this, endpoint));
+                {
+                    auto h = std::make_unique<InputStreamHandler> (*this, endpoint);
+                    inputStreamHandlers.push_back (h.get());
+                    endpointHandlers.push_back (std::move (h));
+                }
                 else
+                {
                     endpointHandlers.push_back (std::make_unique<InputValueHandler> (*this, endpoint));
+                }
             }
             else if (endpoint.details.isEvent())
             {
@@ -580,9 +833,16 @@ private:
             else
             {
                 auto h = std::make_unique<OutputStreamOrValueHandler> (*this, endpoint);
+
+                if (h->isStream)
+                    outputStreamHandlers.push_back (h.get());
+
                 endpointHandlers.push_back (std::move (h));
             }
         }
+
+        pendingEvents.reserve (maxPendingEvents);
+        pendingEventData.resize (maxPendingEvents * maxInputEventDataSize);
     }
 
     //==============================================================================
@@ -594,6 +854,7 @@ private:
         virtual Result setInputFrames (const void*, uint32_t, uint32_t)                            { CMAJ_ASSERT_FALSE; }
         virtual Result setInputValue (const void*, uint32_t)                                       { CMAJ_ASSERT_FALSE; }
         virtual Result addInputEvent (uint32_t, const void*)                                       { CMAJ_ASSERT_FALSE; }
+        virtual Result addTimedInputEvent (uint32_t, uint32_t, const void*)                        { CMAJ_ASSERT_FALSE; }
         virtual Result copyOutputValue (void*)                                                     { CMAJ_ASSERT_FALSE; }
         virtual Result copyOutputFrames (void*, uint32_t)                                          { CMAJ_ASSERT_FALSE; }
         virtual Result iterateOutputEvents (void*, PerformerInterface::HandleOutputEventCallback)  { CMAJ_ASSERT_FALSE; }
@@ -604,11 +865,33 @@ private:
     {
         InputStreamHandler (PerformerBase& p, const EndpointInfo& endpoint) : owner (p)
         {
-            setInputStreamFrames = owner.jit.createSetInputStreamFramesFunction (endpoint);
+            access = owner.jit.createInputStreamAccessor (endpoint);
+            frameSize = static_cast<uint32_t> (endpoint.details.dataTypes.front().getValueDataSize());
+        }
+
+        void setInputStreamFrames (const void* frameData, uint32_t numFrames, uint32_t numTrailingFramesToClear)
+        {
+            if (access.frames != nullptr)
+            {
+                auto size = static_cast<size_t> (numFrames) * access.frameSize;
+
+                if (size != 0)
+                    std::memcpy (access.frames, frameData, size);
+
+                if (numTrailingFramesToClear != 0)
+                    std::memset (access.frames + size, 0, static_cast<size_t> (numTrailingFramesToClear) * access.frameSize);
+            }
+            else
+            {
+                access.convertFrames (frameData, numFrames, numTrailingFramesToClear);
+            }
         }
 
         Result setInputFrames (const void* frameData, uint32_t numFrames, uint32_t framesForBlock) override
         {
+            lastFrameData = static_cast<const uint8_t*> (frameData);
+            lastNumFrames = numFrames;
+
             if (numFrames == framesForBlock)
             {
                 setInputStreamFrames (frameData, numFrames, 0);
@@ -626,8 +909,21 @@ private:
             return Result::Ok;
         }
 
+        /// When the block is being split to deliver timed events, this passes the JIT the
+        /// section of the most recent frames that the next chunk needs.
+        void setInputFramesForChunk (uint32_t startFrame, uint32_t numFrames)
+        {
+            auto numAvailable = lastFrameData != nullptr && lastNumFrames > startFrame
+                                  ? std::min (numFrames, lastNumFrames - startFrame) : 0u;
+
+            setInputStreamFrames (numAvailable != 0 ? lastFrameData + startFrame * frameSize : nullptr,
+                                  numAvailable, numFrames - numAvailable);
+        }
+
         PerformerBase& owner;
-        std::function<void(const void*, uint32_t, uint32_t)> setInputStreamFrames;
+        InputStreamAccessor access;
+        const uint8_t* lastFrameData = nullptr;
+        uint32_t lastNumFrames = 0, frameSize = 0;
     };
 
     //==============================================================================
@@ -644,29 +940,27 @@ private:
             return Result::Ok;
         }
 
-        std::function<void(const void*, uint32_t)> setInputValueFn;
+        PerformerThunk<void(const void*, uint32_t)> setInputValueFn;
         uint32_t dataTypeSize = 0;
     };
 
     //==============================================================================
     struct InputEventHandler : public EndpointHandler
     {
-        InputEventHandler (PerformerBase& owner, const EndpointInfo& endpoint)
+        InputEventHandler (PerformerBase& p, const EndpointInfo& endpoint) : owner (p)
         {
             for (auto& dataType : endpoint.endpoint.dataTypes)
             {
                 auto& t = AST::castToRefSkippingReferences<AST::TypeBase> (dataType);
-                std::function<void(const void*)> handler;
+                PerformerThunk<void(const void*)> handler { [] (void*, const void*) {}, nullptr };
 
                 if (auto handlerFunction = AST::findEventHandlerFunction (endpoint.endpoint, t))
                     handler = owner.jit.createSendEventFunction (endpoint, t, *handlerFunction);
-                else
-                    handler = [] (const void*) {};
 
                 auto type = t.toChocType();
                 auto size = static_cast<uint32_t> (type.getValueDataSize());
 
-                typeHandlers.push_back ({ std::move (type), size, std::move (handler) });
+                typeHandlers.push_back ({ std::move (type), size, handler });
             }
         }
 
@@ -679,13 +973,22 @@ private:
             return Result::Ok;
         }
 
+        Result addTimedInputEvent (uint32_t frame, uint32_t typeIndex, const void* eventData) override
+        {
+            if (typeIndex >= typeHandlers.size())
+                return Result::TypeIndexOutOfRange;
+
+            return owner.queueTimedEvent (*this, frame, typeIndex, eventData, typeHandlers[typeIndex].dataSize);
+        }
+
         struct TypeHandler
         {
             choc::value::Type type;
             uint32_t dataSize = 0;
-            std::function<void(const void*)> handler;
+            PerformerThunk<void(const void*)> handler;
         };
 
+        PerformerBase& owner;
         std::vector<TypeHandler> typeHandlers;
     };
 
@@ -694,24 +997,72 @@ private:
     {
         OutputStreamOrValueHandler (PerformerBase& owner, const EndpointInfo& endpoint)
         {
-            copyOutputValueFn = owner.jit.createCopyOutputValueFunction (endpoint);
             isStream = endpoint.details.isStream();
+
+            if (isStream)
+            {
+                access = owner.jit.createOutputStreamAccessor (endpoint);
+                frameSize = static_cast<uint32_t> (endpoint.details.dataTypes.front().getValueDataSize());
+                stagedFrames.resize (frameSize * owner.maxBlockSize);
+            }
+            else
+            {
+                copyOutputValueFn = owner.jit.createCopyOutputValueFunction (endpoint);
+            }
         }
 
         Result copyOutputValue (void* dest) override
         {
-            return copyOutputValueFn (dest, 1);
+            return copyOutputFrames (dest, 1);
         }
 
         Result copyOutputFrames (void* dest, uint32_t numFramesToCopy) override
         {
-            return copyOutputValueFn (dest, numFramesToCopy);
+            if (! isStream)
+            {
+                copyOutputValueFn (dest);
+                return Result::Ok;
+            }
+
+            if (hasStagedFrames)
+            {
+                std::memcpy (dest, stagedFrames.data(), std::min (stagedFrames.size(), static_cast<size_t> (numFramesToCopy) * frameSize));
+                return Result::Ok;
+            }
+
+            copyStreamFrames (dest, numFramesToCopy);
+            return Result::Ok;
+        }
+
+        /// Copies frames out of the JIT's stream buffer, clearing them as it goes
+        void copyStreamFrames (void* dest, uint32_t numFrames)
+        {
+            if (access.frames != nullptr)
+            {
+                auto size = static_cast<size_t> (numFrames) * access.frameSize;
+                std::memcpy (dest, access.frames, size);
+                std::memset (access.frames, 0, size);
+            }
+            else
+            {
+                access.convertFrames (dest, numFrames);
+            }
         }
 
-        uint32_t dataTypeSize = 0;
-        bool isStream = false;
+        /// When the block is being split to deliver timed events, each chunk's output
+        /// is collected here so that the caller can read the whole block at the end
+        void stageOutputFramesForChunk (uint32_t startFrame, uint32_t numFrames)
+        {
+            copyStreamFrames (stagedFrames.data() + startFrame * frameSize, numFrames);
+            hasStagedFrames = true;
+        }
 
-        std::function<Result(void*, uint32_t)> copyOutputValueFn;
+        uint32_t dataTypeSize = 0, frameSize = 0;
+        bool isStream = false, hasStagedFrames = false;
+        std::vector<uint8_t> stagedFrames;
+
+        OutputStreamAccessor access;
+        PerformerThunk<void(void*)> copyOutputValueFn;
     };
 
     //==============================================================================
@@ -720,11 +1071,7 @@ private:
         OutputEventHandler (PerformerBase& p, const EndpointInfo& endpoint)
             : owner (p), handle (endpoint.handle)
         {
-            getNumOutputEvents = owner.jit.createGetNumOutputEventsFunction (endpoint);
-            getEventTypeIndex  = owner.jit.createGetEventTypeIndexFunction (endpoint);
-            readOutputEvent    = owner.jit.createReadOutputEventFunction (endpoint);
-            resetEventCount    = owner.jit.createResetEventCountFunction (endpoint);
-
+            readOutputEvents = owner.jit.createReadOutputEventsFunction (endpoint);
             queue.initialise (endpoint.details, owner.eventBufferSize);
         }
 
@@ -743,88 +1090,29 @@ private:
             return Result::Ok;
         }
 
-        void moveOutputEventsToQueue()
+        void moveOutputEventsToQueue (uint32_t frameOffset, bool appendToQueue)
         {
-            CMAJ_ASSERT (getNumOutputEvents != nullptr);
-
-            if (auto numEvents = getNumOutputEvents())
-            {
-                if (numEvents > queue.maxNumEvents)
-                {
-                    numEvents = queue.maxNumEvents;
-                    owner.registerXRun();
-                }
-
-                for (uint32_t i = 0; i < numEvents; ++i)
-                {
-                    auto& event = queue.getEvent (i);
-                    event.type  = getEventTypeIndex (i);
-                    event.frame = readOutputEvent (i, event.data);
-                }
+            CMAJ_ASSERT (readOutputEvents);
 
-                queue.numEvents = numEvents;
-                resetEventCount();
-            }
-            else
-            {
+            if (! appendToQueue)
                 queue.numEvents = 0;
-            }
-        }
-
-        struct OutputEventQueue
-        {
-            struct Event
-            {
-                uint32_t frame = 0, type = 0;
-                uint64_t data[1];
-            };
-
-            void initialise (const EndpointDetails& details, uint32_t maxNumEventsToUse)
-            {
-                numEvents = 0;
-                maxNumEvents = maxNumEventsToUse;
-                size_t maxEventDataSize = 0;
-
-                for (auto& t : details.dataTypes)
-                {
-                    auto size = t.getValueDataSize();
-                    maxEventDataSize = std::max (maxEventDataSize, size);
-                    eventSizes.push_back (static_cast<uint32_t> (size));
-                }
-
-                eventStride = ((sizeof (Event) + maxEventDataSize) + 7u) & ~7u;
-                eventSpace.resize (maxNumEvents * eventStride);
-            }
-
-            Event& getEvent (size_t index) noexcept
-            {
-                return *reinterpret_cast<Event*> (eventSpace.data() + eventStride * index);
-            }
 
-            uint32_t numEvents = 0;
-            uint32_t maxNumEvents = 0;
-
-            std::vector<uint32_t> eventSizes;
-
-        private:
-            size_t eventStride = 0;
-            std::vector<uint8_t> eventSpace;
-        };
+            if (readOutputEvents (queue, frameOffset) != 0)
+                owner.registerXRun();
+        }
 
         PerformerBase& owner;
         EndpointHandle handle;
         OutputEventQueue queue;
-
-        std::function<uint32_t()>                 getNumOutputEvents;
-        std::function<uint32_t(uint32_t)>         getEventTypeIndex;
-        std::function<uint32_t(uint32_t, void*)>  readOutputEvent;
-        std::function<void()>                     resetEventCount;
+        ReadOutputEventsThunk readOutputEvents;
     };
 
     //==============================================================================
     std::vector<std::unique_ptr<EndpointHandler>> endpointHandlers;
     uint32_t firstHandle = 0, lastHandle = 0;
     std::vector<OutputEventHandler*> outputEventHandlers;
+    std::vector<InputStreamHandler*> inputStreamHandlers;
+    std::vector<OutputStreamOrValueHandler*> outputStreamHandlers;
 
     EndpointHandler* getEndpointHandler (EndpointHandle handle)
     {
@@ -95,6 +95,7 @@ struct DummyEngineFactory  : public choc::com::ObjectWithAtomicRefCount<EngineFa
         static bool engineSupportsIntrinsic (AST::Intrinsic::Type) { return true; }
 
         static std::string getEngineVersion()   { return "dummy"; }
+        static std::string getTargetDescription()   { return {}; }
 
         struct LinkedCode { LinkedCode (const DummyEngine&, uint32_t, double, CacheDatabaseInterface*, const char*) {} static constexpr double latency = 0; };
         struct JITInstance { JITInstance (std::shared_ptr<LinkedCode>, int32_t, double) {} };
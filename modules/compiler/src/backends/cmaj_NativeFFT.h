@@ -0,0 +1,432 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "../AST/cmaj_AST.h"
+
+namespace cmaj
+{
+
+//==============================================================================
+/// Native implementations of the FFT functions in std::frequency, which a JIT
+/// backend can call instead of compiling the generic library code.
+///
+/// The library versions are recursive and copy their data into temporary arrays at
+/// every level. These are iterative in-place radix-2 transforms which use tables of
+/// twiddle factors and bit-reversed indexes that are built once for each size, and
+/// the real-only functions are done with a complex transform of half the size. The
+/// results have the same layout and scaling as the library versions.
+///
+template <typename FloatType>
+struct NativeFFT
+{
+    /// This has the same layout as the structs that complex32 and complex64 are converted to
+    struct Complex
+    {
+        FloatType real, imag;
+    };
+
+    using ComplexFunction = void(*)(Complex*);
+    using RealFunction    = void(*)(const FloatType*, FloatType*);
+
+    static constexpr uint32_t minOrder = 2, maxOrder = 16;
+
+    /// These return a function for the given power-of-2 size, or nullptr if the size is
+    /// out of range. Getting a function also builds the tables that it needs, so this
+    /// may allocate, but calling the function won't.
+    static ComplexFunction getComplexFFT (uint32_t size)    { return getFunction<ComplexFunction> (size, 0, Functions<>::complexFFT); }
+    static ComplexFunction getComplexIFFT (uint32_t size)   { return getFunction<ComplexFunction> (size, 0, Functions<>::complexIFFT); }
+    static RealFunction getRealForwardFFT (uint32_t size)   { return getFunction<RealFunction> (size, 1, Functions<>::realForwardFFT); }
+    static RealFunction getRealInverseFFT (uint32_t size)   { return getFunction<RealFunction> (size, 1, Functions<>::realInverseFFT); }
+
+private:
+    //==============================================================================
+    struct Plan
+    {
+        Plan (uint32_t order) : size (1u << order)
+        {
+            bitReversedIndexes.resize (size);
+
+            for (uint32_t i = 0; i < size; ++i)
+            {
+                uint32_t reversed = 0;
+
+                for (uint32_t bit = 0; bit < order; ++bit)
+                    if ((i & (1u << bit)) != 0)
+                        reversed |= 1u << (order - 1 - bit);
+
+                bitReversedIndexes[i] = reversed;
+            }
+
+            // The first stage doesn't need any twiddles, and the ones for each later stage
+            // follow each other so that a stage reads its own ones contiguously
+            for (uint32_t half = 2; half < size; half *= 2)
+                for (uint32_t k = 0; k < half; ++k)
+                    twiddles.push_back (getTwiddle (k, half * 2));
+
+            // These are used to split and merge the real transform that is twice this size
+            for (uint32_t k = 0; k <= size; ++k)
+                realTwiddles.push_back (getTwiddle (k, size * 2));
+        }
+
+        static Complex getTwiddle (uint32_t index, uint32_t length)
+        {
+            auto angle = -2.0 * 3.141592653589793238 * index / length;
+            return { static_cast<FloatType> (std::cos (angle)), static_cast<FloatType> (std::sin (angle)) };
+        }
+
+        void forward (Complex* data) const
+        {
+            for (uint32_t i = 0; i < size; ++i)
+                if (auto j = bitReversedIndexes[i]; i < j)
+                    std::swap (data[i], data[j]);
+
+            for (uint32_t i = 0; i < size; i += 2)
+            {
+                auto a = data[i], b = data[i + 1];
+                data[i]     = { a.real + b.real, a.imag + b.imag };
+                data[i + 1] = { a.real - b.real, a.imag - b.imag };
+            }
+
+            auto w = twiddles.data();
+
+            for (uint32_t half = 2; half < size; half *= 2)
+            {
+                for (uint32_t start = 0; start < size; start += half * 2)
+                {
+                    auto lower = data + start;
+                    auto upper = lower + half;
+
+                    for (uint32_t k = 0; k < half; ++k)
+                    {
+                        auto t = multiply (w[k], upper[k]);
+                        upper[k] = { lower[k].real - t.real, lower[k].imag - t.imag };
+                        lower[k] = { lower[k].real + t.real, lower[k].imag + t.imag };
+                    }
+                }
+
+                w += half;
+            }
+        }
+
+        void inverse (Complex* data) const
+        {
+            for (uint32_t i = 0; i < size; ++i)
+                data[i].imag = -data[i].imag;
+
+            forward (data);
+
+            auto scale = static_cast<FloatType> (1) / static_cast<FloatType> (size);
+
+            for (uint32_t i = 0; i < size; ++i)
+                data[i] = { data[i].real * scale, -data[i].imag * scale };
+        }
+
+        // Takes 2 * size real values, treats them as a complex array of half the length,
+        // and then untangles the result into the spectrum of the real signal
+        void realForward (const FloatType* input, FloatType* output) const
+        {
+            std::memmove (output, input, sizeof (FloatType) * 2 * size);
+            auto z = reinterpret_cast<Complex*> (output);
+            forward (z);
+
+            // bins 0 and N/2 are both real, so they're packed into the first element
+            auto z0 = z[0];
+            z[0] = { z0.real + z0.imag, z0.real - z0.imag };
+
+            for (uint32_t k = 1; k <= size / 2; ++k)
+            {
+                auto a = z[k], b = z[size - k];
+                z[k]        = mergeRealSpectrum (a, b, realTwiddles[k]);
+                z[size - k] = mergeRealSpectrum (b, a, realTwiddles[size - k]);
+            }
+
+            // Going from [re0, reN/2, re1, im1, re2, im2...] to the library's
+            // [re0, re1... reN/2, im1, im2...] order is just a de-interleave
+            deinterleave (output, size);
+        }
+
+        void realInverse (const FloatType* input, FloatType* output) const
+        {
+            std::memmove (output, input, sizeof (FloatType) * 2 * size);
+            interleave (output, size);
+            auto z = reinterpret_cast<Complex*> (output);
+
+            auto x0 = z[0];
+            z[0] = { (x0.real + x0.imag) * static_cast<FloatType> (0.5),
+                     (x0.real - x0.imag) * static_cast<FloatType> (0.5) };
+
+            for (uint32_t k = 1; k <= size / 2; ++k)
+            {
+                auto a = z[k], b = z[size - k];
+                z[k]        = splitRealSpectrum (a, b, realTwiddles[k]);
+                z[size - k] = splitRealSpectrum (b, a, realTwiddles[size - k]);
+            }
+
+            // the real output samples are the interleaved real and imaginary parts
+            inverse (z);
+        }
+
+        static Complex multiply (Complex a, Complex b)
+        {
+            return { a.real * b.real - a.imag * b.imag,
+                     a.real * b.imag + a.imag * b.real };
+        }
+
+        // Given Z[k], Z[N/2 - k] of the half-length transform, returns X[k] of the real one
+        static Complex mergeRealSpectrum (Complex zk, Complex zOther, Complex w)
+        {
+            auto half = static_cast<FloatType> (0.5);
+            Complex even { (zk.real + zOther.real) * half, (zk.imag - zOther.imag) * half };
+            Complex odd  { (zk.imag + zOther.imag) * half, (zOther.real - zk.real) * half };
+            auto t = multiply (w, odd);
+            return { even.real + t.real, even.imag + t.imag };
+        }
+
+        // The inverse of mergeRealSpectrum: given X[k], X[N/2 - k], returns Z[k]
+        static Complex splitRealSpectrum (Complex xk, Complex xOther, Complex w)
+        {
+            auto half = static_cast<FloatType> (0.5);
+            Complex even { (xk.real + xOther.real) * half, (xk.imag - xOther.imag) * half };
+            auto odd = multiply ({ (xk.real - xOther.real) * half, (xk.imag + xOther.imag) * half },
+                                 { w.real, -w.imag });
+            return { even.real - odd.imag, even.imag + odd.real };
+        }
+
+        // Turns [a0, b0, a1, b1...] into [a0, a1... b0, b1...] without needing any
+        // temporary storage, by de-interleaving each half and then swapping the middle blocks
+        static void deinterleave (FloatType* data, uint32_t numPairs)
+        {
+            if (numPairs < 2)
+                return;
+
+            auto firstHalf = numPairs / 2;
+            deinterleave (data, firstHalf);
+            deinterleave (data + firstHalf * 2, numPairs - firstHalf);
+            std::rotate (data + firstHalf, data + firstHalf * 2, data + firstHalf + numPairs);
+        }
+
+        static void interleave (FloatType* data, uint32_t numPairs)
+        {
+            if (numPairs < 2)
+                return;
+
+            auto firstHalf = numPairs / 2;
+            std::rotate (data + firstHalf, data + numPairs, data + numPairs + firstHalf);
+            interleave (data, firstHalf);
+            interleave (data + firstHalf * 2, numPairs - firstHalf);
+        }
+
+        const uint32_t size;
+        std::vector<uint32_t> bitReversedIndexes;
+        std::vector<Complex> twiddles, realTwiddles;
+    };
+
+    //==============================================================================
+    struct PlanList
+    {
+        std::mutex lock;
+        std::array<std::unique_ptr<Plan>, maxOrder + 1> plans;
+        std::array<std::atomic<const Plan*>, maxOrder + 1> readyPlans {};
+    };
+
+    static PlanList& getPlanList()
+    {
+        static PlanList list;
+        return list;
+    }
+
+    static void preparePlan (uint32_t order)
+    {
+        auto& list = getPlanList();
+        std::lock_guard<std::mutex> l (list.lock);
+
+        if (list.plans[order] == nullptr)
+        {
+            list.plans[order] = std::make_unique<Plan> (order);
+            list.readyPlans[order].store (list.plans[order].get(), std::memory_order_release);
+        }
+    }
+
+    static const Plan& getPlan (uint32_t order)
+    {
+        return *getPlanList().readyPlans[order].load (std::memory_order_acquire);
+    }
+
+    // Each size gets its own entry point, because the native functions take the same
+    // arguments as the Cmajor ones, which don't include the size
+    template <typename Indexes = std::make_index_sequence<maxOrder + 1 - minOrder>>
+    struct Functions;
+
+    template <size_t... indexes>
+    struct Functions<std::index_sequence<indexes...>>
+    {
+        template <uint32_t order> static void performComplexFFT (Complex* data)                       { getPlan (order).forward (data); }
+        template <uint32_t order> static void performComplexIFFT (Complex* data)                      { getPlan (order).inverse (data); }
+        template <uint32_t order> static void performRealForwardFFT (const FloatType* in, FloatType* out)  { getPlan (order - 1).realForward (in, out); }
+        template <uint32_t order> static void performRealInverseFFT (const FloatType* in, FloatType* out)  { getPlan (order - 1).realInverse (in, out); }
+
+        static constexpr ComplexFunction complexFFT[]     = { performComplexFFT<minOrder + indexes>... };
+        static constexpr ComplexFunction complexIFFT[]    = { performComplexIFFT<minOrder + indexes>... };
+        static constexpr RealFunction    realForwardFFT[] = { performRealForwardFFT<minOrder + indexes>... };
+        static constexpr RealFunction    realInverseFFT[] = { performRealInverseFFT<minOrder + indexes>... };
+    };
+
+    template <typename FunctionType>
+    static FunctionType getFunction (uint32_t size, uint32_t planOrderOffset, const FunctionType* functions)
+    {
+        for (uint32_t order = minOrder; order <= maxOrder; ++order)
+        {
+            if (size == (1u << order))
+            {
+                preparePlan (order - planOrderOffset);
+                return functions[order - minOrder];
+            }
+        }
+
+        return {};
+    }
+};
+
+//==============================================================================
+/// Looks for specialised versions of the std::frequency FFT functions in a program, and
+/// registers native implementations for the ones whose argument types are suitable.
+/// Any others are left alone, so will be compiled from the library code as normal.
+inline void addNativeFFTFunctions (AST::Program& program, AST::ExternalFunctionManager& externalFunctionManager)
+{
+    auto& root = program.rootNamespace;
+    auto stdNamespace = root.findSystemChildNamespace (root.getStrings().stdLibraryNamespaceName);
+
+    if (stdNamespace == nullptr)
+        return;
+
+    auto frequencyNamespace = stdNamespace->findSystemChildNamespace (root.getStringPool().get ("frequency"));
+
+    if (frequencyNamespace == nullptr)
+        return;
+
+    struct ArrayDetails
+    {
+        uint32_t size = 0;
+        bool isComplex = false, is64Bit = false;
+
+        bool operator== (const ArrayDetails& other) const
+        {
+            return size == other.size && isComplex == other.isComplex && is64Bit == other.is64Bit;
+        }
+    };
+
+    auto getArrayDetails = [] (const AST::TypeBase& paramType) -> std::optional<ArrayDetails>
+    {
+        auto& type = paramType.skipConstAndRefModifiers();
+
+        if (! type.isFixedSizeArray())
+            return {};
+
+        auto elementType = type.getArrayOrVectorElementType();
+
+        if (elementType == nullptr)
+            return {};
+
+        auto size = type.getFixedSizeAggregateNumElements();
+
+        if (elementType->isPrimitiveFloat32())  return ArrayDetails { size, false, false };
+        if (elementType->isPrimitiveFloat64())  return ArrayDetails { size, false, true };
+
+        // complex types will have been converted to structs with two float members
+        if (auto s = elementType->skipConstAndRefModifiers().getAsStructType())
+        {
+            if (s->memberNames.size() == 2
+                 && s->getMemberName (0) == s->getStrings().real
+                 && s->getMemberName (1) == s->getStrings().imag)
+            {
+                auto& realType = s->getMemberType (0);
+                auto& imagType = s->getMemberType (1);
+
+                if (realType.isPrimitiveFloat32() && imagType.isPrimitiveFloat32())  return ArrayDetails { size, true, false };
+                if (realType.isPrimitiveFloat64() && imagType.isPrimitiveFloat64())  return ArrayDetails { size, true, true };
+            }
+        }
+
+        return {};
+    };
+
+    auto findNativeFunction = [&] (const AST::Function& f) -> void*
+    {
+        auto paramTypes = f.getParameterTypes();
+        auto name = f.getOriginalName();
+
+        if (name == "complexFFT" || name == "complexIFFT")
+        {
+            if (paramTypes.size() != 1)
+                return {};
+
+            auto array = getArrayDetails (paramTypes.front());
+
+            if (! (array && array->isComplex))
+                return {};
+
+            bool isInverse = (name == "complexIFFT");
+
+            if (array->is64Bit)
+                return (void*) (isInverse ? NativeFFT<double>::getComplexIFFT (array->size) : NativeFFT<double>::getComplexFFT (array->size));
+
+            return (void*) (isInverse ? NativeFFT<float>::getComplexIFFT (array->size) : NativeFFT<float>::getComplexFFT (array->size));
+        }
+
+        if (name == "realOnlyForwardFFT" || name == "realOnlyInverseFFT")
+        {
+            if (paramTypes.size() != 2)
+                return {};
+
+            auto input = getArrayDetails (paramTypes[0]);
+            auto output = getArrayDetails (paramTypes[1]);
+
+            if (! (input && output && *input == *output && ! input->isComplex))
+                return {};
+
+            bool isInverse = (name == "realOnlyInverseFFT");
+
+            if (input->is64Bit)
+                return (void*) (isInverse ? NativeFFT<double>::getRealInverseFFT (input->size) : NativeFFT<double>::getRealForwardFFT (input->size));
+
+            return (void*) (isInverse ? NativeFFT<float>::getRealInverseFFT (input->size) : NativeFFT<float>::getRealForwardFFT (input->size));
+        }
+
+        return {};
+    };
+
+    for (auto& f : frequencyNamespace->functions.iterateAs<AST::Function>())
+        if (f.isSpecialisedGeneric())
+            if (auto nativeFunction = findNativeFunction (f))
+                externalFunctionManager.addFunctionWithImplementation (f, nativeFunction);
+}
+
+} // namespace cmaj
@@ -0,0 +1,108 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+namespace cmaj
+{
+
+//==============================================================================
+/// A plain function pointer and a context pointer, which is what the performer's
+/// endpoint handlers use to call into a JIT instance.
+///
+/// Unlike a std::function it's trivially copyable, never allocates, and calling it
+/// is a single call through a plain function pointer. The context objects are owned
+/// by a PerformerThunkContexts list, which must outlive the thunks that refer to it.
+template <typename Signature>
+struct PerformerThunk;
+
+template <typename ReturnType, typename... Args>
+struct PerformerThunk<ReturnType(Args...)>
+{
+    using FunctionType = ReturnType(*)(void* context, Args...);
+
+    FunctionType function = nullptr;
+    void* context = nullptr;
+
+    ReturnType operator() (Args... args) const      { return function (context, args...); }
+    explicit operator bool() const                  { return function != nullptr; }
+
+    /// Creates a thunk that calls a static function, passing it the given context object
+    /// as its first argument.
+    template <auto staticFunction, typename Context>
+    static PerformerThunk bind (Context& c)
+    {
+        return { [] (void* contextPointer, Args... args) -> ReturnType { return staticFunction (*static_cast<Context*> (contextPointer), args...); },
+                 std::addressof (c) };
+    }
+};
+
+//==============================================================================
+/// Owns the context objects that a set of PerformerThunks refer to.
+struct PerformerThunkContexts
+{
+    template <typename Context>
+    std::decay_t<Context>& add (Context&& c)
+    {
+        auto context = std::make_shared<std::decay_t<Context>> (std::forward<Context> (c));
+        auto& result = *context;
+        contexts.push_back (std::move (context));
+        return result;
+    }
+
+    /// Takes ownership of a lambda or functor, and returns a thunk that calls it
+    template <typename Signature, typename Functor>
+    PerformerThunk<Signature> create (Functor&& f)
+    {
+        return createThunk<Functor> (static_cast<Signature*> (nullptr), std::forward<Functor> (f));
+    }
+
+private:
+    std::vector<std::shared_ptr<void>> contexts;
+
+    template <typename Functor, typename ReturnType, typename... Args>
+    PerformerThunk<ReturnType(Args...)> createThunk (ReturnType(*)(Args...), Functor&& f)
+    {
+        using FunctorType = std::decay_t<Functor>;
+        auto& functor = add (std::forward<Functor> (f));
+
+        return { [] (void* contextPointer, Args... args) -> ReturnType { return (*static_cast<FunctorType*> (contextPointer)) (args...); },
+                 std::addressof (functor) };
+    }
+};
+
+//==============================================================================
+/// Describes how a performer should move the frames of a stream endpoint in or out
+/// of a JIT instance. When the JIT's native frame layout is identical to the packed
+/// layout that the API uses, it provides the address of its frame buffer so that the
+/// performer can copy the data directly. Otherwise, it provides a thunk to do the
+/// conversion.
+template <typename ConvertFunctionSignature>
+struct StreamFrameAccessor
+{
+    uint8_t* frames = nullptr;
+    uint32_t frameSize = 0;
+    PerformerThunk<ConvertFunctionSignature> convertFrames;
+};
+
+} // namespace cmaj
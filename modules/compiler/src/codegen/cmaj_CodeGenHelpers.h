@@ -268,6 +268,15 @@ struct CompilePerformanceTimes
 
     std::vector<Category> categories;
 
+    /// Timings for parts of a category that ran in parallel (e.g. the partitions of
+    /// a concurrent JIT build), which are listed separately and not added to the total
+    std::vector<std::pair<std::string, Seconds>> parallelTasks;
+
+    void addParallelTask (std::string name, Seconds time)
+    {
+        parallelTasks.emplace_back (std::move (name), time);
+    }
+
     std::string getResults()
     {
         if (categories.empty())
@@ -282,8 +291,20 @@ struct CompilePerformanceTimes
             total += c.result;
         }
 
-        return "Total build time: " + choc::text::getDurationDescription (total) + "\n"
-                + choc::text::joinStrings (results, ", ");
+        auto log = "Total build time: " + choc::text::getDurationDescription (total) + "\n"
+                     + choc::text::joinStrings (results, ", ");
+
+        if (! parallelTasks.empty())
+        {
+            std::vector<std::string> taskTimes;
+
+            for (auto& t : parallelTasks)
+                taskTimes.push_back (t.first + ": " + choc::text::getDurationDescription (t.second));
+
+            log += "\nParallel tasks: " + choc::text::joinStrings (taskTimes, ", ");
+        }
+
+        return log;
     }
 
     struct PerformanceCounter
@@ -785,7 +785,7 @@ private:
 
         // if we've got an aggregate that resolves to a slice, a null value would
         // throw away its original size
-        if (value.isZero() && ! (type.isSlice() && value.isConstantAggregate()))
+        if (value.isZero() && ! (type.isSlice() && (value.isConstantAggregate() || value.isConstantPackedArray())))
             return createNullConstantReader (type);
 
         if (auto p = type.getAsPrimitiveType())
@@ -803,6 +803,9 @@ private:
         if (auto agg = value.getAsConstantAggregate())
             return builder.createConstantAggregate (*agg);
 
+        if (auto packed = value.getAsConstantPackedArray())
+            return builder.createConstantPackedArray (*packed);
+
         if (auto e = value.getAsConstantEnum())
             return builder.createConstantInt32 (static_cast<int32_t> (e->index.get()));
 
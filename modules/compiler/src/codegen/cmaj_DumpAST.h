@@ -81,6 +81,7 @@ inline std::string dumpAST (AST::Object& object)
             if (auto p = property.getAsFloatProperty())        { out << choc::text::floatToString (p->get()); return; }
             if (auto p = property.getAsBoolProperty())         { out << (p->get() ? "true" : "false"); return; }
             if (auto p = property.getAsEnumProperty())         { out << p->getEnumString(); return; }
+            if (auto p = property.getAsDataProperty())         { out << '<' << p->getDescription() << '>'; return; }
 
             if (auto p = property.getAsObjectProperty())
             {
@@ -98,6 +98,35 @@ struct NativeTypeLayout
         return getNativeSize();
     }
 
+    /// Describes the layout as a list of chunks, so that a performer library's loader
+    /// can convert data without needing the AST. The chunks are only included if the
+    /// layout requires packing.
+    choc::value::Value toJSON() const
+    {
+        auto result = choc::value::createObject ({},
+                                                 "nativeSize", static_cast<int32_t> (getNativeSize()),
+                                                 "packedSize", static_cast<int32_t> (type.toChocType().getValueDataSize()));
+
+        if (requiresPacking())
+        {
+            auto chunkList = choc::value::createEmptyArray();
+
+            for (auto& c : chunks)
+            {
+                auto chunk = choc::value::createEmptyArray();
+                chunk.addArrayElement (static_cast<int32_t> (c.packedOffset));
+                chunk.addArrayElement (static_cast<int32_t> (c.nativeOffset));
+                chunk.addArrayElement (static_cast<int32_t> (c.numBytes));
+                chunk.addArrayElement (static_cast<int32_t> (c.numBits));
+                chunkList.addArrayElement (chunk);
+            }
+
+            result.setMember ("chunks", chunkList);
+        }
+
+        return result;
+    }
+
     const AST::TypeBase& type;
 
 private:
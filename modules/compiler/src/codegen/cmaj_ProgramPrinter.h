@@ -1028,6 +1028,19 @@ private:
                     .addPunctuation (" ")
                     .add (formatExpressionList (a->values.getAsObjectList()).addParensAlways());
 
+        if (auto a = e.getAsConstantPackedArray())
+        {
+            AST::ObjectRefVector<const AST::Object> elements;
+            elements.reserve (a->getNumElements());
+
+            for (uint32_t i = 0; i < a->getNumElements(); ++i)
+                elements.push_back (*a->getAggregateElementValue (i));
+
+            return formatExpression (a->type)
+                    .addPunctuation (" ")
+                    .add (formatExpressionList (elements).addParensAlways());
+        }
+
         if (auto c = e.getAsCast())
             return formatExpression (c->targetType)
                     .add (formatExpressionList (c->arguments).addParensAlways());
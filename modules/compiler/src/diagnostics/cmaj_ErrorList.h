@@ -365,6 +365,7 @@ DECL_COMPILE_ERROR (unsupportedSampleRate,                  "Unsupported sample
 DECL_COMPILE_ERROR (failedToCompile,                        "Failed to compile {0}")
 DECL_COMPILE_ERROR (failedToLink,                           "Failed to link {0}")
 DECL_COMPILE_ERROR (failedToJit,                            "Failed to construct jit {0}")
+DECL_COMPILE_ERROR (unknownTargetCPU,                       "Unknown target CPU '{0}'")
 
 // Warnings
 DECL_WARNING (indexHasRuntimeOverhead,                      "Performance warning: using an array index of type 'int' will add a runtime range check. To avoid this, use a `wrap<>` or `clamp<>` type for the index. To hide this warning, use .at() instead of []")
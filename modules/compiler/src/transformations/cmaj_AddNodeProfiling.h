@@ -0,0 +1,109 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+namespace cmaj::transformations
+{
+
+//==============================================================================
+/// Lets FlattenGraph count the CPU cycles spent in each node of the main graph.
+///
+/// The graph gets a state array holding a pair of int64 counters for each node: the
+/// total number of cycles spent in its run function, and the number of times it was
+/// called. Each node's run call (including the loop for a node array) is wrapped like
+/// this:
+///
+///     {
+///         let _profileStart = readCycleCounter();
+///         run (state, io);
+///         _profileCounters[n * 2] += readCycleCounter() - _profileStart;
+///         ++_profileCounters[n * 2 + 1];
+///     }
+///
+/// The node names are added to Program::profiledNodeNames in the same order, so that
+/// the performer can find the counters in the state and label them.
+///
+/// This is opt-in, and only enabled when BuildSettings::shouldProfileNodes() is set.
+struct NodeProfiler
+{
+    NodeProfiler (AST::Program& program, AST::ProcessorBase& graph, const std::vector<const AST::GraphNode*>& nodes)
+        : readCycleCounter (getOrCreateReadCycleCounterFunction (program.rootNamespace))
+    {
+        for (auto node : nodes)
+        {
+            if (node->getProcessorType()->findMainFunction() != nullptr)
+            {
+                nodeIndexes[node] = static_cast<int32_t> (program.profiledNodeNames.size());
+                program.profiledNodeNames.push_back (std::string (node->getName()));
+            }
+        }
+
+        auto numCounters = std::max (static_cast<int32_t> (nodeIndexes.size() * 2), 2);
+
+        counters = AST::createStateVariable (graph, getNodeProfileCountersName(),
+                                             AST::createArrayOfType (graph, graph.context.allocator.int64Type, numCounters), {});
+    }
+
+    /// Calls addRunCall to add the node's run call to the block, wrapped in the counter updates
+    template <typename AddRunCallFn>
+    void addProfiledRunCall (AST::ScopeBlock& block, const AST::GraphNode& node, AddRunCallFn&& addRunCall)
+    {
+        auto index = nodeIndexes.find (std::addressof (node));
+
+        if (index == nodeIndexes.end())
+            return addRunCall (block);
+
+        auto& nodeBlock = block.allocateChild<AST::ScopeBlock>();
+        auto& startTime = AST::createLocalVariableRef (nodeBlock, "_profileStart", AST::createFunctionCall (nodeBlock, *readCycleCounter));
+
+        addRunCall (nodeBlock);
+
+        auto getCounter = [&] (int32_t offset) -> AST::ValueBase&
+        {
+            return AST::createGetElement (nodeBlock, AST::createVariableReference (nodeBlock.context, *counters), index->second * 2 + offset);
+        };
+
+        auto& elapsed = AST::createSubtract (nodeBlock, AST::createFunctionCall (nodeBlock, *readCycleCounter), startTime);
+        AST::addAssignment (nodeBlock, getCounter (0), AST::createAdd (nodeBlock, getCounter (0), elapsed));
+        nodeBlock.addStatement (AST::createPreInc (nodeBlock.context, getCounter (1)));
+
+        block.addStatement (nodeBlock);
+    }
+
+private:
+    ptr<AST::Function> readCycleCounter;
+    ptr<AST::VariableDeclaration> counters;
+    std::unordered_map<const AST::GraphNode*, int32_t> nodeIndexes;
+
+    /// The intrinsic has no library declaration, so it's added on demand. Backends that
+    /// can't read a cycle counter fall back to this body, which returns 0.
+    static AST::Function& getOrCreateReadCycleCounterFunction (AST::Namespace& rootNamespace)
+    {
+        auto& intrinsicsNamespace = *findIntrinsicsNamespace (rootNamespace);
+        auto name = intrinsicsNamespace.getStringPool().get (AST::Intrinsic::getIntrinsicName (AST::Intrinsic::Type::readCycleCounter));
+
+        if (auto f = intrinsicsNamespace.findFunction (name, 0))
+            return *f;
+
+        auto& allocator = intrinsicsNamespace.context.allocator;
+        auto& f = AST::createFunctionInModule (intrinsicsNamespace, allocator.int64Type, name);
+        AST::addReturnStatement (*f.getMainBlock(), allocator.createConstantInt64 (0));
+        return f;
+    }
+};
+
+}
@@ -20,11 +20,203 @@ namespace cmaj::transformations
 {
 
 //==============================================================================
-inline void addSparseStreamSupport (AST::Program& program)
+/// Lets FlattenGraph put graph nodes to sleep while they're silent.
+///
+/// A node can sleep if it has at least one input stream, and all of its outputs are
+/// streams of primitive or small vector/array types. It gets a state counter holding
+/// the number of consecutive frames for which all of its input and output streams have
+/// been silent, and once that reaches the settle time, its run function is skipped
+/// (leaving its outputs at zero) until an input stream becomes non-silent or one of
+/// its event handlers is called. (Changes to its input values don't wake it up).
+///
+/// Because a node could have internal state that stays inaudible for longer than the
+/// settle time (e.g. a long delay line), this is opt-in, and only enabled when the
+/// BuildSettings provide a non-zero settle time.
+struct SparseStreamSupport
 {
-    auto& mainProcessor = program.getMainProcessor();
+    static constexpr double silenceThreshold = 1.0e-6;
+    static constexpr uint32_t maxElementsToTest = 16;
 
-    (void) mainProcessor;
+    static bool canNodeSleep (const AST::GraphNode& node)
+    {
+        auto& processor = *node.getProcessorType();
+        auto ioStruct = processor.findStruct (processor.getStrings().ioStructName);
+
+        if (ioStruct == nullptr)
+            return false;
+
+        bool hasInputStream = false, hasOutputStream = false;
+
+        for (auto& endpoint : processor.endpoints.iterateAs<AST::EndpointDeclaration>())
+        {
+            if (endpoint.isStream())
+            {
+                auto memberIndex = ioStruct->indexOfMember (StreamUtilities::getEndpointStateMemberName (endpoint));
+
+                if (memberIndex < 0 || ! canTestForSilence (ioStruct->getMemberType (static_cast<size_t> (memberIndex))))
+                    return false;
+
+                if (endpoint.isInput)
+                    hasInputStream = true;
+                else
+                    hasOutputStream = true;
+            }
+            else if (! endpoint.isInput)
+            {
+                return false;
+            }
+        }
+
+        return hasInputStream && hasOutputStream;
+    }
+
+    static AST::VariableDeclaration& createSilentFrameCounter (AST::ProcessorBase& graph, const AST::GraphNode& node)
+    {
+        auto& int32Type = graph.context.allocator.int32Type;
+        auto name = std::string (node.getName()) + "_silentFrames";
+
+        if (auto arraySize = node.getArraySize())
+            return AST::createStateVariable (graph, name, AST::createArrayOfType (graph, int32Type, *arraySize), {});
+
+        return AST::createStateVariable (graph, name, int32Type, {});
+    }
+
+    static void addCounterReset (AST::ScopeBlock& block, AST::ValueBase& silentFrameCounter)
+    {
+        AST::addAssignment (block, silentFrameCounter, block.context.allocator.createConstantInt32 (0));
+    }
+
+    static ptr<AST::ValueBase> createSilenceTest (AST::ScopeBlock& block, AST::ValueBase& ioVariable,
+                                                  const AST::ProcessorBase& processor, bool testInputs)
+    {
+        auto ioStruct = processor.findStruct (processor.getStrings().ioStructName);
+        ptr<AST::ValueBase> result;
+
+        for (auto& endpoint : processor.endpoints.iterateAs<AST::EndpointDeclaration>())
+        {
+            if (endpoint.isStream() && endpoint.isInput == testInputs)
+            {
+                auto memberName = StreamUtilities::getEndpointStateMemberName (endpoint);
+                auto& memberType = ioStruct->getMemberType (static_cast<size_t> (ioStruct->indexOfMember (memberName)));
+
+                auto& test = createSilenceTest (block, memberType, [&] () -> AST::ValueBase&
+                {
+                    return AST::createGetStructMember (block, ioVariable, memberName);
+                });
+
+                result = combine (block, result, test);
+            }
+        }
+
+        return result;
+    }
+
+private:
+    using GetValueFn = std::function<AST::ValueBase&()>;
+
+    static bool canTestForSilence (const AST::TypeBase& type)
+    {
+        if (type.isPrimitiveFloat() || type.isPrimitiveInt())
+            return true;
+
+        if (type.isVector() || type.isFixedSizeArray())
+            return type.getArrayOrVectorSize (0) <= maxElementsToTest
+                    && canTestForSilence (*type.getArrayOrVectorElementType());
+
+        return false;
+    }
+
+    static AST::ValueBase& combine (AST::ScopeBlock& block, ptr<AST::ValueBase> lhs, AST::ValueBase& rhs)
+    {
+        if (lhs == nullptr)
+            return rhs;
+
+        return AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::logicalAnd, *lhs, rhs);
+    }
+
+    static AST::ValueBase& createSilenceTest (AST::ScopeBlock& block, const AST::TypeBase& type, const GetValueFn& getValue)
+    {
+        auto& allocator = block.context.allocator;
+
+        if (type.isPrimitiveFloat())
+        {
+            auto& threshold = type.isPrimitiveFloat32() ? static_cast<AST::ValueBase&> (allocator.createConstantFloat32 (static_cast<float> (silenceThreshold)))
+                                                        : static_cast<AST::ValueBase&> (allocator.createConstantFloat64 (silenceThreshold));
+
+            auto& minusThreshold = type.isPrimitiveFloat32() ? static_cast<AST::ValueBase&> (allocator.createConstantFloat32 (-static_cast<float> (silenceThreshold)))
+                                                             : static_cast<AST::ValueBase&> (allocator.createConstantFloat64 (-silenceThreshold));
+
+            return AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::logicalAnd,
+                                        AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::lessThanOrEqual, getValue(), threshold),
+                                        AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::greaterThanOrEqual, getValue(), minusThreshold));
+        }
+
+        if (type.isPrimitiveInt())
+            return AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::equals, getValue(), type.allocateConstantValue (block.context));
+
+        CMAJ_ASSERT (type.isVector() || type.isFixedSizeArray());
+
+        auto& elementType = *type.getArrayOrVectorElementType();
+        auto numElements = static_cast<int32_t> (type.getArrayOrVectorSize (0));
+        ptr<AST::ValueBase> result;
+
+        for (int32_t i = 0; i < numElements; ++i)
+        {
+            auto& test = createSilenceTest (block, elementType, [&] () -> AST::ValueBase&
+            {
+                return AST::createGetElement (block, getValue(), i);
+            });
+
+            result = combine (block, result, test);
+        }
+
+        return *result;
+    }
+};
+
+//==============================================================================
+/// Adds a node's run call to the block, guarded so that it's skipped while the node is
+/// asleep, and updates the node's silent frame counter after it runs:
+///
+///     if (! inputsSilent) counter = 0;
+///
+///     if (counter < settleFrames)
+///     {
+///         run (state, io);
+///         counter = (inputsSilent && outputsSilent) ? counter + 1 : 0;
+///     }
+inline void addSparseStreamSupport (AST::ScopeBlock& block, AST::Statement& runCall,
+                                    AST::ValueBase& silentFrameCounter, AST::ValueBase& ioVariable,
+                                    const AST::ProcessorBase& processor, uint32_t settleFrames)
+{
+    auto inputTest = SparseStreamSupport::createSilenceTest (block, ioVariable, processor, true);
+    CMAJ_ASSERT (inputTest != nullptr);
+
+    auto& inputsSilent = AST::createLocalVariableRef (block, "_inputsSilent", *inputTest);
+
+    auto& resetBlock = block.allocateChild<AST::ScopeBlock>();
+    SparseStreamSupport::addCounterReset (resetBlock, silentFrameCounter);
+    block.addStatement (AST::createIfStatement (block.context, AST::createLogicalNot (block.context, inputsSilent), resetBlock));
+
+    auto& runBlock = block.allocateChild<AST::ScopeBlock>();
+    runBlock.addStatement (runCall);
+
+    auto& stillSilent = AST::createBinaryOp (runBlock, AST::BinaryOpTypeEnum::Enum::logicalAnd, inputsSilent,
+                                             *SparseStreamSupport::createSilenceTest (runBlock, ioVariable, processor, false));
+
+    auto& incrementBlock = runBlock.allocateChild<AST::ScopeBlock>();
+    incrementBlock.addStatement (AST::createPreInc (incrementBlock.context, silentFrameCounter));
+
+    auto& resetAfterRunBlock = runBlock.allocateChild<AST::ScopeBlock>();
+    SparseStreamSupport::addCounterReset (resetAfterRunBlock, silentFrameCounter);
+
+    runBlock.addStatement (AST::createIfStatement (runBlock.context, stillSilent, incrementBlock, resetAfterRunBlock));
+
+    block.addStatement (AST::createIfStatement (block.context,
+                                                AST::createBinaryOp (block, AST::BinaryOpTypeEnum::Enum::lessThan,
+                                                                     silentFrameCounter,
+                                                                     block.context.allocator.createConstantInt32 (static_cast<int32_t> (settleFrames))),
+                                                runBlock));
 }
 
 }
@@ -84,8 +84,8 @@ struct BinaryModuleWriter
 
     void write (const void* buffer, size_t size)
     {
-        for (size_t i = 0; i < size; ++i)
-            writeByte (static_cast<const uint8_t*> (buffer)[i]);
+        auto start = static_cast<const uint8_t*> (buffer);
+        data.insert (data.end(), start, start + size);
     }
 
     void writeZeros (uint32_t size)
@@ -171,6 +171,13 @@ struct BinaryModuleWriter
             return;
         }
 
+        if (auto p = prop.getAsDataProperty())
+        {
+            writeCompressedInt (static_cast<int64_t> (p->size()));
+            write (p->getData(), p->size());
+            return;
+        }
+
         if (auto p = prop.getAsListProperty())
         {
             writeCompressedInt (static_cast<int64_t> (p->size()));
@@ -430,6 +437,18 @@ struct BinaryModuleReader
             return;
         }
 
+        if (auto p = prop.getAsDataProperty())
+        {
+            auto numBytes = readCompressedInt();
+
+            if (numBytes < 0 || static_cast<uint64_t> (numBytes) > size)
+                throwError();
+
+            p->set (data, static_cast<size_t> (numBytes));
+            skip (static_cast<size_t> (numBytes));
+            return;
+        }
+
         if (auto p = prop.getAsListProperty())
         {
             auto numItems = readCompressedUInt32();
@@ -575,6 +594,7 @@ struct BinaryModuleReader
             case AST::ChildObject::typeID:        return parentObject.context.allocator.allocate<AST::ChildObject> (parentObject);
             case AST::ObjectReference::typeID:    return parentObject.context.allocator.allocate<AST::ObjectReference> (parentObject);
             case AST::ListProperty::typeID:       return parentObject.context.allocator.allocate<AST::ListProperty> (parentObject);
+            case AST::DataProperty::typeID:       return parentObject.context.allocator.allocate<AST::DataProperty> (parentObject);
             case AST::EnumProperty::typeID:       // there are multiple enum classes, so won't create the base class
             default:                              CMAJ_ASSERT_FALSE;
         }
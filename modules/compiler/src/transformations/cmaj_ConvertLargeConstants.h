@@ -38,12 +38,17 @@ static inline void convertLargeConstantsToGlobals (AST::Program& program)
         AST::Namespace& rootNamespace;
         int insideFunction = 0;
 
-        std::vector<ref<AST::VariableDeclaration>> constants;
+        // the globals created so far, bucketed by a hash of their value's signature
+        std::unordered_map<uint32_t, std::vector<ref<AST::VariableDeclaration>>> constants;
 
         AST::VariableDeclaration& createGlobal (AST::ValueBase& a, const AST::TypeBase& type)
         {
-            for (auto existing : constants)
-                if (existing->isIdentical (a))
+            AST::SignatureBuilder signature;
+            signature << a;
+            auto& constantsWithSameHash = constants[signature.getXXHash()];
+
+            for (auto existing : constantsWithSameHash)
+                if (existing->initialValue.getObjectRef().isIdentical (a))
                     return existing;
 
             auto& gv = rootNamespace.context.allocate<AST::VariableDeclaration>();
@@ -53,7 +58,7 @@ static inline void convertLargeConstantsToGlobals (AST::Program& program)
             gv.variableType = AST::VariableTypeEnum::Enum::state;
             gv.isConstant = true;
 
-            constants.push_back (gv);
+            constantsWithSameHash.push_back (gv);
             return gv;
         }
 
@@ -77,7 +82,8 @@ static inline void convertLargeConstantsToGlobals (AST::Program& program)
                     auto& type = *arg.getResultType();
 
                     if (type.isFixedSizeAggregate())
-                        if (auto a = AST::castToSkippingReferences<AST::ConstantAggregate> (arg))
+                        if (AST::castToSkippingReferences<AST::ConstantAggregate> (arg) != nullptr
+                             || AST::castToSkippingReferences<AST::ConstantPackedArray> (arg) != nullptr)
                             replaceWithGlobal (arg, type);
                 }
             }
@@ -96,6 +102,17 @@ static inline void convertLargeConstantsToGlobals (AST::Program& program)
                 replaceWithGlobal (a, type);
         }
 
+        void visit (AST::ConstantPackedArray& a) override
+        {
+            if (insideFunction == 0)
+                return;
+
+            auto& type = *a.getResultType();
+
+            if (type.isFixedSizeAggregate() && a.getNumElements() > arraySizeToConvertToGlobal)
+                replaceWithGlobal (a, type);
+        }
+
         void replaceWithGlobal (AST::ValueBase& a, const AST::TypeBase& type)
         {
             auto referrersCopy = a.getReferrers();
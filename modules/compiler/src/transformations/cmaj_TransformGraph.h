@@ -24,7 +24,8 @@ struct FlattenGraph
 {
     struct Renderer
     {
-        Renderer (AST::ProcessorBase& g, ProcessorInfo::GetInfo getInfo) : graph (g), getProcessorInfo (getInfo)
+        Renderer (AST::ProcessorBase& g, ProcessorInfo::GetInfo getInfo, uint32_t sparseSettleFrames = 0)
+            : graph (g), getProcessorInfo (getInfo), sparseStreamSettleFrames (sparseSettleFrames)
         {
             initFunction = g.findSystemInitFunction();
             mainFunction = g.findMainFunction();
@@ -181,6 +182,10 @@ struct FlattenGraph
                                        *ioVariable,
                                        mainFunction->context.allocate<AST::ScopeBlock>() };
 
+            if (sparseStreamSettleFrames != 0 && ! useStateForIO && ! isDelayNode (node)
+                 && SparseStreamSupport::canNodeSleep (node))
+                newInstance.silentFrameCounter = SparseStreamSupport::createSilentFrameCounter (graph, node);
+
             nodeInstanceInfoMap[std::addressof (node)] = std::make_unique<InstanceInfo> (std::move (newInstance));
             nodesToRender.push_back (std::addressof (node));
 
@@ -308,6 +313,7 @@ struct FlattenGraph
             ref<AST::VariableReference> stateVariable;
             ref<AST::VariableReference> ioVariable;
             ptr<AST::ScopeBlock> steps;
+            ptr<AST::VariableDeclaration> silentFrameCounter;
             AST::ObjectRefVector<const AST::GraphNode> dependencies;
             AST::ObjectRefVector<const AST::GraphNode> delayDependencies;
             bool hasBeenRun = false;
@@ -548,6 +554,7 @@ struct FlattenGraph
                     auto& indexArgument = AST::createVariableReference (block.context, fn.parameters.findObjectWithName (fn.getStrings().index));
                     auto& stateNodeElement = AST::createGetElement (block, stateMember, indexArgument);
 
+                    addSilentFrameCounterReset (block, stateArgument, dest.getNode(), indexArgument);
                     addEventHandlerCall (block, *eventHandler, stateNodeElement, dest, destIndex, valueArgument);
                 }
                 else
@@ -555,6 +562,7 @@ struct FlattenGraph
                     addLoop (block, *destNodeArraySize, [&] (AST::ScopeBlock& loopBlock, AST::ValueBase& index)
                     {
                         auto& stateNodeElement = AST::createGetElement (loopBlock, stateMember, index);
+                        addSilentFrameCounterReset (loopBlock, stateArgument, dest.getNode(), index);
                         addEventHandlerCall (loopBlock, *eventHandler, stateNodeElement, dest, destIndex, valueArgument);
                     });
                 }
@@ -562,9 +570,15 @@ struct FlattenGraph
             else
             {
                 ref<AST::ValueBase> nodeState = stateMember;
+                ptr<AST::ValueBase> nodeIndex;
 
                 if (auto getElement = AST::castToSkippingReferences<AST::GetElement> (dest.node))
+                {
+                    nodeIndex = AST::castToSkippingReferences<AST::ValueBase> (getElement->getSingleIndex());
                     nodeState = AST::createGetElement (block, stateMember, getElement->getSingleIndex());
+                }
+
+                addSilentFrameCounterReset (block, stateArgument, dest.getNode(), nodeIndex);
 
                 if (destEndpointIsArray && destIndex == nullptr && sourceIndex == nullptr && sourceIsArray)
                 {
@@ -815,6 +829,14 @@ struct FlattenGraph
         }
 
         void addRunCall (ptr<AST::ScopeBlock> block, const AST::GraphNode& node)
+        {
+            if (nodeProfiler != nullptr)
+                nodeProfiler->addProfiledRunCall (*block, node, [&] (AST::ScopeBlock& b) { addNodeRunCall (b, node); });
+            else
+                addNodeRunCall (block, node);
+        }
+
+        void addNodeRunCall (ptr<AST::ScopeBlock> block, const AST::GraphNode& node)
         {
             if (auto processorMainFunction = node.getProcessorType()->findMainFunction())
             {
@@ -824,25 +846,71 @@ struct FlattenGraph
                 {
                     addLoop (block, *arraySize, [&] (AST::ScopeBlock& loopBlock, AST::ValueBase& index)
                     {
+                        ptr<AST::ValueBase> silentFrameCounter;
+
+                        if (instanceInfo.silentFrameCounter != nullptr)
+                            silentFrameCounter = AST::createGetElement (block, AST::createVariableReference (block->context, *instanceInfo.silentFrameCounter), index);
+
                         addRunCall (loopBlock,
+                                    *node.getProcessorType(),
                                     processorMainFunction,
                                     AST::createGetElement (block, instanceInfo.stateVariable, index),
-                                    AST::createGetElement (block, instanceInfo.ioVariable, index));
+                                    AST::createGetElement (block, instanceInfo.ioVariable, index),
+                                    silentFrameCounter);
                     });
                 }
                 else
                 {
-                    addRunCall (block, processorMainFunction,
-                                instanceInfo.stateVariable, instanceInfo.ioVariable);
+                    ptr<AST::ValueBase> silentFrameCounter;
+
+                    if (instanceInfo.silentFrameCounter != nullptr)
+                        silentFrameCounter = AST::createVariableReference (block->context, *instanceInfo.silentFrameCounter);
+
+                    addRunCall (block, *node.getProcessorType(), processorMainFunction,
+                                instanceInfo.stateVariable, instanceInfo.ioVariable,
+                                silentFrameCounter);
                 }
             }
         }
 
-        static void addRunCall (ptr<AST::ScopeBlock> block, ptr<AST::Function> mainFunction,
-                                AST::ValueBase& stateVariable, AST::ValueBase& ioVariable)
+        void addRunCall (ptr<AST::ScopeBlock> block, const AST::ProcessorBase& processor, ptr<AST::Function> processorMainFunction,
+                         AST::ValueBase& stateVariable, AST::ValueBase& ioVariable,
+                         ptr<AST::ValueBase> silentFrameCounter)
+        {
+            auto& functionCall = AST::createFunctionCall (block, *processorMainFunction, stateVariable, ioVariable);
+
+            if (silentFrameCounter == nullptr)
+            {
+                block->addStatement (functionCall);
+                return;
+            }
+
+            // Each sleeping node gets its own scope, so that its local silence flag doesn't clash with other nodes
+            auto& nodeBlock = block->allocateChild<AST::ScopeBlock>();
+            addSparseStreamSupport (nodeBlock, functionCall, *silentFrameCounter, ioVariable, processor, sparseStreamSettleFrames);
+            block->addStatement (nodeBlock);
+        }
+
+        /// Wakes up a sleeping node when one of its event handlers is called
+        void addSilentFrameCounterReset (AST::ScopeBlock& block, AST::ValueBase& stateArgument,
+                                         const AST::GraphNode& node, ptr<AST::ValueBase> nodeIndex)
         {
-            auto& functionCall = AST::createFunctionCall (block, *mainFunction, stateVariable, ioVariable);
-            block->addStatement (functionCall);
+            auto& instanceInfo = getInfoForNode (node);
+
+            if (instanceInfo.silentFrameCounter == nullptr)
+                return;
+
+            auto& counter = AST::createGetStructMember (block, stateArgument, std::string (instanceInfo.silentFrameCounter->name.get()));
+
+            if (nodeIndex != nullptr)
+                SparseStreamSupport::addCounterReset (block, AST::createGetElement (block, counter, *nodeIndex));
+            else if (auto arraySize = node.getArraySize())
+                addLoop (block, *arraySize, [&] (AST::ScopeBlock& loopBlock, AST::ValueBase& index)
+                {
+                    SparseStreamSupport::addCounterReset (loopBlock, AST::createGetElement (loopBlock, counter, index));
+                });
+            else
+                SparseStreamSupport::addCounterReset (block, counter);
         }
 
         static ptr<AST::TypeBase> getStateStruct (AST::ProcessorBase& processor, std::optional<int> arraySize)
@@ -873,22 +941,30 @@ struct FlattenGraph
 
         AST::ProcessorBase& graph;
         ProcessorInfo::GetInfo getProcessorInfo;
+        uint32_t sparseStreamSettleFrames;
         ptr<AST::Function> initFunction, mainFunction;
         int32_t nextProcessorId = 1;
+        std::unique_ptr<NodeProfiler> nodeProfiler;
 
         std::unordered_map<const AST::GraphNode*, std::unique_ptr<InstanceInfo>> nodeInstanceInfoMap;
         std::vector<const AST::GraphNode*> nodesToRender, delayNodes;
         ptr<AST::ScopeBlock> processorGraphOutput;
     };
 
-    static void flattenGraph (AST::Graph& graph, ProcessorInfo::GetInfo getInfo, uint32_t eventBufferSize, bool isTopLevelProcessor)
+    /// If programToProfile is not null, the graph's nodes are instrumented with a NodeProfiler
+    static void flattenGraph (AST::Graph& graph, ProcessorInfo::GetInfo getInfo, uint32_t eventBufferSize,
+                              bool isTopLevelProcessor, uint32_t sparseStreamSettleFrames,
+                              ptr<AST::Program> programToProfile)
     {
-        Renderer renderer (graph, getInfo);
+        Renderer renderer (graph, getInfo, sparseStreamSettleFrames);
 
         for (auto& i : graph.nodes)
             if (auto node = AST::castTo<AST::GraphNode> (i))
                 renderer.addNode (*node, false);
 
+        if (programToProfile != nullptr)
+            renderer.nodeProfiler = std::make_unique<NodeProfiler> (*programToProfile, graph, renderer.nodesToRender);
+
         graph.visitConnections ([&] (AST::Connection& c)
         {
             addConnection (renderer, c);
@@ -1004,7 +1080,9 @@ struct FlattenGraph
 inline void flatten (AST::Program& program, AST::ProcessorBase& processor,
                      bool isTopLevelProcessor, ProcessorInfo::GetInfo getInfo,
                      uint32_t eventBufferSize,
-                     bool useForwardBranch)
+                     bool useForwardBranch,
+                     uint32_t sparseStreamSettleFrames,
+                     bool profileMainGraphNodes)
 {
     // First ensure all nodes are flattened
     for (auto& n : processor.nodes)
@@ -1023,7 +1101,7 @@ inline void flatten (AST::Program& program, AST::ProcessorBase& processor,
                                           clone.context.allocator.createInt32Type(), {});
             }
 
-            flatten (program, *node->getProcessorType(), false, getInfo, eventBufferSize, useForwardBranch);
+            flatten (program, *node->getProcessorType(), false, getInfo, eventBufferSize, useForwardBranch, sparseStreamSettleFrames, false);
 
             original.findParentNamespace()->subModules.removeObject (original);
         }
@@ -1031,7 +1109,10 @@ inline void flatten (AST::Program& program, AST::ProcessorBase& processor,
 
     if (auto graph = processor.getAsGraph())
     {
-        FlattenGraph::flattenGraph (*graph, getInfo, eventBufferSize, isTopLevelProcessor);
+        bool isMainGraph = std::addressof (program.getMainProcessor()) == std::addressof (processor);
+
+        FlattenGraph::flattenGraph (*graph, getInfo, eventBufferSize, isTopLevelProcessor, sparseStreamSettleFrames,
+                                    profileMainGraphNodes && isMainGraph ? std::addressof (program) : nullptr);
     }
     else
     {
@@ -1047,14 +1128,16 @@ inline void flatten (AST::Program& program, AST::ProcessorBase& processor,
 inline void flattenGraph (AST::Program& program,
                           uint32_t maxBlockSize,
                           uint32_t eventBufferSize,
-                          bool useForwardBranch)
+                          bool useForwardBranch,
+                          uint32_t sparseStreamSettleFrames,
+                          bool profileNodes)
 {
     ProcessorInfoManager processorInfoManager;
 
     bool isBlockProcessor = maxBlockSize > 1;
 
     flatten (program, program.getMainProcessor(), ! isBlockProcessor,
-             processorInfoManager.getProcessorInfo(), eventBufferSize, useForwardBranch);
+             processorInfoManager.getProcessorInfo(), eventBufferSize, useForwardBranch, sparseStreamSettleFrames, profileNodes);
 
     if (isBlockProcessor)
     {
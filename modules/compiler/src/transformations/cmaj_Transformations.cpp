@@ -19,6 +19,8 @@
 #include <iostream>
 #include <map>
 #include <set>
+#include <chrono>
+#include <limits>
 
 #include "../../include/cmaj_ErrorHandling.h"
 #include "choc/text/choc_Wildcard.h"
@@ -38,6 +40,8 @@
 #include "cmaj_ProcessorPropertiesToState.h"
 #include "cmaj_CanonicaliseLoopsAndBlocks.h"
 #include "cmaj_OversamplingTransformation.h"
+#include "cmaj_AddSparseStreamSupport.h"
+#include "cmaj_AddNodeProfiling.h"
 #include "cmaj_TransformGraph.h"
 #include "cmaj_HoistedEndpointConnector.h"
 #include "cmaj_SimplifyGraphConnections.h"
@@ -47,7 +51,6 @@
 #include "cmaj_FunctionInliner.h"
 #include "cmaj_RemoveUnusedEndpoints.h"
 #include "cmaj_RemoveUnusedNodes.h"
-#include "cmaj_AddSparseStreamSupport.h"
 #include "cmaj_CloneGraphNodes.h"
 #include "cmaj_BinaryModuleFormat.h"
 #include "cmaj_MergeDuplicateNamespaces.h"
@@ -62,23 +65,67 @@
 namespace cmaj::transformations
 {
 
+struct ResolutionPass
+{
+    std::string_view name;
+    passes::PassResult (*run) (AST::Program&, bool throwOnErrors);
+};
+
+static constexpr ResolutionPass resolutionPasses[] =
+{
+    { "TypeResolver",        passes::runPass<passes::TypeResolver> },
+    { "FunctionResolver",    passes::runPass<passes::FunctionResolver> },
+    { "NameResolver",        passes::runPass<passes::NameResolver> },
+    { "ModuleSpecialiser",   passes::runPass<passes::ModuleSpecialiser> },
+    { "ProcessorResolver",   passes::runPass<passes::ProcessorResolver> },
+    { "EndpointResolver",    passes::runPass<passes::EndpointResolver> },
+    { "ConstantFolder",      passes::runPass<passes::ConstantFolder> },
+    { "StrengthReduction",   passes::runPass<passes::StrengthReduction> },
+    { "ExternalResolver",    passes::runPass<passes::ExternalResolver> }
+};
+
+/// Runs the resolution passes in turn until none of them have anything left to change.
+/// Each pass remembers how many changes had been made in total when it last ran, and
+/// is skipped if nothing has happened since then, because it would just see the same
+/// tree again. A pass that made changes itself always runs again, so the loop finishes
+/// once every pass has had a clean run over the final state of the program.
 static void runResolutionPasses (AST::Program& program, bool throwOnErrors)
 {
+    constexpr auto numPasses = std::size (resolutionPasses);
+    constexpr auto neverRun = std::numeric_limits<size_t>::max();
+
+    size_t totalChanges = 0;
+    size_t changesSeenOnLastRun[numPasses];
+    std::fill (std::begin (changesSeenOnLastRun), std::end (changesSeenOnLastRun), neverRun);
+
     for (;;)
     {
-        passes::PassResult result;
-
-        result += passes::runPass<passes::TypeResolver>             (program, throwOnErrors);
-        result += passes::runPass<passes::FunctionResolver>         (program, throwOnErrors);
-        result += passes::runPass<passes::NameResolver>             (program, throwOnErrors);
-        result += passes::runPass<passes::ModuleSpecialiser>        (program, throwOnErrors);
-        result += passes::runPass<passes::ProcessorResolver>        (program, throwOnErrors);
-        result += passes::runPass<passes::EndpointResolver>         (program, throwOnErrors);
-        result += passes::runPass<passes::ConstantFolder>           (program, throwOnErrors);
-        result += passes::runPass<passes::StrengthReduction>        (program, throwOnErrors);
-        result += passes::runPass<passes::ExternalResolver>         (program, throwOnErrors);
-
-        if (result.numChanges == 0)
+        bool anyPassesRun = false;
+
+        for (size_t i = 0; i < numPasses; ++i)
+        {
+            auto& pass = resolutionPasses[i];
+            auto& stats = program.getResolutionPassStats (pass.name);
+
+            if (changesSeenOnLastRun[i] == totalChanges)
+            {
+                ++stats.numSkipped;
+                continue;
+            }
+
+            auto startTime = std::chrono::steady_clock::now();
+            auto result = pass.run (program, throwOnErrors);
+
+            stats.seconds += std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+            stats.numChanges += result.numChanges;
+            ++stats.numRuns;
+
+            changesSeenOnLastRun[i] = totalChanges;
+            totalChanges += result.numChanges;
+            anyPassesRun = true;
+        }
+
+        if (! anyPassesRun)
             return;
     }
 }
@@ -150,7 +197,9 @@ void prepareForCodeGen (AST::Program& program,
     inlineAllCallsWhichAdvance (program);
     createSystemInitFunctions (program, processorReplacementState.sessionIDVariable, processorReplacementState.frequencyVariable);
     convertLargeConstantsToGlobals (program);
-    flattenGraph (program, buildSettings.getMaxBlockSize(), buildSettings.getEventBufferSize(), useForwardBranchesForAdvance);
+    flattenGraph (program, buildSettings.getMaxBlockSize(), buildSettings.getEventBufferSize(),
+                  useForwardBranchesForAdvance, buildSettings.getSparseStreamSettleFrames(),
+                  buildSettings.shouldProfileNodes());
 }
 
 void prepareForGraphGen (AST::Program& program,
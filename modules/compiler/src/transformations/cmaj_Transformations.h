@@ -40,6 +40,10 @@ namespace cmaj::transformations
                             double& resultLatency,
                             const std::function<bool(const EndpointID&)>& isEndpointActive);
 
+    /// When node profiling is enabled, this is the name of the main graph's state array which
+    /// holds the counters for the nodes listed in AST::Program::profiledNodeNames
+    inline constexpr std::string_view getNodeProfileCountersName()      { return "_profileCounters"; }
+
     // Run passes for graph generation
     void prepareForGraphGen (AST::Program&,
                              double frequency,
@@ -106,6 +106,7 @@ struct Files
         "*/\n"
         "\n"
         "import { ServerSession } from \"../cmaj_api/cmaj-server-session.js\"\n"
+        "import * as binaryMessages from \"/panel_api/helpers/cmaj-binary-messages.js\"\n"
         "\n"
         "\n"
         "//==============================================================================\n"
@@ -117,18 +118,35 @@ struct Files
         "        super (sessionID);\n"
         "\n"
         "        this.socket = new WebSocket (SOCKET_URL + \"/\" + sessionID);\n"
+        "        this.socket.binaryType = \"arraybuffer\";\n"
         "\n"
-        "        this.socket.onopen = () => this.handleSessionConnection();\n"
+        "        this.socket.onopen = () =>\n"
+        "        {\n"
+        "            // asks the server to send audio levels, CPU level, etc. as binary frames\n"
+        "            this.sendMessageToServer ({ type: \"enable_binary_messages\" });\n"
+        "            this.handleSessionConnection();\n"
+        "        };\n"
         "\n"
         "        this.socket.onmessage = msg =>\n"
         "        {\n"
-        "            const message = JSON.parse (msg.data);\n"
+        "            const message = this.decodeMessage (msg.data);\n"
         "\n"
         "            if (message)\n"
         "                this.handleMessageFromServer (message);\n"
         "        };\n"
         "    }\n"
         "\n"
+        "    decodeMessage (data)\n"
+        "    {\n"
+        "        if (typeof data !== \"string\")\n"
+        "            return binaryMessages.decodeBinaryMessage (data);\n"
+        "\n"
+        "        if (data.startsWith (binaryMessages.binaryMessageTextPrefix))\n"
+        "            return binaryMessages.decodeBinaryMessageText (data);\n"
+        "\n"
+        "        return JSON.parse (data);\n"
+        "    }\n"
+        "\n"
         "    dispose()\n"
         "    {\n"
         "        super.dispose();\n"
@@ -2863,19 +2881,115 @@ struct Files
         "`;\n"
         "    }\n"
         "}\n";
+    static constexpr const char* panel_api_helpers_cmajbinarymessages_js = "//\n"
+        "//     ,ad888ba,                              88\n"
+        "//    d8\"'    \"8b\n"
+        "//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit\n"
+        "//   Y8,           88    88    88  88     88  88\n"
+        "//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd\n"
+        "//     '\"Y888Y\"'   88    88    88  '\"8bbP\"Y8  88     https://cmajor.dev\n"
+        "//                                           ,88\n"
+        "//                                        888P\"\n"
+        "//\n"
+        "//  The Cmajor project is subject to commercial or open-source licensing.\n"
+        "//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or\n"
+        "//  visit https://cmajor.dev to learn about our commercial licence options.\n"
+        "//\n"
+        "//  CMAJOR IS PROVIDED \"AS IS\" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER\n"
+        "//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE\n"
+        "//  DISCLAIMED.\n"
+        "\n"
+        "/**\n"
+        "    Decodes the binary frames that the patch server uses to send high-rate messages\n"
+        "    such as audio levels, CPU level and float event data. See the BinaryViewMessage\n"
+        "    class in cmaj_Patch.h for a description of the format.\n"
+        "\n"
+        "    The decoded messages have the same { type, message } form as the JSON messages,\n"
+        "    except that their arrays of values are Float32Arrays.\n"
+        "*/\n"
+        "\n"
+        "/// The server sends binary frames as base64 text that starts with this character,\n"
+        "/// which can't be the start of a JSON message.\n"
+        "export const binaryMessageTextPrefix = \"#\";\n"
+        "\n"
+        "const headerSize = 8;\n"
+        "\n"
+        "const ContentType =\n"
+        "{\n"
+        "    audioMinMax:        1,\n"
+        "    audioFullData:      2,\n"
+        "    cpuLevel:           3,\n"
+        "    eventFloat:         4,\n"
+        "    eventFloatArray:    5\n"
+        "};\n"
+        "\n"
+        "/// Returns a { type, message } object for a frame, or undefined if it's not a valid frame\n"
+        "export function decodeBinaryMessage (buffer)\n"
+        "{\n"
+        "    if (buffer.byteLength < headerSize)\n"
+        "        return undefined;\n"
+        "\n"
+        "    const header = new DataView (buffer);\n"
+        "    const contentType = header.getUint8 (0);\n"
+        "    const typeLength = header.getUint8 (1);\n"
+        "    const numRows = header.getUint16 (2, true);\n"
+        "    const rowLength = header.getUint32 (4, true);\n"
+        "    const dataStart = headerSize + ((typeLength + 3) & ~3);\n"
+        "\n"
+        "    if (buffer.byteLength < dataStart + numRows * rowLength * 4)\n"
+        "        return undefined;\n"
+        "\n"
+        "    const type = new TextDecoder().decode (new Uint8Array (buffer, headerSize, typeLength));\n"
+        "    const values = new Float32Array (buffer, dataStart, numRows * rowLength);\n"
+        "    const getRow = (row) => values.subarray (row * rowLength, (row + 1) * rowLength);\n"
+        "\n"
+        "    switch (contentType)\n"
+        "    {\n"
+        "        case ContentType.audioMinMax:\n"
+        "            return { type, message: { min: getRow (0), max: getRow (1), rms: getRow (2) } };\n"
+        "\n"
+        "        case ContentType.audioFullData:\n"
+        "        {\n"
+        "            const data = [];\n"
+        "\n"
+        "            for (let row = 0; row < numRows; ++row)\n"
+        "                data.push (getRow (row));\n"
+        "\n"
+        "            return { type, message: { data } };\n"
+        "        }\n"
+        "\n"
+        "        case ContentType.cpuLevel:          return { type, message: { level: values[0] } };\n"
+        "        case ContentType.eventFloat:        return { type, message: values[0] };\n"
+        "        case ContentType.eventFloatArray:   return { type, message: getRow (0) };\n"
+        "        default:                            return undefined;\n"
+        "    }\n"
+        "}\n"
+        "\n"
+        "/// Decodes a frame that was sent as text, i.e. the prefix character followed by base64\n"
+        "export function decodeBinaryMessageText (text)\n"
+        "{\n"
+        "    const chars = atob (text.substring (binaryMessageTextPrefix.length));\n"
+        "    const bytes = new Uint8Array (chars.length);\n"
+        "\n"
+        "    for (let i = 0; i < chars.length; ++i)\n"
+        "        bytes[i] = chars.charCodeAt (i);\n"
+        "\n"
+        "    return decodeBinaryMessage (bytes.buffer);\n"
+        "}\n";
 
 
     static constexpr std::array files =
     {
         File { "embedded_patch_runner_template.html", std::string_view (embedded_patch_runner_template_html, 904) },
         File { "embedded_patch_chooser_template.html", std::string_view (embedded_patch_chooser_template_html, 300) },
-        File { "embedded_patch_session_template.js", std::string_view (embedded_patch_session_template_js, 2052) },
+        File { "embedded_patch_session_template.js", std::string_view (embedded_patch_session_template_js, 2689) },
         File { "panel_api/cmaj-graph.js", std::string_view (panel_api_cmajgraph_js, 2940) },
         File { "panel_api/cmaj-patch-panel.js", std::string_view (panel_api_cmajpatchpanel_js, 56412) },
         File { "panel_api/cmaj-cpu-meter.js", std::string_view (panel_api_cmajcpumeter_js, 3617) },
         File { "panel_api/helpers/cmaj-image-strip-control.js", std::string_view (panel_api_helpers_cmajimagestripcontrol_js, 5666) },
         File { "panel_api/helpers/cmaj-level-meter.js", std::string_view (panel_api_helpers_cmajlevelmeter_js, 6758) },
-        File { "panel_api/helpers/cmaj-waveform-display.js", std::string_view (panel_api_helpers_cmajwaveformdisplay_js, 5020) }
+        File { "panel_api/helpers/cmaj-waveform-display.js", std::string_view (panel_api_helpers_cmajwaveformdisplay_js, 5020) },
+        File { "panel_api/helpers/cmaj-binary-messages.js", std::string_view (panel_api_helpers_cmajbinarymessages_js, 3555) }
     };
 
 };
@@ -22,6 +22,7 @@
 */
 
 import { ServerSession } from "../cmaj_api/cmaj-server-session.js"
+import * as binaryMessages from "/panel_api/helpers/cmaj-binary-messages.js"
 
 
 //==============================================================================
@@ -33,18 +34,35 @@ class WebSocketServerSession  extends ServerSession
         super (sessionID);
 
         this.socket = new WebSocket (SOCKET_URL + "/" + sessionID);
+        this.socket.binaryType = "arraybuffer";
 
-        this.socket.onopen = () => this.handleSessionConnection();
+        this.socket.onopen = () =>
+        {
+            // asks the server to send audio levels, CPU level, etc. as binary frames
+            this.sendMessageToServer ({ type: "enable_binary_messages" });
+            this.handleSessionConnection();
+        };
 
         this.socket.onmessage = msg =>
         {
-            const message = JSON.parse (msg.data);
+            const message = this.decodeMessage (msg.data);
 
             if (message)
                 this.handleMessageFromServer (message);
         };
     }
 
+    decodeMessage (data)
+    {
+        if (typeof data !== "string")
+            return binaryMessages.decodeBinaryMessage (data);
+
+        if (data.startsWith (binaryMessages.binaryMessageTextPrefix))
+            return binaryMessages.decodeBinaryMessageText (data);
+
+        return JSON.parse (data);
+    }
+
     dispose()
     {
         super.dispose();
@@ -0,0 +1,95 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+/**
+    Decodes the binary frames that the patch server uses to send high-rate messages
+    such as audio levels, CPU level and float event data. See the BinaryViewMessage
+    class in cmaj_Patch.h for a description of the format.
+
+    The decoded messages have the same { type, message } form as the JSON messages,
+    except that their arrays of values are Float32Arrays.
+*/
+
+/// The server sends binary frames as base64 text that starts with this character,
+/// which can't be the start of a JSON message.
+export const binaryMessageTextPrefix = "#";
+
+const headerSize = 8;
+
+const ContentType =
+{
+    audioMinMax:        1,
+    audioFullData:      2,
+    cpuLevel:           3,
+    eventFloat:         4,
+    eventFloatArray:    5
+};
+
+/// Returns a { type, message } object for a frame, or undefined if it's not a valid frame
+export function decodeBinaryMessage (buffer)
+{
+    if (buffer.byteLength < headerSize)
+        return undefined;
+
+    const header = new DataView (buffer);
+    const contentType = header.getUint8 (0);
+    const typeLength = header.getUint8 (1);
+    const numRows = header.getUint16 (2, true);
+    const rowLength = header.getUint32 (4, true);
+    const dataStart = headerSize + ((typeLength + 3) & ~3);
+
+    if (buffer.byteLength < dataStart + numRows * rowLength * 4)
+        return undefined;
+
+    const type = new TextDecoder().decode (new Uint8Array (buffer, headerSize, typeLength));
+    const values = new Float32Array (buffer, dataStart, numRows * rowLength);
+    const getRow = (row) => values.subarray (row * rowLength, (row + 1) * rowLength);
+
+    switch (contentType)
+    {
+        case ContentType.audioMinMax:
+            return { type, message: { min: getRow (0), max: getRow (1), rms: getRow (2) } };
+
+        case ContentType.audioFullData:
+        {
+            const data = [];
+
+            for (let row = 0; row < numRows; ++row)
+                data.push (getRow (row));
+
+            return { type, message: { data } };
+        }
+
+        case ContentType.cpuLevel:          return { type, message: { level: values[0] } };
+        case ContentType.eventFloat:        return { type, message: values[0] };
+        case ContentType.eventFloatArray:   return { type, message: getRow (0) };
+        default:                            return undefined;
+    }
+}
+
+/// Decodes a frame that was sent as text, i.e. the prefix character followed by base64
+export function decodeBinaryMessageText (text)
+{
+    const chars = atob (text.substring (binaryMessageTextPrefix.length));
+    const bytes = new Uint8Array (chars.length);
+
+    for (let i = 0; i < chars.length; ++i)
+        bytes[i] = chars.charCodeAt (i);
+
+    return decodeBinaryMessage (bytes.buffer);
+}
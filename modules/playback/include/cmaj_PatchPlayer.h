@@ -24,6 +24,7 @@
 #include "cmajor/helpers/cmaj_Patch.h"
 #include "cmajor/helpers/cmaj_PatchWorker_QuickJS.h"
 #include "cmajor/helpers/cmaj_PatchWorker_WebView.h"
+#include "cmajor/helpers/cmaj_FileBasedCacheDatabase.h"
 #include "choc/text/choc_JSON.h"
 #include "cmaj_AllocationChecker.h"
 #include "cmaj_AudioMIDIPlayer.h"
@@ -39,6 +40,7 @@ struct PatchPlayer  : public cmaj::audio_utils::AudioMIDICallback
                  bool checkFilesForChanges)
     {
         initPatchCallbacks (engineOptions, buildSettings);
+        initAudioDataCache();
         patch.setAutoRebuildOnFileChange (checkFilesForChanges);
     }
 
@@ -168,6 +170,21 @@ struct PatchPlayer  : public cmaj::audio_utils::AudioMIDICallback
 
 private:
     //==============================================================================
+    // Keeps decoded audio files in the temp folder, so that rebuilding or reloading a
+    // patch doesn't need to decode its audio externals again.
+    void initAudioDataCache()
+    {
+        try
+        {
+            auto folder = std::filesystem::temp_directory_path() / "cmajor_audio_cache";
+            create_directories (folder);
+            patch.audioDataCache = choc::com::create<cmaj::FileBasedCacheDatabase> (folder, maxNumCachedAudioFiles);
+        }
+        catch (...) {}
+    }
+
+    static constexpr size_t maxNumCachedAudioFiles = 200;
+
     void initPatchCallbacks (const choc::value::Value& engineOptions, const cmaj::BuildSettings& buildSettings)
     {
         std::string engineType;
@@ -121,6 +121,12 @@ struct PerformerAllocationCheckWrapper  : public choc::com::ObjectWithAtomicRefC
         return target->addInputEvent (endpoint, typeIndex, eventData);
     }
 
+    Result addInputEvents (EndpointHandle endpoint, const EventBatch* batch) override
+    {
+        ScopedAllocationTracker allocationTracker;
+        return target->addInputEvents (endpoint, batch);
+    }
+
     Result copyOutputValue (EndpointHandle h, void* dest) override
     {
         ScopedAllocationTracker allocationTracker;
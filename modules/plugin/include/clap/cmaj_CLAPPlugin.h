@@ -173,6 +173,7 @@ struct Plugin::Impl
         if (! blockRestartRequests)
         {
             isResetRequestPending = true;
+            patchNeedsReloading = true;
             lastRequestedManifestPath = nextPathToManifest;
             host.request_restart (std::addressof (host));
         }
@@ -239,11 +240,13 @@ private:
 
     void consumeEventsFromEditor (const clap_output_events_t&);
     void dispatchEvent (const clap_event_header_t&);
+    void addTimedMIDIInputEvent (const clap_event_header_t&, uint32_t frame);
 
     //==============================================================================
     static void copyAndNullTerminateTruncatingIfNecessary (const std::string& from, char* to, size_t capacity);
 
     static clap_event_midi_t toClapMidiEvent (uint32_t sampleOffset, uint16_t portIndex, const choc::midi::ShortMessage&);
+    static choc::midi::ShortMessage toMIDINoteMessage (const clap_event_note_t&, bool isNoteOn);
     static clap_event_note_t toClapNoteEvent (uint32_t sampleOffset,
                                               uint16_t portIndex,
                                               uint16_t noteType,
@@ -262,6 +265,7 @@ private:
     std::atomic<bool> blockEditorDispatch = false;
     std::atomic<bool> blockRestartRequests = false; // Bitwig seems to crash when requesting restart whilst being restarted
     std::atomic<bool> isResetRequestPending = false; // Doesn't actually need to be atomic unless we do something in start/stop processing
+    bool patchNeedsReloading = true;
 
     // currently ramp frames are not applied when setting via host automation
     using SetParameterValueFromProcessFn = std::function<void(cmaj::EndpointHandle, float)>;
@@ -457,12 +461,33 @@ auto getExtension (const clap_host_t& host, const char* extension)
 
 inline bool Plugin::Impl::clapPlugin_activate (double frequencyToUse, uint32_t, uint32_t maxBlockSizeToUse)
 {
+    // If only the sample rate has changed and the patch was built with a dynamic frequency,
+    // it can switch to the new rate without being reloaded
+    if (! patchNeedsReloading && maxBlockSizeToUse == maxBlockSize && patch.canChangeSampleRateWithoutRebuilding())
+    {
+        frequency = frequencyToUse;
+
+        auto params = patch.getPlaybackParams();
+        params.sampleRate = frequency;
+        patch.setPlaybackParams (params);
+
+        if (pendingStateToApplyWhenActivated)
+        {
+            patch.setFullStoredState (pendingStateToApplyWhenActivated->fullStoredState);
+            pendingStateToApplyWhenActivated = {};
+        }
+
+        return true;
+    }
+
     frequency = frequencyToUse;
     maxBlockSize = maxBlockSizeToUse;
 
     if (! loadPatch (lastRequestedManifestPath, { frequency, maxBlockSize }))
         return false;
 
+    patchNeedsReloading = false;
+
     // currently caches are always recalculated. however, in the generated plugin case this is wasteful.
     updateParameterInfoCachesFromLoadedPatch();
     updateAudioPortInfoCachesFromLoadedPatch();
@@ -845,13 +870,37 @@ inline clap_process_status Plugin::Impl::clapPlugin_process (const clap_process_
         auto* outputs = state.audio_outputs;
         const auto count = state.frames_count;
 
-        const auto shouldConsumeEvent = [] (const auto& e) -> bool
+        // Only parameter changes split the block. Note and MIDI events are passed to the
+        // performer with their frame offsets, so that it can deliver them at the right frame itself.
+        const auto isParameterEvent = [] (const auto& e) -> bool
         {
             return e.space_id == CLAP_CORE_EVENT_SPACE_ID
-                && (e.type == CLAP_EVENT_MIDI
-                ||  e.type == CLAP_EVENT_NOTE_ON
+                && e.type == CLAP_EVENT_PARAM_VALUE;
+        };
+
+        const auto isMIDIInputEvent = [] (const auto& e) -> bool
+        {
+            return e.space_id == CLAP_CORE_EVENT_SPACE_ID
+                && (e.type == CLAP_EVENT_NOTE_ON
                 ||  e.type == CLAP_EVENT_NOTE_OFF
-                ||  e.type == CLAP_EVENT_PARAM_VALUE);
+                ||  e.type == CLAP_EVENT_MIDI);
+        };
+
+        const auto numInputEvents = inputQueue.size (std::addressof (inputQueue));
+        uint32_t nextMIDIInputEventIndex = 0;
+
+        const auto addMIDIInputEventsForRange = [&, this] (const EventTimeRange& range)
+        {
+            for (; nextMIDIInputEventIndex < numInputEvents; ++nextMIDIInputEventIndex)
+            {
+                const auto* event = inputQueue.get (std::addressof (inputQueue), nextMIDIInputEventIndex);
+
+                if (event->time >= range.end && range.end < count)
+                    break;
+
+                if (isMIDIInputEvent (*event))
+                    addTimedMIDIInputEvent (*event, event->time > range.start ? event->time - range.start : 0);
+            }
         };
 
         const auto toChannelArrayView = [] (auto& scratch, const auto& portInfos, auto* clapBuffers, auto blockSize)
@@ -881,16 +930,17 @@ inline clap_process_status Plugin::Impl::clapPlugin_process (const clap_process_
 
         forEachFilteredEventRange ({ 0, count },
                                    inputQueue,
-                                   shouldConsumeEvent,
+                                   isParameterEvent,
                                    [this] (const auto& event) { dispatchEvent (event); },
                                    [&] (const auto& range)
         {
             const bool replaceOutput = true;
+            addMIDIInputEventsForRange (range);
 
             patch.process ({
                 inputChannels.getFrameRange ({ range.start, range.end }),
                 outputChannels.getFrameRange ({ range.start, range.end }),
-                {}, // handle splitting events externally, for sample-accurate automation etc.
+                {}, // note and MIDI events are added above, and parameter changes split the block, for sample-accurate automation
                 [&, this] (auto frameIndex, const auto& message)
                 {
                     if (infoForOutputNotePorts.empty())
@@ -1017,23 +1067,13 @@ inline void Plugin::Impl::dispatchEvent (const clap_event_header_t& eventHeader)
         case CLAP_EVENT_NOTE_ON:
         {
             const auto& event = reinterpret_cast<const clap_event_note_t&> (eventHeader);
-
-            sendMIDIInputEvent (event.port_index, {
-                static_cast<uint8_t> (0x90 + (event.channel & 0xf)),
-                static_cast<uint8_t> (event.key),
-                static_cast<uint8_t> (event.velocity * 127.0)
-            });
+            sendMIDIInputEvent (event.port_index, toMIDINoteMessage (event, true));
             break;
         }
         case CLAP_EVENT_NOTE_OFF:
         {
             const auto& event = reinterpret_cast<const clap_event_note_t&> (eventHeader);
-
-            sendMIDIInputEvent (event.port_index, {
-                static_cast<uint8_t> (0x80 + (event.channel & 0xf)),
-                static_cast<uint8_t> (event.key),
-                static_cast<uint8_t> (event.velocity * 127.0)
-            });
+            sendMIDIInputEvent (event.port_index, toMIDINoteMessage (event, false));
             break;
         }
         case CLAP_EVENT_PARAM_VALUE:
@@ -1164,6 +1204,34 @@ inline void Plugin::Impl::dispatchEvent (const clap_event_header_t& eventHeader)
     }
 }
 
+inline void Plugin::Impl::addTimedMIDIInputEvent (const clap_event_header_t& eventHeader, uint32_t frame)
+{
+    const auto addEvent = [&, this] (auto portIndex, const choc::midi::ShortMessage& msg)
+    {
+        if (portIndex < 0 || static_cast<size_t> (portIndex) >= inputNotePortEndpointIds.size())
+            return;
+
+        patch.addTimedMIDIInputEvent (inputNotePortEndpointIds[static_cast<size_t> (portIndex)], frame, msg);
+    };
+
+    if (eventHeader.type == CLAP_EVENT_MIDI)
+    {
+        const auto& event = reinterpret_cast<const clap_event_midi_t&> (eventHeader);
+        addEvent (event.port_index, { event.data, 3 });
+        return;
+    }
+
+    const auto& event = reinterpret_cast<const clap_event_note_t&> (eventHeader);
+    addEvent (event.port_index, toMIDINoteMessage (event, eventHeader.type == CLAP_EVENT_NOTE_ON));
+}
+
+inline choc::midi::ShortMessage Plugin::Impl::toMIDINoteMessage (const clap_event_note_t& event, bool isNoteOn)
+{
+    return choc::midi::ShortMessage (static_cast<uint8_t> ((isNoteOn ? 0x90 : 0x80) + (event.channel & 0xf)),
+                                     static_cast<uint8_t> (event.key),
+                                     static_cast<uint8_t> (event.velocity * 127.0));
+}
+
 inline void Plugin::Impl::clapPlugin_onMainThread()
 {
 }
@@ -34,14 +34,20 @@ namespace cmaj::javascript
     //==============================================================================
     struct JavascriptEngine
     {
+        /// If a cache is supplied, all the engines that the script links will use it
         JavascriptEngine (const cmaj::BuildSettings&,
-                          const choc::value::Value& engineOptions);
+                          const choc::value::Value& engineOptions,
+                          cmaj::CacheDatabaseInterface::Ptr linkCache = {});
         ~JavascriptEngine();
 
         choc::javascript::Context& getContext();
         void resetPerformerLibrary();
         std::string getEngineTypeName();
 
+        /// Returns the time that engines have spent parsing, loading and linking
+        /// since the last call to resetPerformerLibrary()
+        std::chrono::duration<double> getCompileTime();
+
     private:
         struct Pimpl;
         std::unique_ptr<Pimpl> pimpl;
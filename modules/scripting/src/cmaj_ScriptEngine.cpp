@@ -49,8 +49,9 @@ void executeScript (const std::string& file,
 //==============================================================================
 struct JavascriptEngine::Pimpl
 {
-    Pimpl (const cmaj::BuildSettings& buildSettings, const choc::value::Value& engineOptions)
-        : performerLibrary (buildSettings)
+    Pimpl (const cmaj::BuildSettings& buildSettings, const choc::value::Value& engineOptions,
+           cmaj::CacheDatabaseInterface::Ptr linkCache)
+        : performerLibrary (buildSettings, std::move (linkCache))
     {
         try
         {
@@ -84,8 +85,9 @@ struct JavascriptEngine::Pimpl
 };
 
 JavascriptEngine::JavascriptEngine (const cmaj::BuildSettings& buildSettings,
-                                    const choc::value::Value& engineOptions)
-    : pimpl (std::make_unique<Pimpl> (buildSettings, engineOptions))
+                                    const choc::value::Value& engineOptions,
+                                    cmaj::CacheDatabaseInterface::Ptr linkCache)
+    : pimpl (std::make_unique<Pimpl> (buildSettings, engineOptions, std::move (linkCache)))
 {
 }
 
@@ -106,4 +108,9 @@ std::string JavascriptEngine::getEngineTypeName()
     return pimpl->performerLibrary.getEngineTypeName();
 }
 
+std::chrono::duration<double> JavascriptEngine::getCompileTime()
+{
+    return pimpl->performerLibrary.getCompileTime();
+}
+
 }
@@ -22,6 +22,7 @@
 
 #include "../../compiler/include/cmaj_ErrorHandling.h"
 #include "../include/cmaj_ScriptEngine.h"
+#include "../../../include/cmajor/helpers/cmaj_InMemoryCacheDatabase.h"
 #include "choc/platform/choc_Platform.h"
 #include "choc/audio/choc_MIDIFile.h"
 #include "cmaj_javascript_ObjectHandle.h"
@@ -70,7 +71,7 @@ namespace cmaj::test
         void runTests (std::ostream& console,
                        const cmaj::BuildSettings& buildSettings, std::optional<int> testToRun,
                        bool runDisabled, const choc::value::Value& engineOptions,
-                       std::string testScriptPath);
+                       std::string testScriptPath, cmaj::CacheDatabaseInterface::Ptr linkCache);
 
         bool needsResaving() const
         {
@@ -185,7 +186,9 @@ namespace cmaj::test
             TestSuite& suite;
             TestSection section;
             std::vector<std::string> log, passed, failed, disabled, unsupported, errorReports;
-            std::chrono::duration<double> time = {};
+            std::chrono::duration<double> time = {}, compileTime = {};
+
+            std::chrono::duration<double> getRunTime() const     { return time - compileTime; }
 
         private:
             std::ostream* console = nullptr;
@@ -392,6 +395,9 @@ namespace cmaj::test
             disabled += s.disabled;
             unsupported += s.unsupported;
             time += s.time;
+
+            for (auto& t : s.tests)
+                compileTime += t.compileTime;
         }
 
         int passed = 0;
@@ -400,7 +406,7 @@ namespace cmaj::test
         int unsupported = 0;
         int files = 0;
         size_t total = 0;
-        std::chrono::duration<double> time = {};
+        std::chrono::duration<double> time = {}, compileTime = {};
 
         bool noFailures() const
         {
@@ -422,6 +428,10 @@ namespace cmaj::test
                 << "Failed:      " << failed << std::endl
                 << "Disabled:    " << disabled << std::endl
                 << "Unsupported: " << unsupported << std::endl
+                << std::endl
+                << "Compile time: " << choc::text::getDurationDescription (compileTime) << std::endl
+                << "Run time:     " << choc::text::getDurationDescription (time - compileTime) << std::endl
+                << "(summed over all threads)" << std::endl
                 << std::endl;
         }
 
@@ -457,6 +467,11 @@ namespace cmaj::test
                     oss << "        <testcase name=\"Test " <<  std::setw (3) << t.section.testNum
                         << "\" classname=\"" << getClassName (ts->filename) << "\" time=\"" << t.time.count() << "\">" << std::endl;
 
+                    oss << "            <properties>" << std::endl
+                        << "                <property name=\"compileTime\" value=\"" << t.compileTime.count() << "\"/>" << std::endl
+                        << "                <property name=\"runTime\" value=\"" << t.getRunTime().count() << "\"/>" << std::endl
+                        << "            </properties>" << std::endl;
+
                     if (! t.failed.empty())
                         oss << "            <failure message=\"" << t.failed.front() << "\"/>" << std::endl;
 
@@ -483,12 +498,13 @@ namespace cmaj::test
                               TestSuite& suite,
                               std::ostream& out,
                               const choc::value::Value& engineOptions,
-                              std::string testScriptPathToUse)
+                              std::string testScriptPathToUse,
+                              cmaj::CacheDatabaseInterface::Ptr linkCache)
            : testFile (suite.filename), output (out),
              defaultEngineOptions (engineOptions), testScriptPath (std::move (testScriptPathToUse))
         {
             javascriptEngine = std::make_shared<javascript::JavascriptEngine> (buildSettings.setFrequency (44100),
-                                                                               engineOptions);
+                                                                               engineOptions, std::move (linkCache));
 
             auto& context = getContext();
 
@@ -544,6 +560,7 @@ namespace cmaj::test
             if (errors.hasErrors())
                 test.reportTestFailed (choc::text::trim (errors.toString()));
 
+            test.compileTime = javascriptEngine->getCompileTime();
             test.end();
             currentTest = nullptr;
         }
@@ -1018,7 +1035,7 @@ function getEngineName()                             { return _getEngineName();
     inline void TestSuite::runTests (std::ostream& console,
                                      const cmaj::BuildSettings& buildSettings, std::optional<int> testToRun,
                                      bool runDisabled, const choc::value::Value& engineOptions,
-                                     std::string testScriptPath)
+                                     std::string testScriptPath, cmaj::CacheDatabaseInterface::Ptr linkCache)
     {
         if (!testToRun || testToRun.value() == 1)
         {
@@ -1027,7 +1044,7 @@ function getEngineName()                             { return _getEngineName();
                     << std::endl;
         }
 
-        TestJavascriptEngine testEngine (buildSettings, *this, console, engineOptions, testScriptPath);
+        TestJavascriptEngine testEngine (buildSettings, *this, console, engineOptions, testScriptPath, std::move (linkCache));
 
         for (auto& test : tests)
         {
@@ -1048,7 +1065,8 @@ function getEngineName()                             { return _getEngineName();
                            bool printOnlyErrors,
                            uint32_t threadLimit,
                            const choc::value::Value& engineOptions,
-                           std::string testScriptPath)
+                           std::string testScriptPath,
+                           const cmaj::CacheDatabaseInterface::Ptr& linkCache)
     {
         JobPool jobPool;
 
@@ -1061,10 +1079,10 @@ function getEngineName()                             { return _getEngineName();
 
                 jobPool.addJob (std::async (std::launch::deferred,
                                               [&suite, testIndex, &buildSettings, printOnlyErrors, &output,
-                                               runDisabled, &engineOptions, testScriptPath] ()
+                                               runDisabled, &engineOptions, testScriptPath, linkCache] ()
                                               {
                                                   std::ostringstream testOutput;
-                                                  suite->runTests (testOutput, buildSettings, testIndex, runDisabled, engineOptions, testScriptPath);
+                                                  suite->runTests (testOutput, buildSettings, testIndex, runDisabled, engineOptions, testScriptPath, linkCache);
 
                                                   if (! printOnlyErrors)
                                                       output << testOutput.str();
@@ -1131,6 +1149,15 @@ function getEngineName()                             { return _getEngineName();
 
         TestResult totalResults;
 
+        // All the sections share this, so that any which build an identical program
+        // (including in later iterations) can reload its object code and skip the code
+        // generation. Its size is capped, so a long run can't keep growing it. Reloaded
+        // object code can't be compiled lazily, so the cache is left out when the tests
+        // have been asked to exercise that.
+        auto linkCache = choc::com::create<cmaj::InMemoryCacheDatabase>();
+        auto sectionBuildSettings = cmaj::BuildSettings (buildSettings);
+        sectionBuildSettings.setCacheObjectCode (! buildSettings.shouldCompileHandlersLazily());
+
         try
         {
             std::vector<std::unique_ptr<TestSuite>> testSuites;
@@ -1143,9 +1170,9 @@ function getEngineName()                             { return _getEngineName();
                 for (auto& file : testFiles)
                     testSuites.emplace_back (std::make_unique<TestSuite> (file));
 
-                runSuites (testSuites, buildSettings, output,
+                runSuites (testSuites, sectionBuildSettings, output,
                            testToRun, runDisabled, showProgressBar, printOnlyErrors,
-                           threadLimit, engineOptions, testScriptPath);
+                           threadLimit, engineOptions, testScriptPath, linkCache);
             }
 
             auto endTime = std::chrono::steady_clock::now();
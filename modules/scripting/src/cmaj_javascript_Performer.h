@@ -28,7 +28,8 @@ namespace cmaj::javascript
 //==============================================================================
 struct PerformerLibrary
 {
-    PerformerLibrary (const cmaj::BuildSettings& bs) : buildSettings (bs)
+    PerformerLibrary (const cmaj::BuildSettings& bs, cmaj::CacheDatabaseInterface::Ptr cache = {})
+        : buildSettings (bs), linkCache (std::move (cache))
     {
         setEngineType ({});
     }
@@ -118,8 +119,12 @@ struct PerformerLibrary
     {
         programs.clear();
         performers.clear();
+        compileTime = {};
     }
 
+    /// Returns the total time spent parsing, loading and linking since the last reset()
+    std::chrono::duration<double> getCompileTime() const    { return compileTime; }
+
     cmaj::Program* getProgram (choc::javascript::ArgumentList args, size_t index)
     {
         return programs.getObject (args, index);
@@ -474,10 +479,12 @@ private:
 
                 auto endTime = std::chrono::steady_clock::now();
 
+                std::chrono::duration<double> elapsed = endTime - startTime;
+                owner.compileTime += elapsed;
+
                 if (! messages.empty())
                     return messages.toJSON();
 
-                std::chrono::duration<double> elapsed = endTime - startTime;
                 return choc::value::Value (elapsed.count());
             }
 
@@ -489,13 +496,15 @@ private:
             DiagnosticMessageList messages;
 
             auto startTime = std::chrono::steady_clock::now();
-            engine.link (messages);
+            engine.link (messages, owner.linkCache.get());
             auto endTime = std::chrono::steady_clock::now();
 
+            std::chrono::duration<double> elapsed = endTime - startTime;
+            owner.compileTime += elapsed;
+
             if (! messages.empty())
                 return messages.toJSON();
 
-            std::chrono::duration<double> elapsed = endTime - startTime;
             return choc::value::Value (elapsed.count());
         }
 
@@ -612,6 +621,8 @@ private:
     //==============================================================================
     std::string engineTypeName, actualEngineName;
     cmaj::BuildSettings buildSettings;
+    cmaj::CacheDatabaseInterface::Ptr linkCache;
+    std::chrono::duration<double> compileTime = {};
 
     ObjectHandleList<Performer, std::unique_ptr<Performer>> performers;
     ObjectHandleList<Engine, std::unique_ptr<Engine>> engines;
@@ -678,10 +689,12 @@ private:
             program->parse (messages, filename, content);
             auto endTime = std::chrono::steady_clock::now();
 
+            std::chrono::duration<double> elapsed = endTime - startTime;
+            compileTime += elapsed;
+
             if (! messages.empty())
                 return messages.toJSON();
 
-            std::chrono::duration<double> elapsed = endTime - startTime;
             return choc::value::Value (elapsed.count());
         }
 
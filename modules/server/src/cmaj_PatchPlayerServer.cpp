@@ -20,6 +20,7 @@
 #include "choc/text/choc_TextTable.h"
 #include "choc/threading/choc_ThreadSafeFunctor.h"
 #include "choc/network/choc_HTTPServer.h"
+#include "choc/memory/choc_Base64.h"
 #include "cmaj_LocalFileCache.h"
 #include "../../playback/include/cmaj_PatchPlayer.h"
 #include "../../playback/include/cmaj_AudioSources.h"
@@ -260,6 +261,12 @@ struct PatchPlayerServer
                 if (! v.isObject())
                     return;
 
+                if (auto typeMember = v["type"]; typeMember.isString() && typeMember.getString() == "enable_binary_messages")
+                {
+                    acceptsBinaryMessages = true;
+                    return;
+                }
+
                 std::scoped_lock l (messageQueueLock);
 
                 if (currentSession != nullptr
@@ -317,6 +324,7 @@ struct PatchPlayerServer
 
         PatchPlayerServer& owner;
         std::shared_ptr<Session> currentSession;
+        std::atomic<bool> acceptsBinaryMessages { false };
         std::mutex messageQueueLock;
         std::vector<std::unique_ptr<choc::value::Value>> messageQueue;
         choc::threading::TaskThread messageThread;
@@ -365,6 +373,32 @@ struct PatchPlayerServer
                 c->sendWebSocketMessage (json);
         }
 
+        /// Returns true if every connected client has asked for binary messages
+        bool canSendBinaryMessages()
+        {
+            std::scoped_lock sl (clientLock);
+
+            if (clients.empty())
+                return false;
+
+            for (auto* c : clients)
+                if (! c->acceptsBinaryMessages)
+                    return false;
+
+            return true;
+        }
+
+        /// Sends a BinaryViewMessage frame. The websocket server only sends text frames, so
+        /// this sends the frame's text form (see BinaryViewMessage::toText()).
+        void sendBinary (const void* frameData, size_t frameSize)
+        {
+            auto text = BinaryViewMessage::toText (frameData, frameSize);
+            std::scoped_lock sl (clientLock);
+
+            for (auto* c : clients)
+                c->sendWebSocketMessage (text);
+        }
+
     private:
         Session& session;
         std::mutex clientLock;
@@ -774,6 +808,16 @@ struct PatchPlayerServer
                 session.sendMessageToClient (m);
             }
 
+            bool canReceiveBinaryMessages() const override
+            {
+                return session.activeClientList.canSendBinaryMessages();
+            }
+
+            void sendBinaryMessage (const void* frameData, size_t frameSize) override
+            {
+                session.activeClientList.sendBinary (frameData, frameSize);
+            }
+
             Session& session;
         };
 
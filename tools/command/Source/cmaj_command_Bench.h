@@ -0,0 +1,498 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#include "choc/audio/choc_MIDIFile.h"
+#include "../../../modules/playback/include/cmaj_PatchPlayer.h"
+#include "../../../modules/playback/include/cmaj_AudioFileUtils.h"
+#include "cmaj_command_PerformerBenchmarks.h"
+
+//==============================================================================
+struct BenchOptions
+{
+    void parseArguments (choc::ArgumentList& args)
+    {
+        if (args.size() == 0)
+            throw std::runtime_error ("Expected a patch to benchmark");
+
+        if (auto input = args.removeExistingFileIfPresent ("--input"))
+            inputAudioFile = input->string();
+
+        if (auto midi = args.removeExistingFileIfPresent ("--midi"))
+            inputMIDIFile = midi->string();
+
+        if (auto sizes = args.removeValueFor ("--blockSizes"))
+        {
+            blockSizes.clear();
+
+            for (auto& size : choc::text::splitString (*sizes, ',', false))
+            {
+                auto n = std::stoi (std::string (choc::text::trim (size)));
+
+                if (n <= 0 || n > 8192)
+                    throw std::runtime_error ("Illegal block size: " + size);
+
+                blockSizes.push_back (static_cast<uint32_t> (n));
+            }
+
+            if (blockSizes.empty())
+                throw std::runtime_error ("Expected a list of block sizes");
+        }
+
+        sampleRate          = args.removeIntValue<uint32_t> ("--rate", sampleRate);
+        framesToRender      = args.removeIntValue<uint64_t> ("--length", sampleRate * 10ull);
+        warmUpFrames        = args.removeIntValue<uint64_t> ("--warmup", sampleRate);
+        repetitions         = std::max (1u, args.removeIntValue<uint32_t> ("--repetitions", repetitions));
+        parameterChanges    = args.removeIntValue<uint32_t> ("--parameterChanges", parameterChanges);
+
+        if (sampleRate == 0)
+            throw std::runtime_error ("Illegal sample rate");
+
+        if (framesToRender == 0)
+            throw std::runtime_error ("Illegal length");
+
+        if (auto json = args.removeValueFor ("--json"))
+            jsonOutputFile = *json;
+
+        auto files = args.getAllAsExistingFiles();
+
+        if (files.size() != 1 || files[0].extension() != ".cmajorpatch")
+            throw std::runtime_error ("Expected a .cmajorpatch file");
+
+        patchFile = files[0].string();
+    }
+
+    std::string patchFile, inputAudioFile, inputMIDIFile, jsonOutputFile;
+    std::vector<uint32_t> blockSizes { 64, 256, 1024 };
+    uint32_t sampleRate = 44100, repetitions = 5, parameterChanges = 0;
+    uint64_t framesToRender = 0, warmUpFrames = 0;
+};
+
+//==============================================================================
+/// Builds a patch once, then renders it at each of the requested block sizes,
+/// timing every individual block so that the latency distribution can be reported
+/// as well as the overall throughput.
+struct BenchRunner
+{
+    BenchRunner (const BenchOptions& o,
+                 const choc::value::Value& engineOptions,
+                 cmaj::BuildSettings& buildSettings)
+      : options (o), patchPlayer (engineOptions, buildSettings, false)
+    {
+        maxBlockSize = *std::max_element (options.blockSizes.begin(), options.blockSizes.end());
+
+        patchPlayer.onStatusChange = [] (const cmaj::Patch::Status& s)
+        {
+            if (s.messageList.hasErrors())
+                throw std::runtime_error (s.messageList.toString());
+        };
+
+        cmaj::PatchManifest manifest;
+        manifest.initialiseWithFile (options.patchFile);
+
+        if (! patchPlayer.patch.preload (manifest))
+            throw std::runtime_error ("Could not load patch");
+
+        numInputChannels  = getNumAudioChannels (patchPlayer.patch.getInputEndpoints());
+        numOutputChannels = getNumAudioChannels (patchPlayer.patch.getOutputEndpoints());
+
+        if (! options.inputAudioFile.empty())
+            loadInputAudio();
+
+        if (! options.inputMIDIFile.empty())
+            loadInputMIDI();
+
+        // All the block sizes are rendered by the same build, so it's linked for the largest one
+        patchPlayer.patch.setPlaybackParams (cmaj::Patch::PlaybackParams (options.sampleRate, maxBlockSize,
+                                                                         numInputChannels, numOutputChannels), false);
+
+        auto buildStart = Clock::now();
+
+        if (! patchPlayer.loadPatch (options.patchFile, true) || ! patchPlayer.patch.isPlayable())
+            throw std::runtime_error ("Could not build patch");
+
+        buildMilliseconds = getMilliseconds (Clock::now() - buildStart);
+
+        // Patch::process() renders in-place, so the buffer holds whichever is larger of the inputs and outputs
+        auto numChannels = std::max (1u, std::max (numInputChannels, numOutputChannels));
+        audioBuffer.resize ({ numChannels, maxBlockSize });
+        channelPointers.resize (numChannels);
+
+        for (uint32_t i = 0; i < numChannels; ++i)
+            channelPointers[i] = audioBuffer.getView().getChannel (i).data.data;
+
+        if (inputAudio.getNumFrames() == 0)
+            createSyntheticInput();
+
+        for (auto& param : patchPlayer.patch.getParameterList())
+            parameters.push_back (param);
+    }
+
+    choc::value::Value run()
+    {
+        auto result = choc::value::createObject ("BenchmarkResults",
+                                                 "patch", options.patchFile,
+                                                 "sampleRate", static_cast<int32_t> (options.sampleRate),
+                                                 "buildMilliseconds", buildMilliseconds);
+
+        firstBlockMicroseconds = renderBlock (options.blockSizes.front());
+        result.addMember ("firstBlockMicroseconds", firstBlockMicroseconds);
+
+        auto blockSizeResults = choc::value::createEmptyArray();
+
+        for (auto blockSize : options.blockSizes)
+            blockSizeResults.addArrayElement (runBlockSize (blockSize));
+
+        result.addMember ("blockSizes", blockSizeResults);
+
+        // Only present if the patch was built with --profileNodes
+        if (auto profile = patchPlayer.patch.getNodeProfile(); profile.isArray())
+            result.addMember ("nodeProfile", profile);
+
+        return result;
+    }
+
+    static void printSummary (const choc::value::ValueView& results)
+    {
+        std::cout << "Patch: " << results["patch"].toString() << std::endl
+                  << "Build time: " << choc::text::floatToString (results["buildMilliseconds"].getFloat64(), 2) << "ms" << std::endl
+                  << "First block: " << choc::text::floatToString (results["firstBlockMicroseconds"].getFloat64(), 2) << "us" << std::endl;
+
+        for (const auto& r : results["blockSizes"])
+            std::cout << "Block size " << r["blockSize"].getInt32() << ":"
+                      << "  p50 " << choc::text::floatToString (r["p50Microseconds"].getFloat64(), 2) << "us"
+                      << "  p99 " << choc::text::floatToString (r["p99Microseconds"].getFloat64(), 2) << "us"
+                      << "  max " << choc::text::floatToString (r["maxMicroseconds"].getFloat64(), 2) << "us"
+                      << "  " << choc::text::floatToString (r["framesPerSecond"].getFloat64(), 0) << " frames/sec"
+                      << " (" << choc::text::floatToString (r["realtimeRatio"].getFloat64(), 1) << "x realtime)" << std::endl;
+
+        if (results.hasObjectMember ("nodeProfile"))
+            printNodeProfile (results["nodeProfile"]);
+    }
+
+    static void printNodeProfile (const choc::value::ValueView& profile)
+    {
+        std::vector<choc::value::ValueView> nodes;
+        int64_t totalCycles = 0;
+
+        for (const auto& node : profile)
+        {
+            nodes.push_back (node);
+            totalCycles += node["cycles"].getInt64();
+        }
+
+        std::sort (nodes.begin(), nodes.end(), [] (const auto& a, const auto& b) { return a["cycles"].getInt64() > b["cycles"].getInt64(); });
+
+        std::cout << "Node profile (all block sizes):" << std::endl;
+
+        for (auto& node : nodes)
+        {
+            auto cycles = node["cycles"].getInt64();
+            auto calls = node["calls"].getInt64();
+
+            std::cout << "  " << node["node"].toString() << ": "
+                      << choc::text::floatToString (totalCycles > 0 ? 100.0 * static_cast<double> (cycles) / static_cast<double> (totalCycles) : 0.0, 1) << "%"
+                      << "  " << (calls > 0 ? cycles / calls : 0) << " cycles/call"
+                      << "  " << calls << " calls" << std::endl;
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const BenchOptions& options;
+    cmaj::PatchPlayer patchPlayer;
+
+    uint32_t maxBlockSize = 0, numInputChannels = 0, numOutputChannels = 0;
+    double buildMilliseconds = 0, firstBlockMicroseconds = 0;
+
+    choc::buffer::ChannelArrayBuffer<float> inputAudio, audioBuffer;
+    std::vector<float*> channelPointers;
+    uint64_t inputPosition = 0, framesRendered = 0;
+
+    struct TimedMIDIMessage
+    {
+        double time;
+        choc::midi::ShortMessage message;
+    };
+
+    std::vector<TimedMIDIMessage> inputMIDI;
+    double midiSequenceLength = 0;
+    std::vector<cmaj::PatchParameterPtr> parameters;
+    std::minstd_rand random { 1234 };
+
+    static double getMilliseconds (Clock::duration d)   { return std::chrono::duration<double, std::milli> (d).count(); }
+    static double getMicroseconds (Clock::duration d)   { return std::chrono::duration<double, std::micro> (d).count(); }
+
+    static uint32_t getNumAudioChannels (const cmaj::EndpointDetailsList& endpoints)
+    {
+        uint32_t channels = 0;
+
+        for (auto& e : endpoints)
+            channels += e.getNumAudioChannels();
+
+        return channels;
+    }
+
+    void loadInputAudio()
+    {
+        auto reader = cmaj::audio_utils::createFileReader (options.inputAudioFile);
+
+        if (reader == nullptr)
+            throw std::runtime_error ("Couldn't open input file");
+
+        auto& properties = reader->getProperties();
+        auto numFrames = static_cast<choc::buffer::FrameCount> (std::min<uint64_t> (properties.numFrames, options.sampleRate * 60ull));
+        numInputChannels = properties.numChannels;
+
+        inputAudio.resize ({ numInputChannels, numFrames });
+
+        if (! reader->readFrames (0, inputAudio.getView()))
+            throw std::runtime_error ("Failed to read from audio input");
+    }
+
+    void loadInputMIDI()
+    {
+        auto content = choc::file::loadFileAsString (options.inputMIDIFile);
+
+        choc::midi::File midi;
+        midi.load (content.data(), content.size());
+
+        for (auto& e : midi.toSequence().events)
+            if (e.message.isShortMessage())
+                inputMIDI.push_back ({ e.timeStamp, choc::midi::ShortMessage (e.message) });
+
+        if (! inputMIDI.empty())
+            midiSequenceLength = inputMIDI.back().time + 0.001;
+    }
+
+    // Without an input file, the patch gets a few seconds of noise and, if it takes
+    // MIDI, a repeating pattern of short notes.
+    void createSyntheticInput()
+    {
+        if (numInputChannels != 0)
+        {
+            std::uniform_real_distribution<float> noise (-0.5f, 0.5f);
+            inputAudio.resize ({ numInputChannels, options.sampleRate * 4u });
+
+            for (uint32_t chan = 0; chan < numInputChannels; ++chan)
+                for (uint32_t frame = 0; frame < inputAudio.getNumFrames(); ++frame)
+                    inputAudio.getSample (chan, frame) = noise (random);
+        }
+
+        if (inputMIDI.empty() && patchPlayer.patch.hasMIDIInput())
+        {
+            constexpr double noteInterval = 0.125;
+
+            for (int i = 0; i < 32; ++i)
+            {
+                auto note = static_cast<uint8_t> (48 + (i * 7) % 24);
+                inputMIDI.push_back ({ i * noteInterval,         choc::midi::ShortMessage (0x90, note, 100) });
+                inputMIDI.push_back ({ (i + 0.5) * noteInterval, choc::midi::ShortMessage (0x80, note, 0) });
+            }
+
+            midiSequenceLength = 32 * noteInterval;
+        }
+    }
+
+    void prepareInputForBlock (uint32_t numFrames)
+    {
+        if (inputAudio.getNumFrames() != 0)
+        {
+            auto totalInputFrames = inputAudio.getNumFrames();
+
+            for (uint32_t i = 0; i < numFrames; ++i)
+            {
+                auto sourceFrame = static_cast<uint32_t> ((inputPosition + i) % totalInputFrames);
+
+                for (uint32_t chan = 0; chan < inputAudio.getNumChannels(); ++chan)
+                    channelPointers[chan][i] = inputAudio.getSample (chan, sourceFrame);
+            }
+
+            inputPosition += numFrames;
+        }
+
+        if (midiSequenceLength > 0)
+        {
+            auto blockStart = std::fmod (static_cast<double> (framesRendered) / options.sampleRate, midiSequenceLength);
+            auto blockEnd = blockStart + static_cast<double> (numFrames) / options.sampleRate;
+
+            for (auto& e : inputMIDI)
+            {
+                auto time = e.time < blockStart ? e.time + midiSequenceLength : e.time;
+
+                if (time >= blockStart && time < blockEnd)
+                    patchPlayer.patch.addMIDIMessage (static_cast<int> ((time - blockStart) * options.sampleRate),
+                                                      e.message.midiData.bytes, e.message.size());
+            }
+        }
+
+        if (! parameters.empty())
+        {
+            std::uniform_real_distribution<float> position (0.0f, 1.0f);
+
+            for (uint32_t i = 0; i < options.parameterChanges; ++i)
+            {
+                auto& param = parameters[random() % parameters.size()];
+                param->setValue (param->properties.convertFrom0to1 (position (random)), false, -1, 0);
+            }
+        }
+    }
+
+    double renderBlock (uint32_t numFrames)
+    {
+        prepareInputForBlock (numFrames);
+
+        auto start = Clock::now();
+        patchPlayer.patch.process (channelPointers.data(), numFrames, [] (uint32_t, choc::midi::ShortMessage) {});
+        auto elapsed = getMicroseconds (Clock::now() - start);
+
+        framesRendered += numFrames;
+        return elapsed;
+    }
+
+    choc::value::Value runBlockSize (uint32_t blockSize)
+    {
+        auto numWarmUpBlocks = static_cast<uint32_t> ((options.warmUpFrames + blockSize - 1) / blockSize);
+        auto numBlocksPerRun = static_cast<uint32_t> (std::max<uint64_t> (1, options.framesToRender / blockSize));
+
+        for (uint32_t i = 0; i < numWarmUpBlocks; ++i)
+            renderBlock (blockSize);
+
+        std::vector<double> blockTimes;
+        blockTimes.reserve (static_cast<size_t> (numBlocksPerRun) * options.repetitions);
+        std::vector<double> runFramesPerSecond;
+
+        for (uint32_t rep = 0; rep < options.repetitions; ++rep)
+        {
+            double totalMicroseconds = 0;
+
+            for (uint32_t i = 0; i < numBlocksPerRun; ++i)
+            {
+                auto t = renderBlock (blockSize);
+                blockTimes.push_back (t);
+                totalMicroseconds += t;
+            }
+
+            runFramesPerSecond.push_back (numBlocksPerRun * static_cast<double> (blockSize) * 1.0e6 / std::max (totalMicroseconds, 1.0e-3));
+        }
+
+        std::sort (blockTimes.begin(), blockTimes.end());
+        std::sort (runFramesPerSecond.begin(), runFramesPerSecond.end());
+
+        auto getPercentile = [] (const std::vector<double>& sorted, double percentile)
+        {
+            auto index = static_cast<size_t> (std::ceil (percentile / 100.0 * static_cast<double> (sorted.size())));
+            return sorted[std::min (sorted.size() - 1, index > 0 ? index - 1 : 0)];
+        };
+
+        double mean = 0, variance = 0;
+
+        for (auto t : blockTimes)
+            mean += t;
+
+        mean /= static_cast<double> (blockTimes.size());
+
+        for (auto t : blockTimes)
+            variance += (t - mean) * (t - mean);
+
+        variance /= static_cast<double> (blockTimes.size());
+
+        auto framesPerSecond = getPercentile (runFramesPerSecond, 50);
+
+        return choc::value::createObject ("BlockSizeResult",
+                                          "blockSize", static_cast<int32_t> (blockSize),
+                                          "repetitions", static_cast<int32_t> (options.repetitions),
+                                          "blocksPerRepetition", static_cast<int32_t> (numBlocksPerRun),
+                                          "p50Microseconds", getPercentile (blockTimes, 50),
+                                          "p99Microseconds", getPercentile (blockTimes, 99),
+                                          "maxMicroseconds", blockTimes.back(),
+                                          "meanMicroseconds", mean,
+                                          "stdDevMicroseconds", std::sqrt (variance),
+                                          "framesPerSecond", framesPerSecond,
+                                          "minFramesPerSecond", runFramesPerSecond.front(),
+                                          "maxFramesPerSecond", runFramesPerSecond.back(),
+                                          "realtimeRatio", framesPerSecond / options.sampleRate);
+    }
+};
+
+//==============================================================================
+void bench (choc::ArgumentList& args, const choc::value::Value& engineOptions, cmaj::BuildSettings& buildSettings)
+{
+    if (args.removeIfFound ("--performer"))
+    {
+        choc::test::TestProgress progress;
+        cmaj::performer_benchmarks::runBenchmarks (progress);
+        progress.printReport();
+
+        if (progress.numFails > 0)
+            throw std::runtime_error ("");
+
+        return;
+    }
+
+    BenchOptions options;
+    options.parseArguments (args);
+
+    choc::messageloop::initialise();
+
+    std::optional<std::exception> exceptionThrown;
+
+    auto t = std::thread ([&]
+    {
+        try
+        {
+            BenchRunner runner (options, engineOptions, buildSettings);
+            auto results = runner.run();
+
+            if (options.jsonOutputFile == "-")
+            {
+                std::cout << choc::json::toString (results, true) << std::endl;
+            }
+            else
+            {
+                BenchRunner::printSummary (results);
+
+                if (! options.jsonOutputFile.empty())
+                    choc::file::replaceFileWithContent (options.jsonOutputFile, choc::json::toString (results, true));
+            }
+        }
+        catch (const std::exception& e)
+        {
+            exceptionThrown = std::runtime_error (e.what());
+        }
+        catch (...)
+        {
+            exceptionThrown = std::runtime_error ("unknown exception");
+        }
+
+        choc::messageloop::stop();
+    });
+
+    choc::messageloop::run();
+    t.join();
+
+    if (exceptionThrown)
+        throw *exceptionThrown;
+}
@@ -18,6 +18,7 @@
 
 #include "../../../include/cmajor/API/cmaj_Program.h"
 #include "../../../include/cmajor/helpers/cmaj_Patch.h"
+#include "../../../include/cmajor/helpers/cmaj_PerformerLibrary.h"
 #include "../../../include/cmajor/helpers/cmaj_PatchWorker_QuickJS.h"
 #include "../../../include/cmajor/helpers/cmaj_PatchWorker_WebView.h"
 #include "../../../modules/embedded_assets/cmaj_EmbeddedAssets.h"
@@ -67,6 +68,7 @@ static std::string getCodeGenTargetHelp (std::string_view type)
     if (type == "wam")            return "Converts a patch to a Javascript web audio module";
     if (type == "wast")           return "Compiles a patch to a chunk of WAST code";
     if (type == "llvm")           return "Dumps the assembly code for a patch or set of .cmajor files for the specified target architecture";
+    if (type == "sharedlib")      return "Compiles a patch to a native shared library which can be loaded with createEngineForPerformerLibrary()";
 
     return {};
 }
@@ -84,6 +86,32 @@ static std::string getCodeGenTargetHelp()
     return table.toString ({}, "  ", "\n");
 }
 
+//==============================================================================
+/// The sharedlib target produces position-independent object code, which is linked into
+/// a shared library here, unless the output filename asks for the object file itself.
+static void writePerformerLibrary (choc::ArgumentList& args, const std::string& outputFile, const std::string& objectCode)
+{
+    if (outputFile.empty())
+        throw std::runtime_error ("Expected an argument --output=<library file>");
+
+    auto outputPath = std::filesystem::path (outputFile);
+    std::string linker = "c++";
+
+    if (auto l = args.removeValueFor ("--linker"))
+        linker = *l;
+
+    if (outputPath.extension() == ".o" || outputPath.extension() == ".obj")
+        return choc::file::replaceFileWithContent (outputPath, objectCode);
+
+   #ifdef _WIN32
+    (void) linker;
+    throw std::runtime_error ("Can't link a shared library on Windows - use an --output file ending in .obj to get the object code");
+   #else
+    if (auto error = cmaj::linkPerformerLibrary (objectCode, absolute (outputPath).string(), linker); ! error.empty())
+        throw std::runtime_error ("Failed to link " + outputFile + ":\n" + error);
+   #endif
+}
+
 //==============================================================================
 void generateFromPatch (choc::ArgumentList& args,
                         std::filesystem::path patchManifestFile,
@@ -145,9 +173,23 @@ void generateFromPatch (choc::ArgumentList& args,
         if (auto format = args.removeValueFor ("--targetFormat"))
             options.addMember ("targetFormat", *format);
 
+        if (auto cpus = args.removeValueFor ("--multiversion"))
+            options.addMember ("multiversion", *cpus);
+
         optionsJSON = choc::json::toString (options, false);
     }
 
+    if (targetType == "sharedlib")
+    {
+        auto options = choc::value::createObject ({});
+
+        if (auto cpus = args.removeValueFor ("--multiversion"))
+            options.addMember ("multiversion", *cpus);
+
+        return writePerformerLibrary (args, outputFile, generateCodeAndCheckResult (patch, loadParams, targetType,
+                                                                                    choc::json::toString (options, false)).generatedCode);
+    }
+
     writeToFolderOrConsole (outputFile, generateCodeAndCheckResult (patch, loadParams, targetType, optionsJSON).generatedCode);
 }
 
@@ -0,0 +1,339 @@
+//
+//     ,ad888ba,                              88
+//    d8"'    "8b
+//   d8            88,dba,,adba,   ,aPP8A.A8  88     The Cmajor Toolkit
+//   Y8,           88    88    88  88     88  88
+//    Y8a.   .a8P  88    88    88  88,   ,88  88     (C)2024 Cmajor Software Ltd
+//     '"Y888Y"'   88    88    88  '"8bbP"Y8  88     https://cmajor.dev
+//                                           ,88
+//                                        888P"
+//
+//  The Cmajor project is subject to commercial or open-source licensing.
+//  You may use it under the terms of the GPLv3 (see www.gnu.org/licenses), or
+//  visit https://cmajor.dev to learn about our commercial licence options.
+//
+//  CMAJOR IS PROVIDED "AS IS" WITHOUT ANY WARRANTY, AND ALL WARRANTIES, WHETHER
+//  EXPRESSED OR IMPLIED, INCLUDING MERCHANTABILITY AND FITNESS FOR PURPOSE, ARE
+//  DISCLAIMED.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include "choc/tests/choc_UnitTest.h"
+#include "cmajor/API/cmaj_Engine.h"
+#include "cmajor/helpers/cmaj_AudioMIDIPerformer.h"
+#include "../../../modules/compiler/src/backends/cmaj_PerformerThunk.h"
+
+namespace cmaj::performer_benchmarks
+{
+    /// These are run by `cmaj bench --performer` rather than with the unit tests. They don't
+    /// fail on slow timings, they just report them, so that changes to the performer's hot
+    /// paths can be compared by running them before and after.
+    template <typename Fn>
+    static double getAverageNanoseconds (uint32_t numIterations, Fn&& fn)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < numIterations; ++i)
+            fn();
+
+        auto elapsed = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now() - start);
+        return elapsed.count() / numIterations;
+    }
+
+    static std::string formatNanoseconds (double ns)
+    {
+        return choc::text::floatToString (ns, 2) + "ns";
+    }
+
+    //==============================================================================
+    /// Measures the per-block cost of a minimal processor, and the extra cost of
+    /// sending and receiving each event, through the public performer API.
+    static void benchmarkPerformerOverhead (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (PerformerOverhead);
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float32 in;
+                output stream float32 out;
+                input event int32 eventIn;
+                output event int32 eventOut;
+
+                event eventIn (int32 i)
+                {
+                    eventOut <- i;
+                }
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- in;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        auto inHandle       = engine.getEndpointHandle ("in");
+        auto outHandle      = engine.getEndpointHandle ("out");
+        auto eventInHandle  = engine.getEndpointHandle ("eventIn");
+        auto eventOutHandle = engine.getEndpointHandle ("eventOut");
+
+        constexpr uint32_t blockSize = 512, numEventsPerBlock = 32, numBlocks = 2000;
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (blockSize)
+                                                      .setEventBufferSize (numEventsPerBlock));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+        auto performer = engine.createPerformer();
+        CHOC_EXPECT_TRUE (performer);
+
+        if (! performer)
+            return;
+
+        std::vector<float> inputFrames (blockSize, 0.5f), outputFrames (blockSize);
+        uint32_t numEventsReceived = 0;
+
+        auto renderBlock = [&] (uint32_t numEvents)
+        {
+            performer.setBlockSize (blockSize);
+            performer.setInputFrames (inHandle, inputFrames.data(), blockSize);
+
+            for (uint32_t i = 0; i < numEvents; ++i)
+                performer.addInputEvent (eventInHandle, 0, static_cast<int32_t> (i));
+
+            performer.advance();
+            performer.copyOutputFrames (outHandle, outputFrames.data(), blockSize);
+
+            performer.iterateOutputEvents (eventOutHandle, [&] (auto, uint32_t, uint32_t, const void*, uint32_t)
+            {
+                ++numEventsReceived;
+                return true;
+            });
+        };
+
+        auto blockTime = getAverageNanoseconds (numBlocks, [&] { renderBlock (0); });
+        auto blockWithEventsTime = getAverageNanoseconds (numBlocks, [&] { renderBlock (numEventsPerBlock); });
+
+        CHOC_EXPECT_EQ (numEventsReceived, numBlocks * numEventsPerBlock);
+        CHOC_EXPECT_EQ (outputFrames.back(), 0.5f);
+
+        progress.print ("Performer overhead: " + formatNanoseconds (blockTime) + " per " + std::to_string (blockSize) + "-frame block, "
+                          + formatNanoseconds ((blockWithEventsTime - blockTime) / numEventsPerBlock) + " per event");
+    }
+
+    //==============================================================================
+    /// Compares the way the performer used to call its endpoint handlers with the way it
+    /// calls them now, for the same work. Before, reading a block of output events cost
+    /// two std::function calls per event plus two per block. Now it's a single thunk call
+    /// per block, which moves all the events itself. Both sides read the same native event
+    /// list, and are called through a volatile pointer so that the compiler can't see
+    /// through the dispatch and inline it, as it can't in the real performer.
+    static void benchmarkHandlerDispatch (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (HandlerDispatch);
+
+        struct NativeEvent
+        {
+            uint32_t frame, type;
+            int32_t value;
+        };
+
+        struct QueuedEvent
+        {
+            uint32_t frame = 0, type = 0;
+            int32_t value = 0;
+        };
+
+        constexpr uint32_t numEventsPerBlock = 32, numBlocks = 20000;
+
+        std::vector<NativeEvent> nativeEvents;
+        std::vector<QueuedEvent> queue (numEventsPerBlock);
+        uint32_t eventCount = 0;
+
+        for (uint32_t i = 0; i < numEventsPerBlock; ++i)
+            nativeEvents.push_back ({ i, 0, static_cast<int32_t> (i) });
+
+        auto readEvent = [&] (uint32_t index, QueuedEvent& dest)
+        {
+            auto& e = nativeEvents[index];
+            dest.type  = e.type;
+            dest.frame = e.frame;
+            std::memcpy (std::addressof (dest.value), std::addressof (e.value), sizeof (int32_t));
+        };
+
+        // Before: one type-erased call to find each event's type and another to read it
+        struct StdFunctionHandlers
+        {
+            std::function<uint32_t()>                       getNumOutputEvents;
+            std::function<uint32_t(uint32_t)>               getEventTypeIndex;
+            std::function<uint32_t(uint32_t, QueuedEvent&)> readOutputEvent;
+            std::function<void()>                           resetEventCount;
+        };
+
+        StdFunctionHandlers stdFunctionHandlers
+        {
+            [&] { return eventCount; },
+            [&] (uint32_t index) { return nativeEvents[index].type; },
+            [&] (uint32_t index, QueuedEvent& dest) { readEvent (index, dest); return dest.frame; },
+            [&] { eventCount = 0; }
+        };
+
+        auto* volatile oldHandlers = std::addressof (stdFunctionHandlers);
+
+        auto stdFunctionTime = getAverageNanoseconds (numBlocks, [&]
+        {
+            eventCount = numEventsPerBlock;
+            auto& handlers = *oldHandlers;
+            auto numEvents = handlers.getNumOutputEvents();
+
+            for (uint32_t i = 0; i < numEvents; ++i)
+            {
+                queue[i].type = handlers.getEventTypeIndex (i);
+                handlers.readOutputEvent (i, queue[i]);
+            }
+
+            handlers.resetEventCount();
+        });
+
+        // After: a plain function and context pointer, called once for the whole block
+        PerformerThunkContexts contexts;
+
+        auto readOutputEvents = contexts.create<uint32_t(QueuedEvent*, uint32_t)> ([&] (QueuedEvent* dest, uint32_t maxEvents)
+        {
+            auto numEvents = std::min (eventCount, maxEvents);
+
+            for (uint32_t i = 0; i < numEvents; ++i)
+                readEvent (i, dest[i]);
+
+            eventCount = 0;
+            return numEvents;
+        });
+
+        auto* volatile newHandler = std::addressof (readOutputEvents);
+
+        auto thunkTime = getAverageNanoseconds (numBlocks, [&]
+        {
+            eventCount = numEventsPerBlock;
+            (*newHandler) (queue.data(), numEventsPerBlock);
+        });
+
+        CHOC_EXPECT_EQ (queue.back().value, static_cast<int32_t> (numEventsPerBlock - 1));
+
+        // And the cost of a single call, which is what each value or event sent to an input pays
+        int32_t total = 0;
+        std::function<void(int32_t)> addStdFunction = [&] (int32_t v) { total += v; };
+        auto addThunk = contexts.create<void(int32_t)> ([&] (int32_t v) { total += v; });
+
+        auto* volatile stdFunctionToCall = std::addressof (addStdFunction);
+        auto* volatile thunkToCall = std::addressof (addThunk);
+
+        constexpr uint32_t numCalls = 1000000;
+        auto stdFunctionCallTime = getAverageNanoseconds (numCalls, [&] { (*stdFunctionToCall) (1); });
+        auto thunkCallTime       = getAverageNanoseconds (numCalls, [&] { (*thunkToCall) (1); });
+
+        CHOC_EXPECT_EQ (total, static_cast<int32_t> (2 * numCalls));
+
+        progress.print ("Output event dispatch, " + std::to_string (numEventsPerBlock) + " events per block:"
+                          + " std::function " + formatNanoseconds (stdFunctionTime) + " per block (" + formatNanoseconds (stdFunctionTime / numEventsPerBlock) + " per event),"
+                          + " thunk " + formatNanoseconds (thunkTime) + " per block (" + formatNanoseconds (thunkTime / numEventsPerBlock) + " per event)");
+
+        progress.print ("Single handler call: std::function " + formatNanoseconds (stdFunctionCallTime)
+                          + ", thunk " + formatNanoseconds (thunkCallTime));
+    }
+
+    //==============================================================================
+    /// Compares the AudioMIDIPerformer's render throughput for a range of host block
+    /// sizes, where each one is also used as the engine's maximum block size.
+    static void benchmarkAudioMIDIPerformerBlockSizes (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (AudioMIDIPerformerBlockSizes);
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float32<2> in;
+                output stream float32<2> out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- in * 0.5f;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        constexpr uint32_t totalFramesToRender = 1u << 20;
+        std::string results;
+
+        for (uint32_t blockSize : { 64u, 512u, 2048u, 8192u })
+        {
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+            auto engine = cmaj::Engine::create ("llvm");
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                          .setMaxBlockSize (blockSize));
+
+            CHOC_EXPECT_TRUE (program.parse (messages, "", source));
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            cmaj::AudioMIDIPerformer::Builder builder (engine, 4096);
+            builder.connectAudioInputTo ({ 0, 1 }, engine.getInputEndpoints().endpoints.front(), { 0, 1 }, {});
+            builder.connectAudioOutputTo (engine.getOutputEndpoints().endpoints.front(), { 0, 1 }, { 0, 1 }, {});
+
+            CHOC_EXPECT_TRUE (engine.link (messages, {}));
+            auto performer = builder.createPerformer();
+
+            if (! performer->prepareToStart())
+            {
+                CHOC_FAIL ("Failed to create performer");
+                return;
+            }
+
+            std::vector<float> inputData (2 * blockSize, 0.5f), outputData (2 * blockSize);
+            std::array<const float*, 2> inputChannels { { inputData.data(), inputData.data() + blockSize } };
+            std::array<float*, 2> outputChannels { { outputData.data(), outputData.data() + blockSize } };
+
+            auto block = choc::audio::AudioMIDIBlockDispatcher::Block { choc::buffer::createChannelArrayView (inputChannels.data(), 2u, blockSize),
+                                                                        choc::buffer::createChannelArrayView (outputChannels.data(), 2u, blockSize),
+                                                                        {}, {} };
+
+            auto frameTime = getAverageNanoseconds (totalFramesToRender / blockSize, [&]
+            {
+                performer->process (block, true);
+            }) / blockSize;
+
+            CHOC_EXPECT_EQ (outputData.back(), 0.25f);
+
+            results += "  " + std::to_string (blockSize) + " frames: " + formatNanoseconds (frameTime) + " per frame";
+        }
+
+        progress.print ("AudioMIDIPerformer block sizes:" + results);
+    }
+
+    static void runBenchmarks (choc::test::TestProgress& progress)
+    {
+        CHOC_CATEGORY (PerformerBenchmarks);
+
+        benchmarkPerformerOverhead (progress);
+        benchmarkHandlerDispatch (progress);
+        benchmarkAudioMIDIPerformerBlockSizes (progress);
+    }
+}
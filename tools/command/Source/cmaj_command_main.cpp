@@ -26,6 +26,7 @@
 
 #include "cmaj_command_Generate.h"
 #include "cmaj_command_Render.h"
+#include "cmaj_command_Bench.h"
 #include "cmaj_command_CreatePatch.h"
 #include "cmaj_command_RunTests.h"
 
@@ -69,6 +70,14 @@ cmaj <command> [options]    Runs the given command. Options can include the foll
     --debug                 Turn on debug output from the performer
     --sessionID=n           Set the session id to the given value
     --eventBufferSize=n     Set the max number of events per buffer
+    --targetCPU=<cpu>       Build native code for "host" (default), "baseline", or a named CPU
+    --targetFeatures=<list> Extra CPU features for native code, e.g. +avx2,+fma
+    --profileNodes          Count the CPU cycles used by each node of the main graph (LLVM only)
+    --tiered                Start running quickly-compiled code while optimising in the background (LLVM only)
+    --compileThreads=n      The number of threads to use for generating machine code (LLVM only, default is 1)
+    --lazyHandlers          Compile input event and value handlers in the background after linking (LLVM only)
+    --cacheObjectCode       Keep machine code in the build cache, so identical programs skip code generation (LLVM only)
+    --sparseStreamSettleFrames=n  Stop running graph nodes whose streams have been silent for n frames (default 0 = off)
     --engine=<type>         Use the specified engine - e.g. llvm, webview, cpp
     --simd                  WASM generation uses SIMD/non-SIMD at runtime (default)
     --no-simd               WASM generation does not emit SIMD
@@ -120,6 +129,22 @@ cmaj render [opts] <file>   Renders the given file or patch
     --input=<file>          Use input from the given file
     --midi=<file>           Use input MIDI data from the given file
 
+cmaj bench [opts] <file>    Builds the given patch once, and measures how long it takes to render
+
+    --blockSizes=<list>     A comma-separated list of block sizes to measure (default 64,256,1024)
+    --rate=<rate>           Use the specified sample rate (default 44100)
+    --length=<frames>       The number of frames to render for each repetition (default 10 seconds)
+    --warmup=<frames>       The number of frames to render before measuring each block size
+    --repetitions=n         How many times to repeat the measurement for each block size
+    --input=<file>          Use input audio from the given file (default is generated noise)
+    --midi=<file>           Use input MIDI data from the given file (default is a generated pattern)
+    --parameterChanges=n    Set this many randomly chosen parameters before each block
+    --json=<file>           Write the results to the given file as JSON, or use "-" to print
+                            only the JSON to stdout
+    --performer             Instead of a patch, measure the overhead of the performer API itself:
+                            the cost per block and per event, and the AudioMIDIPerformer's
+                            throughput at a range of block sizes
+
 cmaj generate [opts] <file> Generates some code from the given file or patch
 
     Performs various types of code-gen output. Targets are:
@@ -132,6 +157,12 @@ CODE_GEN_TARGETS
     --clapIncludePath=<folder>  If generating a CLAP plugin, this is the path to your CLAP include folder
     --cmajorIncludePath=<folder>  If generating a plugin, this is the path to your cmajor/include folder
     --maxFramesPerBlock=n   Specify the maximum block size when generating code
+    --multiversion=<cpus>   For --target=llvm or sharedlib, adds versions of advanceBlock tuned for
+                            each of a comma-separated list of x86 CPUs (e.g. x86-64-v3,x86-64-v4),
+                            one of which is chosen when the program is initialised
+    --linker=<command>      For --target=sharedlib, the command used to link the library (default
+                            "c++"), which is split into arguments at its spaces and run without a
+                            shell. If the output file ends in .o, the object code is written instead
 
 cmaj create [opts] <folder> Creates a folder containing files for a new empty patch
 
@@ -168,6 +199,30 @@ static cmaj::BuildSettings parseBuildArgs (choc::ArgumentList& args)
     if (auto bufferSize = args.removeIntValue<uint32_t> ("--eventBufferSize"))
         buildSettings.setEventBufferSize (*bufferSize);
 
+    if (auto cpu = args.removeValueFor ("--targetCPU"))
+        buildSettings.setTargetCPU (*cpu);
+
+    if (auto features = args.removeValueFor ("--targetFeatures"))
+        buildSettings.setTargetFeatures (*features);
+
+    if (args.removeIfFound ("--profileNodes"))
+        buildSettings.setNodeProfiling (true);
+
+    if (args.removeIfFound ("--tiered"))
+        buildSettings.setTieredCompilation (true);
+
+    if (auto threads = args.removeIntValue<uint32_t> ("--compileThreads"))
+        buildSettings.setNumCompileThreads (*threads);
+
+    if (args.removeIfFound ("--lazyHandlers"))
+        buildSettings.setLazyHandlerCompilation (true);
+
+    if (args.removeIfFound ("--cacheObjectCode"))
+        buildSettings.setCacheObjectCode (true);
+
+    if (auto settleFrames = args.removeIntValue<uint32_t> ("--sparseStreamSettleFrames"))
+        buildSettings.setSparseStreamSettleFrames (*settleFrames);
+
     return buildSettings;
 }
 
@@ -248,6 +303,7 @@ static void performCommandLineTask (choc::ArgumentList& args)
     if (isCommand (args, "server"))    return runServerProcess (args, engine, buildSettings, parseAudioDeviceArgs (args));
     if (isCommand (args, "generate"))  return generate (args, engine, buildSettings);
     if (isCommand (args, "render"))    return render (args, engine, buildSettings);
+    if (isCommand (args, "bench"))     return bench (args, engine, buildSettings);
     if (isCommand (args, "test"))      return runTests (args, engine, buildSettings);
     if (isCommand (args, "create"))    return createPatch (args);
     if (isCommand (args, "unit-test")) return runUnitTests (args, engine, buildSettings);
@@ -19,7 +19,10 @@
 #pragma once
 
 #include <map>
+#include <thread>
 #include "cmajor/API/cmaj_Engine.h"
+#include "cmajor/helpers/cmaj_PerformerLibrary.h"
+#include "cmajor/helpers/cmaj_PerformerBatch.h"
 
 namespace cmaj::api_tests
 {
@@ -398,6 +401,1323 @@ namespace cmaj::api_tests
         CHOC_EXPECT_EQ (output, "111111");
     }
 
+    static void checkPackedExternalData (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkPackedExternalData)
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                output event int32 out;
+
+                external float32[] mono;
+                external float32<2>[] stereo;
+                external int64[4] table;
+
+                int index;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- int32 (mono.at (index) * 2.0f)
+                            <- int32 (stereo.at (index)[1])
+                            <- int32 (table.at (index));
+
+                        index = (index + 1) % 4;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+
+        bool result = engine.load (messages, program, [&] (const cmaj::ExternalVariable& e) -> choc::value::Value
+                                                      {
+                                                          if (e.name == "P::mono")
+                                                              return choc::value::createArray (1000u, [] (uint32_t i) { return static_cast<float> (i) + 0.5f; });
+
+                                                          if (e.name == "P::stereo")
+                                                              return choc::value::createArray (4u, [] (uint32_t i)
+                                                              {
+                                                                  return choc::value::createVector (2u, [i] (uint32_t chan) { return static_cast<float> (i * 10 + chan); });
+                                                              });
+
+                                                          if (e.name == "P::table")
+                                                              return choc::value::createArray (4u, [] (uint32_t i) { return static_cast<int32_t> (i * 100); });
+
+                                                          return {};
+                                                      }, {});
+
+        CHOC_EXPECT_TRUE (result);
+        CHOC_EXPECT_TRUE (messages.empty());
+
+        const auto outHandle = engine.getEndpointHandle ("out");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (1));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+        CHOC_EXPECT_TRUE (messages.empty());
+        auto performer = engine.createPerformer();
+        CHOC_EXPECT_TRUE (performer);
+
+        performer.setBlockSize (1);
+        std::string output;
+
+        for (int frame = 0; frame < 4; ++frame)
+        {
+            performer.advance();
+
+            performer.iterateOutputEvents (outHandle, [&] (auto, uint32_t, uint32_t, const void* data, uint32_t)
+            {
+                output += std::to_string (*reinterpret_cast<const int32_t*> (data)) + " ";
+                return true;
+            });
+        }
+
+        CHOC_EXPECT_EQ (output, "1 1 0 3 11 100 5 21 200 7 31 300 ");
+    }
+
+    static void checkPerformerBatch (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkPerformerBatch)
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float32<2> in;
+                input value float32 gain;
+                output stream float32<2> out;
+
+                void main()
+                {
+                    float32<2> total;
+
+                    loop
+                    {
+                        total = total * 0.5f + in * gain;
+                        out <- total;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto inHandle   = engine.getEndpointHandle ("in");
+        const auto gainHandle = engine.getEndpointHandle ("gain");
+        const auto outHandle  = engine.getEndpointHandle ("out");
+
+        constexpr uint32_t numInstances = 5, numChannels = 2, maxBlockSize = 16;
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (maxBlockSize));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        cmaj::PerformerBatch batch;
+        CHOC_EXPECT_TRUE (batch.create (engine, numInstances));
+        CHOC_EXPECT_EQ (batch.size(), numInstances);
+
+        // A second batch which shares its instances between threads, and must produce
+        // exactly the same output as the single-threaded one
+        cmaj::PerformerBatch threadedBatch;
+        CHOC_EXPECT_TRUE (threadedBatch.create (engine, numInstances));
+        threadedBatch.setNumThreads (3);
+
+        // The same number of performers run separately, which the batch must match exactly
+        std::vector<cmaj::Performer> separate;
+
+        for (uint32_t i = 0; i < numInstances; ++i)
+            separate.push_back (engine.createPerformer());
+
+        for (uint32_t i = 0; i < numInstances; ++i)
+        {
+            auto gain = 1.0f + static_cast<float> (i) * 0.25f;
+            CHOC_EXPECT_TRUE (batch[i].setInputValue (gainHandle, gain, 0) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (threadedBatch[i].setInputValue (gainHandle, gain, 0) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (separate[i].setInputValue (gainHandle, gain, 0) == cmaj::Result::Ok);
+        }
+
+        // Blocks of varying sizes, up to the maximum, with different input for every
+        // instance, channel and frame
+        for (uint32_t block = 0; block < 8; ++block)
+        {
+            auto numFrames = maxBlockSize - (block * 5) % maxBlockSize;
+
+            auto input = choc::buffer::createInterleavedBuffer (numInstances * numChannels, numFrames,
+                                                                [&] (choc::buffer::ChannelCount chan, choc::buffer::FrameCount frame)
+                                                                {
+                                                                    return static_cast<float> ((chan + 1) * 100 + frame * 3 + block);
+                                                                });
+
+            auto batchOutput = choc::buffer::InterleavedBuffer<float> (numInstances * numChannels, numFrames);
+
+            CHOC_EXPECT_TRUE (batch.setBlockSize (numFrames) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (batch.setInputFrames (inHandle, input.getView()) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (batch.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (batch.copyOutputFrames (outHandle, batchOutput.getView()) == cmaj::Result::Ok);
+
+            auto threadedOutput = choc::buffer::InterleavedBuffer<float> (numInstances * numChannels, numFrames);
+
+            CHOC_EXPECT_TRUE (threadedBatch.setBlockSize (numFrames) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (threadedBatch.setInputFrames (inHandle, input.getView()) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (threadedBatch.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (threadedBatch.copyOutputFrames (outHandle, threadedOutput.getView()) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (contentMatches (batchOutput.getView(), threadedOutput.getView()));
+
+            for (uint32_t i = 0; i < numInstances; ++i)
+            {
+                auto channels = choc::buffer::ChannelRange { i * numChannels, (i + 1) * numChannels };
+                auto separateInput = choc::buffer::InterleavedBuffer<float> (numChannels, numFrames);
+                auto separateOutput = choc::buffer::InterleavedBuffer<float> (numChannels, numFrames);
+                copy (separateInput.getView(), input.getView().getChannelRange (channels));
+
+                CHOC_EXPECT_TRUE (separate[i].setBlockSize (numFrames) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (separate[i].setInputFrames (inHandle, separateInput.getView().data.data, numFrames) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (separate[i].advance() == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (separate[i].copyOutputFrames (outHandle, separateOutput.getView().data.data, numFrames) == cmaj::Result::Ok);
+
+                CHOC_EXPECT_TRUE (contentMatches (separateOutput.getView(), batchOutput.getView().getChannelRange (channels)));
+            }
+        }
+
+        CHOC_EXPECT_TRUE (batch.reset() == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (threadedBatch.reset() == cmaj::Result::Ok);
+    }
+
+    static void checkTimedInputEvents (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkTimedInputEvents)
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float32 in;
+                input event float32 level;
+                output stream float32 out;
+                output event int32 delivered;
+                output event int32 marks;
+
+                float32 currentLevel;
+                int32 frame;
+
+                event level (float32 f)
+                {
+                    currentLevel = f;
+                    delivered <- frame;
+                }
+
+                void main()
+                {
+                    loop
+                    {
+                        if (frame == 10)
+                            marks <- frame;
+
+                        out <- in + currentLevel;
+                        ++frame;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto inHandle        = engine.getEndpointHandle ("in");
+        const auto levelHandle     = engine.getEndpointHandle ("level");
+        const auto outHandle       = engine.getEndpointHandle ("out");
+        const auto deliveredHandle = engine.getEndpointHandle ("delivered");
+        const auto marksHandle     = engine.getEndpointHandle ("marks");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (16));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        auto performer = engine.createPerformer();
+        CHOC_EXPECT_TRUE (performer);
+
+        const uint32_t blockSize = 16;
+        uint32_t blockStart = 0;
+        auto input = choc::buffer::InterleavedBuffer<float> (1, blockSize);
+        auto output = choc::buffer::InterleavedBuffer<float> (1, blockSize);
+
+        // Renders a block of a ramp, with the given events, and returns a "frame:value" list of the output
+        // events from the given endpoint
+        auto renderBlock = [&] (std::vector<std::pair<uint32_t, float>> levels, EndpointHandle eventsToReturn)
+        {
+            for (uint32_t i = 0; i < blockSize; ++i)
+                input.getSample (0, i) = static_cast<float> (blockStart + i);
+
+            std::vector<TimestampedEvent> events;
+
+            for (auto& l : levels)
+                events.push_back ({ l.first, 0, std::addressof (l.second) });
+
+            CHOC_EXPECT_TRUE (performer.setBlockSize (blockSize) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.setInputFrames (inHandle, input.getView()) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.addInputEvents (levelHandle, events.data(), static_cast<uint32_t> (events.size())) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.copyOutputFrames (outHandle, output) == cmaj::Result::Ok);
+
+            std::string result;
+
+            performer.iterateOutputEvents (eventsToReturn, [&] (auto, uint32_t, uint32_t frame, const void* data, uint32_t)
+            {
+                result += std::to_string (frame) + ":" + std::to_string (*static_cast<const int32_t*> (data)) + " ";
+                return true;
+            });
+
+            blockStart += blockSize;
+            return result;
+        };
+
+        // Events on the first, a middle and the last frame, and one beyond the end of the block, which
+        // should be delivered on its last frame. The event handler reports the frame that it was called on.
+        CHOC_EXPECT_EQ (renderBlock ({ { 0, 1.0f }, { 7, 2.0f }, { 15, 3.0f }, { 40, 4.0f } }, deliveredHandle), "0:0 7:7 15:15 15:15 ");
+
+        // The output stream should be unbroken across the chunks that the block was split into
+        for (uint32_t i = 0; i < blockSize; ++i)
+            CHOC_EXPECT_EQ (output.getSample (0, i), static_cast<float> (i) + (i < 7 ? 1.0f : (i < 15 ? 2.0f : 4.0f)));
+
+        // An event that main() emits during a later chunk should be given its offset from the start of the block
+        CHOC_EXPECT_TRUE (performer.reset() == cmaj::Result::Ok);
+        blockStart = 0;
+        CHOC_EXPECT_EQ (renderBlock ({ { 0, 1.0f }, { 7, 2.0f } }, marksHandle), "10:10 ");
+
+        // Then a block without events following a split one, a split block following that, and another without events
+        CHOC_EXPECT_EQ (renderBlock ({}, deliveredHandle), "");
+
+        for (uint32_t i = 0; i < blockSize; ++i)
+            CHOC_EXPECT_EQ (output.getSample (0, i), static_cast<float> (blockSize + i) + 2.0f);
+
+        CHOC_EXPECT_EQ (renderBlock ({ { 5, 5.0f } }, deliveredHandle), "5:37 ");
+
+        for (uint32_t i = 0; i < blockSize; ++i)
+            CHOC_EXPECT_EQ (output.getSample (0, i), static_cast<float> (blockSize * 2 + i) + (i < 5 ? 2.0f : 5.0f));
+
+        CHOC_EXPECT_EQ (renderBlock ({}, deliveredHandle), "");
+
+        for (uint32_t i = 0; i < blockSize; ++i)
+            CHOC_EXPECT_EQ (output.getSample (0, i), static_cast<float> (blockSize * 3 + i) + 5.0f);
+
+        CHOC_EXPECT_EQ (performer.getXRuns(), 0u);
+
+        // When there's no room left for pending events, the extra ones are delivered straight away
+        // and counted as an xrun
+        auto numEventsToOverflow = performer.getEventBufferSize() + 1;
+        float value = 1.0f;
+        std::vector<TimestampedEvent> events (numEventsToOverflow, TimestampedEvent { 1, 0, std::addressof (value) });
+
+        CHOC_EXPECT_TRUE (performer.setBlockSize (blockSize) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.addInputEvents (levelHandle, events.data(), numEventsToOverflow) == cmaj::Result::Ok);
+        CHOC_EXPECT_EQ (performer.getXRuns(), 1u);
+
+        // If advance() is called before any block size has been set, it fails, but the timed
+        // events are still delivered, and take effect in the first real block
+        performer = engine.createPerformer();
+        value = 6.0f;
+        TimestampedEvent earlyEvent { 3, 0, std::addressof (value) };
+
+        CHOC_EXPECT_TRUE (performer.addInputEvents (levelHandle, std::addressof (earlyEvent), 1) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::InvalidBlockSize);
+
+        blockStart = 0;
+        CHOC_EXPECT_EQ (renderBlock ({}, marksHandle), "10:10 ");
+
+        for (uint32_t i = 0; i < blockSize; ++i)
+            CHOC_EXPECT_EQ (output.getSample (0, i), static_cast<float> (i) + 6.0f);
+    }
+
+    static void checkNodeProfiling (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkNodeProfiling)
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            graph G [[ main ]]
+            {
+                input stream float32 in;
+                output stream float32 out;
+
+                node first = P;
+                node second = P;
+
+                connection in -> first -> second -> out;
+            }
+
+            processor P
+            {
+                input stream float32 in;
+                output stream float32 out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- in * 2.0f;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (16)
+                                                      .setNodeProfiling (true));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        auto performer = engine.createPerformer();
+        CHOC_EXPECT_TRUE (performer.setBlockSize (4) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+
+        auto profile = performer.getNodeProfile();
+        CHOC_EXPECT_TRUE (profile.isArray());
+        CHOC_EXPECT_EQ (profile.size(), 2u);
+
+        for (const auto& node : profile)
+        {
+            auto name = node["node"].toString();
+            CHOC_EXPECT_TRUE (name == "first" || name == "second");
+            CHOC_EXPECT_EQ (node["calls"].getInt64(), 4);
+            CHOC_EXPECT_TRUE (node["cycles"].getInt64() >= 0);
+        }
+    }
+
+    static void checkSparseStreams (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkSparseStreams)
+
+        const auto source = R"(
+            graph G [[ main ]]
+            {
+                input stream float32 in;
+                input stream float32 gainIn;
+                input stream float32<32> wideIn;
+                output stream float32 counted;
+                output stream float32 gained;
+                output stream float32<32> wideCounted;
+
+                node counter = Counter;
+                node gain = Gain;
+                node wideCounter = WideCounter;
+
+                connection
+                {
+                    in -> counter -> counted;
+                    gainIn -> gain -> gained;
+                    wideIn -> wideCounter -> wideCounted;
+                }
+            }
+
+            // Passes its input through, except that a non-silent input is replaced by
+            // the number of frames for which this node has actually been run
+            processor Counter
+            {
+                input stream float32 in;
+                output stream float32 out;
+
+                int32 framesRun;
+
+                void main()
+                {
+                    loop
+                    {
+                        ++framesRun;
+                        out <- in > 0.5f ? float32 (framesRun) : in;
+                        advance();
+                    }
+                }
+            }
+
+            processor WideCounter
+            {
+                input stream float32<32> in;
+                output stream float32<32> out;
+
+                int32 framesRun;
+
+                void main()
+                {
+                    loop
+                    {
+                        ++framesRun;
+                        var result = in;
+
+                        if (in[0] > 0.5f)
+                            result[0] = float32 (framesRun);
+
+                        out <- result;
+                        advance();
+                    }
+                }
+            }
+
+            processor Gain
+            {
+                input stream float32 in;
+                output stream float32 out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- in * 0.5f;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        const uint32_t blockSize = 64, numBlocks = 4, numFrames = blockSize * numBlocks;
+        const uint32_t settleFrames = 32, wakeFrame = 200, wide = 32;
+        const float belowThreshold = 1.0e-7f;
+
+        struct Output
+        {
+            std::vector<float> counted, gained, wideCounted;
+        };
+
+        auto render = [&] (uint32_t sparseStreamSettleFrames)
+        {
+            auto engine = cmaj::Engine::create ("llvm");
+
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (messages.empty());
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            const auto inHandle          = engine.getEndpointHandle ("in");
+            const auto gainInHandle      = engine.getEndpointHandle ("gainIn");
+            const auto wideInHandle      = engine.getEndpointHandle ("wideIn");
+            const auto countedHandle     = engine.getEndpointHandle ("counted");
+            const auto gainedHandle      = engine.getEndpointHandle ("gained");
+            const auto wideCountedHandle = engine.getEndpointHandle ("wideCounted");
+
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                          .setMaxBlockSize (blockSize)
+                                                          .setSparseStreamSettleFrames (sparseStreamSettleFrames));
+
+            CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+            auto performer = engine.createPerformer();
+            CHOC_EXPECT_TRUE (performer);
+
+            auto in = choc::buffer::InterleavedBuffer<float> (1, blockSize);
+            auto gainIn = choc::buffer::InterleavedBuffer<float> (1, blockSize);
+            auto wideIn = choc::buffer::InterleavedBuffer<float> (wide, blockSize);
+            auto counted = choc::buffer::InterleavedBuffer<float> (1, blockSize);
+            auto gained = choc::buffer::InterleavedBuffer<float> (1, blockSize);
+            auto wideCounted = choc::buffer::InterleavedBuffer<float> (wide, blockSize);
+
+            Output result;
+
+            for (uint32_t block = 0; block < numBlocks; ++block)
+            {
+                for (uint32_t i = 0; i < blockSize; ++i)
+                {
+                    auto frame = block * blockSize + i;
+
+                    // Input that's below the silence threshold, apart from a single frame
+                    in.getSample (0, i) = frame == wakeFrame ? 1.0f : belowThreshold;
+                    wideIn.getSample (0, i) = in.getSample (0, i);
+
+                    for (uint32_t chan = 1; chan < wide; ++chan)
+                        wideIn.getSample (chan, i) = 0.0f;
+
+                    // Bursts of signal separated by runs of digital silence
+                    gainIn.getSample (0, i) = (frame / 48) % 2 == 0 ? 0.0f : std::sin (static_cast<float> (frame));
+                }
+
+                CHOC_EXPECT_TRUE (performer.setBlockSize (blockSize) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.setInputFrames (inHandle, in.getView()) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.setInputFrames (gainInHandle, gainIn.getView()) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.setInputFrames (wideInHandle, wideIn.getView()) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.copyOutputFrames (countedHandle, counted) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.copyOutputFrames (gainedHandle, gained) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.copyOutputFrames (wideCountedHandle, wideCounted) == cmaj::Result::Ok);
+
+                for (uint32_t i = 0; i < blockSize; ++i)
+                {
+                    result.counted.push_back (counted.getSample (0, i));
+                    result.gained.push_back (gained.getSample (0, i));
+                    result.wideCounted.push_back (wideCounted.getSample (0, i));
+                }
+            }
+
+            return result;
+        };
+
+        auto withoutSleeping = render (0);
+        auto withSleeping = render (settleFrames);
+
+        // Without the feature, every node runs on every frame
+        for (uint32_t i = 0; i < numFrames; ++i)
+            CHOC_EXPECT_EQ (withoutSleeping.counted[i], i == wakeFrame ? static_cast<float> (wakeFrame + 1) : belowThreshold);
+
+        // With it, the counter runs for settleFrames frames of input below the threshold, then sleeps
+        // with a zero output until the first non-silent frame, when it wakes, and after another
+        // settleFrames frames of silence it goes back to sleep
+        for (uint32_t i = 0; i < numFrames; ++i)
+        {
+            if (i == wakeFrame)
+                CHOC_EXPECT_EQ (withSleeping.counted[i], static_cast<float> (settleFrames + 1));
+            else if (i < settleFrames || (i > wakeFrame && i <= wakeFrame + settleFrames))
+                CHOC_EXPECT_EQ (withSleeping.counted[i], belowThreshold);
+            else
+                CHOC_EXPECT_EQ (withSleeping.counted[i], 0.0f);
+        }
+
+        // A node whose output is exactly zero whenever its input is gives identical output either way
+        CHOC_EXPECT_TRUE (withSleeping.gained == withoutSleeping.gained);
+
+        // Streams wider than the number of elements that are tested for silence stop a node
+        // from sleeping, so it's run on every frame
+        CHOC_EXPECT_TRUE (withSleeping.wideCounted == withoutSleeping.wideCounted);
+        CHOC_EXPECT_EQ (withSleeping.wideCounted[wakeFrame], static_cast<float> (wakeFrame + 1));
+    }
+
+    static void checkDynamicFrequency (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkDynamicFrequency)
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                output stream float64 out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- processor.frequency * processor.period;
+                        advance();
+                        out <- processor.frequency;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto outHandle = engine.getEndpointHandle ("out");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (16)
+                                                      .setDynamicFrequency (true));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        for (auto rate : { 44100.0, 48000.0, 96000.0 })
+        {
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (rate));
+
+            auto performer = engine.createPerformer();
+            double output[2] = {};
+
+            CHOC_EXPECT_TRUE (performer.setBlockSize (2) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.copyOutputFrames (outHandle, output, 2) == cmaj::Result::Ok);
+
+            CHOC_EXPECT_NEAR (output[0], 1.0, 1.0e-9);
+            CHOC_EXPECT_EQ (output[1], rate);
+        }
+    }
+
+    static void checkTieredCompilation (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkTieredCompilation)
+
+        const auto source = R"(
+            processor P
+            {
+                output stream int64 out;
+
+                void main()
+                {
+                    int64 total;
+
+                    loop
+                    {
+                        for (wrap<16> i)
+                            total += i;
+
+                        out <- total;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        auto createLinkedEngine = [&] (bool tiered)
+        {
+            auto engine = cmaj::Engine::create ("llvm");
+
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (messages.empty());
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                          .setMaxBlockSize (16)
+                                                          .setOptimisationLevel (3)
+                                                          .setTieredCompilation (tiered));
+
+            CHOC_EXPECT_TRUE (engine.link (messages, {}));
+            return engine;
+        };
+
+        auto renderBlock = [&] (cmaj::Engine& engine, cmaj::Performer& performer, int blockNumber)
+        {
+            int64_t output[16] = {};
+            CHOC_EXPECT_TRUE (performer.setBlockSize (16) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.copyOutputFrames (engine.getEndpointHandle ("out"), output, 16) == cmaj::Result::Ok);
+            CHOC_EXPECT_EQ (output[15], int64_t (blockNumber) * 16 * 120);
+        };
+
+        {
+            // Keep rendering while the optimised code is built, so that the switch-over
+            // happens part-way through, and check that the state carries on undisturbed
+            auto engine = createLinkedEngine (true);
+            auto performer = engine.createPerformer();
+            int block = 0;
+
+            for (auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds (60);
+                 performer.isRunningQuickTier() && std::chrono::steady_clock::now() < timeout;)
+            {
+                renderBlock (engine, performer, ++block);
+                std::this_thread::sleep_for (std::chrono::milliseconds (1));
+            }
+
+            CHOC_EXPECT_FALSE (performer.isRunningQuickTier());
+
+            for (int i = 0; i < 100; ++i)
+                renderBlock (engine, performer, ++block);
+        }
+
+        {
+            // Destroying the code straight after linking cancels the optimised build rather than
+            // waiting for it, and the performer carries on with the quick tier until then
+            auto engine = createLinkedEngine (true);
+            auto performer = engine.createPerformer();
+            renderBlock (engine, performer, 1);
+        }
+
+        {
+            // A build that isn't tiered only ever runs its optimised code
+            auto engine = createLinkedEngine (false);
+            auto performer = engine.createPerformer();
+            CHOC_EXPECT_FALSE (performer.isRunningQuickTier());
+            renderBlock (engine, performer, 1);
+        }
+    }
+
+    static void checkParallelCodeGen (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkParallelCodeGen)
+
+        // A long chain of functions, so that there's enough code to be split between threads
+        const int numFunctions = 600;
+        std::string source = "processor P\n{\n    input stream int32 in;\n    output stream int32 out;\n\n"
+                             "    int32 f0 (int32 x) { return x; }\n";
+
+        for (int i = 1; i < numFunctions; ++i)
+            source += "    int32 f" + std::to_string (i) + " (int32 x) { return f" + std::to_string (i - 1) + " (x) * 3 + " + std::to_string (i) + "; }\n";
+
+        source += "\n    void main() { loop { out <- f" + std::to_string (numFunctions - 1) + " (in); advance(); } }\n}\n";
+
+        const uint32_t numFrames = 64;
+        int32_t input[numFrames] = {};
+
+        for (uint32_t i = 0; i < numFrames; ++i)
+            input[i] = static_cast<int32_t> (i * 1000003u);
+
+        auto render = [&] (uint32_t numThreads, bool expectPartitions)
+        {
+            auto engine = cmaj::Engine::create ("llvm");
+
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (messages.empty());
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            const auto inHandle = engine.getEndpointHandle ("in");
+            const auto outHandle = engine.getEndpointHandle ("out");
+
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                          .setMaxBlockSize (numFrames)
+                                                          .setOptimisationLevel (0)
+                                                          .setNumCompileThreads (numThreads));
+
+            CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+            // The partitions' compile times are only logged when the module was split up
+            CHOC_EXPECT_EQ (choc::text::contains (engine.getLastBuildLog(), "partition"), expectPartitions);
+
+            auto performer = engine.createPerformer();
+            std::vector<int32_t> output (numFrames);
+
+            CHOC_EXPECT_TRUE (performer.setBlockSize (numFrames) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.setInputFrames (inHandle, input, numFrames) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.copyOutputFrames (outHandle, output.data(), numFrames) == cmaj::Result::Ok);
+            return output;
+        };
+
+        // The default is a single thread, so a build is only partitioned when asked for
+        auto unpartitioned = render (0, false);
+        auto singleThread  = render (1, false);
+        auto partitioned   = render (4, true);
+
+        CHOC_EXPECT_TRUE (unpartitioned == singleThread);
+        CHOC_EXPECT_TRUE (unpartitioned == partitioned);
+
+        for (uint32_t i = 0; i < numFrames; ++i)
+        {
+            auto expected = static_cast<uint32_t> (input[i]);
+
+            for (uint32_t f = 1; f < static_cast<uint32_t> (numFunctions); ++f)
+                expected = expected * 3u + f;
+
+            CHOC_EXPECT_EQ (partitioned[i], static_cast<int32_t> (expected));
+        }
+    }
+
+    static void checkObjectCodeCache (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkObjectCodeCache)
+
+        // Keeps track of what a link stores and finds, so that it's possible to tell
+        // whether the machine code was generated or reloaded
+        struct CountingCache  : public choc::com::ObjectWithAtomicRefCount<cmaj::CacheDatabaseInterface, CountingCache>
+        {
+            void store (const char* key, const void* data, uint64_t size) override
+            {
+                ++numStores;
+                entries[key] = std::vector<char> (static_cast<const char*> (data), static_cast<const char*> (data) + size);
+            }
+
+            uint64_t reload (const char* key, void* dest, uint64_t destSize) override
+            {
+                auto found = entries.find (key);
+
+                if (found == entries.end())
+                    return 0;
+
+                if (dest != nullptr && destSize >= found->second.size())
+                {
+                    memcpy (dest, found->second.data(), found->second.size());
+
+                    if (choc::text::contains (key, "_obj_"))
+                        ++numObjectCodeReloads;
+                }
+
+                return found->second.size();
+            }
+
+            std::map<std::string, std::vector<char>> entries;
+            int numStores = 0, numObjectCodeReloads = 0;
+        };
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float32 in;
+                output stream float32 out;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- in * 3.0f + 1.0f;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        auto cache = choc::com::create<CountingCache>();
+
+        auto render = [&]
+        {
+            auto engine = cmaj::Engine::create ("llvm");
+
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (messages.empty());
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                          .setMaxBlockSize (4)
+                                                          .setCacheObjectCode (true));
+
+            CHOC_EXPECT_TRUE (engine.link (messages, cache.get()));
+
+            float input[4] = { 1.0f, 2.0f, 3.0f, 4.0f }, output[4] = {};
+            auto performer = engine.createPerformer();
+
+            CHOC_EXPECT_TRUE (performer.setBlockSize (4) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.setInputFrames (engine.getEndpointHandle ("in"), input, 4) == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.copyOutputFrames (engine.getEndpointHandle ("out"), output, 4) == cmaj::Result::Ok);
+            CHOC_EXPECT_EQ (output[3], 13.0f);
+        };
+
+        // The first link has to generate the code, and stores its object code
+        render();
+        CHOC_EXPECT_EQ (cache->numObjectCodeReloads, 0);
+        CHOC_EXPECT_TRUE (cache->numStores > 0);
+
+        // The second link of the same program loads that object code rather than generating
+        // anything, so it has nothing new to store
+        auto numStoresAfterFirstLink = cache->numStores;
+        render();
+        CHOC_EXPECT_EQ (cache->numObjectCodeReloads, 1);
+        CHOC_EXPECT_EQ (cache->numStores, numStoresAfterFirstLink);
+    }
+
+    static void checkLazyHandlerCompilation (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkLazyHandlerCompilation)
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input value float32 gain;
+                input event float32 offset;
+                input event int32 unused;
+                output stream float32 out;
+
+                float32 currentOffset;
+
+                event offset (float32 f)    { currentOffset = f; }
+                event unused (int32 i)      { currentOffset = float32 (i); }
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- gain + currentOffset;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        const auto gainHandle   = engine.getEndpointHandle ("gain");
+        const auto offsetHandle = engine.getEndpointHandle ("offset");
+        const auto outHandle    = engine.getEndpointHandle ("out");
+
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                      .setMaxBlockSize (16)
+                                                      .setLazyHandlerCompilation (true));
+
+        CHOC_EXPECT_TRUE (engine.link (messages, {}));
+
+        auto performer = engine.createPerformer();
+        performer.prefetchEndpoint (offsetHandle);
+
+        float output[4] = {};
+
+        // These are sent straight after linking, so will usually arrive before the background
+        // thread has compiled their handlers. They must be held and replayed in order once the
+        // code is ready, rather than being lost.
+        CHOC_EXPECT_TRUE (performer.setBlockSize (4) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.setInputValue (gainHandle, 2.0f, 0) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.addInputEvent (offsetHandle, 0, 1.0f) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.addInputEvent (offsetHandle, 0, 3.0f) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (performer.copyOutputFrames (outHandle, output, 4) == cmaj::Result::Ok);
+
+        for (auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds (60);
+             output[3] != 5.0f && std::chrono::steady_clock::now() < timeout;)
+        {
+            std::this_thread::sleep_for (std::chrono::milliseconds (1));
+            CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+            CHOC_EXPECT_TRUE (performer.copyOutputFrames (outHandle, output, 4) == cmaj::Result::Ok);
+        }
+
+        CHOC_EXPECT_EQ (output[3], 5.0f);
+        CHOC_EXPECT_EQ (performer.getXRuns(), 0u);
+
+        // Without lazy compilation, everything is ready as soon as the performer is created
+        auto eagerEngine = cmaj::Engine::create ("llvm");
+        cmaj::Program eagerProgram;
+
+        eagerProgram.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (eagerEngine.load (messages, eagerProgram, {}, {}));
+        eagerEngine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0)
+                                                           .setMaxBlockSize (16));
+        CHOC_EXPECT_TRUE (eagerEngine.link (messages, {}));
+
+        auto eagerPerformer = eagerEngine.createPerformer();
+        CHOC_EXPECT_TRUE (eagerPerformer.setBlockSize (4) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (eagerPerformer.setInputValue (eagerEngine.getEndpointHandle ("gain"), 2.0f, 0) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (eagerPerformer.addInputEvent (eagerEngine.getEndpointHandle ("offset"), 0, 3.0f) == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (eagerPerformer.advance() == cmaj::Result::Ok);
+        CHOC_EXPECT_TRUE (eagerPerformer.copyOutputFrames (eagerEngine.getEndpointHandle ("out"), output, 4) == cmaj::Result::Ok);
+        CHOC_EXPECT_EQ (output[3], 5.0f);
+        CHOC_EXPECT_EQ (eagerPerformer.getXRuns(), 0u);
+    }
+
+    static void checkPerformerLibraryGeneration (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkPerformerLibraryGeneration)
+
+        auto engine = cmaj::Engine::create ("llvm");
+
+        auto targets = engine.getAvailableCodeGenTargetTypes();
+
+        if (std::find (targets.begin(), targets.end(), "sharedlib") == targets.end())
+            return;
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input value float32 gain;
+                input event bool<3> flags;
+                output stream float32 out;
+                output event int32 count;
+
+                bool<3> currentFlags;
+
+                event flags (bool<3> f)   { currentFlags = f; count <- 1; }
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- currentFlags[1] ? gain : 0.0f;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+        engine.setBuildSettings (cmaj::BuildSettings().setMaxBlockSize (64));
+
+        auto result = engine.generateCode ("sharedlib", {});
+        CHOC_EXPECT_TRUE (result.messages.empty());
+
+        // The object code should export the entry point, and contain the details that
+        // the loader needs for every endpoint, including the layout of the bool vector
+        CHOC_EXPECT_TRUE (choc::text::contains (result.generatedCode, cmaj::performerLibraryEntryPoint));
+        CHOC_EXPECT_TRUE (choc::text::contains (result.generatedCode, "\"eventCountOffset\""));
+        CHOC_EXPECT_TRUE (choc::text::contains (result.generatedCode, "\"setValue\""));
+        CHOC_EXPECT_TRUE (choc::text::contains (result.generatedCode, "\"chunks\""));
+    }
+
+    static void checkPerformerLibraryLoading (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkPerformerLibraryLoading)
+
+       #ifndef _WIN32
+        auto jitEngine = cmaj::Engine::create ("llvm");
+
+        auto targets = jitEngine.getAvailableCodeGenTargetTypes();
+
+        if (std::find (targets.begin(), targets.end(), "sharedlib") == targets.end())
+            return;
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float32 in;
+                input value float32 gain;
+                input event float32 offset;
+                output stream float32 out;
+                output event int32 changes;
+
+                float32 currentOffset;
+                int32 numChanges;
+
+                event offset (float32 f)
+                {
+                    currentOffset = f;
+                    changes <- ++numChanges;
+                }
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- in * gain + currentOffset;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        program.parse (messages, "", source);
+        CHOC_EXPECT_TRUE (messages.empty());
+        CHOC_EXPECT_TRUE (jitEngine.load (messages, program, {}, {}));
+
+        const uint32_t blockSize = 32;
+        jitEngine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (blockSize));
+
+        auto library = jitEngine.generateCode ("sharedlib", {});
+        CHOC_EXPECT_TRUE (library.messages.empty());
+        CHOC_EXPECT_TRUE (jitEngine.link (messages, {}));
+
+       #ifdef __APPLE__
+        choc::file::TempFile libraryFile (choc::file::TempFile::createRandomFilename ("cmaj_test", "dylib"));
+       #else
+        choc::file::TempFile libraryFile (choc::file::TempFile::createRandomFilename ("cmaj_test", "so"));
+       #endif
+
+        auto linkError = cmaj::linkPerformerLibrary (library.generatedCode, libraryFile.file.string());
+        CHOC_EXPECT_EQ (linkError, std::string());
+
+        auto libraryEngine = cmaj::createEngineForPerformerLibrary (libraryFile.file.string());
+        CHOC_EXPECT_TRUE (libraryEngine);
+
+        if (! libraryEngine)
+            return;
+
+        libraryEngine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0));
+
+        // Renders some blocks with changing values and events, and returns the output frames
+        // followed by a list of the output events
+        auto render = [&] (cmaj::Engine& engine)
+        {
+            const auto inHandle      = engine.getEndpointHandle ("in");
+            const auto gainHandle    = engine.getEndpointHandle ("gain");
+            const auto offsetHandle  = engine.getEndpointHandle ("offset");
+            const auto outHandle     = engine.getEndpointHandle ("out");
+            const auto changesHandle = engine.getEndpointHandle ("changes");
+
+            auto performer = engine.createPerformer();
+            CHOC_EXPECT_TRUE (performer);
+
+            std::vector<float> input (blockSize), output (blockSize);
+            std::vector<float> frames;
+            std::string events;
+
+            for (uint32_t block = 0; block < 4; ++block)
+            {
+                for (uint32_t i = 0; i < blockSize; ++i)
+                    input[i] = static_cast<float> (block * blockSize + i) * 0.25f;
+
+                if (block == 0)  CHOC_EXPECT_TRUE (performer.setInputValue (gainHandle, 2.0f, 0) == cmaj::Result::Ok);
+                if (block == 2)  CHOC_EXPECT_TRUE (performer.setInputValue (gainHandle, 0.5f, 0) == cmaj::Result::Ok);
+                if (block != 2)  CHOC_EXPECT_TRUE (performer.addInputEvent (offsetHandle, 0, static_cast<float> (block) + 1.0f) == cmaj::Result::Ok);
+
+                CHOC_EXPECT_TRUE (performer.setBlockSize (blockSize) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.setInputFrames (inHandle, input.data(), blockSize) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.copyOutputFrames (outHandle, output.data(), blockSize) == cmaj::Result::Ok);
+
+                frames.insert (frames.end(), output.begin(), output.end());
+
+                performer.iterateOutputEvents (changesHandle, [&] (auto, uint32_t, uint32_t frame, const void* data, uint32_t)
+                {
+                    events += std::to_string (block) + "/" + std::to_string (frame) + ":"
+                                + std::to_string (*static_cast<const int32_t*> (data)) + " ";
+                    return true;
+                });
+            }
+
+            return std::make_pair (frames, events);
+        };
+
+        auto jitOutput = render (jitEngine);
+        auto libraryOutput = render (libraryEngine);
+
+        CHOC_EXPECT_EQ (jitOutput.second, "0/0:1 1/0:2 3/0:3 ");
+        CHOC_EXPECT_EQ (libraryOutput.second, jitOutput.second);
+        CHOC_EXPECT_TRUE (libraryOutput.first == jitOutput.first);
+        CHOC_EXPECT_EQ (libraryOutput.first[blockSize * 2 + 4], static_cast<float> (blockSize * 2 + 4) * 0.25f * 0.5f + 2.0f);
+       #endif
+    }
+
+    static void checkMultiversionedPerformerLibrary (choc::test::TestProgress& progress)
+    {
+        CHOC_TEST (checkMultiversionedPerformerLibrary)
+
+       #if ! defined (_WIN32) && (defined (__x86_64__) || defined (_M_X64))
+        auto targets = cmaj::Engine::create ("llvm").getAvailableCodeGenTargetTypes();
+
+        if (std::find (targets.begin(), targets.end(), "sharedlib") == targets.end())
+            return;
+
+        const auto source = R"(
+            processor P
+            {
+                input stream float32 in;
+                output stream float32 out;
+                output stream int32 count;
+
+                float32[64] history;
+                wrap<64> position;
+                int32 counter;
+
+                void main()
+                {
+                    loop
+                    {
+                        history[position++] = in;
+
+                        float32 sum = 0;
+
+                        for (wrap<64> i)
+                            sum += history[i];
+
+                        out <- sum;
+                        counter += int32 (in * 4.0f);
+                        count <- counter;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        const uint32_t blockSize = 128;
+
+        // Builds, links and loads a library, then returns all the frames from some blocks
+        auto render = [&] (const std::string& options)
+        {
+            auto engine = cmaj::Engine::create ("llvm");
+
+            cmaj::Program program;
+            cmaj::DiagnosticMessageList messages;
+
+            program.parse (messages, "", source);
+            CHOC_EXPECT_TRUE (messages.empty());
+            CHOC_EXPECT_TRUE (engine.load (messages, program, {}, {}));
+
+            engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (blockSize));
+
+            auto code = engine.generateCode ("sharedlib", options);
+            CHOC_EXPECT_TRUE (code.messages.empty());
+
+           #ifdef __APPLE__
+            choc::file::TempFile libraryFile (choc::file::TempFile::createRandomFilename ("cmaj_test", "dylib"));
+           #else
+            choc::file::TempFile libraryFile (choc::file::TempFile::createRandomFilename ("cmaj_test", "so"));
+           #endif
+
+            CHOC_EXPECT_EQ (cmaj::linkPerformerLibrary (code.generatedCode, libraryFile.file.string()), std::string());
+
+            std::vector<float> frames;
+            std::vector<int32_t> counts;
+
+            auto libraryEngine = cmaj::createEngineForPerformerLibrary (libraryFile.file.string());
+            CHOC_EXPECT_TRUE (libraryEngine);
+
+            if (! libraryEngine)
+                return std::make_pair (frames, counts);
+
+            libraryEngine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0));
+
+            auto inHandle    = libraryEngine.getEndpointHandle ("in");
+            auto outHandle   = libraryEngine.getEndpointHandle ("out");
+            auto countHandle = libraryEngine.getEndpointHandle ("count");
+
+            auto performer = libraryEngine.createPerformer();
+            std::vector<float> input (blockSize), output (blockSize);
+            std::vector<int32_t> countOutput (blockSize);
+
+            for (uint32_t block = 0; block < 4; ++block)
+            {
+                // Multiples of 0.25 keep the sums exact, whatever order a vectorised loop adds them in
+                for (uint32_t i = 0; i < blockSize; ++i)
+                    input[i] = static_cast<float> ((block * blockSize + i) % 37) * 0.25f;
+
+                CHOC_EXPECT_TRUE (performer.setBlockSize (blockSize) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.setInputFrames (inHandle, input.data(), blockSize) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.advance() == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.copyOutputFrames (outHandle, output.data(), blockSize) == cmaj::Result::Ok);
+                CHOC_EXPECT_TRUE (performer.copyOutputFrames (countHandle, countOutput.data(), blockSize) == cmaj::Result::Ok);
+
+                frames.insert (frames.end(), output.begin(), output.end());
+                counts.insert (counts.end(), countOutput.begin(), countOutput.end());
+            }
+
+            return std::make_pair (frames, counts);
+        };
+
+        // The multiversioned library will run whichever variant suits this machine, and
+        // whichever that is, it must give the same results as a single-version build
+        auto singleVersion = render ("{}");
+        auto multiversioned = render (R"({ "multiversion": "x86-64-v2,x86-64-v3,x86-64-v4" })");
+
+        CHOC_EXPECT_EQ (singleVersion.first.size(), static_cast<size_t> (blockSize * 4));
+        CHOC_EXPECT_TRUE (multiversioned.first == singleVersion.first);
+        CHOC_EXPECT_TRUE (multiversioned.second == singleVersion.second);
+       #endif
+    }
+
     static void runUnitTests (choc::test::TestProgress& progress)
     {
         CHOC_CATEGORY (Performer);
@@ -406,5 +1726,18 @@ namespace cmaj::api_tests
         checkGraph (progress);
         checkOutputEventWithMultipleTypes (progress);
         checkInvalidEngine (progress);
+        checkPackedExternalData (progress);
+        checkPerformerBatch (progress);
+        checkTimedInputEvents (progress);
+        checkNodeProfiling (progress);
+        checkSparseStreams (progress);
+        checkDynamicFrequency (progress);
+        checkTieredCompilation (progress);
+        checkParallelCodeGen (progress);
+        checkObjectCodeCache (progress);
+        checkLazyHandlerCompilation (progress);
+        checkPerformerLibraryGeneration (progress);
+        checkPerformerLibraryLoading (progress);
+        checkMultiversionedPerformerLibrary (progress);
     }
 }
@@ -1509,6 +1509,140 @@ inline void runUnitTests (choc::test::TestProgress& progress)
         CHOC_EXPECT_NEAR (outputBacking.right[3], 0.0f, 0.0001f);
     }
 
+    {
+        CHOC_TEST (MidiEventsWithinBlock)
+
+        // setup
+        StubHost host {};
+
+        const clap_plugin_descriptor_t descriptor {};
+
+        const auto manifestSource = R"({
+            "CmajorVersion": 1,
+            "ID": "com.your-name.your-patch-id",
+            "version": "1.0",
+            "name": "Test",
+            "description": "Test",
+            "category": "generator",
+            "manufacturer": "Your Company Goes Here",
+            "isInstrument": false,
+
+            "source": ["test.cmajor"]
+        })";
+
+        const auto cmajorSource = R"(
+            graph Test [[ main ]]
+            {
+                output stream float<2> out;
+
+                input event std::midi::Message midiInput;
+
+                node step = UnitStep;
+
+                connection
+                {
+                    step -> std::mixers::MonoToStereo (float) -> out;
+                    midiInput -> std::midi::MPEConverter -> step.note;
+                }
+            }
+
+            processor UnitStep
+            {
+                output stream float out;
+
+                input event (std::notes::NoteOn, std::notes::NoteOff) note;
+
+                event note (std::notes::NoteOn e)
+                {
+                    pulse = true;
+                }
+
+                event note (std::notes::NoteOff e)
+                {
+                    pulse = false;
+                }
+
+                var pulse = false;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- float32 (pulse);
+
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        const auto vfs = createJITEnvironmentWithInMemoryFileSystem ({
+            { "test.cmajorpatch", manifestSource },
+            { "test.cmajor", cmajorSource }
+        });
+
+        auto plugin = cmaj::plugin::clap::create (descriptor, host, "test.cmajorpatch", vfs);
+
+        CHOC_ASSERT (plugin != nullptr);
+
+        plugin->init (plugin.get());
+
+        const double frequency = 4;
+        constexpr uint32_t minBlockSize = 4;
+        constexpr uint32_t maxBlockSize = 4;
+
+        ScopedActivator deactivateOnExit { *plugin, frequency, minBlockSize, maxBlockSize }; // N.B. main-thread
+        CHOC_ASSERT (deactivateOnExit.activated);
+
+        StubStereoAudioPortBackingData<minBlockSize> inputBacking;
+        StubStereoAudioPortBackingData<minBlockSize> outputBacking;
+
+        const clap_audio_buffer_t inputs {};
+        auto outputs = toClapAudioBuffer (outputBacking);
+
+        using EventQueueContext = std::vector<clap_event_midi_t>;
+
+        // N.B. these land part-way through the block, so they must be delivered at their
+        // frames by the performer, as nothing else splits the block here
+        EventQueueContext inputEventQueueContext
+        {
+            makeMidiEvent (1, 0, { 0x90, 0x3C, 0x7F }),
+            makeMidiEvent (3, 0, { 0x80, 0x3C, 0x00 }),
+        };
+        const auto inputEventQueue = toInputEventQueue<EventQueueContext> (inputEventQueueContext);
+
+        // execute
+        {
+            CHOC_EXPECT_TRUE (plugin->start_processing (plugin.get())); // N.B. audio-thread
+            const clap_process_t process
+            {
+                /*.steady_time = */-1,
+                /*.frames_count = */minBlockSize,
+                /*.transport = */nullptr, // free-running
+                /*.audio_inputs = */std::addressof (inputs),
+                /*.audio_outputs = */std::addressof (outputs),
+                /*.audio_inputs_count = */0,
+                /*.audio_outputs_count = */1,
+                /*.in_events = */std::addressof (inputEventQueue),
+                /*.out_events = */nullptr
+            };
+
+            CHOC_EXPECT_EQ (plugin->process (plugin.get(), std::addressof (process)), CLAP_PROCESS_CONTINUE);
+
+            plugin->stop_processing (plugin.get()); // N.B. audio-thread
+        }
+
+        // verify
+        CHOC_EXPECT_NEAR (outputBacking.left[0], 0.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (outputBacking.left[1], 1.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (outputBacking.left[2], 1.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (outputBacking.left[3], 0.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (outputBacking.right[0], 0.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (outputBacking.right[1], 1.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (outputBacking.right[2], 1.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (outputBacking.right[3], 0.0f, 0.0001f);
+    }
+
     {
         CHOC_TEST (MidiOutputEvents)
 
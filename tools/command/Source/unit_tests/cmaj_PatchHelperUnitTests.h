@@ -19,6 +19,7 @@
 #pragma once
 
 #include "cmajor/helpers/cmaj_Patch.h"
+#include "cmajor/helpers/cmaj_InMemoryCacheDatabase.h"
 
 namespace cmaj::patch_helper_tests
 {
@@ -1143,6 +1144,483 @@ static bool runUnitTests (choc::test::TestProgress& progress)
         CHOC_EXPECT_NEAR (outputBackingBuffer[3], 0.125f, 0.0001f);
     }
 
+    {
+        CHOC_TEST (ChangeSampleRateWithDynamicFrequency)
+
+        const auto manifestSource = R"({
+            "CmajorVersion": 1,
+            "ID": "com.your_name.your_patch_ID",
+            "version": "1.0",
+            "name": "Test",
+            "description": "Test",
+            "category": "generator",
+            "manufacturer": "Your Company Goes Here",
+            "isInstrument": true,
+
+            "source": ["Test.cmajor"]
+        })";
+
+        const auto cmajorSource = R"(
+            processor Test  [[ main ]]
+            {
+                input value float level [[ name: "level", min: 0, max: 10, init: 1 ]];
+                output stream float out;
+                output stream float rate;
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- level;
+                        rate <- float (processor.frequency);
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        Patch patch;
+        initTestPatch (patch);
+
+        patch.createEngine = []
+        {
+            auto engine = Engine::create();
+            engine.setBuildSettings (engine.getBuildSettings().setDynamicFrequency (true));
+            return engine;
+        };
+
+        cmaj::Patch::PlaybackParams params;
+        params.blockSize = 4;
+        params.sampleRate = 100;
+        params.numInputChannels = 0;
+        params.numOutputChannels = 2;
+        patch.setPlaybackParams (params);
+
+        if (! patch.loadPatch ({ createManifestWithInMemoryFiles (manifestSource, {{ "Test.cmajor", cmajorSource }}), {} }, true))
+        {
+            CHOC_FAIL ("Failed to load patch");
+            return false;
+        }
+
+        CHOC_EXPECT_TRUE (patch.canChangeSampleRateWithoutRebuilding());
+
+        std::array<std::array<float, 4>, 2> buffer {};
+        std::array<float*, 2> buffers { { buffer[0].data(), buffer[1].data() } };
+
+        auto levelID = EndpointID::create (std::string_view ("level"));
+        patch.sendEventOrValueToPatch (levelID, choc::value::Value (5.0f).getView(), 0, 0);
+        patch.process (buffers.data(), 4, [] (auto&&...) {});
+
+        CHOC_EXPECT_NEAR (buffer[0][3], 5.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (buffer[1][3], 100.0f, 0.0001f);
+
+        auto parameterBefore = patch.findParameter (levelID);
+
+        // A rebuild would replace the parameter objects, so finding the same one afterwards
+        // shows that the rate was changed in place. The new performer must render its very
+        // first block with the parameter's current value rather than its default.
+        params.sampleRate = 200;
+        patch.setPlaybackParams (params);
+
+        CHOC_EXPECT_TRUE (patch.findParameter (levelID) == parameterBefore);
+        CHOC_EXPECT_NEAR (parameterBefore->currentValue, 5.0f, 0.0001f);
+
+        patch.process (buffers.data(), 4, [] (auto&&...) {});
+
+        CHOC_EXPECT_NEAR (buffer[0][0], 5.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (buffer[0][3], 5.0f, 0.0001f);
+        CHOC_EXPECT_NEAR (buffer[1][0], 200.0f, 0.0001f);
+    }
+
+    {
+        CHOC_TEST (AudioMIDIPerformer/TimestampedEvents)
+
+        const auto source = R"(
+            processor Test
+            {
+                input event float32 in;
+                output stream float32 out;
+
+                float32 level;
+
+                event in (float32 f)    { level = f; }
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- level;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+        auto engine = cmaj::Engine::create();
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (32));
+
+        if (! (program.parse (messages, "", source) && engine.load (messages, program, {}, {})))
+        {
+            CHOC_FAIL ("Failed to load!");
+            return false;
+        }
+
+        AudioMIDIPerformer::Builder builder (engine, 4096);
+        builder.connectAudioOutputTo (engine.getOutputEndpoints().endpoints.front(), { 0 }, { 0 }, {});
+
+        if (! engine.link (messages, {}))
+        {
+            CHOC_FAIL ("Failed to link!");
+            return false;
+        }
+
+        auto performer = builder.createPerformer();
+        CHOC_EXPECT_TRUE (performer->prepareToStart());
+
+        // The events should land on their exact frames, even though the second one is
+        // beyond the performer's maximum block size
+        auto inHandle = engine.getEndpointHandle ("in");
+        CHOC_EXPECT_TRUE (performer->postEvent (inHandle, choc::value::createFloat32 (0.5f), 0, 10));
+        CHOC_EXPECT_TRUE (performer->postEvent (inHandle, choc::value::createFloat32 (1.0f), 0, 40));
+
+        std::array<float, 64> outputBackingBuffer {{}};
+        std::array<float*, 1> outputBuffers { { outputBackingBuffer.data() } };
+        std::array<const float*, 1> inputBuffers { { nullptr } };
+
+        performer->process ({ choc::buffer::createChannelArrayView (inputBuffers.data(), 0u, 64u),
+                              choc::buffer::createChannelArrayView (outputBuffers.data(), 1u, 64u),
+                              {}, {} }, true);
+
+        CHOC_EXPECT_EQ (outputBackingBuffer[9], 0.0f);
+        CHOC_EXPECT_EQ (outputBackingBuffer[10], 0.5f);
+        CHOC_EXPECT_EQ (outputBackingBuffer[39], 0.5f);
+        CHOC_EXPECT_EQ (outputBackingBuffer[40], 1.0f);
+        CHOC_EXPECT_EQ (outputBackingBuffer[63], 1.0f);
+        CHOC_EXPECT_EQ (performer->getCurrentFramePosition(), 64u);
+
+        auto stats = performer->getInputQueueStatistics();
+        CHOC_EXPECT_EQ (stats.numItemsPushed, 2u);
+        CHOC_EXPECT_EQ (stats.numItemsDropped, 0u);
+        CHOC_EXPECT_EQ (stats.highWaterMark, 2u);
+    }
+
+    {
+        CHOC_TEST (AudioMIDIPerformer/TimeStampedMIDIOverflow)
+
+        const auto source = R"(
+            processor Test
+            {
+                input event std::midi::Message midiIn;
+                output stream float32 out;
+
+                float32 count;
+
+                event midiIn (std::midi::Message m)    { count += 1.0f; }
+
+                void main()
+                {
+                    loop
+                    {
+                        out <- count;
+                        advance();
+                    }
+                }
+            }
+        )";
+
+        cmaj::Program program;
+        cmaj::DiagnosticMessageList messages;
+        auto engine = cmaj::Engine::create();
+        engine.setBuildSettings (cmaj::BuildSettings().setFrequency (44100.0).setMaxBlockSize (64).setEventBufferSize (8));
+
+        if (! (program.parse (messages, "", source) && engine.load (messages, program, {}, {})))
+        {
+            CHOC_FAIL ("Failed to load!");
+            return false;
+        }
+
+        AudioMIDIPerformer::Builder builder (engine, 4096);
+        builder.connectMIDIInputTo (engine.getInputEndpoints().endpoints.front());
+        builder.connectAudioOutputTo (engine.getOutputEndpoints().endpoints.front(), { 0 }, { 0 }, {});
+
+        if (! engine.link (messages, {}))
+        {
+            CHOC_FAIL ("Failed to link!");
+            return false;
+        }
+
+        auto performer = builder.createPerformer();
+        CHOC_EXPECT_TRUE (performer->prepareToStart());
+
+        // Two messages per frame for the first 50 frames is far more than the event
+        // buffer can hold in one go, so the block has to be split to deliver them all
+        constexpr uint32_t numMessages = 100, numFrames = 64;
+        const uint8_t noteOn[] = { 0x90, 60, 100 };
+
+        std::vector<choc::audio::AudioMIDIBlockDispatcher::MIDIMessage> midiMessages;
+        std::vector<int> midiMessageTimes;
+
+        for (uint32_t i = 0; i < numMessages; ++i)
+        {
+            midiMessages.push_back ({ {}, {}, choc::midi::MessageView (noteOn, sizeof (noteOn)) });
+            midiMessageTimes.push_back (static_cast<int> (i / 2));
+        }
+
+        std::array<float, numFrames> outputBackingBuffer {{}};
+        std::array<float*, 1> outputBuffers { { outputBackingBuffer.data() } };
+        std::array<const float*, 1> inputBuffers { { nullptr } };
+
+        CHOC_EXPECT_TRUE (performer->processWithTimeStampedMIDI (choc::buffer::createChannelArrayView (inputBuffers.data(), 0u, numFrames),
+                                                                 choc::buffer::createChannelArrayView (outputBuffers.data(), 1u, numFrames),
+                                                                 midiMessages.data(), midiMessageTimes.data(), numMessages, {}, true));
+
+        for (uint32_t frame = 0; frame < numFrames; ++frame)
+            CHOC_EXPECT_EQ (outputBackingBuffer[frame], static_cast<float> (std::min (2 * (frame + 1), numMessages)));
+
+        CHOC_EXPECT_EQ (performer->getCurrentFramePosition(), static_cast<uint64_t> (numFrames));
+    }
+
+    {
+        CHOC_TEST (TimestampedEventQueue/MultipleProducers)
+
+        constexpr uint32_t numThreads = 4, numItemsPerThread = 20000;
+
+        TimestampedEventQueue queue;
+        queue.reset (64, sizeof (uint32_t));
+
+        std::vector<std::thread> producers;
+
+        for (uint32_t t = 0; t < numThreads; ++t)
+        {
+            producers.emplace_back ([&queue, t]
+            {
+                for (uint32_t i = 0; i < numItemsPerThread; ++i)
+                {
+                    queue.push (10000, [&] (TimestampedEventQueue::Item& item, void* payload)
+                    {
+                        item.endpoint = t;
+                        item.dataSize = sizeof (i);
+                        std::memcpy (payload, std::addressof (i), sizeof (i));
+                        return true;
+                    });
+                }
+            });
+        }
+
+        std::vector<uint32_t> nextExpectedItem (numThreads);
+        uint32_t numReceived = 0;
+        bool allInOrder = true;
+
+        for (auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds (20);
+             numReceived < numThreads * numItemsPerThread && std::chrono::steady_clock::now() < deadline;)
+        {
+            if (auto item = queue.peek())
+            {
+                uint32_t value;
+                std::memcpy (std::addressof (value), queue.getPeekedPayload(), sizeof (value));
+                allInOrder = allInOrder && value == nextExpectedItem[item->endpoint]++;
+                ++numReceived;
+                queue.pop();
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        for (auto& t : producers)
+            t.join();
+
+        CHOC_EXPECT_TRUE (allInOrder);
+        CHOC_EXPECT_EQ (numReceived, numThreads * numItemsPerThread);
+
+        auto stats = queue.getStatistics();
+        CHOC_EXPECT_EQ (stats.numItemsPushed, static_cast<uint64_t> (numThreads * numItemsPerThread));
+        CHOC_EXPECT_EQ (stats.numItemsDropped, 0u);
+        CHOC_EXPECT_TRUE (stats.highWaterMark <= stats.capacity);
+    }
+
+    {
+        CHOC_TEST (AudioLevelStatistics/PackedAndStridedData)
+
+        // The first two channels of a three-channel buffer have a stride that doesn't match their
+        // channel count, so they take the non-vectorised path, which the results are compared to.
+        choc::buffer::InterleavedBuffer<float> source (3, 1001);
+        uint32_t seed = 1;
+
+        for (uint32_t frame = 0; frame < source.getNumFrames(); ++frame)
+        {
+            for (uint32_t chan = 0; chan < 3; ++chan)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                source.getSample (chan, frame) = static_cast<float> (seed >> 8) / static_cast<float> (1u << 24) * 2.0f - 1.0f;
+            }
+        }
+
+        choc::buffer::InterleavedBuffer<float> packed (2, source.getNumFrames());
+        copy (packed, source.getView().getChannelRange ({ 0, 2 }));
+
+        AudioLevelStatistics strided (2), whole (2), sections (2), section (2);
+        strided.add (source.getView().getChannelRange ({ 0, 2 }));
+        whole.add (packed.getView());
+
+        for (uint32_t start = 0; start < packed.getNumFrames(); start += 37)
+        {
+            section.clear();
+            section.add (packed.getView().getFrameRange ({ start, std::min (start + 37, packed.getNumFrames()) }));
+            sections.add (section);
+        }
+
+        CHOC_EXPECT_EQ (whole.numFrames, 1001u);
+        CHOC_EXPECT_EQ (sections.numFrames, 1001u);
+
+        for (uint32_t chan = 0; chan < 2; ++chan)
+        {
+            CHOC_EXPECT_EQ (whole.mins[chan], strided.mins[chan]);
+            CHOC_EXPECT_EQ (whole.maxs[chan], strided.maxs[chan]);
+            CHOC_EXPECT_EQ (sections.mins[chan], strided.mins[chan]);
+            CHOC_EXPECT_EQ (sections.maxs[chan], strided.maxs[chan]);
+            CHOC_EXPECT_NEAR (whole.getRMS (chan), strided.getRMS (chan), 0.0001f);
+            CHOC_EXPECT_NEAR (sections.getRMS (chan), strided.getRMS (chan), 0.0001f);
+        }
+    }
+
+    {
+        CHOC_TEST (BinaryViewMessage/RoundTrip)
+
+        // Decodes a frame in the same way as decodeBinaryMessage() in cmaj-binary-messages.js,
+        // which reads the header fields as little-endian
+        struct DecodedFrame
+        {
+            bool isValid = false;
+            uint32_t contentType = 0, numRows = 0, rowLength = 0;
+            std::string type;
+            std::vector<float> values;
+        };
+
+        auto decode = [] (const std::vector<char>& frame)
+        {
+            DecodedFrame result;
+
+            if (frame.size() < BinaryViewMessage::headerSize)
+                return result;
+
+            auto d = reinterpret_cast<const uint8_t*> (frame.data());
+            auto typeLength = static_cast<size_t> (d[1]);
+            auto dataStart = BinaryViewMessage::headerSize + ((typeLength + 3u) & ~static_cast<size_t> (3));
+
+            result.contentType = d[0];
+            result.numRows = static_cast<uint32_t> (d[2]) | (static_cast<uint32_t> (d[3]) << 8);
+            result.rowLength = static_cast<uint32_t> (d[4]) | (static_cast<uint32_t> (d[5]) << 8)
+                                | (static_cast<uint32_t> (d[6]) << 16) | (static_cast<uint32_t> (d[7]) << 24);
+
+            // A Float32Array needs its data to start on a 4-byte boundary
+            if (dataStart % 4 != 0 || frame.size() != dataStart + sizeof (float) * result.numRows * result.rowLength)
+                return result;
+
+            result.type = std::string (frame.data() + BinaryViewMessage::headerSize, typeLength);
+            result.values.resize (result.numRows * result.rowLength);
+            memcpy (result.values.data(), frame.data() + dataStart, sizeof (float) * result.values.size());
+            result.isValid = true;
+            return result;
+        };
+
+        struct TestCase
+        {
+            BinaryViewMessage::ContentType contentType;
+            uint32_t numRows, rowLength;
+        };
+
+        const TestCase testCases[] =
+        {
+            { BinaryViewMessage::ContentType::audioMinMax,     3, 2 },
+            { BinaryViewMessage::ContentType::audioFullData,   2, 5 },
+            { BinaryViewMessage::ContentType::cpuLevel,        1, 1 },
+            { BinaryViewMessage::ContentType::eventFloat,      1, 1 },
+            { BinaryViewMessage::ContentType::eventFloatArray, 1, 7 }
+        };
+
+        std::vector<char> frame;
+
+        for (auto& testCase : testCases)
+        {
+            // Types of every length up to the maximum, to check the padding
+            for (size_t typeLength : { 0u, 1u, 2u, 3u, 4u, 5u, 8u, 255u })
+            {
+                auto type = std::string (typeLength, 'x');
+
+                for (size_t i = 0; i < typeLength; ++i)
+                    type[i] = static_cast<char> ('a' + i % 26);
+
+                CHOC_EXPECT_TRUE (BinaryViewMessage::canEncodeType (type));
+
+                auto numValues = testCase.numRows * testCase.rowLength;
+                std::vector<float> values;
+
+                for (uint32_t i = 0; i < numValues; ++i)
+                    values.push_back (static_cast<float> (i) * 0.5f - 3.0f);
+
+                memcpy (BinaryViewMessage::create (frame, testCase.contentType, type, testCase.numRows, testCase.rowLength),
+                        values.data(), sizeof (float) * numValues);
+
+                auto decoded = decode (frame);
+
+                CHOC_EXPECT_TRUE (decoded.isValid);
+                CHOC_EXPECT_EQ (decoded.contentType, static_cast<uint32_t> (testCase.contentType));
+                CHOC_EXPECT_EQ (decoded.type, type);
+                CHOC_EXPECT_EQ (decoded.numRows, testCase.numRows);
+                CHOC_EXPECT_EQ (decoded.rowLength, testCase.rowLength);
+                CHOC_EXPECT_TRUE (decoded.values == values);
+
+                // The text form that the server sends must decode to the same frame
+                auto text = BinaryViewMessage::toText (frame.data(), frame.size());
+                CHOC_EXPECT_EQ (text[0], BinaryViewMessage::textPrefix);
+
+                std::vector<char> decodedText;
+                CHOC_EXPECT_TRUE (choc::base64::decodeToContainer (decodedText, std::string_view (text).substr (1)));
+                CHOC_EXPECT_TRUE (decodedText == frame);
+            }
+        }
+
+        CHOC_EXPECT_FALSE (BinaryViewMessage::canEncodeType (std::string (256, 'x')));
+    }
+
+    {
+        CHOC_TEST (InMemoryCacheDatabase/SizeLimit)
+
+        InMemoryCacheDatabase cache (100);
+        const std::array<char, 40> data {{}};
+
+        cache.store ("a", data.data(), 40);
+        cache.store ("b", data.data(), 40);
+
+        // Reloading "a" makes "b" the least recently used, so that's the one to go
+        CHOC_EXPECT_EQ (cache.reload ("a", nullptr, 0), 40u);
+        cache.store ("c", data.data(), 40);
+
+        CHOC_EXPECT_EQ (cache.getNumEntries(), size_t (2));
+        CHOC_EXPECT_EQ (cache.getTotalSize(), 80u);
+        CHOC_EXPECT_EQ (cache.reload ("a", nullptr, 0), 40u);
+        CHOC_EXPECT_EQ (cache.reload ("b", nullptr, 0), 0u);
+        CHOC_EXPECT_EQ (cache.reload ("c", nullptr, 0), 40u);
+
+        // Replacing an entry frees its old data first, and anything bigger than the
+        // whole limit isn't kept at all
+        cache.store ("a", data.data(), 10);
+        CHOC_EXPECT_EQ (cache.getTotalSize(), 50u);
+
+        std::vector<char> tooBig (101);
+        cache.store ("d", tooBig.data(), tooBig.size());
+        CHOC_EXPECT_EQ (cache.reload ("d", nullptr, 0), 0u);
+        CHOC_EXPECT_EQ (cache.getNumEntries(), size_t (2));
+
+        cache.clear();
+        CHOC_EXPECT_EQ (cache.getNumEntries(), size_t (0));
+        CHOC_EXPECT_EQ (cache.getTotalSize(), 0u);
+    }
+
     return progress.numFails == 0;
 }
 